@@ -0,0 +1,261 @@
+//===--- ConfigMirror.h --------------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_CONFIG_MIRROR_INCLUDED
+#define REGISTRY_CONFIG_MIRROR_INCLUDED
+
+#include "Registry/RegistryApi.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "Registry/RegistryName.h"
+#include "Registry/RegistryValue.h"
+#include "Registry/RegistryValueCache.h"
+
+#pragma warning(push)
+#pragma warning(disable : 4251)
+
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// Immutable key of a ConfigMirror tree.
+    ///
+    /// A node never changes once published: a change of the source builds new nodes, and shares the
+    /// unchanged subtrees with the previous tree. Lookups neither lock nor allocate.
+    ///
+    class REGISTRY_API ConfigNode
+    {
+        friend class ConfigMirror;
+
+    public:
+        /// Values, by name
+        using Values = std::map<std::string, RegistryValue, Name::Less>;
+        /// Subkeys, by name
+        using SubKeys = std::map<std::string, std::shared_ptr<const ConfigNode>, Name::Less>;
+
+    public:
+        ///
+        /// Initialize an empty node.
+        ///
+        ConfigNode();
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Path of the key, relative to the root of the source
+        const std::string& GetPath() const noexcept;
+
+        /// Last write time of the key, when it was read
+        ULONGLONG GetLastWriteTime() const noexcept;
+
+        /// Values, by name
+        const Values& GetValues() const noexcept;
+
+        /// Subkeys, by name
+        const SubKeys& GetSubKeys() const noexcept;
+
+        //
+        // Getters
+        //
+
+    public:
+        /// Find a subkey by name or path, or return null if it doesn't exist
+        const ConfigNode* FindSubKey(std::string_view subkey) const noexcept;
+
+        /// Find a value, or return null if it doesn't exist
+        const RegistryValue* FindValue(std::string_view valueName) const noexcept;
+
+        /// Does the key hold the value?
+        bool HasValue(std::string_view valueName) const noexcept;
+
+        ///
+        /// Get a value.
+        ///
+        /// @exception RegistryException The value doesn't exist (ERROR_FILE_NOT_FOUND).
+        ///
+        const RegistryValue& GetValue(std::string_view valueName) const;
+
+
+    private:
+        /// Path of the key
+        std::string _path;
+        /// Last write time of the key
+        ULONGLONG _lastWriteTime = 0;
+        /// Values, shared with the previous node while the key doesn't change
+        std::shared_ptr<const Values> _values;
+        /// Subkeys
+        SubKeys _subkeys;
+    };
+
+
+    ///
+    /// Read-mostly mirror of a key subtree, for readers that can afford neither a registry call nor a lock.
+    ///
+    /// The subtree is materialized into an immutable tree of ConfigNode, published through an atomic shared
+    /// pointer: a reader takes a consistent snapshot with a single atomic load and keeps it as long as it
+    /// needs. Refresh, called directly or by the background thread, checks the last write time of every key
+    /// and reads again only the keys that changed; unchanged subtrees are shared with the previous tree.
+    ///
+    /// The background thread asks the source to notify the changes of the subtree, and refreshes only after a
+    /// notification; it refreshes at every interval when the source cannot notify.
+    ///
+    /// The atomic load of a shared pointer is lock-free when the standard library makes it so; otherwise it
+    /// takes a short internal spin lock, but never waits for a refresh.
+    ///
+    class REGISTRY_API ConfigMirror
+    {
+
+    public:
+        /// Refresh metrics
+        struct Statistics {
+            /// Number of refreshes
+            unsigned long long refreshes = 0;
+            /// Number of new trees published
+            unsigned long long publications = 0;
+            /// Number of refreshes that failed
+            unsigned long long failures = 0;
+            /// Number of keys whose last write time was checked
+            unsigned long long keysChecked = 0;
+            /// Number of keys read again
+            unsigned long long keysRead = 0;
+            /// Number of keys shared with the previous tree
+            unsigned long long keysReused = 0;
+            /// Number of background refreshes skipped, the source notifying no change
+            unsigned long long refreshesSkipped = 0;
+            /// Error of the last failed refresh
+            LONG lastError = ERROR_SUCCESS;
+        };
+
+    public:
+        ///
+        /// Mirror the source, reading it once.
+        ///
+        /// @param source Source of the keys, not owned: it must outlive the mirror. Only one refresh uses it at a time.
+        /// @param keyName Path to the root of the subtree, relative to the root of the source.
+        ///
+        /// @exception RegistryException
+        ///
+        explicit ConfigMirror(RegistryCacheSource& source, const std::string& keyName = std::string());
+
+        /// Stop the background thread, and close the change event
+        ~ConfigMirror() noexcept;
+
+        /// Non copyable
+        ConfigMirror(const ConfigMirror&) = delete;
+
+        /// Non copyable
+        ConfigMirror& operator=(const ConfigMirror&) = delete;
+
+        //
+        // Accessor
+        //
+
+    public:
+        ///
+        /// Get the current tree.
+        ///
+        /// @return The root of the tree, or null if the root key doesn't exist.
+        ///
+        std::shared_ptr<const ConfigNode> Snapshot() const noexcept;
+
+        /// Number of trees published, the first one included
+        unsigned long long GetVersion() const noexcept;
+
+        /// Refresh metrics
+        Statistics GetStatistics() const;
+
+        //
+        // Operations
+        //
+
+    public:
+        ///
+        /// Read again the keys that changed, and publish the new tree if any.
+        ///
+        /// @return true if a new tree was published.
+        ///
+        /// @exception RegistryException
+        ///
+        bool Refresh();
+
+        ///
+        /// Start the background thread, refreshing the tree at each interval if the source notified a change.
+        /// The errors of the refreshes are counted in the metrics.
+        ///
+        void Start(std::chrono::milliseconds interval);
+
+        /// Stop the background thread; safe to call from several threads at once
+        void Stop() noexcept;
+
+        //
+        // Internal Operations
+        //
+
+    private:
+        /// Rebuild a subtree, sharing the unchanged nodes with the previous one; null if the key doesn't exist
+        std::shared_ptr<const ConfigNode> Rebuild(const std::string& path, const std::shared_ptr<const ConfigNode>& previous, Statistics& statistics);
+
+        /// Ask the source to signal the change event; false if it cannot
+        bool Watch();
+
+        /// Background thread loop
+        void Run(std::chrono::milliseconds interval);
+
+
+    private:
+        /// Source of the keys, not owned
+        RegistryCacheSource& _source;
+        /// Path to the root of the subtree
+        const std::string _path;
+        /// Current tree, read and written with the atomic shared_ptr functions
+        std::shared_ptr<const ConfigNode> _root;
+        /// Number of trees published
+        std::atomic<unsigned long long> _version {0};
+        /// Serializes the refreshes
+        std::mutex _refreshMutex;
+        /// Serializes Start and Stop
+        std::mutex _controlMutex;
+        /// Guards the metrics and the stop flag
+        mutable std::mutex _mutex;
+        /// Signaled when stop is requested
+        std::condition_variable _stopRequested;
+        /// Metrics
+        Statistics _statistics;
+        /// Signaled by the source when the subtree changes; null if it couldn't be created
+        HANDLE _hChanged = nullptr;
+        /// Background thread
+        std::thread _worker;
+        /// Tells if the background thread must stop
+        bool _stop = false;
+    };
+
+
+} // namespace registry
+} // namespace abscodes
+
+#pragma warning(pop)
+
+#endif // REGISTRY_CONFIG_MIRROR_INCLUDED
@@ -0,0 +1,287 @@
+//===--- LayeredKey.h ----------------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_LAYERED_KEY_INCLUDED
+#define REGISTRY_LAYERED_KEY_INCLUDED
+
+#include "Registry/RegistryApi.h"
+
+#include <atomic>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Registry/RegistryKey.h"
+#include "Registry/RegistryName.h"
+#include "Registry/RegistryValue.h"
+
+#pragma warning(push)
+#pragma warning(disable : 4251)
+
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// Ordered list of registry keys read as one, e.g. policies, then user, then machine defaults.
+    ///
+    /// A value is read from the first layer that holds it. The answer, or its absence from all the layers,
+    /// is cached with the layer that gave it: a cached lookup costs one hash probe instead of one failed
+    /// registry call per layer.
+    ///
+    /// Each layer is watched with RegNotifyChangeKeyValue. A change of a layer invalidates the cached answers
+    /// of that layer and of the layers after it, not those of the layers before it. The notifications are
+    /// asynchronous: a lookup may return the previous answer for a short while after a change.
+    ///
+    /// A layer is a subkey of a parent key, and the subtree of the parent is watched too: a layer that doesn't
+    /// exist yet, e.g. a policy key, is opened once created, and a deleted layer is absent until created again.
+    ///
+    /// Lookups can be concurrent.
+    ///
+    class REGISTRY_API LayeredKey
+    {
+
+    public:
+        /// No layer
+        static constexpr size_t npos = static_cast<size_t>(-1);
+
+        /// Cache metrics
+        struct Statistics {
+            /// Number of lookups answered by the cache
+            unsigned long long hits = 0;
+            /// Number of lookups that read the layers
+            unsigned long long misses = 0;
+            /// Number of layer reads by the misses
+            unsigned long long probes = 0;
+            /// Number of layer changes, notified or forced
+            unsigned long long invalidations = 0;
+        };
+
+        /// Where a layer is
+        struct Source {
+            /// Parent key, watched for the creation and the deletion of the layer
+            RegistryKey parent;
+            /// Path to the layer under the parent, e.g. "Software\\Policies\\Application"
+            std::string subkey;
+        };
+
+    public:
+        ///
+        /// Merge layers, the first one taking precedence.
+        ///
+        /// A layer whose parent is invalid is skipped. A layer that cannot be watched, e.g. under a parent
+        /// opened without KEY_NOTIFY access, is read, or opened if missing, at each lookup that reaches it.
+        ///
+        /// @param layers Parents and paths of the layers; the parents are owned by the layered key.
+        ///
+        /// @exception std::invalid_argument The path of a layer is empty.
+        ///
+        explicit LayeredKey(std::vector<Source> layers);
+
+        /// Stop watching the layers
+        ~LayeredKey() noexcept;
+
+        /// Non copyable
+        LayeredKey(const LayeredKey&) = delete;
+
+        /// Non copyable
+        LayeredKey& operator=(const LayeredKey&) = delete;
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Number of layers
+        size_t GetLayerCount() const noexcept;
+
+        /// Does the key of the layer exist, as last opened?
+        bool IsPresent(size_t layer) const;
+
+        /// Is the layer watched for changes, with its parent?
+        bool IsWatched(size_t layer) const;
+
+        /// Cache metrics
+        Statistics GetStatistics() const noexcept;
+
+        //
+        // Getters
+        //
+
+    public:
+        ///
+        /// Find the layer holding a value.
+        ///
+        /// @return The index of the first layer holding the value, or npos if none does.
+        ///
+        /// @exception RegistryException
+        ///
+        size_t FindLayer(const std::string& valueName) const;
+
+        /// Does a layer hold the value?
+        bool HasValue(const std::string& valueName) const;
+
+        ///
+        /// Get a value from the first layer holding it.
+        ///
+        /// @exception RegistryException No layer holds the value (ERROR_FILE_NOT_FOUND).
+        ///
+        RegistryValue GetValue(const std::string& valueName) const;
+
+        ///
+        /// Get a value from the first layer holding it, or a default value if none does.
+        ///
+        /// @exception RegistryException
+        ///
+        RegistryValue GetValue(const std::string& valueName, const RegistryValue& defaultValue) const;
+
+        ///
+        /// Get a REG_DWORD value from the first layer holding it, or a default value if none does.
+        ///
+        /// @exception RegistryException The value has another type.
+        ///
+        DWORD GetDwordValue(const std::string& valueName, DWORD defaultValue) const;
+
+        ///
+        /// Get a REG_SZ value from the first layer holding it, or a default value if none does.
+        ///
+        /// @exception RegistryException The value has another type.
+        ///
+        std::string GetStringValue(const std::string& valueName, const std::string& defaultValue) const;
+
+        ///
+        /// Enumerate the values of all the layers, each name once with the type of the first layer holding it.
+        /// The names are in the order of the layers, then of the enumeration.
+        ///
+        /// @exception RegistryException
+        ///
+        std::vector<std::pair<std::string, RegistryValueType>> EnumValues() const;
+
+        ///
+        /// Enumerate the subkeys of all the layers, each name once.
+        ///
+        /// @exception RegistryException
+        ///
+        std::vector<std::string> EnumSubKeys() const;
+
+        //
+        // Operations
+        //
+
+    public:
+        /// Invalidate the cached answers of a layer and of the layers after it, as a change notification does
+        void Invalidate(size_t layer);
+
+        /// Invalidate all the cached answers
+        void Invalidate();
+
+        //
+        // Internal Operations
+        //
+
+    private:
+        /// Layer and its change notifications
+        struct Layer {
+            /// Parent key
+            RegistryKey parent;
+            /// Path to the layer under the parent
+            std::string subkey;
+            /// Key of the layer, invalid while it doesn't exist
+            RegistryKey key;
+            /// Guards key: the lookups read it, the notifications open it again
+            mutable std::shared_mutex keyMutex;
+            /// Index of the layer
+            size_t index = 0;
+            /// Owner of the layer
+            LayeredKey* owner = nullptr;
+            /// Event signaled by RegNotifyChangeKeyValue on the key
+            HANDLE hEvent = nullptr;
+            /// Wait registered on the event of the key
+            HANDLE hWait = nullptr;
+            /// Event signaled by RegNotifyChangeKeyValue on the subtree of the parent
+            HANDLE hParentEvent = nullptr;
+            /// Wait registered on the event of the parent
+            HANDLE hParentWait = nullptr;
+            /// Epoch of the last change of this layer or of a layer before it
+            std::atomic<unsigned long long> stamp {0};
+        };
+
+        /// Cached answer
+        struct Entry {
+            /// Value, empty if no layer holds it
+            RegistryValue value;
+            /// Layer holding the value, or npos
+            size_t layer = npos;
+            /// Epoch when the layers were read
+            unsigned long long epoch = 0;
+        };
+
+        /// Look a value up, from the cache or the layers
+        Entry Lookup(const std::string& valueName) const;
+
+        ///
+        /// Read the key of a layer, opening it first if the layer is not watched.
+        ///
+        /// @return false if the layer is missing, or was deleted: the layer is then invalidated.
+        ///
+        template <typename Read>
+        bool ReadLayer(Layer& layer, Read&& read) const;
+
+        /// Open the key of a layer again, if it is missing or deleted; true if the key of the layer changed
+        bool Reopen(Layer& layer) const noexcept;
+
+        /// Forget a deleted key of a layer, unless it was opened again since
+        void Forget(Layer& layer, HKEY hKey) const noexcept;
+
+        /// Watch a layer and its parent, or mark it as never cached
+        void Watch(Layer& layer) noexcept;
+
+        /// Mark a layer and the layers after it as never cached
+        void Unwatch(Layer& layer) const noexcept;
+
+        /// Move the stamps of a layer and of the layers after it to a new epoch
+        void Changed(size_t layer) const noexcept;
+
+        /// Called by the thread pool when the values of a layer change
+        static void CALLBACK OnLayerChanged(PVOID context, BOOLEAN timedOut) noexcept;
+
+        /// Called by the thread pool when a key is created or deleted under the parent of a layer
+        static void CALLBACK OnParentChanged(PVOID context, BOOLEAN timedOut) noexcept;
+
+
+    private:
+        /// Layers, by precedence; their addresses are given to the thread pool
+        std::vector<std::unique_ptr<Layer>> _layers;
+        /// Epoch, moved by each change
+        mutable std::atomic<unsigned long long> _epoch {0};
+        /// Guards the cached answers
+        mutable std::shared_mutex _mutex;
+        /// Cached answers, by value name
+        mutable std::unordered_map<std::string, Entry, Name::Hasher, Name::EqualTo> _entries;
+        /// Metrics
+        mutable std::atomic<unsigned long long> _hits {0};
+        mutable std::atomic<unsigned long long> _misses {0};
+        mutable std::atomic<unsigned long long> _probes {0};
+        mutable std::atomic<unsigned long long> _invalidations {0};
+    };
+
+
+} // namespace registry
+} // namespace abscodes
+
+#pragma warning(pop)
+
+#endif // REGISTRY_LAYERED_KEY_INCLUDED
@@ -0,0 +1,155 @@
+//===--- LazyRegistryKey.h -----------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_LAZY_KEY_INCLUDED
+#define REGISTRY_LAZY_KEY_INCLUDED
+
+#include "Registry/RegistryApi.h"
+
+#include <string>
+
+#include "Registry/RegistryAccessRights.h"
+#include "Registry/RegistryHive.h"
+#include "Registry/RegistryKey.h"
+#include "Registry/RegistryOption.h"
+#include "Registry/RegistryView.h"
+
+#pragma warning(push)
+#pragma warning(disable : 4251)
+
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// Registry key which only records its hive, view and path, and opens its handle on first use.
+    ///
+    /// Chained OpenSubKey and CreateSubKey calls don't touch the registry: they extend the path, and the
+    /// whole chain is folded into one open (or one create) of the full path when the key is first accessed.
+    /// The keys up to the last CreateSubKey of a chain are created, the missing intermediate keys included;
+    /// the keys chained after it with OpenSubKey are only opened, from the created one.
+    ///
+    class REGISTRY_API LazyRegistryKey
+    {
+
+    public:
+        ///
+        /// Initialize a lazy key on the root of a hive.
+        ///
+        /// @param hive A registry hive.
+        /// @param view A scpecific registry view
+        /// @param desiredAccess Access rights, default to all access.
+        ///
+        explicit LazyRegistryKey(RegistryHive hive,
+                                 RegistryView view = RegistryView::Default,
+                                 RegistryAccessRights desiredAccess = RegistryAccessRights::AllAccess) noexcept;
+
+        /// Take over the input key, opened or not
+        LazyRegistryKey(LazyRegistryKey&& other) noexcept = default;
+
+        /// Move-assign from the input key, closing the current handle
+        LazyRegistryKey& operator=(LazyRegistryKey&& other) noexcept = default;
+
+        /// Non copyable
+        LazyRegistryKey(const LazyRegistryKey&) = delete;
+
+        /// Non copyable
+        LazyRegistryKey& operator=(const LazyRegistryKey&) = delete;
+
+    private:
+        /// Internal constructor, for a subkey
+        LazyRegistryKey(const LazyRegistryKey& parent, std::string path, size_t created);
+
+        //
+        // Properties
+        //
+
+    public:
+        /// Has the handle been opened yet?
+        bool IsOpen() const noexcept;
+
+        //
+        // Accessor
+        //
+
+    public:
+        ///
+        RegistryHive GetHive() const noexcept;
+
+        ///
+        RegistryView GetView() const noexcept;
+
+        ///
+        RegistryAccessRights GetAccessRights() const noexcept;
+
+        /// Path of the key, relative to the hive
+        const std::string& GetName() const noexcept;
+
+        /// Access the key, opening it if needed
+        RegistryKey& operator*();
+
+        /// Access the key, opening it if needed
+        RegistryKey* operator->();
+
+        //
+        // Operations
+        //
+
+    public:
+        ///
+        /// Describe a subkey to create or open on first use. Doesn't access the registry.
+        ///
+        /// @param subkey Name or path to subkey.
+        ///
+        LazyRegistryKey CreateSubKey(const std::string& subkey) const;
+
+        ///
+        /// Describe a subkey to open on first use. Doesn't access the registry.
+        ///
+        /// @param subkey Name or path to subkey.
+        ///
+        LazyRegistryKey OpenSubKey(const std::string& subkey) const;
+
+        ///
+        /// Open the key now, if not opened yet.
+        ///
+        /// @exception RegistryException
+        ///
+        RegistryKey& Open();
+
+        /// Close the handle; the next access opens it again
+        void Close() noexcept;
+
+
+    private:
+        ///
+        RegistryHive _hive;
+        ///
+        RegistryView _view;
+        ///
+        RegistryAccessRights _access;
+        /// Full path, relative to the hive
+        std::string _path;
+        /// Length of the prefix of the path created on open; the rest is only opened
+        size_t _created = 0;
+        /// The key, once opened
+        RegistryKey _key;
+    };
+
+
+} // namespace registry
+} // namespace abscodes
+
+#pragma warning(pop)
+
+#endif // REGISTRY_LAZY_KEY_INCLUDED
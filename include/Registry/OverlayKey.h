@@ -0,0 +1,231 @@
+//===--- OverlayKey.h ----------------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_OVERLAY_KEY_INCLUDED
+#define REGISTRY_OVERLAY_KEY_INCLUDED
+
+#include "Registry/RegistryApi.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Registry/RegistryKey.h"
+#include "Registry/RegistryName.h"
+#include "Registry/RegistryValue.h"
+#include "Registry/RegistryValueCache.h"
+#include "Registry/RegistryWriteBatch.h"
+
+#pragma warning(push)
+#pragma warning(disable : 4251)
+
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// Private writable layer over a read-only base, e.g. for application virtualization or test isolation.
+    ///
+    /// Reads fall through to the base. Writes and deletions go to a delta, never to the base: a deleted value
+    /// or key is recorded as a tombstone hiding the base. The delta is a tree of the changed keys, one node
+    /// per name, so that changed keys share the nodes of their common parents: an overlay costs memory for its
+    /// changes only, whatever the size of the base.
+    ///
+    /// The delta can be exported to a RegistryWriteBatch, committed to a registry key, or discarded.
+    ///
+    /// The base is any RegistryCacheSource: RegistryKeyCacheSource for a registry key, MemoryCacheSource for
+    /// a base kept in memory.
+    ///
+    class REGISTRY_API OverlayKey
+    {
+
+    public:
+        ///
+        /// Initialize an overlay without change.
+        ///
+        /// @param base Base to read, not owned: it must outlive the overlay. The overlay never writes it.
+        ///
+        explicit OverlayKey(RegistryCacheSource& base);
+
+        /// Non copyable
+        OverlayKey(const OverlayKey&) = delete;
+
+        /// Non copyable
+        OverlayKey& operator=(const OverlayKey&) = delete;
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Does the delta hold no change?
+        bool IsEmpty() const noexcept;
+
+        /// Number of keys in the delta, the root included
+        size_t GetNodeCount() const;
+
+        /// Number of values written or deleted in the delta
+        size_t GetValueCount() const;
+
+        //
+        // Getters
+        //
+
+    public:
+        /// Does the key exist, in the delta or in the base? The root always exists.
+        bool KeyExists(const std::string& keyName);
+
+        /// Does the key hold the value?
+        bool HasValue(const std::string& keyName, const std::string& valueName);
+
+        ///
+        /// Get a value, from the delta or from the base.
+        ///
+        /// @exception RegistryException The key or the value doesn't exist (ERROR_FILE_NOT_FOUND).
+        ///
+        RegistryValue GetValue(const std::string& keyName, const std::string& valueName);
+
+        ///
+        /// Read all the values of a key, from the delta and from the base.
+        ///
+        /// @return The values, sorted by name; none if the key doesn't exist.
+        ///
+        std::vector<std::pair<std::string, RegistryValue>> ReadKey(const std::string& keyName);
+
+        ///
+        /// Enumerate the direct subkeys of a key, from the delta and from the base.
+        ///
+        /// @return The names, sorted; none if the key doesn't exist.
+        ///
+        std::vector<std::string> EnumSubKeys(const std::string& keyName);
+
+        //
+        // Operations
+        //
+
+    public:
+        /// Create a key and its parents, if needed
+        void CreateKey(const std::string& keyName);
+
+        ///
+        /// Delete a key and its subkeys.
+        ///
+        /// @exception std::invalid_argument The key is the root.
+        /// @exception RegistryException The key doesn't exist (ERROR_FILE_NOT_FOUND).
+        ///
+        void DeleteKey(const std::string& keyName);
+
+        ///
+        /// Write a value, creating its key and its parents if needed.
+        ///
+        /// @exception std::invalid_argument The value is empty (REG_NONE).
+        ///
+        void SetValue(const std::string& keyName, const std::string& valueName, const RegistryValue& value);
+
+        ///
+        /// Delete a value.
+        ///
+        /// @exception RegistryException The key or the value doesn't exist (ERROR_FILE_NOT_FOUND).
+        ///
+        void DeleteValue(const std::string& keyName, const std::string& valueName);
+
+        ///
+        /// Queue the changes of the delta into a batch, the keys relative to the root of the base.
+        ///
+        /// A batch writes values only: the values of the base under a deleted key are deleted, and a created key
+        /// without value is not created. Commit applies the key changes too.
+        ///
+        /// @exception RegistryException
+        ///
+        void Export(RegistryWriteBatch& batch);
+
+        ///
+        /// Apply the changes of the delta under a registry key, e.g. the root of the base, then discard them.
+        ///
+        /// Deleted keys are deleted and created keys are created, parents first, then the values are written
+        /// through a RegistryWriteBatch. A failure does not stop the commit, but keeps the whole delta: every
+        /// operation can be applied again, so the commit can be retried.
+        ///
+        /// @return The operations that could not be applied.
+        ///
+        std::vector<RegistryWriteBatch::Failure> Commit(RegistryKey& root);
+
+        /// Discard the changes of the delta
+        void Discard() noexcept;
+
+        //
+        // Internal Operations
+        //
+
+    private:
+        /// A key of the delta
+        struct Node {
+            /// Changed subkeys, by name
+            std::map<std::string, std::unique_ptr<Node>, Name::Less> subkeys;
+            /// Written values, by name; an empty value is a tombstone
+            std::map<std::string, RegistryValue, Name::Less> values;
+            /// The key exists in the delta
+            bool created = false;
+            /// The key and its subkeys are hidden in the base: a tombstone
+            bool opaque = false;
+        };
+
+        /// Position of a key, as found by Find
+        struct Location {
+            /// Node of the key, null if the delta doesn't hold it
+            Node* node = nullptr;
+            /// Path of the key, normalized
+            std::string path;
+            /// Is the base visible at the key, i.e. no tombstone on the key or its parents?
+            bool baseVisible = true;
+        };
+
+        /// Find a key in the delta
+        Location Find(const std::string& keyName) const;
+
+        /// Does the found key exist?
+        bool Exists(const Location& location);
+
+        /// Does the key exist in the base?
+        bool BaseExists(const std::string& path);
+
+        /// Read a value of the found key, if it exists
+        bool Read(const Location& location, const std::string& valueName, RegistryValue* value);
+
+        /// Get the node of a key, adding it and its parents to the delta; created marks them as existing
+        Node& Insert(const std::string& path, bool created);
+
+        /// Queue the deletion of the base values of a subtree
+        void ExportDeletion(RegistryWriteBatch& batch, const std::string& path);
+
+        /// Visit the nodes, parents first, with the visibility of the base at their parent
+        template <typename Visitor>
+        static void Walk(const Node& node, const std::string& path, bool baseVisible, Visitor& visitor);
+
+
+    private:
+        /// Base, not owned
+        RegistryCacheSource& _base;
+        /// Root of the delta
+        std::unique_ptr<Node> _root;
+    };
+
+
+} // namespace registry
+} // namespace abscodes
+
+#pragma warning(pop)
+
+#endif // REGISTRY_OVERLAY_KEY_INCLUDED
@@ -17,6 +17,7 @@
 #include "Registry/RegistryApi.h"
 
 #include "Registry/RegistryKey.h"
+#include "Registry/RegistryNumberEncoding.h"
 
 
 namespace abscodes {
@@ -79,7 +80,7 @@ namespace registry {
 	///
 	/// @exception RegistryException
 	///
-	REGISTRY_API RegistryKey GetKey(RegistryKey& key, const std::string& keyName);
+	REGISTRY_API RegistryKey GetKey(const RegistryKey& key, const std::string& keyName);
 
 	///
 	/// Check if the key associated with the specified name, in the specified registry key.
@@ -87,7 +88,7 @@ namespace registry {
 	/// @param key A registry key.
 	/// @param keyName Name or path to the subkey.
 	///
-	REGISTRY_API bool HasKey(RegistryKey& key, const std::string& keyName) noexcept;
+	REGISTRY_API bool HasKey(const RegistryKey& key, const std::string& keyName) noexcept;
 
 	///
 	/// Delete the key with the specified name, in the specified registry key.
@@ -131,7 +132,7 @@ namespace registry {
     ///
     /// @exception RegistryException
     ///
-    REGISTRY_API RegistryValue GetValue(RegistryKey& key, const std::string& keyName, const std::string& valueName);
+    REGISTRY_API RegistryValue GetValue(const RegistryKey& key, const std::string& keyName, const std::string& valueName);
 
 	///
 	/// Retrieves the value associated with the specified name, in the specified registry key.
@@ -142,7 +143,7 @@ namespace registry {
 	///
 	/// @exception RegistryException
 	///
-	REGISTRY_API RegistryValue GetValue(RegistryKey& key, const std::string& valueName);
+	REGISTRY_API RegistryValue GetValue(const RegistryKey& key, const std::string& valueName);
 
 	///
 	/// Check if the value associated with the specified name, in the specified registry key.
@@ -151,23 +152,39 @@ namespace registry {
 	/// @param valueName Name of the value.
 	///
 	///
-	REGISTRY_API bool HasValue(RegistryKey& key, const std::string& valueName) noexcept;
+	REGISTRY_API bool HasValue(const RegistryKey& key, const std::string& valueName) noexcept;
 
 
     /// Retrieves the value associated with the specified name, in the specified registry key.
     /// If the value is not found in the specified key, a default value is returned.
-    REGISTRY_API DWORD GetDWord(RegistryKey& key, const std::string& valueName, DWORD defaultValue) noexcept;
-    REGISTRY_API ULONGLONG GetQWord(RegistryKey& key, const std::string& valueName, ULONGLONG defaultValue) noexcept;
-    REGISTRY_API const std::string GetString(RegistryKey& key, const std::string& valueName, const std::string& defaultValue) noexcept;
-    REGISTRY_API const std::string GetExpandString(RegistryKey& key, const std::string& valueName, const std::string& defaultValue) noexcept;
-    REGISTRY_API const std::vector<std::string> GetMultiString(RegistryKey& key, const std::string& valueName, const std::vector<std::string>& defaultValue) noexcept;
-    REGISTRY_API const std::vector<BYTE> GetBinary(RegistryKey& key, const std::string& valueName, const std::vector<BYTE>& defaultValue) noexcept;
-
-    REGISTRY_API int GetInt(RegistryKey& key, const std::string& valueName, int defaultValue) noexcept;
-    REGISTRY_API unsigned int GetUInt(RegistryKey& key, const std::string& valueName, unsigned int defaultValue) noexcept;
-    REGISTRY_API long GetLong(RegistryKey& key, const std::string& valueName, long defaultValue) noexcept;
-    REGISTRY_API unsigned long GetULong(RegistryKey& key, const std::string& valueName, unsigned long defaultValue) noexcept;
-    REGISTRY_API double GetDouble(RegistryKey& key, const std::string& valueName, double defaultValue) noexcept;
+    REGISTRY_API DWORD GetDWord(const RegistryKey& key, const std::string& valueName, DWORD defaultValue) noexcept;
+    REGISTRY_API ULONGLONG GetQWord(const RegistryKey& key, const std::string& valueName, ULONGLONG defaultValue) noexcept;
+    REGISTRY_API const std::string GetString(const RegistryKey& key, const std::string& valueName, const std::string& defaultValue) noexcept;
+    REGISTRY_API const std::string GetExpandString(const RegistryKey& key, const std::string& valueName, const std::string& defaultValue) noexcept;
+    REGISTRY_API const std::vector<std::string> GetMultiString(const RegistryKey& key, const std::string& valueName, const std::vector<std::string>& defaultValue) noexcept;
+    REGISTRY_API const std::vector<BYTE> GetBinary(const RegistryKey& key, const std::string& valueName, const std::vector<BYTE>& defaultValue) noexcept;
+
+    /// Retrieves the number associated with the specified name, in the specified registry key.
+    /// The number may be stored as text (REG_SZ), or natively: integers as REG_DWORD or REG_QWORD, doubles as an 8-byte REG_BINARY.
+    /// If the value is not found in the specified key, or is not a number of the requested type, a default value is returned.
+    REGISTRY_API int GetInt(const RegistryKey& key, const std::string& valueName, int defaultValue) noexcept;
+    REGISTRY_API unsigned int GetUInt(const RegistryKey& key, const std::string& valueName, unsigned int defaultValue) noexcept;
+    REGISTRY_API long GetLong(const RegistryKey& key, const std::string& valueName, long defaultValue) noexcept;
+    REGISTRY_API unsigned long GetULong(const RegistryKey& key, const std::string& valueName, unsigned long defaultValue) noexcept;
+    REGISTRY_API double GetDouble(const RegistryKey& key, const std::string& valueName, double defaultValue) noexcept;
+
+    /// Retrieves the value associated with the specified name, in the specified registry key,
+    /// as a type mapped at compile time (see RegistryTypeTraits).
+    /// If the value is not found in the specified key, or has another type, a default value is returned.
+    template <typename T>
+    T Get(const RegistryKey& key, const std::string& valueName, const T& defaultValue) noexcept {
+        try {
+            return key.Get<T>(valueName);
+        }
+        catch(...) {
+        }
+        return defaultValue;
+    }
 
 
     ///
@@ -217,11 +234,25 @@ namespace registry {
     REGISTRY_API void SetMultiString(RegistryKey& key, const std::string& valueName, const std::vector<std::string>& value) noexcept;
     REGISTRY_API void SetBinary(RegistryKey& key, const std::string& valueName, const std::vector<BYTE>& value) noexcept;
 
-    REGISTRY_API void SetInt(RegistryKey& key, const std::string& valueName, int value) noexcept;
-    REGISTRY_API void SetUInt(RegistryKey& key, const std::string& valueName, unsigned int value) noexcept;
-    REGISTRY_API void SetLong(RegistryKey& key, const std::string& valueName, long value) noexcept;
-    REGISTRY_API void SetULong(RegistryKey& key, const std::string& valueName, unsigned long value) noexcept;
-    REGISTRY_API void SetDouble(RegistryKey& key, const std::string& valueName, double value) noexcept;
+    /// Sets the specified name/number pair on the specified registry key.
+    /// By default the number is stored as text, the shortest text reading back to the same value for doubles;
+    /// see RegistryNumberEncoding to store it natively.
+    REGISTRY_API void SetInt(RegistryKey& key, const std::string& valueName, int value, RegistryNumberEncoding encoding = RegistryNumberEncoding::Text) noexcept;
+    REGISTRY_API void SetUInt(RegistryKey& key, const std::string& valueName, unsigned int value, RegistryNumberEncoding encoding = RegistryNumberEncoding::Text) noexcept;
+    REGISTRY_API void SetLong(RegistryKey& key, const std::string& valueName, long value, RegistryNumberEncoding encoding = RegistryNumberEncoding::Text) noexcept;
+    REGISTRY_API void SetULong(RegistryKey& key, const std::string& valueName, unsigned long value, RegistryNumberEncoding encoding = RegistryNumberEncoding::Text) noexcept;
+    REGISTRY_API void SetDouble(RegistryKey& key, const std::string& valueName, double value, RegistryNumberEncoding encoding = RegistryNumberEncoding::Text) noexcept;
+
+    /// Sets the specified name/value pair on the specified registry key,
+    /// as the registry type mapped at compile time (see RegistryTypeTraits).
+    template <typename T>
+    void Set(RegistryKey& key, const std::string& valueName, const T& value) noexcept {
+        try {
+            key.Set(valueName, value);
+        }
+        catch(...) {
+        }
+    }
 
 	///
 	/// Delete the key with the specified name, in the specified registry key.
@@ -0,0 +1,237 @@
+//===--- RegistryAsync.h -------------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_ASYNC_INCLUDED
+#define REGISTRY_ASYNC_INCLUDED
+
+#include "Registry/RegistryApi.h"
+
+#include <future>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Registry/RegistryIoPool.h"
+#include "Registry/RegistryKey.h"
+#include "Registry/RegistryValue.h"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#    include <coroutine>
+#    include <exception>
+#    include <optional>
+#    define REGISTRY_HAS_COROUTINES
+#endif
+
+
+namespace abscodes {
+namespace registry {
+
+
+    //
+    // Asynchronous operations, run on a RegistryIoPool.
+    // The key must outlive the operation. Reads only use the const API, so they may share the key;
+    // writes must not run concurrently with other operations on the same key.
+    //
+
+    ///
+    /// Open a subkey on the pool.
+    ///
+    /// @param key A registry key.
+    /// @param subkey Name or path to subkey to open.
+    /// @param token Cancellation token.
+    /// @param pool The pool running the operation.
+    ///
+    REGISTRY_API std::future<RegistryKey> OpenSubKeyAsync(const RegistryKey& key,
+                                                         std::string subkey,
+                                                         RegistryCancellationToken token = RegistryCancellationToken(),
+                                                         RegistryIoPool& pool = RegistryIoPool::Default());
+
+    ///
+    /// Retrieves a value on the pool.
+    ///
+    /// @param key A registry key.
+    /// @param valueName Name of the value.
+    /// @param token Cancellation token.
+    /// @param pool The pool running the operation.
+    ///
+    REGISTRY_API std::future<RegistryValue> GetValueAsync(const RegistryKey& key,
+                                                         std::string valueName,
+                                                         RegistryCancellationToken token = RegistryCancellationToken(),
+                                                         RegistryIoPool& pool = RegistryIoPool::Default());
+
+    ///
+    /// Writes a value on the pool.
+    ///
+    /// @param key A registry key.
+    /// @param valueName Name of the value.
+    /// @param value New value.
+    /// @param token Cancellation token.
+    /// @param pool The pool running the operation.
+    ///
+    REGISTRY_API std::future<void> SetValueAsync(RegistryKey& key,
+                                                std::string valueName,
+                                                RegistryValue value,
+                                                RegistryCancellationToken token = RegistryCancellationToken(),
+                                                RegistryIoPool& pool = RegistryIoPool::Default());
+
+    ///
+    /// Enumerate the subkeys on the pool.
+    ///
+    /// @param key A registry key.
+    /// @param token Cancellation token.
+    /// @param pool The pool running the operation.
+    ///
+    REGISTRY_API std::future<std::vector<std::string>> EnumSubKeysAsync(const RegistryKey& key,
+                                                                       RegistryCancellationToken token = RegistryCancellationToken(),
+                                                                       RegistryIoPool& pool = RegistryIoPool::Default());
+
+    ///
+    /// Enumerate the values on the pool.
+    ///
+    /// @param key A registry key.
+    /// @param token Cancellation token.
+    /// @param pool The pool running the operation.
+    ///
+    REGISTRY_API std::future<std::vector<std::pair<std::string, RegistryValueType>>> EnumValuesAsync(const RegistryKey& key,
+                                                                                                     RegistryCancellationToken token = RegistryCancellationToken(),
+                                                                                                     RegistryIoPool& pool = RegistryIoPool::Default());
+
+
+#if defined(REGISTRY_HAS_COROUTINES)
+
+    ///
+    /// co_await-able registry operation.
+    ///
+    /// The operation is posted to the pool when the coroutine suspends, and the coroutine is resumed
+    /// on the pool thread once it completes. No thread is blocked while waiting: a coroutine already
+    /// running on the pool never waits for room in the queue, see RegistryIoPool::Post. When the queue
+    /// is full, it runs the operation itself and carries on without suspending, so that the resumes
+    /// never nest.
+    ///
+    /// Requires C++20; the library itself is C++17, the awaitables are header only.
+    ///
+    template <typename Result>
+    class RegistryAwaitable
+    {
+
+    public:
+        RegistryAwaitable(RegistryIoPool& pool, std::function<Result()> operation, RegistryCancellationToken token)
+          : _pool(pool)
+          , _operation(std::move(operation))
+          , _token(std::move(token)) {}
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle) {
+            try {
+                _pool.Post([this, handle] {
+                    Execute();
+                    handle.resume();
+                });
+                return true;
+            }
+            catch(const Exceptions::RegistryException& e) {
+                if(e.ErrorCode() != ERROR_BUSY) {
+                    throw;
+                }
+            }
+
+            // Posted from a pool thread while the queue is full
+            Execute();
+            return false;
+        }
+
+        Result await_resume() {
+            if(_exception) {
+                std::rethrow_exception(_exception);
+            }
+            if constexpr(!std::is_void<Result>::value) {
+                return std::move(*_result);
+            }
+        }
+
+    private:
+        /// Run the operation, keeping its result or its exception for await_resume
+        void Execute() noexcept {
+            try {
+                _token.ThrowIfCancellationRequested();
+                if constexpr(std::is_void<Result>::value) {
+                    _operation();
+                }
+                else {
+                    _result.emplace(_operation());
+                }
+            }
+            catch(...) {
+                _exception = std::current_exception();
+            }
+        }
+
+    private:
+        using Storage = typename std::conditional<std::is_void<Result>::value, bool, Result>::type;
+
+        RegistryIoPool& _pool;
+        std::function<Result()> _operation;
+        RegistryCancellationToken _token;
+        std::optional<Storage> _result;
+        std::exception_ptr _exception;
+    };
+
+    /// co_await-able OpenSubKey
+    inline RegistryAwaitable<RegistryKey> OpenSubKeyAwaitable(const RegistryKey& key,
+                                                             std::string subkey,
+                                                             RegistryCancellationToken token = RegistryCancellationToken(),
+                                                             RegistryIoPool& pool = RegistryIoPool::Default()) {
+        return RegistryAwaitable<RegistryKey>(pool, [&key, subkey = std::move(subkey)] { return key.OpenSubKey(subkey); }, std::move(token));
+    }
+
+    /// co_await-able GetValue
+    inline RegistryAwaitable<RegistryValue> GetValueAwaitable(const RegistryKey& key,
+                                                             std::string valueName,
+                                                             RegistryCancellationToken token = RegistryCancellationToken(),
+                                                             RegistryIoPool& pool = RegistryIoPool::Default()) {
+        return RegistryAwaitable<RegistryValue>(pool, [&key, valueName = std::move(valueName)] { return key.GetValue(valueName); }, std::move(token));
+    }
+
+    /// co_await-able SetValue
+    inline RegistryAwaitable<void> SetValueAwaitable(RegistryKey& key,
+                                                    std::string valueName,
+                                                    RegistryValue value,
+                                                    RegistryCancellationToken token = RegistryCancellationToken(),
+                                                    RegistryIoPool& pool = RegistryIoPool::Default()) {
+        return RegistryAwaitable<void>(
+          pool, [&key, valueName = std::move(valueName), value = std::move(value)] { key.SetValue(valueName, value); }, std::move(token));
+    }
+
+    /// co_await-able EnumSubKeys
+    inline RegistryAwaitable<std::vector<std::string>> EnumSubKeysAwaitable(const RegistryKey& key,
+                                                                           RegistryCancellationToken token = RegistryCancellationToken(),
+                                                                           RegistryIoPool& pool = RegistryIoPool::Default()) {
+        return RegistryAwaitable<std::vector<std::string>>(pool, [&key] { return key.EnumSubKeys(); }, std::move(token));
+    }
+
+    /// co_await-able EnumValues
+    inline RegistryAwaitable<std::vector<std::pair<std::string, RegistryValueType>>> EnumValuesAwaitable(
+      const RegistryKey& key, RegistryCancellationToken token = RegistryCancellationToken(), RegistryIoPool& pool = RegistryIoPool::Default()) {
+        return RegistryAwaitable<std::vector<std::pair<std::string, RegistryValueType>>>(pool, [&key] { return key.EnumValues(); }, std::move(token));
+    }
+
+#endif // REGISTRY_HAS_COROUTINES
+
+
+} // namespace registry
+} // namespace abscodes
+
+
+#endif // REGISTRY_ASYNC_INCLUDED
@@ -0,0 +1,154 @@
+//===--- RegistryAtomTable.h ---------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_ATOM_TABLE_INCLUDED
+#define REGISTRY_ATOM_TABLE_INCLUDED
+
+#include "Registry/RegistryApi.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "Registry/RegistryName.h"
+#include "Registry/RegistryPagedArray.h"
+
+#pragma warning(push)
+#pragma warning(disable : 4251)
+
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// Concurrent table of interned names, each stored once and identified by a small integer (an atom).
+    ///
+    /// Names are compared case-insensitively, like the registry does: two spellings of the same name get
+    /// the same atom, and the first spelling is the one kept. Atoms are never reused and the stored names
+    /// never move, so the references and views returned stay valid for the lifetime of the table.
+    ///
+    /// Interning locks one of several shards, chosen by the hash of the name; looking an atom up is lock-free.
+    ///
+    class REGISTRY_API RegistryAtomTable
+    {
+
+    public:
+        /// Identifier of an interned name
+        using Atom = std::uint32_t;
+
+        /// Atom of the empty name
+        static constexpr Atom Empty = 0;
+
+    public:
+        /// Initialize a table holding the empty name
+        RegistryAtomTable();
+
+        /// Free the names
+        ~RegistryAtomTable() noexcept;
+
+        /// Non copyable
+        RegistryAtomTable(const RegistryAtomTable&) = delete;
+
+        /// Non copyable
+        RegistryAtomTable& operator=(const RegistryAtomTable&) = delete;
+
+        /// Get the process-wide table, never shrunk: only for a bounded set of names
+        static RegistryAtomTable& Names();
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Number of interned names, the empty name included
+        size_t GetCount() const noexcept;
+
+        ///
+        /// Get the name of an atom, without locking.
+        ///
+        /// @param atom An atom returned by this table.
+        ///
+        /// @exception std::out_of_range
+        ///
+        std::string_view GetName(Atom atom) const;
+
+        ///
+        /// Get the name of an atom, without locking.
+        ///
+        /// @param atom An atom returned by this table.
+        ///
+        /// @exception std::out_of_range
+        ///
+        const std::string& GetString(Atom atom) const;
+
+        //
+        // Operations
+        //
+
+    public:
+        ///
+        /// Get the atom of the name, adding it to the table if needed.
+        ///
+        /// @param name The name.
+        ///
+        Atom Intern(std::string_view name);
+
+        ///
+        /// Get the atom of the name, if it has been interned.
+        ///
+        /// @param name The name.
+        /// @param atom Receives the atom.
+        ///
+        bool TryFind(std::string_view name, Atom& atom) const;
+
+        //
+        // Internal Operations
+        //
+
+    private:
+        /// Shard of a name
+        size_t ShardOf(std::string_view name) const noexcept;
+
+
+    private:
+        /// Names sharing a lock
+        struct Shard {
+            /// Guards names and atoms
+            mutable std::shared_mutex mutex;
+            /// Names of the shard. A deque never moves its elements when growing
+            std::deque<std::string> names;
+            /// Atoms, by name (views into names)
+            std::unordered_map<std::string_view, Atom, Name::Hasher, Name::EqualTo> atoms;
+        };
+
+        static constexpr size_t ShardCount = 16;
+
+        /// Shards
+        Shard _shards[ShardCount];
+        /// Name of each atom
+        RegistryPagedArray<const std::string, 12, 4096> _names;
+        /// Next atom
+        std::atomic<Atom> _next {0};
+    };
+
+
+} // namespace registry
+} // namespace abscodes
+
+#pragma warning(pop)
+
+#endif // REGISTRY_ATOM_TABLE_INCLUDED
@@ -0,0 +1,38 @@
+//===--- RegistryDurability.h --------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_DURABILITY_INCLUDED
+#define REGISTRY_DURABILITY_INCLUDED
+
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// Specifies when the modifications made through a RegistryKey are flushed to disk.
+    ///
+    enum class RegistryDurability {
+        /// Let the system lazy flusher write the hive (the default behavior of the registry)
+        None = 0,
+        /// Queue a flush of the hive, without waiting for it
+        Deferred = 1,
+        /// Wait until a flush of the hive, shared with the concurrent writers, is done
+        GroupCommit = 2,
+    };
+
+
+} // namespace registry
+} // namespace abscodes
+
+
+#endif // REGISTRY_DURABILITY_INCLUDED
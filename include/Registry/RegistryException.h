@@ -55,9 +55,22 @@ namespace registry {
             /// Get the error key name
             char const* ErrorKeyName() const noexcept;
 
+            /// Get the error code, as returned by Windows registry APIs
+            LONG ErrorCode() const noexcept;
+
+        private:
+            /// Copy a key name into _keyName, truncating it if needed
+            void SetKeyName(const char* keyName, size_t length) noexcept;
+
         private:
+            /// Maximum length of the stored key name, terminating NUL included
+            static constexpr size_t _maxKeyNameLength = 512;
+
+            /// Error key name, stored inline so that throwing does not allocate for it
+            /// and that the name outlives the string it was built from
+            char _keyName[_maxKeyNameLength];
             /// Error code, as returned by Windows registry APIs
-            char const* _keyName;
+            LONG _errorCode;
         };
 
 
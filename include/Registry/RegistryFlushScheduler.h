@@ -0,0 +1,192 @@
+//===--- RegistryFlushScheduler.h ----------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_FLUSH_SCHEDULER_INCLUDED
+#define REGISTRY_FLUSH_SCHEDULER_INCLUDED
+
+#include "Registry/RegistryApi.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Registry/RegistryDurability.h"
+#include "Registry/RegistryHive.h"
+
+#pragma warning(push)
+#pragma warning(disable : 4251)
+
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// Process-wide scheduler of the registry flushes.
+    ///
+    /// RegFlushKey writes the whole hive to disk and is very expensive. The scheduler merges the flush requests
+    /// of concurrent writers, so that a single RegFlushKey call per hive serves all the requests received
+    /// within the group commit window.
+    ///
+    class REGISTRY_API RegistryFlushScheduler
+    {
+
+    public:
+        /// Flush metrics of a hive
+        struct Statistics {
+            /// Number of flush requests (deferred and group commit)
+            unsigned long long requests = 0;
+            /// Number of RegFlushKey calls
+            unsigned long long flushes = 0;
+            /// Number of failed RegFlushKey calls
+            unsigned long long failures = 0;
+            /// Cumulated RegFlushKey latency
+            std::chrono::microseconds totalLatency {0};
+            /// Highest RegFlushKey latency
+            std::chrono::microseconds maxLatency {0};
+            /// Latency of the last RegFlushKey call
+            std::chrono::microseconds lastLatency {0};
+        };
+
+    public:
+        ///
+        /// Get the process-wide scheduler.
+        ///
+        /// It is never destroyed: joining its worker from a static destructor could deadlock under the loader
+        /// lock. Call Shutdown before unloading the library, or exiting, to flush the deferred requests.
+        ///
+        static RegistryFlushScheduler& Instance();
+
+        /// Flushes pending requests and stops the worker thread
+        ~RegistryFlushScheduler() noexcept;
+
+        /// Non copyable
+        RegistryFlushScheduler(const RegistryFlushScheduler&) = delete;
+
+        /// Non copyable
+        RegistryFlushScheduler& operator=(const RegistryFlushScheduler&) = delete;
+
+    private:
+        /// Initialize a scheduler, the worker thread is started on first request
+        RegistryFlushScheduler() = default;
+
+        //
+        // Operations
+        //
+
+    public:
+        ///
+        /// Request a flush of the hive.
+        ///
+        /// @param hive The hive modified by the caller.
+        /// @param durability Deferred returns immediately, GroupCommit waits until the flush is done.
+        /// @param window Longest time a request waits for other requests to share its flush.
+        ///
+        /// @exception RegistryException thrown if the group commit flush failed.
+        ///
+        void Schedule(RegistryHive hive, RegistryDurability durability, std::chrono::milliseconds window);
+
+        ///
+        /// Flush the key immediately, and account for it in the hive metrics.
+        ///
+        /// @param hive The hive of the key.
+        /// @param hKey The key handle.
+        ///
+        /// @exception RegistryException
+        ///
+        void Flush(RegistryHive hive, HKEY hKey);
+
+        ///
+        /// Flush all the pending requests and stop the worker thread; later requests are flushed synchronously.
+        /// Must not be called from DllMain. Concurrent or repeated calls are safe: they return once stopped.
+        ///
+        void Shutdown() noexcept;
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Delay applied to the deferred requests
+        std::chrono::milliseconds GetDeferredDelay() const;
+
+        /// Set the delay applied to the deferred requests
+        void SetDeferredDelay(std::chrono::milliseconds delay);
+
+        /// Flush metrics of the hive
+        Statistics GetStatistics(RegistryHive hive) const;
+
+        //
+        // Internal Operations
+        //
+
+    private:
+        /// Group commit request waiting for its flush
+        struct Waiter {
+            /// Generation of the request
+            unsigned long long generation;
+            /// Result of the flush covering the request
+            LONG result = ERROR_SUCCESS;
+            /// Tells if the flush is done
+            bool done = false;
+        };
+
+        /// Flush state of a hive
+        struct HiveState {
+            /// Generation of the last request
+            unsigned long long requested = 0;
+            /// Generation covered by the last flush
+            unsigned long long completed = 0;
+            /// Group commit requests not flushed yet, on the stack of their callers
+            std::vector<Waiter*> waiters;
+            /// When the requests not taken by a flush yet must be flushed, set by the first of them
+            std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+            /// Metrics
+            Statistics statistics;
+        };
+
+        /// Worker thread loop
+        void Run();
+
+        /// Record a RegFlushKey call in the metrics
+        static void Record(Statistics& statistics, LONG retCode, std::chrono::microseconds latency);
+
+
+    private:
+        /// Guards the hive states, the delay, the worker start and the stop flag
+        mutable std::mutex _mutex;
+        /// Signaled when a request is queued or stop is requested
+        std::condition_variable _requested;
+        /// Signaled when a flush completes
+        std::condition_variable _completed;
+        /// Flush state by hive
+        std::map<RegistryHive, HiveState> _hives;
+        /// Delay applied to the deferred requests
+        std::chrono::milliseconds _deferredDelay {100};
+        /// Worker thread, started on first request
+        std::thread _worker;
+        /// Tells if the worker must stop
+        bool _stop = false;
+        /// Runs the shutdown once
+        std::once_flag _shutdown;
+    };
+
+
+} // namespace registry
+} // namespace abscodes
+
+#pragma warning(pop)
+
+#endif // REGISTRY_FLUSH_SCHEDULER_INCLUDED
@@ -0,0 +1,224 @@
+//===--- RegistryIoPool.h ------------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_IO_POOL_INCLUDED
+#define REGISTRY_IO_POOL_INCLUDED
+
+#include "Registry/RegistryApi.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "Registry/RegistryException.h"
+
+#pragma warning(push)
+#pragma warning(disable : 4251)
+
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// Cancellation flag shared between the caller and the queued registry operations.
+    /// Copies share the same flag.
+    ///
+    class REGISTRY_API RegistryCancellationToken
+    {
+
+    public:
+        /// Initialize a token that is not cancelled
+        RegistryCancellationToken();
+
+        /// Request the cancellation of the operations holding the token
+        void Cancel() noexcept;
+
+        /// Has the cancellation been requested?
+        bool IsCancellationRequested() const noexcept;
+
+        /// Throw a RegistryException (ERROR_OPERATION_ABORTED) if the cancellation has been requested
+        void ThrowIfCancellationRequested() const;
+
+    private:
+        /// Shared flag
+        std::shared_ptr<std::atomic<bool>> _cancelled;
+    };
+
+
+    ///
+    /// Bounded thread pool dedicated to blocking registry calls.
+    ///
+    /// Both the number of threads and the number of queued operations are bounded: Post blocks
+    /// while the queue is full, which gives back pressure to the producers. A pool thread never
+    /// blocks on its own pool: its Post fails when the queue is full.
+    ///
+    class REGISTRY_API RegistryIoPool
+    {
+
+    public:
+        /// Throughput and latency metrics
+        struct Statistics {
+            /// Number of operations posted
+            unsigned long long posted = 0;
+            /// Number of operations rejected, posted by a pool thread while the queue was full
+            unsigned long long rejected = 0;
+            /// Number of operations run
+            unsigned long long completed = 0;
+            /// Highest number of queued operations
+            size_t maxQueueDepth = 0;
+            /// Cumulated time spent by the operations in the queue
+            std::chrono::microseconds totalQueueLatency {0};
+            /// Cumulated time spent running the operations
+            std::chrono::microseconds totalRunLatency {0};
+        };
+
+    public:
+        ///
+        /// Start the pool threads.
+        ///
+        /// @param threadCount Number of threads.
+        /// @param queueCapacity Maximum number of queued operations.
+        ///
+        explicit RegistryIoPool(size_t threadCount, size_t queueCapacity = 1024);
+
+        /// Run the queued operations, and stop the threads; a job may destroy its own pool
+        ~RegistryIoPool() noexcept;
+
+        /// Non copyable
+        RegistryIoPool(const RegistryIoPool&) = delete;
+
+        /// Non copyable
+        RegistryIoPool& operator=(const RegistryIoPool&) = delete;
+
+        ///
+        /// Get the process-wide pool used by default.
+        ///
+        /// It is never destroyed: joining its threads from a static destructor could deadlock under the loader
+        /// lock. Call Shutdown before unloading the library.
+        ///
+        static RegistryIoPool& Default();
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Number of threads
+        size_t GetThreadCount() const noexcept;
+
+        /// Throughput and latency metrics
+        Statistics GetStatistics() const;
+
+        //
+        // Operations
+        //
+
+    public:
+        ///
+        /// Queue an operation, blocking while the queue is full.
+        /// From a pool thread, an operation that doesn't fit in the queue is rejected instead.
+        ///
+        /// @param operation Operation to run on a pool thread, it must not throw.
+        ///
+        /// @exception RegistryException The pool is stopped (ERROR_OPERATION_ABORTED), or the queue is full
+        /// and the caller is a pool thread (ERROR_BUSY).
+        ///
+        void Post(std::function<void()> operation);
+
+        ///
+        /// Queue an operation and get a future to its result.
+        /// If the cancellation is requested before the operation starts, the future gets
+        /// a RegistryException (ERROR_OPERATION_ABORTED) instead.
+        ///
+        /// @param operation Operation to run on a pool thread.
+        /// @param token Cancellation token.
+        ///
+        template <typename Operation>
+        auto Submit(Operation operation, RegistryCancellationToken token = RegistryCancellationToken())
+          -> std::future<typename std::invoke_result<Operation>::type> {
+
+            using Result = typename std::invoke_result<Operation>::type;
+
+            auto task = std::make_shared<std::packaged_task<Result()>>([operation = std::move(operation), token]() mutable -> Result {
+                token.ThrowIfCancellationRequested();
+                return operation();
+            });
+
+            auto future = task->get_future();
+            Post([task] { (*task)(); });
+            return future;
+        }
+
+        ///
+        /// Run the queued operations and stop the threads; Post then throws a RegistryException
+        /// (ERROR_OPERATION_ABORTED). Must not be called from DllMain.
+        ///
+        /// Concurrent calls are safe. From a pool thread, the stop is only requested: the threads are joined
+        /// by the next call from another thread, or by the destructor.
+        ///
+        void Shutdown() noexcept;
+
+        //
+        // Internal Operations
+        //
+
+    private:
+        /// A queued operation
+        struct Job {
+            std::function<void()> operation;
+            std::chrono::steady_clock::time_point posted;
+        };
+
+        /// Stop the threads once the queue is empty, without joining them
+        void RequestStop() noexcept;
+
+        /// Thread loop
+        void Run();
+
+
+    private:
+        /// Guards the queue, the statistics and the stop flag
+        mutable std::mutex _mutex;
+        /// Serializes the joins of the threads
+        std::mutex _joinMutex;
+        /// Signaled when a job is queued or stop is requested
+        std::condition_variable _notEmpty;
+        /// Signaled when a job is dequeued
+        std::condition_variable _notFull;
+        /// Queued jobs
+        std::deque<Job> _queue;
+        /// Maximum number of queued jobs
+        const size_t _capacity;
+        /// Pool threads
+        std::vector<std::thread> _threads;
+        /// Metrics
+        Statistics _statistics;
+        /// Tells if the threads must stop
+        bool _stop = false;
+    };
+
+
+} // namespace registry
+} // namespace abscodes
+
+#pragma warning(pop)
+
+#endif // REGISTRY_IO_POOL_INCLUDED
@@ -18,11 +18,23 @@
 #pragma warning(push)
 #pragma warning(disable : 4251)
 
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 
 #include "Registry/RegistryAccessRights.h"
+#include "Registry/RegistryAtomTable.h"
+#include "Registry/RegistryDurability.h"
 #include "Registry/RegistryHive.h"
+#include "Registry/RegistryNameList.h"
 #include "Registry/RegistryOption.h"
+#include "Registry/RegistryPathTable.h"
+#include "Registry/RegistryTypeTraits.h"
 #include "Registry/RegistryValue.h"
 #include "Registry/RegistryValueType.h"
 #include "Registry/RegistryView.h"
@@ -35,9 +47,15 @@ namespace abscodes {
 namespace registry {
 
 
+    class RegistryTransaction;
+
+    ///
+    /// Wrapper around a registry key handle.
+    /// The const operations don't modify the key, so one key can be read from several threads at once.
     ///
     class REGISTRY_API RegistryKey
     {
+        friend class RegistryTransaction;
 
     public:
         ///
@@ -78,8 +96,8 @@ namespace registry {
         ~RegistryKey() noexcept;
 
     private:
-        /// Internal copy constructor
-        RegistryKey(const RegistryKey&, HKEY hKey, std::string subkey);
+        /// Internal copy constructor, for a subkey opened with the given view and access rights
+        RegistryKey(const RegistryKey& parent, HKEY hKey, std::string subkey, RegistryView view, RegistryAccessRights access);
 
         //
         // Properties
@@ -89,6 +107,9 @@ namespace registry {
         /// Is the wrapped HKEY handle valid?
         bool IsValid() const noexcept;
 
+        /// Was the key opened or created as part of a RegistryTransaction?
+        bool IsTransacted() const noexcept;
+
         /// Same as IsValid(), but allow a short "if (regKey)" syntax
         explicit operator bool() const noexcept;
 
@@ -107,13 +128,31 @@ namespace registry {
         RegistryAccessRights GetAccessRights() const;
 
         ///
-        std::string GetName() const;
+        const std::string& GetName() const;
+
+        /// ID of the key name in the RegistryPathTable, one per spelling of the name
+        RegistryPathTable::Id GetPathId() const noexcept;
+
+        /// Hash of the hive, view, access rights and name, equal for names differing only by case
+        size_t Hash() const noexcept;
+
+        ///
+        size_t GetSubKeyCount() const;
 
         ///
-        size_t GetSubKeyCount();
+        size_t GetValueCount() const;
+
+        /// When the modifications made through this key are flushed to disk
+        RegistryDurability GetDurability() const noexcept;
 
         ///
-        size_t GetValueCount();
+        /// Choose when the next modifications made through this key are flushed to disk.
+        /// Subkeys opened or created from this key inherit the setting.
+        ///
+        /// @param durability None, Deferred or GroupCommit.
+        /// @param window Longest time a group commit waits for concurrent writers to share its flush.
+        ///
+        void SetDurability(RegistryDurability durability, std::chrono::milliseconds window = std::chrono::milliseconds(10));
 
         //
         // Operations
@@ -126,7 +165,7 @@ namespace registry {
         /// Closes this key, flushes it to disk if the contents have been modified.
         void Close() noexcept;
 
-        /// Flush the content to disk
+        /// Flush the content to disk, if it has been modified through this key
         void Flush();
 
         ///
@@ -183,7 +222,7 @@ namespace registry {
         ///
         /// @exception RegistryException
         ///
-        RegistryKey OpenSubKey(std::string subkey);
+        RegistryKey OpenSubKey(std::string subkey) const;
 
         ///
         /// Open a subkey. Will throw an exception if the subkey doesn't exist
@@ -193,7 +232,7 @@ namespace registry {
         ///
         /// @exception RegistryException
         ///
-        RegistryKey OpenSubKey(std::string subkey, RegistryAccessRights desiredAccess);
+        RegistryKey OpenSubKey(std::string subkey, RegistryAccessRights desiredAccess) const;
 
         ///
         /// Open a subkey. Will throw an exception if the subkey doesn't exist
@@ -205,7 +244,7 @@ namespace registry {
         ///
         /// @exception RegistryException
         ///
-        RegistryKey OpenSubKey(std::string subkey, RegistryView view, RegistryAccessRights desiredAccess, RegistryOption option);
+        RegistryKey OpenSubKey(std::string subkey, RegistryView view, RegistryAccessRights desiredAccess, RegistryOption option) const;
 
         ///
         /// Deletes the specified subkey. Will throw an exception if the subkey has
@@ -294,13 +333,119 @@ namespace registry {
     public:
         enum class ExpandStringOption { DontExpand, Expand };
 
-        RegistryValue GetValue(const std::string& valueName);
-        DWORD GetDwordValue(const std::string& valueName);
-        ULONGLONG GetQwordValue(const std::string& valueName);
-        std::string GetStringValue(const std::string& valueName);
-        std::string GetExpandStringValue(const std::string& valueName, ExpandStringOption expandOption = ExpandStringOption::DontExpand);
-        std::vector<std::string> GetMultiStringValue(const std::string& valueName);
-        std::vector<BYTE> GetBinaryValue(const std::string& valueName);
+        RegistryValue GetValue(const std::string& valueName) const;
+        DWORD GetDwordValue(const std::string& valueName) const;
+        ULONGLONG GetQwordValue(const std::string& valueName) const;
+        std::string GetStringValue(const std::string& valueName) const;
+        std::string GetExpandStringValue(const std::string& valueName, ExpandStringOption expandOption = ExpandStringOption::DontExpand) const;
+        std::vector<std::string> GetMultiStringValue(const std::string& valueName) const;
+        std::vector<BYTE> GetBinaryValue(const std::string& valueName) const;
+
+        ///
+        /// Read several values of the key at once, with RegQueryMultipleValues.
+        ///
+        /// @param valueNames Names of the values.
+        ///
+        /// @return The values, in the order of the names. A missing value is empty (REG_NONE), and so is a value
+        ///         that cannot be decoded: an unsupported type, or a REG_DWORD or REG_QWORD of the wrong size.
+        ///
+        /// @exception RegistryException The key cannot be read.
+        ///
+        std::vector<RegistryValue> GetValues(const std::vector<std::string>& valueNames) const;
+
+        ///
+        /// Read a value of a subkey, type and data at once, with RegGetValue: the subkey is not opened apart.
+        ///
+        /// @param subKeyName Path to the subkey, relative to the key; empty for the key itself.
+        /// @param valueName Name of the value.
+        /// @param value Receives the value.
+        ///
+        /// @return false if the subkey or the value doesn't exist, or if the value cannot be decoded, as in GetValues.
+        ///
+        /// @exception RegistryException The value cannot be read.
+        ///
+        bool TryGetValue(const std::string& subKeyName, const std::string& valueName, RegistryValue& value) const;
+
+        //
+        // Getters allocating from a memory resource
+        //
+        // The results, and the temporary buffers of the call, are allocated from the given resource,
+        // e.g. a std::pmr::monotonic_buffer_resource released at the end of a request.
+        //
+
+    public:
+        pmr::RegistryValue GetValue(const std::string& valueName, std::pmr::memory_resource* resource) const;
+        std::pmr::string GetStringValue(const std::string& valueName, std::pmr::memory_resource* resource) const;
+        std::pmr::string GetExpandStringValue(const std::string& valueName,
+                                              std::pmr::memory_resource* resource,
+                                              ExpandStringOption expandOption = ExpandStringOption::DontExpand) const;
+        std::pmr::vector<std::pmr::string> GetMultiStringValue(const std::string& valueName, std::pmr::memory_resource* resource) const;
+        std::pmr::vector<BYTE> GetBinaryValue(const std::string& valueName, std::pmr::memory_resource* resource) const;
+
+
+        //
+        // Typed Accessors
+        //
+
+    public:
+        ///
+        /// Read a value of type T, mapped to a registry type at compile time (see RegistryTypeTraits).
+        ///
+        /// RegGetValue is restricted to the registry type of T: reading a value of another type,
+        /// or a REG_BINARY value of another size than T, throws.
+        ///
+        /// @param valueName Name of the value.
+        ///
+        /// @exception RegistryException
+        ///
+        template <typename T>
+        T Get(const std::string& valueName) const;
+
+        ///
+        /// Write a value of type T, as the registry type mapped at compile time (see RegistryTypeTraits).
+        ///
+        /// @param valueName Name of the value.
+        /// @param value New value.
+        ///
+        /// @exception RegistryException
+        ///
+        template <typename T>
+        void Set(const std::string& valueName, const T& value);
+
+
+        //
+        // Atomic Operations
+        //
+
+    public:
+        ///
+        /// Replace the value with desired if it is equal to expected, atomically with respect to other processes.
+        ///
+        /// The write is made in a transaction, which locks the key until the committed value is verified,
+        /// so there is no need for a cross-process mutex. An empty value (REG_NONE) stands for a missing value.
+        ///
+        /// @param valueName Name of the value.
+        /// @param expected Value expected in the registry, updated with the current value on failure.
+        /// @param desired New value, an empty value deletes it.
+        ///
+        /// @return true if the value has been replaced.
+        ///
+        /// @exception RegistryException
+        ///
+        bool CompareExchangeValue(const std::string& valueName, RegistryValue& expected, const RegistryValue& desired);
+
+        ///
+        /// Read-modify-write the value with CompareExchangeValue, retrying when another writer got in between.
+        ///
+        /// @param valueName Name of the value.
+        /// @param update Compute the new value from the current one, called once per attempt.
+        /// @param maxAttempts Number of attempts before giving up.
+        ///
+        /// @return true if the value has been updated.
+        ///
+        /// @exception RegistryException
+        ///
+        bool UpdateValue(const std::string& valueName, const std::function<RegistryValue(const RegistryValue&)>& update, unsigned int maxAttempts = 16);
 
 
         //
@@ -309,18 +454,78 @@ namespace registry {
 
     public:
         /// Return the DWORD type ID for the input registry value
-        DWORD QueryValueType(const std::string& valueName);
+        DWORD QueryValueType(const std::string& valueName) const;
 
         ///
-        void QueryInfoKey(DWORD& subKeys, DWORD& values, FILETIME& lastWriteTime);
+        /// Read the type and the raw data of a value in a single RegGetValue call, into a caller buffer.
+        ///
+        /// Strings are read as UTF-16, without expanding REG_EXPAND_SZ values.
+        ///
+        /// @param valueName Name of the value.
+        /// @param data Output buffer.
+        /// @param dataSize Size of the buffer on input, size of the data on output, in bytes.
+        ///
+        /// @return The DWORD type ID of the value.
+        ///
+        /// @exception RegistryException The value doesn't exist, or doesn't fit in the buffer (ERROR_MORE_DATA).
+        ///
+        DWORD QueryValueData(const std::string& valueName, void* data, DWORD& dataSize) const;
+
+        ///
+        void QueryInfoKey(DWORD& subKeys, DWORD& values, FILETIME& lastWriteTime) const;
 
         /// Enumerate the subkeys of the registry key, using RegEnumKeyEx
-        std::vector<std::string> EnumSubKeys();
+        std::vector<std::string> EnumSubKeys() const;
 
         /// Enumerate the values under the registry key, using RegEnumValue.
         /// Returns a vector of pairs: In each pair, the wstring is the value name,
         /// the DWORD is the value type.
-        std::vector<std::pair<std::string, RegistryValueType>> EnumValues();
+        std::vector<std::pair<std::string, RegistryValueType>> EnumValues() const;
+
+        /// Enumerate the subkeys of the registry key, allocating from the given resource
+        std::pmr::vector<std::pmr::string> EnumSubKeys(std::pmr::memory_resource* resource) const;
+
+        /// Enumerate the values under the registry key, allocating from the given resource
+        std::pmr::vector<std::pair<std::pmr::string, RegistryValueType>> EnumValues(std::pmr::memory_resource* resource) const;
+
+        ///
+        /// Enumerate the subkeys of the registry key, as atoms of the given table.
+        ///
+        /// Unlike EnumSubKeys, a name already interned costs no allocation.
+        ///
+        /// @param names Table the names are interned into; its names are freed with it.
+        ///
+        std::vector<RegistryAtomTable::Atom> EnumSubKeyAtoms(RegistryAtomTable& names) const;
+
+        ///
+        /// Enumerate the values under the registry key, as atoms of the given table.
+        ///
+        /// Unlike EnumValues, a name already interned costs no allocation.
+        ///
+        /// @param names Table the names are interned into; its names are freed with it.
+        ///
+        std::vector<std::pair<RegistryAtomTable::Atom, RegistryValueType>> EnumValueAtoms(RegistryAtomTable& names) const;
+
+        ///
+        /// Enumerate the subkeys of the registry key into a single arena.
+        ///
+        /// The list is reserved from the counts returned by RegQueryInfoKey, so that enumerating
+        /// costs a constant number of allocations, whatever the number of subkeys.
+        ///
+        /// @param sorted True to sort the names case-insensitively.
+        /// @param resource Memory resource of the list.
+        ///
+        RegistryNameList EnumSubKeyNames(bool sorted = false,
+                                         std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
+
+        ///
+        /// Enumerate the value names of the registry key into a single arena.
+        ///
+        /// @param sorted True to sort the names case-insensitively.
+        /// @param resource Memory resource of the list.
+        ///
+        RegistryNameList EnumValueNames(bool sorted = false,
+                                        std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
 
 
         //
@@ -334,7 +539,7 @@ namespace registry {
         void DisableReflectionKey();
 
         ///
-        bool QueryReflectionKey();
+        bool QueryReflectionKey() const;
 
         //
         // Internal Operations
@@ -350,36 +555,76 @@ namespace registry {
         /// Check if the current key is HKEY_PERFORMANCE_DATA
         bool IsPerfDataKey() const;
 
-        ///
-        bool IsWritable() const;
+        /// Do the access rights allow setting a value or creating a subkey?
+        static bool IsWritable(RegistryAccessRights access);
 
+        /// Tells if the key has been modified since the last flush
         bool IsDirty() const;
+
+        /// Record a modification, and schedule a flush according to the durability
         void setDirty();
 
         /// Ensure the key is not closed
         void EnsureNotDisposed() const;
 
-        /// Ensure the key is writable
-        void EnsureWriteable() const;
+        /// Ensure the key is not closed, and the access rights allow writing
+        void EnsureWriteable(RegistryAccessRights access) const;
+
+        /// Get the value, or an empty value if it doesn't exist
+        RegistryValue GetValueOrEmpty(const std::string& valueName) const;
+
+        /// Read the data of a value of a fixed size, as restricted by the RRF_RT_* flags
+        void GetData(const std::string& valueName, DWORD flags, void* data, DWORD dataSize) const;
+
+        /// Write the data of a value
+        void SetData(const std::string& valueName, DWORD type, const void* data, size_t dataSize);
+
+        /// Write a REG_SZ or REG_EXPAND_SZ value
+        void SetStringData(const std::string& valueName, std::string_view value, DWORD type);
 
         ///
-        void ValidateKeyName(std::string& keyName);
+        void ValidateKeyName(std::string& keyName) const;
 
         /// Fixup multiple slashes to a single slash
-        std::string& FixupName(std::string& name);
+        static std::string& FixupName(std::string& name);
+
+        /// Key name, from the path table
+        const std::string& KeyName() const;
+
+        /// Transaction the key belongs to, if any
+        HANDLE Transaction() const noexcept;
+
+        struct Options;
+
+        /// Options of the key, allocated on first use
+        Options& MutableOptions();
 
 
     private:
+        /// Options few keys use, allocated only when set, so that the others stay small
+        struct Options {
+            /// Transaction the key belongs to, shared with RegistryTransaction: the handle stays open while a key holds it
+            std::shared_ptr<void> transaction;
+            /// Group commit window
+            std::chrono::milliseconds flushWindow {10};
+            /// When the modifications are flushed
+            RegistryDurability durability = RegistryDurability::None;
+        };
+
+        // Members are ordered by size, to avoid padding
+
+        /// The wrapped registry key handle
+        HKEY _hKey = nullptr;
+        /// Options, shared by none, inherited by the subkeys
+        std::unique_ptr<Options> _options;
+        /// Key name, interned in the RegistryPathTable, and held
+        RegistryPathTable::Id _pathId = RegistryPathTable::Root;
         ///
         RegistryHive _hive;
         ///
         RegistryView _view = RegistryView::Default;
         ///
         RegistryAccessRights _access = RegistryAccessRights::Read;
-        /// The wrapped registry key handle
-        HKEY _hKey = nullptr;
-        /// Key name
-        std::string _keyName;
         /// Tells if the needs to be flush
         bool _dirty = false;
 
@@ -388,8 +633,10 @@ namespace registry {
         /// Key Name: 255 characters
         /// Value name:  16,383 Unicode characters
         /// Value: either 1 MB or current available memory, depending on registry format.
-        const size_t _maxKeyLength = 255;
-        const size_t _maxValueLength = 16383;
+        static constexpr size_t _maxKeyLength = 255;
+        static constexpr size_t _maxValueLength = 16383;
+
+        friend bool operator==(const RegistryKey& a, const RegistryKey& b) noexcept;
     };
 
     inline void swap(RegistryKey& lhs, RegistryKey& rhs) noexcept {
@@ -408,16 +655,82 @@ namespace registry {
 	}
 
     inline bool operator==(const RegistryKey& a, const RegistryKey& b) noexcept {
-        return a.GetHive() == b.GetHive() && a.GetView() == b.GetView() && a.GetAccessRights() == b.GetAccessRights() && a.GetName() == b.GetName();
+        // Names are interned: comparing their IDs, then their hashes, is enough but for another spelling
+        return a._hive == b._hive && a._view == b._view && a._access == b._access && RegistryPathTable::Instance().Equals(a._pathId, b._pathId);
     }
 
     inline bool operator!=(const RegistryKey& a, const RegistryKey& b) noexcept {
-		return a.GetHive() != b.GetHive() || a.GetView() != b.GetView() || a.GetAccessRights() != b.GetAccessRights() || a.GetName() != b.GetName();
+        return !(a == b);
+    }
+
+    //------------------------------------------------------------------------------
+    //          Typed accessors
+    //------------------------------------------------------------------------------
+    template <typename T>
+    T RegistryKey::Get(const std::string& valueName) const {
+        using Traits = RegistryTypeTraits<T>;
+        static_assert(IsRegistryType<T>, "This type cannot be read from the registry, see RegistryTypeTraits.");
+
+        if constexpr(Traits::Storage == RegistryStorage::Scalar) {
+            typename Traits::StorageType data {};
+            GetData(valueName, Traits::Flags, &data, sizeof(data));
+            return Traits::FromStorage(data);
+        }
+        else if constexpr(Traits::Storage == RegistryStorage::String) {
+            static_assert(std::is_same_v<T, std::string>, "Strings are read as std::string.");
+            return GetStringValue(valueName);
+        }
+        else if constexpr(Traits::Storage == RegistryStorage::MultiString) {
+            return GetMultiStringValue(valueName);
+        }
+        else if constexpr(std::is_same_v<T, std::vector<BYTE>>) {
+            return GetBinaryValue(valueName);
+        }
+        else {
+            static_assert(std::is_same_v<T, std::vector<std::byte>>, "Bytes are read as a vector.");
+            const std::vector<BYTE> bytes = GetBinaryValue(valueName);
+            const auto first = reinterpret_cast<const std::byte*>(bytes.data());
+            return T(first, first + bytes.size());
+        }
+    }
+
+    template <typename T>
+    void RegistryKey::Set(const std::string& valueName, const T& value) {
+        // String literals are written as const char*
+        using Traits = RegistryTypeTraits<std::decay_t<T>>;
+        static_assert(IsRegistryType<std::decay_t<T>>, "This type cannot be written to the registry, see RegistryTypeTraits.");
+
+        if constexpr(Traits::Storage == RegistryStorage::Scalar) {
+            const typename Traits::StorageType& data = Traits::ToStorage(value);
+            SetData(valueName, static_cast<DWORD>(Traits::Type), &data, sizeof(data));
+        }
+        else if constexpr(Traits::Storage == RegistryStorage::String) {
+            SetStringData(valueName, std::string_view(value), REG_SZ);
+        }
+        else if constexpr(Traits::Storage == RegistryStorage::MultiString) {
+            SetMultiStringValue(valueName, value);
+        }
+        else {
+            SetData(valueName, REG_BINARY, value.data(), value.size());
+        }
     }
 
 } // namespace registry
 } // namespace abscodes
 
+
+namespace std {
+
+    /// Hash a RegistryKey consistently with operator==
+    template <>
+    struct hash<abscodes::registry::RegistryKey> {
+        size_t operator()(const abscodes::registry::RegistryKey& key) const noexcept {
+            return key.Hash();
+        }
+    };
+
+} // namespace std
+
 #pragma warning(pop)
 
 #endif // REGISTRY_KEY_INCLUDED
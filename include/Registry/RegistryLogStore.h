@@ -0,0 +1,310 @@
+//===--- RegistryLogStore.h ----------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_LOG_STORE_INCLUDED
+#define REGISTRY_LOG_STORE_INCLUDED
+
+#include "Registry/RegistryApi.h"
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Registry/RegistryDurability.h"
+#include "Registry/RegistryName.h"
+#include "Registry/RegistryValue.h"
+#include "Registry/RegistryValueCache.h"
+#include "Registry/RegistryWriteBatch.h"
+
+#pragma warning(push)
+#pragma warning(disable : 4251)
+
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// Durable key and value store kept in local files, for the configuration that doesn't live in the registry.
+    ///
+    /// Each change is appended to a write-ahead log as a checksummed record, then applied to an in-memory index:
+    /// reads never touch the files. Concurrent writers share their writes, and the flush of the log: the first
+    /// waiting writer writes the records of all the others, with a single flush (group commit).
+    ///
+    /// Once the log exceeds a size, the index is compacted into a checkpoint, a RegistrySnapshot image replacing
+    /// the previous one, and the log is emptied. Opening the store maps the checkpoint, then replays the log; a
+    /// record torn by a crash ends the replay, and is cut from the log.
+    ///
+    /// The files are "<fileName>.checkpoint" and "<fileName>.log". A single store opens them at a time.
+    ///
+    class REGISTRY_API RegistryLogStore : public RegistryCacheSource
+    {
+
+    public:
+        /// Log metrics
+        struct Statistics {
+            /// Number of records appended to the log
+            unsigned long long commits = 0;
+            /// Number of log writes, each one holding one or more records
+            unsigned long long writes = 0;
+            /// Number of log flushes
+            unsigned long long flushes = 0;
+            /// Number of checkpoints written
+            unsigned long long checkpoints = 0;
+            /// Number of automatic checkpoints failed
+            unsigned long long checkpointFailures = 0;
+            /// Number of records replayed when the store was opened
+            unsigned long long replayed = 0;
+            /// Number of bytes cut from the log when the store was opened, from a torn record
+            unsigned long long truncated = 0;
+        };
+
+    public:
+        ///
+        /// Open a store, creating it if it doesn't exist.
+        ///
+        /// @param fileName Path to the files, without extension, in UTF-8.
+        /// @param durability GroupCommit waits until each change is flushed to disk; None and Deferred wait until
+        ///                   it is written to the log, which the system flushes later.
+        /// @param checkpointSize Size of the log that triggers a checkpoint, in bytes.
+        ///
+        /// @exception RegistryException The files cannot be opened, or the checkpoint is invalid (ERROR_INVALID_DATA).
+        ///
+        explicit RegistryLogStore(const std::string& fileName,
+                                  RegistryDurability durability = RegistryDurability::GroupCommit,
+                                  size_t checkpointSize = size_t(4) << 20);
+
+        /// Flush and close the log
+        ~RegistryLogStore() noexcept override;
+
+        /// Non copyable
+        RegistryLogStore(const RegistryLogStore&) = delete;
+
+        /// Non copyable
+        RegistryLogStore& operator=(const RegistryLogStore&) = delete;
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Size of the log, in bytes
+        unsigned long long GetLogSize() const;
+
+        /// Log metrics
+        Statistics GetStatistics() const;
+
+        ///
+        /// Error of the last automatic checkpoint, ERROR_SUCCESS once one succeeds.
+        ///
+        /// A failed automatic checkpoint doesn't fail the commit that triggered it, whose record is written: the
+        /// next attempt waits for the log to double in size.
+        ///
+        LONG GetCheckpointError() const;
+
+        //
+        // Getters
+        //
+
+    public:
+        /// Does the key exist? The root always exists.
+        bool KeyExists(const std::string& keyName) const;
+
+        /// Does the key hold the value?
+        bool HasValue(const std::string& keyName, const std::string& valueName) const;
+
+        ///
+        /// Get a value.
+        ///
+        /// @exception RegistryException The key or the value doesn't exist (ERROR_FILE_NOT_FOUND).
+        ///
+        RegistryValue GetValue(const std::string& keyName, const std::string& valueName) const;
+
+        DWORD GetDwordValue(const std::string& keyName, const std::string& valueName) const;
+        ULONGLONG GetQwordValue(const std::string& keyName, const std::string& valueName) const;
+        std::string GetStringValue(const std::string& keyName, const std::string& valueName) const;
+
+        //
+        // Operations
+        //
+
+    public:
+        ///
+        /// Create a key and its parents, if needed.
+        ///
+        /// @exception RegistryException The log cannot be written.
+        ///
+        void CreateKey(const std::string& keyName);
+
+        ///
+        /// Delete a key and its subkeys.
+        ///
+        /// @exception std::invalid_argument The key is the root.
+        /// @exception RegistryException The key doesn't exist (ERROR_FILE_NOT_FOUND), or the log cannot be written.
+        ///
+        void DeleteKey(const std::string& keyName);
+
+        ///
+        /// Write a value, creating its key and its parents if needed.
+        ///
+        /// @exception std::invalid_argument The value is empty, or of a type a checkpoint cannot hold.
+        /// @exception RegistryException The log cannot be written.
+        ///
+        void SetValue(const std::string& keyName, const std::string& valueName, const RegistryValue& value);
+
+        void SetDwordValue(const std::string& keyName, const std::string& valueName, DWORD value);
+        void SetQwordValue(const std::string& keyName, const std::string& valueName, ULONGLONG value);
+        void SetStringValue(const std::string& keyName, const std::string& valueName, const std::string& value);
+
+        ///
+        /// Delete a value.
+        ///
+        /// @exception RegistryException The key or the value doesn't exist (ERROR_FILE_NOT_FOUND), or the log cannot be written.
+        ///
+        void DeleteValue(const std::string& keyName, const std::string& valueName);
+
+        ///
+        /// Apply the operations of a batch as a single log record: after a crash, all of them or none are replayed.
+        /// The batch is not cleared.
+        ///
+        /// @exception std::invalid_argument A value is of a type a checkpoint cannot hold.
+        /// @exception RegistryException The log cannot be written.
+        ///
+        void Apply(const RegistryWriteBatch& batch);
+
+        ///
+        /// Compact the index into a new checkpoint, and empty the log.
+        ///
+        /// @exception RegistryException The checkpoint cannot be written; the log is kept.
+        ///
+        void Checkpoint();
+
+        //
+        // Cache source
+        //
+
+    public:
+        bool QueryLastWriteTime(const std::string& keyName, FILETIME& lastWriteTime) override;
+
+        std::vector<std::pair<std::string, RegistryValue>> ReadKey(const std::string& keyName) override;
+
+        bool ReadValue(const std::string& keyName, const std::string& valueName, RegistryValue& value) override;
+
+        std::vector<std::string> EnumSubKeys(const std::string& keyName) override;
+
+        //
+        // Internal Operations
+        //
+
+    private:
+        /// Values of a key, by name
+        using Values = std::map<std::string, RegistryValue, Name::Less>;
+
+        /// A key of the index, and its values sorted by name
+        struct Key {
+            Values values;
+            ULONGLONG lastWriteTime = 0;
+        };
+
+        /// Keys, by normalized path
+        using Keys = std::map<std::string, Key, Name::Less>;
+
+        /// A change of the index, to roll back the records of a group that cannot be applied entirely
+        struct Change;
+
+        /// A record waiting to be written by the leader of a group commit
+        struct Pending {
+            /// Encoded record
+            std::vector<BYTE> record;
+            /// Result of the write
+            LONG result = ERROR_SUCCESS;
+            /// Tells if the record was written, or failed
+            bool done = false;
+        };
+
+        /// Load the checkpoint into the index
+        void LoadCheckpoint();
+
+        /// Replay the log into the index, and cut its torn tail
+        void Replay();
+
+        /// Append a record to the log, and apply it to the index once written
+        void Commit(std::vector<BYTE> record);
+
+        /// Write the checkpoint and empty the log; the caller is the leader
+        void WriteCheckpoint();
+
+        /// Apply the operations of a record to the index, tracking the changes; false if the record is invalid
+        bool ApplyRecord(const BYTE* data, size_t size, std::vector<Change>& changes);
+
+        /// Undo the changes of the index, the latest first
+        void Undo(std::vector<Change>& changes) noexcept;
+
+        /// Get a key of the index, creating it and its parents if needed
+        Key& CreateIndexKey(const std::string& path, ULONGLONG time, std::vector<Change>& changes);
+
+        /// Find a key of the index
+        const Key* FindKey(const std::string& path) const;
+
+        /// Find a value of the index
+        const RegistryValue* FindValue(const std::string& keyName, const std::string& valueName) const;
+
+
+    private:
+        /// Path to the checkpoint
+        const std::string _checkpointFileName;
+        /// Path to the log
+        const std::string _logFileName;
+        /// When the writers return
+        const RegistryDurability _durability;
+        /// Size of the log that triggers a checkpoint
+        const size_t _checkpointSize;
+        /// Log file
+        HANDLE _hLog = INVALID_HANDLE_VALUE;
+        /// Size of the log, i.e. end of its last record
+        unsigned long long _logSize = 0;
+        /// Time given to the last record, strictly increasing
+        ULONGLONG _clock = 0;
+
+        /// Serializes the log writes
+        mutable std::mutex _mutex;
+        /// Signaled when the leader is done
+        std::condition_variable _written;
+        /// Records waiting for a leader
+        std::deque<Pending*> _pending;
+        /// Tells if a leader is writing the log
+        bool _writing = false;
+        /// Metrics
+        Statistics _statistics;
+        /// Size of the log that triggers the next automatic checkpoint
+        unsigned long long _nextCheckpoint;
+        /// Error of the last automatic checkpoint
+        LONG _checkpointError = ERROR_SUCCESS;
+
+        /// Protects the index
+        mutable std::shared_mutex _indexMutex;
+        /// Keys, by normalized path; the root is the empty path
+        Keys _keys;
+    };
+
+
+} // namespace registry
+} // namespace abscodes
+
+#pragma warning(pop)
+
+#endif // REGISTRY_LOG_STORE_INCLUDED
@@ -0,0 +1,119 @@
+//===--- RegistryName.h --------------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_NAME_INCLUDED
+#define REGISTRY_NAME_INCLUDED
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// Helpers to compare key and value names the way the Windows registry does, i.e. case-insensitively.
+    ///
+    /// Only ASCII letters are folded; the multi-byte sequences of UTF-8 names are compared as is.
+    ///
+    namespace Name {
+
+        /// Fold an ASCII upper case letter to lower case
+        inline char Fold(char c) noexcept {
+            return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+        }
+
+        /// Case-insensitive equality
+        inline bool Equals(std::string_view lhs, std::string_view rhs) noexcept {
+            if(lhs.size() != rhs.size()) {
+                return false;
+            }
+            for(size_t i = 0; i < lhs.size(); ++i) {
+                if(Fold(lhs[i]) != Fold(rhs[i])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /// Case-insensitive three-way comparison
+        inline int Compare(std::string_view lhs, std::string_view rhs) noexcept {
+            const size_t count = lhs.size() < rhs.size() ? lhs.size() : rhs.size();
+            for(size_t i = 0; i < count; ++i) {
+                const auto l = static_cast<unsigned char>(Fold(lhs[i]));
+                const auto r = static_cast<unsigned char>(Fold(rhs[i]));
+                if(l != r) {
+                    return l < r ? -1 : 1;
+                }
+            }
+            return lhs.size() == rhs.size() ? 0 : (lhs.size() < rhs.size() ? -1 : 1);
+        }
+
+        /// Case-insensitive FNV-1a hash
+        inline size_t Hash(std::string_view name) noexcept {
+            unsigned long long hash = 14695981039346656037ULL;
+            for(const char c : name) {
+                hash ^= static_cast<unsigned char>(Fold(c));
+                hash *= 1099511628211ULL;
+            }
+            return static_cast<size_t>(hash);
+        }
+
+        /// Fixup multiple slashes to a single slash, and remove the leading and trailing ones
+        inline std::string Normalize(std::string_view path) {
+            std::string result;
+            result.reserve(path.size());
+            for(const char c : path) {
+                if(c == '\\' && (result.empty() || result.back() == '\\')) {
+                    continue;
+                }
+                result.push_back(c);
+            }
+            if(!result.empty() && result.back() == '\\') {
+                result.pop_back();
+            }
+            return result;
+        }
+
+        /// Ordering functor for associative containers
+        struct Less {
+            using is_transparent = void;
+            bool operator()(std::string_view lhs, std::string_view rhs) const noexcept {
+                return Compare(lhs, rhs) < 0;
+            }
+        };
+
+        /// Equality functor for unordered containers
+        struct EqualTo {
+            using is_transparent = void;
+            bool operator()(std::string_view lhs, std::string_view rhs) const noexcept {
+                return Equals(lhs, rhs);
+            }
+        };
+
+        /// Hash functor for unordered containers
+        struct Hasher {
+            using is_transparent = void;
+            size_t operator()(std::string_view name) const noexcept {
+                return Hash(name);
+            }
+        };
+
+    } // namespace Name
+
+
+} // namespace registry
+} // namespace abscodes
+
+
+#endif // REGISTRY_NAME_INCLUDED
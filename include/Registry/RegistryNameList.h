@@ -0,0 +1,184 @@
+//===--- RegistryNameList.h ----------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_NAME_LIST_INCLUDED
+#define REGISTRY_NAME_LIST_INCLUDED
+
+#include "Registry/RegistryApi.h"
+
+#include <cstdint>
+#include <iterator>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#pragma warning(push)
+#pragma warning(disable : 4251)
+
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// List of names packed in a single UTF-8 arena.
+    ///
+    /// The characters of all the names are stored back to back in one buffer, and each name is an offset
+    /// and a length into it: filling a list whose size is known up front (see Reserve) costs two allocations,
+    /// whatever the number of names. Both buffers come from the memory resource given at construction, so
+    /// a caller can supply its own arena, e.g. a std::pmr::monotonic_buffer_resource.
+    ///
+    /// The names are views into the arena: they stay valid until the list is modified or destroyed.
+    ///
+    class REGISTRY_API RegistryNameList
+    {
+
+    public:
+        /// Iterator over the names of the list
+        class const_iterator
+        {
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = std::string_view;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = std::string_view;
+
+            const_iterator() noexcept = default;
+
+            const_iterator(const RegistryNameList* list, size_t index) noexcept
+              : _list(list)
+              , _index(index) {}
+
+            std::string_view operator*() const noexcept { return (*_list)[_index]; }
+            std::string_view operator[](difference_type n) const noexcept { return (*_list)[_index + n]; }
+
+            const_iterator& operator++() noexcept { ++_index; return *this; }
+            const_iterator operator++(int) noexcept { auto it = *this; ++_index; return it; }
+            const_iterator& operator--() noexcept { --_index; return *this; }
+            const_iterator operator--(int) noexcept { auto it = *this; --_index; return it; }
+
+            const_iterator& operator+=(difference_type n) noexcept { _index += n; return *this; }
+            const_iterator& operator-=(difference_type n) noexcept { _index -= n; return *this; }
+            const_iterator operator+(difference_type n) const noexcept { return const_iterator(_list, _index + n); }
+            const_iterator operator-(difference_type n) const noexcept { return const_iterator(_list, _index - n); }
+            difference_type operator-(const const_iterator& other) const noexcept {
+                return static_cast<difference_type>(_index) - static_cast<difference_type>(other._index);
+            }
+
+            bool operator==(const const_iterator& other) const noexcept { return _index == other._index; }
+            bool operator!=(const const_iterator& other) const noexcept { return _index != other._index; }
+            bool operator<(const const_iterator& other) const noexcept { return _index < other._index; }
+            bool operator>(const const_iterator& other) const noexcept { return _index > other._index; }
+            bool operator<=(const const_iterator& other) const noexcept { return _index <= other._index; }
+            bool operator>=(const const_iterator& other) const noexcept { return _index >= other._index; }
+
+        private:
+            const RegistryNameList* _list = nullptr;
+            size_t _index = 0;
+        };
+
+    public:
+        ///
+        /// Initialize an empty list.
+        ///
+        /// @param resource Memory resource of the arena and of the offsets.
+        ///
+        explicit RegistryNameList(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Number of names
+        size_t size() const noexcept { return _entries.size(); }
+
+        /// True when the list holds no name
+        bool empty() const noexcept { return _entries.empty(); }
+
+        /// Get a name, by index
+        std::string_view operator[](size_t index) const noexcept {
+            const Entry& entry = _entries[index];
+            return std::string_view(_arena.data() + entry.offset, entry.length);
+        }
+
+        /// First name
+        const_iterator begin() const noexcept { return const_iterator(this, 0); }
+
+        /// Past the last name
+        const_iterator end() const noexcept { return const_iterator(this, _entries.size()); }
+
+        /// Total size of the names, in bytes
+        size_t GetArenaSize() const noexcept { return _arena.size(); }
+
+        /// Memory resource of the list
+        std::pmr::memory_resource* GetResource() const noexcept { return _arena.get_allocator().resource(); }
+
+        //
+        // Operations
+        //
+
+    public:
+        ///
+        /// Reserve room for names, so that filling the list does not reallocate.
+        ///
+        /// @param count Number of names.
+        /// @param bytes Total size of the names, in bytes.
+        ///
+        void Reserve(size_t count, size_t bytes);
+
+        ///
+        /// Append a copy of a name.
+        ///
+        /// @exception std::length_error The arena would exceed 4 GB.
+        ///
+        void PushBack(std::string_view name);
+
+        /// Sort the names case-insensitively, without moving their characters
+        void Sort() noexcept;
+
+        ///
+        /// Find a name, case-insensitively, in a sorted list.
+        ///
+        /// @return The index of the name, or size() if it is not in the list.
+        ///
+        size_t Find(std::string_view name) const noexcept;
+
+        /// Remove all the names, keeping the memory
+        void Clear() noexcept;
+
+        /// Copy the names into strings
+        std::vector<std::string> ToVector() const;
+
+
+    private:
+        /// Position of a name in the arena
+        struct Entry {
+            std::uint32_t offset;
+            std::uint32_t length;
+        };
+
+        /// Characters of the names
+        std::pmr::vector<char> _arena;
+        /// Names, in list order
+        std::pmr::vector<Entry> _entries;
+    };
+
+
+} // namespace registry
+} // namespace abscodes
+
+#pragma warning(pop)
+
+#endif // REGISTRY_NAME_LIST_INCLUDED
@@ -0,0 +1,104 @@
+//===--- RegistryNumberCodec.h -------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_NUMBER_CODEC_INCLUDED
+#define REGISTRY_NUMBER_CODEC_INCLUDED
+
+#include <charconv>
+#include <cstddef>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+
+namespace abscodes {
+namespace registry {
+namespace NumberCodec {
+
+
+    ///
+    /// Size of a buffer large enough for any number written by Format.
+    ///
+    /// The longest outputs are 64-bit integers (20 digits and a sign) and the shortest
+    /// round-trip form of a double, e.g. -2.2250738585072014e-308 (24 characters).
+    ///
+    constexpr size_t BufferSize = 32;
+
+    /// Is T a number handled by the codec?
+    template <typename T>
+    constexpr bool IsNumber = std::is_arithmetic_v<T> && !std::is_same_v<T, bool>;
+
+    ///
+    /// Write a number as text, with std::to_chars.
+    ///
+    /// Integers are written in decimal, floating point numbers in their shortest form that reads back
+    /// to the same value. Nothing is allocated, and the text is not null-terminated.
+    ///
+    /// @param value Number to write.
+    /// @param buffer Output buffer.
+    ///
+    /// @return The text, a view into the buffer.
+    ///
+    template <typename T>
+    std::string_view Format(T value, char (&buffer)[BufferSize]) noexcept {
+        static_assert(IsNumber<T>, "Only numbers can be formatted.");
+
+        // The buffer is large enough for any value, to_chars cannot fail
+        const auto result = std::to_chars(buffer, buffer + BufferSize, value);
+        return std::string_view(buffer, static_cast<size_t>(result.ptr - buffer));
+    }
+
+    ///
+    /// Read a number from text, with std::from_chars.
+    ///
+    /// Leading and trailing blanks, and a leading '+', are skipped; anything else must be part of the number.
+    /// Out of range values, e.g. a negative number read as unsigned, are rejected.
+    ///
+    /// @param text Text to read.
+    /// @param value Number read, left unchanged on failure.
+    ///
+    /// @return false if the text is not a number of type T.
+    ///
+    template <typename T>
+    bool Parse(std::string_view text, T& value) noexcept {
+        static_assert(IsNumber<T>, "Only numbers can be parsed.");
+
+        constexpr std::string_view blanks = " \t\r\n";
+        const size_t first = text.find_first_not_of(blanks);
+        if(first == std::string_view::npos) {
+            return false;
+        }
+        text = text.substr(first, text.find_last_not_of(blanks) - first + 1);
+
+        // from_chars does not accept the plus sign
+        if(text.size() > 1 && text[0] == '+' && text[1] != '-') {
+            text.remove_prefix(1);
+        }
+
+        T parsed {};
+        const char* last = text.data() + text.size();
+        const auto result = std::from_chars(text.data(), last, parsed);
+        if(result.ec != std::errc() || result.ptr != last) {
+            return false;
+        }
+
+        value = parsed;
+        return true;
+    }
+
+
+} // namespace NumberCodec
+} // namespace registry
+} // namespace abscodes
+
+
+#endif // REGISTRY_NUMBER_CODEC_INCLUDED
@@ -0,0 +1,38 @@
+//===--- RegistryNumberEncoding.h ----------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_NUMBER_ENCODING_INCLUDED
+#define REGISTRY_NUMBER_ENCODING_INCLUDED
+
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// Specifies how SetInt, SetUInt, SetLong, SetULong and SetDouble store a number.
+    ///
+    /// The getters read both encodings, so switching a value from one to the other is transparent to the readers.
+    ///
+    enum class RegistryNumberEncoding {
+        /// Decimal text, stored as REG_SZ (the historical format)
+        Text = 0,
+        /// Integers stored as REG_DWORD, or as a sign-extended REG_QWORD when negative; doubles as an 8-byte REG_BINARY
+        Native = 1,
+    };
+
+
+} // namespace registry
+} // namespace abscodes
+
+
+#endif // REGISTRY_NUMBER_ENCODING_INCLUDED
@@ -0,0 +1,46 @@
+//===--- RegistryOpcode.h ------------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_OPCODE_INCLUDED
+#define REGISTRY_OPCODE_INCLUDED
+
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// Specifies the operation described by a RegistryRing submission.
+    ///
+    enum class RegistryOpcode {
+        /// Open the key, so the following operations on it reuse the handle
+        OpenKey = 0,
+        /// Create the key, or open it if it exists
+        CreateKey = 1,
+        /// Read a value
+        GetValue = 2,
+        /// Write a value, creating the key if needed
+        SetValue = 3,
+        /// Delete a value
+        DeleteValue = 4,
+        /// List the subkeys names
+        EnumSubKeys = 5,
+        /// List the values names and types
+        EnumValues = 6,
+    };
+
+
+} // namespace registry
+} // namespace abscodes
+
+
+#endif // REGISTRY_OPCODE_INCLUDED
@@ -0,0 +1,103 @@
+//===--- RegistryPagedArray.h --------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_PAGED_ARRAY_INCLUDED
+#define REGISTRY_PAGED_ARRAY_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// Fixed-capacity array of atomic pointers, allocated by page on first use.
+    ///
+    /// Pages never move once allocated, so a slot is read without locking, and allocating a page is lock-free.
+    /// The pointed objects are not owned.
+    ///
+    template <typename T, size_t PageBits, size_t PageCount>
+    class RegistryPagedArray
+    {
+
+    public:
+        /// Number of slots
+        static constexpr size_t Capacity = PageCount << PageBits;
+
+    public:
+        /// Initialize an array without pages
+        RegistryPagedArray() noexcept {
+            for(auto& page : _pages) {
+                page.store(nullptr, std::memory_order_relaxed);
+            }
+        }
+
+        /// Free the pages
+        ~RegistryPagedArray() noexcept {
+            for(auto& page : _pages) {
+                delete[] page.load(std::memory_order_relaxed);
+            }
+        }
+
+        /// Non copyable
+        RegistryPagedArray(const RegistryPagedArray&) = delete;
+
+        /// Non copyable
+        RegistryPagedArray& operator=(const RegistryPagedArray&) = delete;
+
+        /// Get a slot, or null if its page is not allocated
+        const std::atomic<T*>* Find(size_t index) const noexcept {
+            const size_t page = index >> PageBits;
+            if(page >= PageCount) {
+                return nullptr;
+            }
+            const auto slots = _pages[page].load(std::memory_order_acquire);
+            return slots != nullptr ? &slots[index & (PageSize - 1)] : nullptr;
+        }
+
+        /// Get a slot, allocating its page if needed
+        std::atomic<T*>& Slot(size_t index) {
+            auto& page = _pages[index >> PageBits];
+
+            auto slots = page.load(std::memory_order_acquire);
+            if(slots == nullptr) {
+                // Several threads may race to allocate the page, the first one wins
+                auto allocated = new std::atomic<T*>[PageSize];
+                for(size_t i = 0; i < PageSize; ++i) {
+                    allocated[i].store(nullptr, std::memory_order_relaxed);
+                }
+
+                if(page.compare_exchange_strong(slots, allocated, std::memory_order_acq_rel)) {
+                    slots = allocated;
+                }
+                else {
+                    delete[] allocated;
+                }
+            }
+
+            return slots[index & (PageSize - 1)];
+        }
+
+    private:
+        static constexpr size_t PageSize = size_t(1) << PageBits;
+
+        /// Slots, by page of PageSize slots
+        std::atomic<std::atomic<T*>*> _pages[PageCount];
+    };
+
+
+} // namespace registry
+} // namespace abscodes
+
+#endif // REGISTRY_PAGED_ARRAY_INCLUDED
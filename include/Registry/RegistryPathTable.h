@@ -0,0 +1,165 @@
+//===--- RegistryPathTable.h ---------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_PATH_TABLE_INCLUDED
+#define REGISTRY_PATH_TABLE_INCLUDED
+
+#include "Registry/RegistryApi.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Registry/RegistryPagedArray.h"
+
+#pragma warning(push)
+#pragma warning(disable : 4251)
+
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// Process-wide table of the key paths, each spelling stored once and identified by a small integer.
+    ///
+    /// Paths keep the spelling they were interned with; Equals and GetHash compare them case-insensitively,
+    /// like the registry does, in constant time for the paths differing by their hash. Each ID counts its
+    /// references: the path is freed, and its ID reused, once the last RegistryKey holding it is destroyed,
+    /// so the table holds the paths of the live keys only. References to a stored path stay valid while its
+    /// ID is held.
+    ///
+    class REGISTRY_API RegistryPathTable
+    {
+
+    public:
+        /// Identifier of an interned path
+        using Id = std::uint32_t;
+
+        /// Identifier of the empty path, the root of a hive, never freed
+        static constexpr Id Root = 0;
+
+    public:
+        /// Get the process-wide table, never destroyed so that keys in static storage can outlive it
+        static RegistryPathTable& Instance();
+
+        /// Non copyable
+        RegistryPathTable(const RegistryPathTable&) = delete;
+
+        /// Non copyable
+        RegistryPathTable& operator=(const RegistryPathTable&) = delete;
+
+    private:
+        /// Initialize the table with the empty path
+        RegistryPathTable();
+
+        //
+        // Accessor
+        //
+
+    public:
+        ///
+        /// Get the path of a held ID, without locking.
+        ///
+        /// @param id Path ID.
+        ///
+        /// @exception std::out_of_range
+        ///
+        const std::string& GetPath(Id id) const;
+
+        /// Case-insensitive hash of the path of a held ID
+        size_t GetHash(Id id) const noexcept;
+
+        /// Are the paths of two held IDs equal, case-insensitively?
+        bool Equals(Id lhs, Id rhs) const noexcept;
+
+        /// Number of paths held, the empty path included
+        size_t GetCount() const noexcept;
+
+        //
+        // Operations
+        //
+
+    public:
+        ///
+        /// Get the ID of the path, adding it to the table if needed, and hold it.
+        ///
+        /// @param path Key path, as validated by RegistryKey.
+        ///
+        /// @exception std::overflow_error Too many paths are held.
+        ///
+        Id Intern(std::string_view path);
+
+        /// Release an ID returned by Intern, freeing its path with the last reference
+        void Release(Id id) noexcept;
+
+        //
+        // Internal Operations
+        //
+
+    private:
+        struct Entry;
+
+        /// Entry of a held ID, without locking
+        const Entry* EntryOf(Id id) const noexcept;
+
+        /// Shard of a path
+        size_t ShardOf(std::string_view path) const noexcept;
+
+
+    private:
+        /// A path and its references
+        struct Entry {
+            std::string path;
+            /// Case-insensitive hash of the path
+            size_t hash;
+            /// Number of RegistryKey holding the ID
+            std::atomic<uint32_t> references {1};
+        };
+
+        /// Paths sharing a lock
+        struct Shard {
+            /// Guards ids, and the removal of their entries
+            mutable std::shared_mutex mutex;
+            /// IDs, by exact spelling (views into the entries)
+            std::unordered_map<std::string_view, Id> ids;
+        };
+
+        static constexpr size_t ShardCount = 16;
+
+        /// Shards
+        Shard _shards[ShardCount];
+        /// Entry of each ID
+        RegistryPagedArray<Entry, 12, 4096> _entries;
+        /// Guards the free IDs
+        std::mutex _freeMutex;
+        /// IDs freed, reused first
+        std::vector<Id> _free;
+        /// Next ID never used
+        Id _next = 0;
+        /// Number of IDs held
+        std::atomic<size_t> _count {0};
+    };
+
+
+} // namespace registry
+} // namespace abscodes
+
+#pragma warning(pop)
+
+#endif // REGISTRY_PATH_TABLE_INCLUDED
@@ -0,0 +1,296 @@
+//===--- RegistryPrefetch.h ----------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_PREFETCH_INCLUDED
+#define REGISTRY_PREFETCH_INCLUDED
+
+#include "Registry/RegistryApi.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Registry/RegistryIoPool.h"
+#include "Registry/RegistryName.h"
+#include "Registry/RegistrySettings.h"
+#include "Registry/RegistryValue.h"
+
+#pragma warning(push)
+#pragma warning(disable : 4251)
+
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// Ordered set of (key, value) pairs read by a process, to prefetch on its next launch.
+    ///
+    /// The serialized form starts with a "RegistryPrefetch 1" line, followed by the key path and the value
+    /// name of each pair, each NUL-terminated.
+    ///
+    class REGISTRY_API RegistryPrefetchProfile
+    {
+
+    public:
+        /// A key path and a value name
+        using Entry = std::pair<std::string, std::string>;
+
+    public:
+        ///
+        /// Initialize an empty profile.
+        ///
+        RegistryPrefetchProfile() = default;
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Number of pairs
+        size_t GetSize() const noexcept;
+
+        /// Does the profile hold no pair?
+        bool IsEmpty() const noexcept;
+
+        /// Pairs, in the order they were first added
+        const std::vector<Entry>& GetEntries() const noexcept;
+
+        //
+        // Operations
+        //
+
+    public:
+        ///
+        /// Add a pair, unless the profile already holds it.
+        ///
+        /// @return false if the profile already holds the pair.
+        ///
+        bool Add(const std::string& keyName, const std::string& valueName);
+
+        /// Remove all the pairs
+        void Clear();
+
+        /// Serialize the profile
+        std::string Serialize() const;
+
+        ///
+        /// Read a serialized profile.
+        ///
+        /// @exception RegistryException The profile is invalid (ERROR_INVALID_DATA).
+        ///
+        static RegistryPrefetchProfile Parse(std::string_view text);
+
+        ///
+        /// Write the profile into a file, replaced if it exists.
+        ///
+        /// @param fileName Path to the file, in UTF-8.
+        ///
+        /// @exception RegistryException
+        ///
+        void Save(const std::string& fileName) const;
+
+        ///
+        /// Read a profile from a file.
+        ///
+        /// @param fileName Path to the file, in UTF-8.
+        ///
+        /// @exception RegistryException The file cannot be read (the error of the Windows API) or is invalid (ERROR_INVALID_DATA).
+        ///
+        static RegistryPrefetchProfile Load(const std::string& fileName);
+
+
+    private:
+        /// Pairs, in the order they were first added
+        std::vector<Entry> _entries;
+        /// Value names of each key, to find the duplicates
+        std::map<std::string, std::set<std::string, Name::Less>, Name::Less> _index;
+    };
+
+
+    ///
+    /// Records the (key, value) pairs read during a startup window, to build a prefetch profile.
+    ///
+    /// Recording is opt-in: nothing is recorded but what is passed to Record, e.g. by a RegistryPrefetcher.
+    /// Record can be called from several threads at once.
+    ///
+    class REGISTRY_API RegistryPrefetchRecorder
+    {
+
+    public:
+        ///
+        /// Start recording.
+        ///
+        /// @param window Duration of the recording, from now.
+        ///
+        explicit RegistryPrefetchRecorder(std::chrono::milliseconds window = std::chrono::seconds(1));
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Is the recorder still recording?
+        bool IsRecording() const noexcept;
+
+        /// Get a copy of the pairs recorded so far
+        RegistryPrefetchProfile GetProfile() const;
+
+        //
+        // Operations
+        //
+
+    public:
+        ///
+        /// Record a read, unless the window is over.
+        ///
+        /// @return false if the read was not recorded, because the window is over.
+        ///
+        bool Record(const std::string& keyName, const std::string& valueName);
+
+        /// Stop recording before the end of the window
+        void Stop() noexcept;
+
+
+    private:
+        /// Guards the recorded pairs
+        mutable std::mutex _mutex;
+        /// Recorded pairs
+        RegistryPrefetchProfile _profile;
+        /// End of the window
+        const std::chrono::steady_clock::time_point _end;
+        /// Tells if the recording was stopped
+        std::atomic<bool> _stopped {false};
+    };
+
+
+    ///
+    /// Reads the values of a prefetch profile in parallel, so that the first reads of the application hit.
+    ///
+    /// Start queues one batched read per key of the profile on an I/O pool. GetValue then answers the first
+    /// read of each prefetched value, waiting for its key if it is still in flight; later reads, and reads of
+    /// values that are not in the profile, go to the store. Reads can be recorded for the next launch.
+    ///
+    class REGISTRY_API RegistryPrefetcher
+    {
+
+    public:
+        /// Hit rate metrics
+        struct Statistics {
+            /// Number of values queued by Start
+            size_t prefetched = 0;
+            /// Number of reads answered by a prefetched value
+            size_t hits = 0;
+            /// Number of hits that waited for their key to be read
+            size_t waits = 0;
+            /// Number of reads that went to the store
+            size_t misses = 0;
+
+            /// Ratio of hits among the reads, or 0 without read
+            double GetHitRate() const noexcept;
+        };
+
+    public:
+        ///
+        /// Initialize a prefetcher.
+        ///
+        /// @param store Store to read, not owned: it must outlive the prefetcher.
+        /// @param pool Pool running the prefetch reads, not owned.
+        /// @param recorder Recorder of the reads, if any, not owned.
+        ///
+        explicit RegistryPrefetcher(RegistrySettingsStore& store,
+                                    RegistryIoPool& pool = RegistryIoPool::Default(),
+                                    RegistryPrefetchRecorder* recorder = nullptr);
+
+        /// Wait for the prefetch reads in flight
+        ~RegistryPrefetcher() noexcept;
+
+        /// Non copyable
+        RegistryPrefetcher(const RegistryPrefetcher&) = delete;
+
+        /// Non copyable
+        RegistryPrefetcher& operator=(const RegistryPrefetcher&) = delete;
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Hit rate metrics
+        Statistics GetStatistics() const;
+
+        //
+        // Operations
+        //
+
+    public:
+        ///
+        /// Queue the reads of a profile, one per key, in the order of the profile.
+        ///
+        void Start(const RegistryPrefetchProfile& profile);
+
+        /// Wait for the prefetch reads in flight
+        void Wait() const;
+
+        ///
+        /// Read a value, from the prefetched values if possible.
+        ///
+        /// @return The value, or an empty value (REG_NONE) if it doesn't exist.
+        ///
+        RegistryValue GetValue(const std::string& keyName, const std::string& valueName);
+
+        /// Wait for the prefetch reads in flight, then drop the prefetched values not read yet; not concurrent with Start
+        void Clear();
+
+        //
+        // Internal Operations
+        //
+
+    private:
+        /// Prefetched values of a key
+        struct Key {
+            /// Index of each value in the read result, and whether it was served
+            std::map<std::string, std::pair<size_t, bool>, Name::Less> values;
+            /// Values, in the order of the indexes; not valid until the read is queued
+            std::shared_future<std::vector<RegistryValue>> result;
+        };
+
+
+    private:
+        /// Store to read, not owned
+        RegistrySettingsStore& _store;
+        /// Pool running the prefetch reads, not owned
+        RegistryIoPool& _pool;
+        /// Recorder of the reads, not owned
+        RegistryPrefetchRecorder* _recorder;
+        /// Guards the prefetched keys and the metrics
+        mutable std::mutex _mutex;
+        /// Prefetched keys, by normalized path
+        std::map<std::string, Key, Name::Less> _keys;
+        /// Metrics
+        Statistics _statistics;
+    };
+
+
+} // namespace registry
+} // namespace abscodes
+
+#pragma warning(pop)
+
+#endif // REGISTRY_PREFETCH_INCLUDED
@@ -0,0 +1,348 @@
+//===--- RegistryRing.h --------------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_RING_INCLUDED
+#define REGISTRY_RING_INCLUDED
+
+#include "Registry/RegistryApi.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Registry/RegistryKey.h"
+#include "Registry/RegistryName.h"
+#include "Registry/RegistryOpcode.h"
+#include "Registry/RegistryValue.h"
+
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#pragma warning(disable : 4324) // structure was padded due to alignment specifier
+
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// Lock-free bounded multi-producer multi-consumer queue.
+    ///
+    /// Each cell carries a sequence number telling whether it is ready to be written or read,
+    /// so producers and consumers only contend on their own index.
+    ///
+    template <typename T>
+    class RegistryRingBuffer
+    {
+
+    public:
+        ///
+        /// Allocate the cells.
+        ///
+        /// @param capacity Minimum number of cells, rounded up to a power of two.
+        ///
+        explicit RegistryRingBuffer(size_t capacity)
+          : _mask(RoundUp(capacity) - 1)
+          , _cells(new Cell[_mask + 1]) {
+            for(size_t i = 0; i <= _mask; ++i) {
+                _cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        /// Non copyable
+        RegistryRingBuffer(const RegistryRingBuffer&) = delete;
+
+        /// Non copyable
+        RegistryRingBuffer& operator=(const RegistryRingBuffer&) = delete;
+
+        /// Number of cells
+        size_t Capacity() const noexcept {
+            return _mask + 1;
+        }
+
+        /// Is the ring empty? Only a hint when other threads use the ring
+        bool IsEmpty() const noexcept {
+            const size_t position = _dequeue.load(std::memory_order_relaxed);
+            return static_cast<std::ptrdiff_t>(_cells[position & _mask].sequence.load(std::memory_order_acquire) - (position + 1)) < 0;
+        }
+
+        ///
+        /// Push an item, unless the ring is full.
+        ///
+        /// @param item The item, only moved from on success.
+        ///
+        bool TryPush(T& item) {
+            Cell* cell;
+            size_t position = _enqueue.load(std::memory_order_relaxed);
+            for(;;) {
+                cell = &_cells[position & _mask];
+                const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                const auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+                if(difference == 0) {
+                    if(_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                }
+                else if(difference < 0) {
+                    // Full
+                    return false;
+                }
+                else {
+                    position = _enqueue.load(std::memory_order_relaxed);
+                }
+            }
+
+            cell->data = std::move(item);
+            cell->sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        ///
+        /// Pop an item, unless the ring is empty.
+        ///
+        /// @param item Receives the item.
+        ///
+        bool TryPop(T& item) {
+            Cell* cell;
+            size_t position = _dequeue.load(std::memory_order_relaxed);
+            for(;;) {
+                cell = &_cells[position & _mask];
+                const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                const auto difference = static_cast<std::ptrdiff_t>(sequence - (position + 1));
+                if(difference == 0) {
+                    if(_dequeue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                }
+                else if(difference < 0) {
+                    // Empty
+                    return false;
+                }
+                else {
+                    position = _dequeue.load(std::memory_order_relaxed);
+                }
+            }
+
+            item = std::move(cell->data);
+            cell->sequence.store(position + _mask + 1, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        struct Cell {
+            std::atomic<size_t> sequence;
+            T data;
+        };
+
+        static size_t RoundUp(size_t capacity) noexcept {
+            size_t size = 2;
+            while(size < capacity) {
+                size <<= 1;
+            }
+            return size;
+        }
+
+        const size_t _mask;
+        std::unique_ptr<Cell[]> _cells;
+        /// Producers and consumers indexes live on their own cache line
+        alignas(64) std::atomic<size_t> _enqueue {0};
+        alignas(64) std::atomic<size_t> _dequeue {0};
+    };
+
+
+    ///
+    /// Operation pushed into a RegistryRing.
+    ///
+    struct RegistrySubmission {
+        /// Operation to run
+        RegistryOpcode opcode = RegistryOpcode::OpenKey;
+        /// Opaque value copied to the completion
+        unsigned long long userData = 0;
+        /// Path of the key, relative to the ring root key
+        std::string keyName;
+        /// Name of the value, for value operations
+        std::string valueName;
+        /// Value to write, for SetValue
+        RegistryValue value;
+    };
+
+
+    ///
+    /// Result of a RegistrySubmission, polled from a RegistryRing.
+    ///
+    struct RegistryCompletion {
+        /// Operation that was run
+        RegistryOpcode opcode = RegistryOpcode::OpenKey;
+        /// Opaque value copied from the submission
+        unsigned long long userData = 0;
+        /// ERROR_SUCCESS, or the error code of the failed operation
+        LONG errorCode = ERROR_SUCCESS;
+        /// Error message, when the operation failed
+        std::string message;
+        /// Value read, for GetValue
+        RegistryValue value;
+        /// Subkeys names, for EnumSubKeys
+        std::vector<std::string> subKeys;
+        /// Values names and types, for EnumValues
+        std::vector<std::pair<std::string, RegistryValueType>> values;
+    };
+
+
+    ///
+    /// Submission/completion rings processing registry operations in batches.
+    ///
+    /// Producers push operations into the lock-free submission ring. A worker thread drains it in
+    /// batches, groups the operations of a batch by key (operations on the same key keep their
+    /// order), reuses the key handles it has already opened, and pushes the results into the
+    /// completion ring, which consumers poll.
+    ///
+    /// The worker stops draining while the completion ring is full, so completions must be
+    /// polled for Submit to make progress.
+    ///
+    class REGISTRY_API RegistryRing
+    {
+
+    public:
+        /// Throughput metrics
+        struct Statistics {
+            /// Number of operations submitted
+            unsigned long long submitted = 0;
+            /// Number of operations completed
+            unsigned long long completed = 0;
+            /// Number of batches drained
+            unsigned long long batches = 0;
+            /// Number of operations which reused an open handle
+            unsigned long long handleHits = 0;
+            /// Number of operations which opened a handle
+            unsigned long long handleMisses = 0;
+        };
+
+    public:
+        ///
+        /// Start the worker.
+        ///
+        /// @param root Key the submissions paths are relative to, owned by the ring.
+        /// @param capacity Minimum number of entries of each ring.
+        /// @param batchSize Maximum number of operations drained at once.
+        /// @param handleCacheSize Maximum number of handles kept open.
+        ///
+        explicit RegistryRing(RegistryKey root, size_t capacity = 1024, size_t batchSize = 64, size_t handleCacheSize = 64);
+
+        /// Process the submitted operations, and stop the worker
+        ~RegistryRing() noexcept;
+
+        /// Non copyable
+        RegistryRing(const RegistryRing&) = delete;
+
+        /// Non copyable
+        RegistryRing& operator=(const RegistryRing&) = delete;
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Throughput metrics
+        Statistics GetStatistics() const noexcept;
+
+        //
+        // Operations
+        //
+
+    public:
+        ///
+        /// Push an operation, unless the submission ring is full.
+        ///
+        /// @param submission The operation, only moved from on success.
+        ///
+        bool TrySubmit(RegistrySubmission& submission);
+
+        ///
+        /// Push an operation, yielding while the submission ring is full.
+        ///
+        /// @param submission The operation.
+        ///
+        void Submit(RegistrySubmission submission);
+
+        ///
+        /// Pop a completion, unless there is none.
+        ///
+        /// @param completion Receives the completion.
+        ///
+        bool TryPoll(RegistryCompletion& completion);
+
+        ///
+        /// Pop a completion, yielding until there is one.
+        ///
+        RegistryCompletion Poll();
+
+        //
+        // Internal Operations
+        //
+
+    private:
+        /// Worker loop
+        void Run();
+
+        /// Run an operation
+        void Process(const std::string& keyName, RegistrySubmission& submission, RegistryCompletion& completion);
+
+        /// Get an open handle to the key, from the cache when possible
+        RegistryKey& Acquire(const std::string& keyName, bool create);
+
+        /// Wake up the worker if it is sleeping
+        void Notify();
+
+
+    private:
+        /// Root key
+        RegistryKey _root;
+        /// Pending operations
+        RegistryRingBuffer<RegistrySubmission> _submissions;
+        /// Results waiting to be polled
+        RegistryRingBuffer<RegistryCompletion> _completions;
+        /// Maximum number of operations drained at once
+        const size_t _batchSize;
+        /// Maximum number of cached handles
+        const size_t _handleCacheSize;
+        /// Open handles, by key path (worker thread only)
+        std::unordered_map<std::string, RegistryKey, Name::Hasher, Name::EqualTo> _handles;
+
+        /// Worker sleep
+        std::mutex _mutex;
+        std::condition_variable _wakeUp;
+        std::atomic<bool> _sleeping {false};
+        std::atomic<bool> _stop {false};
+
+        /// Metrics
+        std::atomic<unsigned long long> _submitted {0};
+        std::atomic<unsigned long long> _completed {0};
+        std::atomic<unsigned long long> _batches {0};
+        std::atomic<unsigned long long> _handleHits {0};
+        std::atomic<unsigned long long> _handleMisses {0};
+
+        /// Worker thread, started last
+        std::thread _worker;
+    };
+
+
+} // namespace registry
+} // namespace abscodes
+
+#pragma warning(pop)
+
+#endif // REGISTRY_RING_INCLUDED
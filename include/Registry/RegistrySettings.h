@@ -0,0 +1,543 @@
+//===--- RegistrySettings.h ----------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_SETTINGS_INCLUDED
+#define REGISTRY_SETTINGS_INCLUDED
+
+#include "Registry/RegistryApi.h"
+
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Registry/RegistryKey.h"
+#include "Registry/RegistryName.h"
+#include "Registry/RegistryTypeTraits.h"
+#include "Registry/RegistryValue.h"
+#include "Registry/RegistryWriteBatch.h"
+
+#pragma warning(push)
+#pragma warning(disable : 4251)
+
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// Where a RegistryBinder reads and writes its settings.
+    ///
+    /// RegistryKeyStore is the registry itself; MemorySettingsStore stands in for it, e.g. in tests.
+    ///
+    class REGISTRY_API RegistrySettingsStore
+    {
+
+    public:
+        virtual ~RegistrySettingsStore() = default;
+
+        ///
+        ///
+        /// Read several values of one key at once.
+        ///
+        /// A store allows several threads to read at once, e.g. the prefetch pool and the application; it doesn't
+        /// synchronize a read with Commit, which the caller must not run concurrently with any other call.
+        ///
+        /// @param keyName Path to the key, relative to the root of the store.
+        /// @param valueNames Names of the values.
+        ///
+        /// @return The values, in the order of the names. A missing key or value is empty (REG_NONE), and so is
+        ///         a value that cannot be decoded.
+        ///
+        virtual std::vector<RegistryValue> ReadValues(const std::string& keyName, const std::vector<std::string>& valueNames) = 0;
+
+        ///
+        /// Apply the operations of the batch, then clear it.
+        ///
+        /// @return The operations that could not be applied.
+        ///
+        virtual std::vector<RegistryWriteBatch::Failure> Commit(RegistryWriteBatch& batch) = 0;
+    };
+
+
+    ///
+    /// Settings store backed by a registry key.
+    ///
+    /// Each read opens the key once and gets all its values with a single RegQueryMultipleValues call.
+    ///
+    class REGISTRY_API RegistryKeyStore : public RegistrySettingsStore
+    {
+
+    public:
+        ///
+        /// Initialize a store under the root key.
+        ///
+        /// @param root Root key, not owned: it must outlive the store.
+        ///
+        explicit RegistryKeyStore(RegistryKey& root) noexcept;
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Number of calls to ReadValues, i.e. of key opens and batched reads
+        size_t GetReadCount() const noexcept;
+
+        //
+        // Operations
+        //
+
+    public:
+        std::vector<RegistryValue> ReadValues(const std::string& keyName, const std::vector<std::string>& valueNames) override;
+
+        std::vector<RegistryWriteBatch::Failure> Commit(RegistryWriteBatch& batch) override;
+
+
+    private:
+        /// Root key, not owned
+        RegistryKey& _root;
+        /// Number of calls to ReadValues
+        std::atomic<size_t> _reads {0};
+    };
+
+
+    ///
+    /// Settings store kept in memory, standing in for the registry.
+    ///
+    class REGISTRY_API MemorySettingsStore : public RegistrySettingsStore
+    {
+
+    public:
+        ///
+        /// Initialize an empty store.
+        ///
+        MemorySettingsStore() = default;
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Number of calls to ReadValues
+        size_t GetReadCount() const noexcept;
+
+        /// Number of values written by Commit
+        size_t GetWriteCount() const noexcept;
+
+        /// Get a value, or an empty value if it doesn't exist
+        RegistryValue GetValue(const std::string& keyName, const std::string& valueName) const;
+
+        /// Set a value, without counting it as a write
+        void SetValue(const std::string& keyName, const std::string& valueName, const RegistryValue& value);
+
+        //
+        // Operations
+        //
+
+    public:
+        std::vector<RegistryValue> ReadValues(const std::string& keyName, const std::vector<std::string>& valueNames) override;
+
+        std::vector<RegistryWriteBatch::Failure> Commit(RegistryWriteBatch& batch) override;
+
+
+    private:
+        /// Values of a key, sorted by name
+        using KeyValues = std::map<std::string, RegistryValue, Name::Less>;
+
+        /// Keys, sorted by normalized path
+        std::map<std::string, KeyValues, Name::Less> _keys;
+        /// Number of calls to ReadValues
+        std::atomic<size_t> _reads {0};
+        /// Number of values written by Commit
+        size_t _writes = 0;
+    };
+
+
+    ///
+    /// Conversions between a C++ type and a RegistryValue, following RegistryTypeTraits.
+    ///
+    namespace SettingsValue {
+
+        ///
+        /// Convert a RegistryValue to T.
+        ///
+        /// @return false, leaving result unchanged, if the value is not of the registry type of T.
+        ///
+        template <typename T>
+        bool FromValue(const RegistryValue& value, T& result) {
+            using Traits = RegistryTypeTraits<T>;
+            static_assert(IsRegistryType<T>, "This type cannot be read from the registry, see RegistryTypeTraits.");
+
+            if(value.GetType() != Traits::Type) {
+                return false;
+            }
+
+            if constexpr(Traits::Storage == RegistryStorage::Scalar) {
+                if constexpr(std::is_same_v<typename Traits::StorageType, DWORD>) {
+                    result = Traits::FromStorage(value.DWord());
+                }
+                else if constexpr(std::is_same_v<typename Traits::StorageType, ULONGLONG>) {
+                    result = Traits::FromStorage(value.QWord());
+                }
+                else {
+                    if(value.Binary().size() != sizeof(T)) {
+                        return false;
+                    }
+                    std::memcpy(&result, value.Binary().data(), sizeof(T));
+                }
+            }
+            else if constexpr(Traits::Storage == RegistryStorage::String) {
+                static_assert(std::is_same_v<T, std::string>, "Strings are read as std::string.");
+                result = value.String();
+            }
+            else if constexpr(Traits::Storage == RegistryStorage::MultiString) {
+                result = value.MultiString();
+            }
+            else {
+                const auto first = reinterpret_cast<const typename T::value_type*>(value.Binary().data());
+                result.assign(first, first + value.Binary().size());
+            }
+
+            return true;
+        }
+
+        /// Convert T to a RegistryValue of its registry type
+        template <typename T>
+        RegistryValue ToValue(const T& source) {
+            using Traits = RegistryTypeTraits<T>;
+            static_assert(IsRegistryType<T>, "This type cannot be written to the registry, see RegistryTypeTraits.");
+
+            RegistryValue value(Traits::Type);
+
+            if constexpr(Traits::Storage == RegistryStorage::Scalar) {
+                if constexpr(std::is_same_v<typename Traits::StorageType, DWORD>) {
+                    value.DWord() = Traits::ToStorage(source);
+                }
+                else if constexpr(std::is_same_v<typename Traits::StorageType, ULONGLONG>) {
+                    value.QWord() = Traits::ToStorage(source);
+                }
+                else {
+                    const auto first = reinterpret_cast<const BYTE*>(&source);
+                    value.Binary().assign(first, first + sizeof(T));
+                }
+            }
+            else if constexpr(Traits::Storage == RegistryStorage::String) {
+                value.String() = source;
+            }
+            else if constexpr(Traits::Storage == RegistryStorage::MultiString) {
+                value.MultiString() = source;
+            }
+            else {
+                const auto first = reinterpret_cast<const BYTE*>(source.data());
+                value.Binary().assign(first, first + source.size());
+            }
+
+            return value;
+        }
+
+        /// Can two values of type T be compared with operator==?
+        template <typename T, typename = void>
+        constexpr bool IsEqualityComparable = false;
+
+        template <typename T>
+        constexpr bool IsEqualityComparable<T, std::void_t<decltype(std::declval<const T&>() == std::declval<const T&>())>> = true;
+
+        ///
+        /// Compare two values of type T, with its operator==.
+        ///
+        /// Structures are not compared as their bytes, which include the padding.
+        ///
+        template <typename T>
+        bool Equals(const T& lhs, const T& rhs) {
+            static_assert(IsEqualityComparable<T>, "A bound structure needs an operator==.");
+            return lhs == rhs;
+        }
+
+    } // namespace SettingsValue
+
+
+    template <typename Settings>
+    class RegistryBinder;
+
+    ///
+    /// Declarative binding of the members of a settings structure to registry values.
+    ///
+    /// Each member is bound to a (subpath, value name, type, default) tuple, the type being the one of the member,
+    /// mapped at compile time by RegistryTypeTraits. Members are grouped by subpath, so that a RegistryBinder
+    /// reads each key once.
+    ///
+    template <typename Settings>
+    class RegistrySchema
+    {
+        friend class RegistryBinder<Settings>;
+
+    public:
+        ///
+        /// Initialize an empty schema.
+        ///
+        RegistrySchema() = default;
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Number of bound members
+        size_t GetFieldCount() const noexcept {
+            size_t count = 0;
+            for(const auto& group : _groups) {
+                count += group.fields.size();
+            }
+            return count;
+        }
+
+        /// Number of distinct subpaths, i.e. of keys read by a load
+        size_t GetKeyCount() const noexcept {
+            return _groups.size();
+        }
+
+        //
+        // Operations
+        //
+
+    public:
+        ///
+        /// Bind a member to a registry value.
+        ///
+        /// @param keyName Path to the key, relative to the root of the store.
+        /// @param valueName Name of the value.
+        /// @param member Member of the settings.
+        /// @param defaultValue Value of the member when the registry value is missing, or has another type.
+        ///
+        template <typename T>
+        RegistrySchema& Bind(const std::string& keyName, const std::string& valueName, T Settings::*member, T defaultValue = T()) {
+            static_assert(IsRegistryType<T>, "This type cannot be bound to the registry, see RegistryTypeTraits.");
+
+            Field field;
+            field.valueName = valueName;
+            field.load = [member, defaultValue](Settings& settings, const RegistryValue& value) {
+                if(!SettingsValue::FromValue(value, settings.*member)) {
+                    settings.*member = defaultValue;
+                }
+            };
+            field.save = [member](const Settings& settings) {
+                return SettingsValue::ToValue(settings.*member);
+            };
+            field.equals = [member](const Settings& lhs, const Settings& rhs) {
+                return SettingsValue::Equals(lhs.*member, rhs.*member);
+            };
+            field.copy = [member](Settings& to, const Settings& from) {
+                to.*member = from.*member;
+            };
+
+            Group& group = GetGroup(keyName);
+            group.valueNames.push_back(valueName);
+            group.fields.push_back(std::move(field));
+            return *this;
+        }
+
+
+    private:
+        /// A bound member, type-erased
+        struct Field {
+            std::string valueName;
+            /// Set the member from a value, or to its default
+            std::function<void(Settings&, const RegistryValue&)> load;
+            /// Convert the member to a value
+            std::function<RegistryValue(const Settings&)> save;
+            /// Compare the member of two settings
+            std::function<bool(const Settings&, const Settings&)> equals;
+            /// Copy the member from other settings
+            std::function<void(Settings&, const Settings&)> copy;
+        };
+
+        /// Members bound to the values of one key
+        struct Group {
+            /// Normalized path of the key
+            std::string keyName;
+            /// Names of the values, in the order of the fields
+            std::vector<std::string> valueNames;
+            std::vector<Field> fields;
+        };
+
+        /// Find or add the group of a key
+        Group& GetGroup(const std::string& keyName) {
+            const std::string path = Name::Normalize(keyName);
+            for(auto& group : _groups) {
+                if(Name::Equals(group.keyName, path)) {
+                    return group;
+                }
+            }
+            _groups.emplace_back();
+            _groups.back().keyName = path;
+            return _groups.back();
+        }
+
+        /// Groups, in the order of their first binding
+        std::vector<Group> _groups;
+    };
+
+
+    ///
+    /// Loads and saves a settings structure as described by a RegistrySchema.
+    ///
+    /// A load reads each key of the schema once, all its values at once, and never throws for a missing
+    /// or mistyped value: the member gets its default. The binder keeps a copy of the settings as last
+    /// loaded or saved, so that a save writes only the members modified since, in one RegistryWriteBatch.
+    ///
+    /// The schema and the store must outlive the binder.
+    ///
+    template <typename Settings>
+    class RegistryBinder
+    {
+
+    public:
+        ///
+        /// Initialize the settings with the defaults of the schema, without reading the store.
+        ///
+        RegistryBinder(const RegistrySchema<Settings>& schema, RegistrySettingsStore& store)
+          : _schema(schema)
+          , _store(store) {
+            const RegistryValue empty;
+            for(const auto& group : _schema._groups) {
+                for(const auto& field : group.fields) {
+                    field.load(_settings, empty);
+                }
+            }
+            _saved = _settings;
+        }
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Current settings
+        Settings& Get() noexcept {
+            return _settings;
+        }
+
+        /// Current settings
+        const Settings& Get() const noexcept {
+            return _settings;
+        }
+
+        /// Number of members modified since the last load or save
+        size_t GetDirtyCount() const {
+            size_t count = 0;
+            for(const auto& group : _schema._groups) {
+                for(const auto& field : group.fields) {
+                    count += field.equals(_settings, _saved) ? 0 : 1;
+                }
+            }
+            return count;
+        }
+
+        /// Is any member modified since the last load or save?
+        bool IsDirty() const {
+            return GetDirtyCount() != 0;
+        }
+
+        //
+        // Operations
+        //
+
+    public:
+        ///
+        /// Read all the members from the store, one read per key of the schema.
+        ///
+        /// @return The settings loaded.
+        ///
+        /// @exception RegistryException An error other than a missing key or value.
+        ///
+        const Settings& Load() {
+            for(const auto& group : _schema._groups) {
+                const std::vector<RegistryValue> values = _store.ReadValues(group.keyName, group.valueNames);
+                for(size_t i = 0; i < group.fields.size(); ++i) {
+                    group.fields[i].load(_settings, values[i]);
+                }
+            }
+            _saved = _settings;
+            return _settings;
+        }
+
+        ///
+        /// Write the modified members to the store, in one batch.
+        ///
+        /// Members that could not be written stay modified, so that a later save retries them.
+        ///
+        /// @return The writes that failed.
+        ///
+        std::vector<RegistryWriteBatch::Failure> Save() {
+            RegistryWriteBatch batch;
+            for(const auto& group : _schema._groups) {
+                for(const auto& field : group.fields) {
+                    if(!field.equals(_settings, _saved)) {
+                        batch.SetValue(group.keyName, field.valueName, field.save(_settings));
+                    }
+                }
+            }
+
+            if(batch.IsEmpty()) {
+                return {};
+            }
+
+            std::vector<RegistryWriteBatch::Failure> failures = _store.Commit(batch);
+
+            for(const auto& group : _schema._groups) {
+                for(const auto& field : group.fields) {
+                    if(!IsFailed(failures, group.keyName, field.valueName)) {
+                        field.copy(_saved, _settings);
+                    }
+                }
+            }
+
+            return failures;
+        }
+
+        /// Discard the modifications made since the last load or save
+        void Revert() {
+            _settings = _saved;
+        }
+
+
+    private:
+        /// Did the write of the value fail, by itself or because its key could not be opened?
+        static bool IsFailed(const std::vector<RegistryWriteBatch::Failure>& failures, const std::string& keyName, const std::string& valueName) {
+            for(const auto& failure : failures) {
+                if(Name::Equals(failure.keyName, keyName) && (failure.valueName.empty() || Name::Equals(failure.valueName, valueName))) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        const RegistrySchema<Settings>& _schema;
+        RegistrySettingsStore& _store;
+        /// Current settings
+        Settings _settings {};
+        /// Settings as last loaded or saved
+        Settings _saved {};
+    };
+
+
+} // namespace registry
+} // namespace abscodes
+
+#pragma warning(pop)
+
+#endif // REGISTRY_SETTINGS_INCLUDED
@@ -0,0 +1,252 @@
+//===--- RegistrySharedSnapshot.h ----------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_SHARED_SNAPSHOT_INCLUDED
+#define REGISTRY_SHARED_SNAPSHOT_INCLUDED
+
+#include "Registry/RegistryApi.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Registry/RegistryKey.h"
+#include "Registry/RegistrySnapshot.h"
+
+#pragma warning(push)
+#pragma warning(disable : 4251)
+
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// Publishes snapshot images into a shared memory segment, for RegistrySharedReader.
+    ///
+    /// The segment holds a small header and two slots: each publication writes the slot the current version
+    /// doesn't use, then moves the sequence number, seqlock style. Readers never wait for the publisher,
+    /// and a publication never waits for the readers.
+    ///
+    /// A single publisher writes a segment at a time.
+    ///
+    class REGISTRY_API RegistrySharedPublisher
+    {
+
+    public:
+        ///
+        /// Create a named segment, shared with the other processes of the session.
+        ///
+        /// A segment still held by readers, e.g. when the publisher restarts, is reused if it has the same layout
+        /// and at least the capacity: publications carry on from its last version. Its previous publisher must
+        /// be gone.
+        ///
+        /// @param name Name of the file mapping, e.g. "Local\\MyConfiguration".
+        /// @param capacity Largest image the segment holds, in bytes.
+        ///
+        /// @exception RegistryException The mapping cannot be created, or exists with another layout or a smaller
+        /// capacity (ERROR_ALREADY_EXISTS).
+        ///
+        RegistrySharedPublisher(const std::string& name, size_t capacity);
+
+        ///
+        /// Use a memory region as segment, not owned: it must outlive the publisher.
+        ///
+        /// @param memory Region, aligned on 8 bytes.
+        /// @param size Size of the region, see GetSegmentSize.
+        ///
+        /// @exception std::invalid_argument The region is too small or not aligned.
+        ///
+        RegistrySharedPublisher(void* memory, size_t size);
+
+        /// Unmap the segment, if owned
+        ~RegistrySharedPublisher() noexcept;
+
+        /// Non copyable
+        RegistrySharedPublisher(const RegistrySharedPublisher&) = delete;
+
+        /// Non copyable
+        RegistrySharedPublisher& operator=(const RegistrySharedPublisher&) = delete;
+
+        /// Size of a segment holding images of the capacity
+        static size_t GetSegmentSize(size_t capacity) noexcept;
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Largest image the segment holds, in bytes
+        size_t GetCapacity() const noexcept;
+
+        /// Number of images published, 0 if none
+        unsigned long long GetVersion() const noexcept;
+
+        //
+        // Operations
+        //
+
+    public:
+        ///
+        /// Publish an image.
+        ///
+        /// @exception std::length_error The image exceeds the capacity of the segment.
+        ///
+        void Publish(const std::vector<BYTE>& image);
+
+        /// Publish the image of the builder
+        void Publish(const RegistrySnapshotBuilder& builder);
+
+        ///
+        /// Publish a registry key and all its subkeys and values.
+        ///
+        /// @exception RegistryException
+        ///
+        void Publish(const RegistryKey& key);
+
+        //
+        // Internal Operations
+        //
+
+    private:
+        /// Initialize the header of the segment
+        void Initialize(size_t capacity);
+
+        /// Unmap the segment, if owned
+        void Dispose() noexcept;
+
+
+    private:
+        /// The segment
+        BYTE* _segment = nullptr;
+        /// Mapping handle, if owned
+        HANDLE _hMapping = nullptr;
+    };
+
+
+    ///
+    /// Reads the snapshot images published into a shared memory segment by RegistrySharedPublisher.
+    ///
+    /// Refresh copies the current image into the reader, checking the sequence number around the copy
+    /// and retrying if the slot was overwritten meanwhile: it never waits for the publisher. The keys are
+    /// then read from the copy, with the RegistrySnapshot API. Each copy is immutable, and shared with its
+    /// keys: keys opened before a Refresh keep reading the previous image, freed with the last of them.
+    ///
+    /// The image is copied rather than read in place on purpose. RegistrySnapshot checks every offset of
+    /// an image once, then lookups trust them; a slot overwritten during a lookup would make it read out of
+    /// the image, and checking the sequence after the lookup would come too late. The copy is made once per
+    /// published version, not per lookup.
+    ///
+    class REGISTRY_API RegistrySharedReader
+    {
+
+    public:
+        ///
+        /// Open a named segment, read only. The header is checked against the size of the view.
+        ///
+        /// @param name Name of the file mapping.
+        ///
+        /// @exception RegistryException The mapping doesn't exist (ERROR_FILE_NOT_FOUND) or is invalid (ERROR_INVALID_DATA).
+        ///
+        explicit RegistrySharedReader(const std::string& name);
+
+        ///
+        /// Read a memory region written by a publisher, not owned: it must outlive the reader.
+        ///
+        /// @exception RegistryException The region is not a segment (ERROR_INVALID_DATA).
+        ///
+        RegistrySharedReader(const void* memory, size_t size);
+
+        /// Unmap the segment, if owned
+        ~RegistrySharedReader() noexcept;
+
+        /// Non copyable
+        RegistrySharedReader(const RegistrySharedReader&) = delete;
+
+        /// Non copyable
+        RegistrySharedReader& operator=(const RegistrySharedReader&) = delete;
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Number of images published into the segment, 0 if none
+        unsigned long long GetVersion() const noexcept;
+
+        /// Version of the image copied by the last Refresh, 0 if none
+        unsigned long long GetSnapshotVersion() const noexcept;
+
+        /// Number of copies retried because the publisher overwrote the slot
+        unsigned long long GetRetryCount() const noexcept;
+
+        //
+        // Operations
+        //
+
+    public:
+        ///
+        /// Copy the current image, if it is newer than the last one copied.
+        /// The keys of the previous image remain valid, and keep reading it.
+        ///
+        /// @return true if a newer image was copied.
+        ///
+        /// @exception RegistryException The image is invalid (ERROR_INVALID_DATA).
+        ///
+        bool Refresh();
+
+        /// Get the image copied by the last Refresh
+        const RegistrySnapshot& Snapshot() const noexcept;
+
+        /// Get the root key of the image copied by the last Refresh
+        SnapshotKey Root() const;
+
+        ///
+        /// Open a key of the image copied by the last Refresh.
+        ///
+        /// @exception RegistryException The key doesn't exist (ERROR_FILE_NOT_FOUND).
+        ///
+        SnapshotKey OpenKey(std::string_view keyName) const;
+
+        //
+        // Internal Operations
+        //
+
+    private:
+        /// Check the header of the segment
+        void Validate(size_t size) const;
+
+        /// Unmap the segment, if owned
+        void Dispose() noexcept;
+
+
+    private:
+        /// The segment
+        const BYTE* _segment = nullptr;
+        /// Mapping handle, if owned
+        HANDLE _hMapping = nullptr;
+        /// View of the copy of the current image, shared with its keys
+        RegistrySnapshot _snapshot;
+        /// Version of the copy
+        unsigned long long _version = 0;
+        /// Number of copies retried
+        unsigned long long _retries = 0;
+    };
+
+
+} // namespace registry
+} // namespace abscodes
+
+#pragma warning(pop)
+
+#endif // REGISTRY_SHARED_SNAPSHOT_INCLUDED
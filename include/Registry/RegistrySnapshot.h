@@ -0,0 +1,404 @@
+//===--- RegistrySnapshot.h ----------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_SNAPSHOT_INCLUDED
+#define REGISTRY_SNAPSHOT_INCLUDED
+
+#include "Registry/RegistryApi.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Registry/RegistryKey.h"
+#include "Registry/RegistryName.h"
+#include "Registry/RegistryValue.h"
+#include "Registry/RegistryValueType.h"
+
+#pragma warning(push)
+#pragma warning(disable : 4251)
+
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// Serializes a tree of keys and values into an immutable snapshot image.
+    ///
+    /// The image is relocatable, it holds no pointer, and can be read in place with RegistrySnapshot:
+    /// - a header, with the size of the image and a checksum of the header;
+    /// - the keys, in breadth-first order so that the subkeys of a key are contiguous, then the values;
+    /// - a minimal perfect hash index of the key paths, and one of the (key, value name) pairs;
+    /// - the names, in UTF-8, and the value payloads, aligned on 8 bytes.
+    ///
+    /// Strings are stored in UTF-8 and NUL-terminated, multi-strings as a sequence of NUL-terminated strings.
+    ///
+    class REGISTRY_API RegistrySnapshotBuilder
+    {
+
+    public:
+        ///
+        /// Initialize a builder holding only the root key.
+        ///
+        RegistrySnapshotBuilder();
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Number of keys, the root included
+        size_t GetKeyCount() const noexcept;
+
+        /// Number of values
+        size_t GetValueCount() const noexcept;
+
+        /// Can a snapshot hold a value of this type?
+        static bool CanStore(RegistryValueType type) noexcept;
+
+        //
+        // Operations
+        //
+
+    public:
+        ///
+        /// Add a key, and its parents.
+        ///
+        /// @param keyName Path to the key, relative to the root.
+        /// @param lastWriteTime Last write time of the key.
+        ///
+        void AddKey(const std::string& keyName, FILETIME lastWriteTime = FILETIME {});
+
+        ///
+        /// Set a value, adding its key if needed.
+        ///
+        /// @param keyName Path to the key, relative to the root.
+        /// @param valueName Name of the value.
+        /// @param value Value, of any type but REG_NONE.
+        ///
+        void SetValue(const std::string& keyName, const std::string& valueName, const RegistryValue& value);
+
+        ///
+        /// Add a registry key and all its subkeys and values.
+        ///
+        /// Values of a type RegistryValue doesn't support (e.g. REG_LINK) are skipped.
+        ///
+        /// @param key Registry key to read.
+        /// @param keyName Path of the key in the snapshot, relative to the root.
+        ///
+        /// @exception RegistryException
+        ///
+        void AddTree(const RegistryKey& key, const std::string& keyName = std::string());
+
+        ///
+        /// Serialize the keys and values into an image.
+        ///
+        /// @exception std::length_error The image would exceed the limits of the format.
+        ///
+        std::vector<BYTE> Build() const;
+
+        ///
+        /// Serialize the keys and values into a file, replaced if it exists.
+        ///
+        /// @param fileName Path to the file, in UTF-8.
+        ///
+        /// @exception RegistryException
+        ///
+        void Save(const std::string& fileName) const;
+
+        /// Remove all the keys and values, but the root key
+        void Clear();
+
+
+    private:
+        /// A key, and its values sorted by name
+        struct Key {
+            std::map<std::string, RegistryValue, Name::Less> values;
+            ULONGLONG lastWriteTime = 0;
+        };
+
+        /// Keys, by normalized path; the root is the empty path
+        std::map<std::string, Key, Name::Less> _keys;
+        /// Number of values
+        size_t _valueCount = 0;
+    };
+
+
+    class SnapshotKey;
+
+    ///
+    /// Read-only view of a snapshot image, built by RegistrySnapshotBuilder.
+    ///
+    /// The image is read in place, from a memory-mapped file or any memory holding it: lookups go through
+    /// the perfect hash indexes and never parse nor allocate. The image is validated once, when the snapshot
+    /// is opened. A snapshot, and its keys, can be read from several threads at once.
+    ///
+    /// The keys share the image with the snapshot: a mapped file, or a buffer handed over with a shared pointer,
+    /// stays alive until the snapshot and all its keys are gone, even if the snapshot is moved or destroyed first.
+    ///
+    class REGISTRY_API RegistrySnapshot
+    {
+        friend class SnapshotKey;
+
+    public:
+        ///
+        /// Initialize an empty snapshot.
+        ///
+        RegistrySnapshot() = default;
+
+        ///
+        /// View an image held in memory, not owned: it must outlive the snapshot and all its keys.
+        ///
+        /// @param data Image, aligned on 8 bytes.
+        /// @param size Size of the image, in bytes.
+        ///
+        /// @exception RegistryException The image is invalid (ERROR_INVALID_DATA).
+        ///
+        RegistrySnapshot(const void* data, size_t size);
+
+        ///
+        /// View an image held in memory, shared with the keys of the snapshot.
+        ///
+        /// @param data Image, aligned on 8 bytes.
+        /// @param size Size of the image, in bytes.
+        ///
+        /// @exception RegistryException The image is invalid (ERROR_INVALID_DATA).
+        ///
+        RegistrySnapshot(std::shared_ptr<const BYTE> data, size_t size);
+
+        ///
+        /// Map a snapshot file in memory, read only.
+        ///
+        /// @param fileName Path to the file, in UTF-8.
+        ///
+        /// @exception RegistryException The file cannot be mapped, or is invalid (ERROR_INVALID_DATA).
+        ///
+        static RegistrySnapshot Open(const std::string& fileName);
+
+        /// Take over the image of the input snapshot; its keys remain valid.
+        RegistrySnapshot(RegistrySnapshot&& other) noexcept;
+
+        /// Move-assign from the input snapshot, releasing the current image once its keys are gone.
+        RegistrySnapshot& operator=(RegistrySnapshot&& other) noexcept;
+
+        /// Non copyable
+        RegistrySnapshot(const RegistrySnapshot&) = delete;
+
+        /// Non copyable
+        RegistrySnapshot& operator=(const RegistrySnapshot&) = delete;
+
+        /// Release the image, unmapped once its keys are gone
+        ~RegistrySnapshot() noexcept;
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Does the snapshot hold an image?
+        bool IsValid() const noexcept;
+
+        /// Number of keys, the root included
+        size_t GetKeyCount() const noexcept;
+
+        /// Number of values
+        size_t GetValueCount() const noexcept;
+
+        /// Size of the image, in bytes
+        size_t GetSize() const noexcept;
+
+        //
+        // Operations
+        //
+
+    public:
+        /// Get the root key
+        SnapshotKey Root() const;
+
+        ///
+        /// Open a key, by path.
+        ///
+        /// @exception RegistryException The key doesn't exist (ERROR_FILE_NOT_FOUND).
+        ///
+        SnapshotKey OpenKey(std::string_view keyName) const;
+
+        //
+        // Internal Operations
+        //
+
+    private:
+        /// Check the header, the bounds of every record and of the indexes
+        void Validate() const;
+
+        /// Find a key by path, relative to a parent key; returns the key count if there is none
+        static uint32_t FindKey(const BYTE* data, uint32_t parent, std::string_view subkey) noexcept;
+
+        /// Find a value of a key; returns the value count if there is none
+        static uint32_t FindValue(const BYTE* data, uint32_t key, std::string_view valueName) noexcept;
+
+
+    private:
+        /// The image, shared with the keys
+        std::shared_ptr<const BYTE> _data;
+        /// Size of the image
+        size_t _size = 0;
+    };
+
+
+    ///
+    /// Raw data of a value, pointing into a snapshot.
+    ///
+    struct SnapshotData {
+        /// Type of the value
+        RegistryValueType type = RegistryValueType::None;
+        /// First byte of the payload
+        const BYTE* data = nullptr;
+        /// Size of the payload, in bytes, without the terminating NUL of a string
+        size_t size = 0;
+    };
+
+
+    ///
+    /// Key of a RegistrySnapshot, with the read API of RegistryKey.
+    ///
+    /// A key is a small value, cheap to copy, which keeps the image of its snapshot alive. Strings are returned as
+    /// views into the image, valid as long as the key: only GetValue, GetMultiStringValue, GetBinaryValue and the
+    /// enumerations allocate.
+    ///
+    class REGISTRY_API SnapshotKey
+    {
+        friend class RegistrySnapshot;
+
+    public:
+        ///
+        /// Initialize an invalid key.
+        ///
+        SnapshotKey() = default;
+
+        //
+        // Properties
+        //
+
+    public:
+        /// Does the key belong to a snapshot?
+        bool IsValid() const noexcept;
+
+        /// Same as IsValid(), but allow a short "if (key)" syntax
+        explicit operator bool() const noexcept;
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Path of the key, relative to the root of the snapshot
+        std::string_view GetName() const;
+
+        ///
+        size_t GetSubKeyCount() const;
+
+        ///
+        size_t GetValueCount() const;
+
+        /// Last write time of the key, when the snapshot was built
+        FILETIME GetLastWriteTime() const;
+
+        //
+        // Operations
+        //
+
+    public:
+        ///
+        /// Open a subkey.
+        ///
+        /// @param subkey Name or path to the subkey.
+        ///
+        /// @exception RegistryException The subkey doesn't exist (ERROR_FILE_NOT_FOUND).
+        ///
+        SnapshotKey OpenSubKey(std::string_view subkey) const;
+
+        /// Find a subkey, or return an invalid key if it doesn't exist
+        SnapshotKey FindSubKey(std::string_view subkey) const noexcept;
+
+        /// Get a direct subkey, by index
+        SnapshotKey GetSubKey(size_t index) const;
+
+        //
+        // Getters
+        //
+
+    public:
+        /// Does the key hold the value?
+        bool HasValue(std::string_view valueName) const noexcept;
+
+        /// Return the DWORD type ID of the value
+        DWORD QueryValueType(std::string_view valueName) const;
+
+        ///
+        /// Get the raw data of a value, without copying it.
+        ///
+        /// @exception RegistryException The value doesn't exist (ERROR_FILE_NOT_FOUND).
+        ///
+        SnapshotData GetData(std::string_view valueName) const;
+
+        RegistryValue GetValue(std::string_view valueName) const;
+        DWORD GetDwordValue(std::string_view valueName) const;
+        ULONGLONG GetQwordValue(std::string_view valueName) const;
+        std::string_view GetStringValue(std::string_view valueName) const;
+        std::string_view GetExpandStringValue(std::string_view valueName) const;
+        std::vector<std::string_view> GetMultiStringValue(std::string_view valueName) const;
+        std::vector<BYTE> GetBinaryValue(std::string_view valueName) const;
+
+        //
+        // Query Operations
+        //
+
+    public:
+        /// Enumerate the names of the direct subkeys
+        std::vector<std::string_view> EnumSubKeys() const;
+
+        /// Enumerate the values, as pairs of name and type
+        std::vector<std::pair<std::string_view, RegistryValueType>> EnumValues() const;
+
+        //
+        // Internal Operations
+        //
+
+    private:
+        SnapshotKey(std::shared_ptr<const BYTE> data, uint32_t index) noexcept;
+
+        /// Ensure the key belongs to a snapshot
+        void EnsureValid() const;
+
+        /// Get the data of a value of the given type
+        SnapshotData GetTypedData(std::string_view valueName, RegistryValueType type) const;
+
+
+    private:
+        /// Image of the snapshot, shared with it
+        std::shared_ptr<const BYTE> _data;
+        /// Index of the key in the image
+        uint32_t _index = 0;
+    };
+
+
+} // namespace registry
+} // namespace abscodes
+
+#pragma warning(pop)
+
+#endif // REGISTRY_SNAPSHOT_INCLUDED
@@ -0,0 +1,163 @@
+//===--- RegistryTransaction.h -------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_TRANSACTION_INCLUDED
+#define REGISTRY_TRANSACTION_INCLUDED
+
+#include "Registry/RegistryApi.h"
+
+#include <chrono>
+#include <memory>
+
+#include "Registry/RegistryAccessRights.h"
+#include "Registry/RegistryHive.h"
+#include "Registry/RegistryKey.h"
+#include "Registry/RegistryOption.h"
+#include "Registry/RegistryView.h"
+
+#pragma warning(push)
+#pragma warning(disable : 4251)
+
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// Kernel Transaction Manager (KTM) transaction spanning several registry keys.
+    ///
+    /// Keys opened or created through the transaction, and the subkeys opened or created from them,
+    /// are transacted: their modifications become visible to other handles atomically on Commit,
+    /// and are discarded on Rollback. An uncommitted transaction is rolled back on destruction.
+    ///
+    /// The keys share the transaction handle: it is closed with the last of them, so that a key used after
+    /// the end of the transaction fails with ERROR_TRANSACTION_NOT_ACTIVE, never on a reused handle.
+    ///
+    class REGISTRY_API RegistryTransaction
+    {
+
+    public:
+        ///
+        /// Create a transaction.
+        ///
+        /// @param timeout Time after which the transaction is rolled back, zero for no timeout.
+        ///
+        /// @exception RegistryException
+        ///
+        explicit RegistryTransaction(std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+
+        /// Take ownership of the input transaction.
+        RegistryTransaction(RegistryTransaction&& other) noexcept;
+
+        /// Move-assign from the input transaction, rolling back the current one.
+        RegistryTransaction& operator=(RegistryTransaction&& other) noexcept;
+
+        /// Non copyable
+        RegistryTransaction(const RegistryTransaction&) = delete;
+
+        /// Non copyable
+        RegistryTransaction& operator=(const RegistryTransaction&) = delete;
+
+        /// Roll back the transaction if it is still active, and close it
+        ~RegistryTransaction() noexcept;
+
+        //
+        // Properties
+        //
+
+    public:
+        /// Can the transaction still be committed or rolled back?
+        bool IsActive() const noexcept;
+
+        /// Access the wrapped transaction handle
+        HANDLE Get() const noexcept;
+
+        //
+        // Operations
+        //
+
+    public:
+        ///
+        /// Creates a new key, or opens an existing one, as part of the transaction.
+        ///
+        /// @param hive A registry hive.
+        /// @param subkey Name or path to the key to create or open, empty for the root key of the hive.
+        /// @param view A scpecific registry view
+        /// @param desiredAccess Access rights, default to all access.
+        /// @param option todo
+        ///
+        /// @exception RegistryException
+        ///
+        RegistryKey CreateKey(RegistryHive hive,
+                              std::string subkey,
+                              RegistryView view = RegistryView::Default,
+                              RegistryAccessRights desiredAccess = RegistryAccessRights::AllAccess,
+                              RegistryOption option = RegistryOption::None);
+
+        ///
+        /// Open a key as part of the transaction. Will throw an exception if the key doesn't exist
+        ///
+        /// @param hive A registry hive.
+        /// @param subkey Name or path to the key to open, empty for the root key of the hive.
+        /// @param view A scpecific registry view
+        /// @param desiredAccess Access rights, default to all access.
+        ///
+        /// @exception RegistryException
+        ///
+        RegistryKey OpenKey(RegistryHive hive,
+                            std::string subkey,
+                            RegistryView view = RegistryView::Default,
+                            RegistryAccessRights desiredAccess = RegistryAccessRights::AllAccess);
+
+        ///
+        /// Make all the modifications of the transaction visible, atomically.
+        ///
+        /// @exception RegistryException
+        ///
+        void Commit();
+
+        ///
+        /// Discard all the modifications of the transaction.
+        ///
+        /// @exception RegistryException
+        ///
+        void Rollback();
+
+        //
+        // Internal Operations
+        //
+
+    private:
+        /// Make sure the transaction can still be used
+        void EnsureActive() const;
+
+        /// Roll back if needed, and release the handle
+        void Dispose() noexcept;
+
+        /// Open a new handle to the root key of the hive, in the transaction: the predefined handle is not transacted
+        RegistryKey OpenRoot(RegistryHive hive, RegistryView view, RegistryAccessRights desiredAccess) const;
+
+
+    private:
+        /// The wrapped transaction handle, shared with the transacted keys
+        std::shared_ptr<void> _hTransaction;
+        /// Tells if the transaction was committed or rolled back
+        bool _completed = false;
+    };
+
+
+} // namespace registry
+} // namespace abscodes
+
+#pragma warning(pop)
+
+#endif // REGISTRY_TRANSACTION_INCLUDED
@@ -0,0 +1,210 @@
+//===--- RegistryTypeTraits.h --------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_TYPE_TRAITS_INCLUDED
+#define REGISTRY_TYPE_TRAITS_INCLUDED
+
+#include "Registry/RegistryApi.h"
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "Registry/RegistryValueType.h"
+
+#if __has_include(<version>)
+#    include <version>
+#endif
+
+#if defined(__cpp_lib_span)
+#    include <span>
+#    define REGISTRY_HAS_SPAN
+#endif
+
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// How a C++ type is stored in the registry.
+    ///
+    enum class RegistryStorage {
+        /// The type cannot be stored
+        None,
+        /// Fixed-size value, stored as its bits: REG_DWORD, REG_QWORD or REG_BINARY
+        Scalar,
+        /// UTF-8 text, stored as REG_SZ
+        String,
+        /// List of UTF-8 texts, stored as REG_MULTI_SZ
+        MultiString,
+        /// Variable-size bytes, stored as REG_BINARY
+        Bytes,
+    };
+
+
+    ///
+    /// Compile-time mapping of a C++ type to a registry type.
+    ///
+    /// Each supported type defines:
+    /// - Storage: how the value is stored, see RegistryStorage;
+    /// - Type: the registry type written;
+    /// - Flags: the RRF_RT_* flags restricting RegGetValue to that type.
+    ///
+    /// Scalar types also define StorageType, the fixed-size type actually written, with ToStorage/FromStorage:
+    /// - bool, enumerations and integers up to 32 bits are REG_DWORD, 64-bit integers REG_QWORD;
+    /// - any other trivially copyable type is REG_BINARY, of exactly sizeof(T) bytes: floating point numbers
+    ///   too, the native encoding of SetDouble (see RegistryNumberEncoding).
+    ///
+    template <typename T, typename Enable = void>
+    struct RegistryTypeTraits {
+        static constexpr RegistryStorage Storage = RegistryStorage::None;
+    };
+
+
+    namespace Traits {
+
+        /// Integer type of the same size as an arithmetic or enumeration type
+        template <typename T>
+        using UnsignedOf = std::conditional_t<sizeof(T) <= sizeof(DWORD), DWORD, ULONGLONG>;
+
+        /// Is T stored as a REG_DWORD or a REG_QWORD? Floating point numbers are not: their bits are no integer
+        template <typename T>
+        constexpr bool IsNumber = (std::is_integral_v<T> || std::is_enum_v<T>) && (sizeof(T) <= sizeof(ULONGLONG));
+
+        /// Is T a span? Spans are trivially copyable, but their bytes are not their content
+        template <typename T>
+        constexpr bool IsSpan = false;
+
+#if defined(REGISTRY_HAS_SPAN)
+        template <typename T, size_t Extent>
+        constexpr bool IsSpan<std::span<T, Extent>> = true;
+#endif
+
+        /// Is T stored as its bytes?
+        template <typename T>
+        constexpr bool IsPod = !IsNumber<T> && !IsSpan<T> && !std::is_pointer_v<T> && !std::is_array_v<T>
+                               && std::is_trivially_copyable_v<T> && std::is_standard_layout_v<T>;
+
+        /// Is T a vector of bytes?
+        template <typename T>
+        constexpr bool IsByteVector = std::is_same_v<T, std::vector<BYTE>> || std::is_same_v<T, std::vector<std::byte>>;
+
+    } // namespace Traits
+
+
+    /// bool, integers and enumerations
+    template <typename T>
+    struct RegistryTypeTraits<T, std::enable_if_t<Traits::IsNumber<T>>> {
+        using StorageType = Traits::UnsignedOf<T>;
+
+        static constexpr RegistryStorage Storage = RegistryStorage::Scalar;
+        static constexpr RegistryValueType Type = sizeof(StorageType) == sizeof(DWORD) ? RegistryValueType::DWord : RegistryValueType::QWord;
+        static constexpr DWORD Flags = sizeof(StorageType) == sizeof(DWORD) ? RRF_RT_REG_DWORD : RRF_RT_REG_QWORD;
+
+        static StorageType ToStorage(const T& value) noexcept {
+            if constexpr(std::is_same_v<T, bool>) {
+                return value ? 1 : 0;
+            }
+            else {
+                return static_cast<StorageType>(value);
+            }
+        }
+
+        static T FromStorage(StorageType bits) noexcept {
+            if constexpr(std::is_same_v<T, bool>) {
+                return bits != 0;
+            }
+            else {
+                return static_cast<T>(bits);
+            }
+        }
+    };
+
+    /// Floating point numbers and trivially copyable structures, stored as their bytes
+    template <typename T>
+    struct RegistryTypeTraits<T, std::enable_if_t<Traits::IsPod<T>>> {
+        using StorageType = T;
+
+        static constexpr RegistryStorage Storage = RegistryStorage::Scalar;
+        static constexpr RegistryValueType Type = RegistryValueType::Binary;
+        static constexpr DWORD Flags = RRF_RT_REG_BINARY;
+
+        static const T& ToStorage(const T& value) noexcept {
+            return value;
+        }
+
+        static T FromStorage(const T& value) noexcept {
+            return value;
+        }
+    };
+
+    /// UTF-8 text
+    template <>
+    struct RegistryTypeTraits<std::string> {
+        static constexpr RegistryStorage Storage = RegistryStorage::String;
+        static constexpr RegistryValueType Type = RegistryValueType::String;
+        static constexpr DWORD Flags = RRF_RT_REG_SZ;
+    };
+
+    /// UTF-8 text, write only
+    template <>
+    struct RegistryTypeTraits<std::string_view> : RegistryTypeTraits<std::string> {};
+
+    /// UTF-8 text, write only
+    template <>
+    struct RegistryTypeTraits<const char*> : RegistryTypeTraits<std::string> {};
+
+    /// UTF-8 text, write only
+    template <>
+    struct RegistryTypeTraits<char*> : RegistryTypeTraits<std::string> {};
+
+    /// List of UTF-8 texts
+    template <>
+    struct RegistryTypeTraits<std::vector<std::string>> {
+        static constexpr RegistryStorage Storage = RegistryStorage::MultiString;
+        static constexpr RegistryValueType Type = RegistryValueType::MultiString;
+        static constexpr DWORD Flags = RRF_RT_REG_MULTI_SZ;
+    };
+
+    /// Bytes
+    template <typename T>
+    struct RegistryTypeTraits<T, std::enable_if_t<Traits::IsByteVector<T>>> {
+        static constexpr RegistryStorage Storage = RegistryStorage::Bytes;
+        static constexpr RegistryValueType Type = RegistryValueType::Binary;
+        static constexpr DWORD Flags = RRF_RT_REG_BINARY;
+    };
+
+#if defined(REGISTRY_HAS_SPAN)
+    /// Bytes, write only
+    template <typename T, size_t Extent>
+    struct RegistryTypeTraits<std::span<T, Extent>, std::enable_if_t<std::is_same_v<std::remove_const_t<T>, std::byte> || std::is_same_v<std::remove_const_t<T>, BYTE>>> {
+        static constexpr RegistryStorage Storage = RegistryStorage::Bytes;
+        static constexpr RegistryValueType Type = RegistryValueType::Binary;
+        static constexpr DWORD Flags = RRF_RT_REG_BINARY;
+    };
+#endif
+
+
+    /// Can T be read from, and written to, the registry?
+    template <typename T>
+    constexpr bool IsRegistryType = RegistryTypeTraits<T>::Storage != RegistryStorage::None;
+
+
+} // namespace registry
+} // namespace abscodes
+
+
+#endif // REGISTRY_TYPE_TRAITS_INCLUDED
@@ -15,6 +15,8 @@
 
 #include "Registry/RegistryApi.h"
 
+#include <memory>
+#include <memory_resource>
 #include <string>
 #include <vector>
 
@@ -29,19 +31,52 @@ namespace registry {
     ///
     /// "Variant-style" Registry value.
     ///
-    class REGISTRY_API RegistryValue
+    /// The strings and vectors of the value are allocated with Allocator: RegistryValue uses std::allocator,
+    /// pmr::RegistryValue a polymorphic allocator, so that it can be filled from a caller-supplied arena.
+    ///
+    template <typename Allocator>
+    class BasicRegistryValue
     {
 
+    public:
+        /// Allocator of the strings and vectors
+        using allocator_type = Allocator;
+
+        /// REG_SZ and REG_EXPAND_SZ storage
+        using string_type = std::basic_string<char, std::char_traits<char>, Allocator>;
+
+        /// REG_MULTI_SZ storage
+        using multi_string_type = std::vector<string_type, typename std::allocator_traits<Allocator>::template rebind_alloc<string_type>>;
+
+        /// REG_BINARY storage
+        using binary_type = std::vector<BYTE, typename std::allocator_traits<Allocator>::template rebind_alloc<BYTE>>;
+
     public:
         ///
         /// Initialize an empty value (REG_NONE).
         ///
-        RegistryValue() = default;
+        BasicRegistryValue() = default;
+
+        ///
+        /// Initialize an empty value (REG_NONE), allocating with the given allocator.
+        ///
+        explicit BasicRegistryValue(const Allocator& allocator);
 
         /// Initialize with the given value kind.
         /// Caller can use accessor corresponding to the given type (e.g. String() for REG_SZ)
         /// to set the desired value.
-        explicit RegistryValue(RegistryValueType type);
+        explicit BasicRegistryValue(RegistryValueType type, const Allocator& allocator = Allocator());
+
+        /// Copy a value, allocating with the given allocator
+        BasicRegistryValue(const BasicRegistryValue& other, const Allocator& allocator);
+
+        BasicRegistryValue(const BasicRegistryValue&) = default;
+        BasicRegistryValue(BasicRegistryValue&&) = default;
+        BasicRegistryValue& operator=(const BasicRegistryValue&) = default;
+        BasicRegistryValue& operator=(BasicRegistryValue&&) = default;
+
+        /// Allocator of the value
+        allocator_type get_allocator() const noexcept;
 
         /// Registry value type (e.g. REG_SZ) associated to current value.
         RegistryValueType GetType() const;
@@ -63,10 +98,10 @@ namespace registry {
 
         DWORD DWord() const;
         ULONGLONG QWord() const;
-        const std::string& String() const;
-        const std::string& ExpandString() const;
-        const std::vector<std::string>& MultiString() const;
-        const std::vector<BYTE>& Binary() const;
+        const string_type& String() const;
+        const string_type& ExpandString() const;
+        const multi_string_type& MultiString() const;
+        const binary_type& Binary() const;
 
 
         //
@@ -75,10 +110,10 @@ namespace registry {
 
         DWORD& DWord();
         ULONGLONG& QWord();
-        std::string& String();
-        std::string& ExpandString();
-        std::vector<std::string>& MultiString();
-        std::vector<BYTE>& Binary();
+        string_type& String();
+        string_type& ExpandString();
+        multi_string_type& MultiString();
+        binary_type& Binary();
 
     private:
         /// Registry value type
@@ -89,18 +124,54 @@ namespace registry {
         /// Store REG_QWORD value
         ULONGLONG _qword = 0;
         /// Store REG_SZ value
-        std::string _string;
+        string_type _string;
         /// Store REG_EXPAND_SZ value
-        std::string _expandString;
+        string_type _expandString;
         /// Store REG_MULTI_SZ value
-        std::vector<std::string> _multiString;
+        multi_string_type _multiString;
         /// Store REG_BINARY value
-        std::vector<BYTE> _binary;
+        binary_type _binary;
 
         /// Clear all the data members
         void ResetValues();
     };
 
+    /// Registry value allocated on the heap
+    using RegistryValue = BasicRegistryValue<std::allocator<char>>;
+
+    namespace pmr {
+        /// Registry value allocated from a memory resource
+        using RegistryValue = BasicRegistryValue<std::pmr::polymorphic_allocator<char>>;
+    } // namespace pmr
+
+    extern template class REGISTRY_API BasicRegistryValue<std::allocator<char>>;
+    extern template class REGISTRY_API BasicRegistryValue<std::pmr::polymorphic_allocator<char>>;
+
+    //------------------------------------------------------------------------------
+    //          Overloads of relational comparison operators for RegistryValue
+    //------------------------------------------------------------------------------
+    template <typename Allocator>
+    inline bool operator==(const BasicRegistryValue<Allocator>& a, const BasicRegistryValue<Allocator>& b) {
+        if(a.GetType() != b.GetType()) {
+            return false;
+        }
+
+        switch(a.GetType()) {
+            case RegistryValueType::DWord: return a.DWord() == b.DWord();
+            case RegistryValueType::QWord: return a.QWord() == b.QWord();
+            case RegistryValueType::String: return a.String() == b.String();
+            case RegistryValueType::ExpandString: return a.ExpandString() == b.ExpandString();
+            case RegistryValueType::MultiString: return a.MultiString() == b.MultiString();
+            case RegistryValueType::Binary: return a.Binary() == b.Binary();
+            default: return true;
+        }
+    }
+
+    template <typename Allocator>
+    inline bool operator!=(const BasicRegistryValue<Allocator>& a, const BasicRegistryValue<Allocator>& b) {
+        return !(a == b);
+    }
+
 
 } // namespace registry
 } // namespace abscodes
@@ -0,0 +1,355 @@
+//===--- RegistryValueCache.h --------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_VALUE_CACHE_INCLUDED
+#define REGISTRY_VALUE_CACHE_INCLUDED
+
+#include "Registry/RegistryApi.h"
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Registry/RegistryKey.h"
+#include "Registry/RegistryName.h"
+#include "Registry/RegistrySnapshot.h"
+#include "Registry/RegistryValue.h"
+
+#pragma warning(push)
+#pragma warning(disable : 4251)
+
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// Where a RegistryValueCache reads its keys.
+    ///
+    /// RegistryKeyCacheSource is the registry itself; MemoryCacheSource stands in for it, e.g. in tests.
+    ///
+    class REGISTRY_API RegistryCacheSource
+    {
+
+    public:
+        virtual ~RegistryCacheSource() = default;
+
+        ///
+        /// Get the last write time of a key.
+        ///
+        /// @param keyName Path to the key, relative to the root of the source.
+        /// @param lastWriteTime Receives the last write time of the key.
+        ///
+        /// @return false if the key doesn't exist.
+        ///
+        virtual bool QueryLastWriteTime(const std::string& keyName, FILETIME& lastWriteTime) = 0;
+
+        ///
+        /// Read all the values of a key, but its subkeys.
+        ///
+        /// @param keyName Path to the key, relative to the root of the source.
+        ///
+        /// @return The values, by name; none if the key doesn't exist.
+        ///
+        virtual std::vector<std::pair<std::string, RegistryValue>> ReadKey(const std::string& keyName) = 0;
+
+        ///
+        /// Read a single value of a key.
+        ///
+        /// The default scans ReadKey; a source overrides it when it can read one value for less.
+        ///
+        /// @param keyName Path to the key, relative to the root of the source.
+        /// @param valueName Name of the value.
+        /// @param value Receives the value.
+        ///
+        /// @return false if the key or the value doesn't exist.
+        ///
+        virtual bool ReadValue(const std::string& keyName, const std::string& valueName, RegistryValue& value);
+
+        ///
+        /// Enumerate the names of the direct subkeys of a key.
+        ///
+        /// @param keyName Path to the key, relative to the root of the source.
+        ///
+        /// @return The names; none if the key doesn't exist.
+        ///
+        virtual std::vector<std::string> EnumSubKeys(const std::string& keyName) = 0;
+
+        ///
+        /// Signal an event at the next change of a key, of its values or of any key below it.
+        ///
+        /// The notification fires once: the caller watches again after each one. The default cannot notify.
+        ///
+        /// @param keyName Path to the key, relative to the root of the source.
+        /// @param hEvent Event to signal.
+        ///
+        /// @return false if the source cannot notify the changes of the key, e.g. the key doesn't exist.
+        ///
+        virtual bool WatchTree(const std::string& keyName, HANDLE hEvent);
+    };
+
+
+    ///
+    /// Cache source backed by a registry key.
+    ///
+    /// Values of a type a snapshot cannot hold (e.g. REG_LINK) are not read.
+    ///
+    class REGISTRY_API RegistryKeyCacheSource : public RegistryCacheSource
+    {
+
+    public:
+        ///
+        /// Initialize a source under the root key.
+        ///
+        /// @param root Root key, not owned: it must outlive the source.
+        ///
+        explicit RegistryKeyCacheSource(RegistryKey& root) noexcept;
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Number of calls to QueryLastWriteTime, i.e. of RegQueryInfoKey calls
+        size_t GetQueryCount() const noexcept;
+
+        /// Number of calls to ReadKey
+        size_t GetReadCount() const noexcept;
+
+        /// Number of calls to ReadValue, i.e. of RegGetValue calls
+        size_t GetValueReadCount() const noexcept;
+
+        //
+        // Operations
+        //
+
+    public:
+        bool QueryLastWriteTime(const std::string& keyName, FILETIME& lastWriteTime) override;
+
+        std::vector<std::pair<std::string, RegistryValue>> ReadKey(const std::string& keyName) override;
+
+        bool ReadValue(const std::string& keyName, const std::string& valueName, RegistryValue& value) override;
+
+        std::vector<std::string> EnumSubKeys(const std::string& keyName) override;
+
+        bool WatchTree(const std::string& keyName, HANDLE hEvent) override;
+
+
+    private:
+        /// Root key, not owned
+        RegistryKey& _root;
+        /// Key watched by WatchTree, kept open: closing it signals the event
+        RegistryKey _watched;
+        /// Path of the watched key
+        std::string _watchedName;
+        /// Number of calls to QueryLastWriteTime
+        size_t _queries = 0;
+        /// Number of calls to ReadKey
+        size_t _reads = 0;
+        /// Number of calls to ReadValue
+        size_t _valueReads = 0;
+    };
+
+
+    ///
+    /// Cache source kept in memory, standing in for the registry.
+    ///
+    /// Each change of a key moves its last write time forward, like the registry does: setting a value moves
+    /// the time of its key, creating or deleting a key moves the time of its parent.
+    ///
+    class REGISTRY_API MemoryCacheSource : public RegistryCacheSource
+    {
+
+    public:
+        ///
+        /// Initialize an empty source.
+        ///
+        MemoryCacheSource() = default;
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Number of calls to QueryLastWriteTime
+        size_t GetQueryCount() const noexcept;
+
+        /// Number of calls to ReadKey
+        size_t GetReadCount() const noexcept;
+
+        /// Set a value, creating its key and its parents if needed
+        void SetValue(const std::string& keyName, const std::string& valueName, const RegistryValue& value);
+
+        /// Delete a key and its subkeys, if it exists
+        void DeleteKey(const std::string& keyName);
+
+        //
+        // Operations
+        //
+
+    public:
+        bool QueryLastWriteTime(const std::string& keyName, FILETIME& lastWriteTime) override;
+
+        std::vector<std::pair<std::string, RegistryValue>> ReadKey(const std::string& keyName) override;
+
+        bool ReadValue(const std::string& keyName, const std::string& valueName, RegistryValue& value) override;
+
+        std::vector<std::string> EnumSubKeys(const std::string& keyName) override;
+
+
+    private:
+        /// A key, and its values sorted by name
+        struct Key {
+            std::map<std::string, RegistryValue, Name::Less> values;
+            ULONGLONG lastWriteTime = 0;
+        };
+
+        /// Get a key, creating it and its parents if needed
+        Key& CreateKey(const std::string& path);
+
+        /// Keys, by normalized path
+        std::map<std::string, Key, Name::Less> _keys;
+        /// Last write time given to a key
+        ULONGLONG _clock = 0;
+        /// Number of calls to QueryLastWriteTime
+        size_t _queries = 0;
+        /// Number of calls to ReadKey
+        size_t _reads = 0;
+    };
+
+
+    ///
+    /// Decoded values of a declared set of keys, kept across process restarts in a snapshot file.
+    ///
+    /// The file stores the values of each key with its last write time. Loading the file checks every key
+    /// with a single last write time query, and reads again only the keys that changed since the file was
+    /// saved: a warm start costs one metadata call per key. A missing or invalid file only makes a cold start.
+    ///
+    /// Only the values of the declared keys are cached, not their subkeys.
+    ///
+    class REGISTRY_API RegistryValueCache
+    {
+
+    public:
+        ///
+        /// Initialize an empty cache of the keys.
+        ///
+        /// @param source Source of the keys, not owned: it must outlive the cache.
+        /// @param keyNames Paths to the keys, relative to the root of the source.
+        ///
+        RegistryValueCache(RegistryCacheSource& source, const std::vector<std::string>& keyNames);
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Number of declared keys
+        size_t GetKeyCount() const noexcept;
+
+        /// Number of keys read from the source by the last Load or Refresh
+        size_t GetReloadCount() const noexcept;
+
+        //
+        // Getters
+        //
+
+    public:
+        /// Does the cache hold the value?
+        bool HasValue(const std::string& keyName, const std::string& valueName) const;
+
+        ///
+        /// Get a cached value.
+        ///
+        /// @exception RegistryException The key is not declared, or the value doesn't exist (ERROR_FILE_NOT_FOUND).
+        ///
+        const RegistryValue& GetValue(const std::string& keyName, const std::string& valueName) const;
+
+        //
+        // Operations
+        //
+
+    public:
+        ///
+        /// Load the keys from a snapshot, reading again from the source the keys that changed.
+        ///
+        /// @return The number of keys read from the source.
+        ///
+        size_t Load(const RegistrySnapshot& snapshot);
+
+        ///
+        /// Load the keys from a snapshot file, reading again from the source the keys that changed.
+        ///
+        /// All the keys are read from the source if the file doesn't exist or is invalid.
+        ///
+        /// @param fileName Path to the file, in UTF-8.
+        ///
+        /// @return The number of keys read from the source.
+        ///
+        size_t Load(const std::string& fileName);
+
+        ///
+        /// Check the keys against the source, reading again the ones that changed.
+        ///
+        /// @return The number of keys read from the source.
+        ///
+        size_t Refresh();
+
+        /// Serialize the cached keys into a snapshot image
+        std::vector<BYTE> Build() const;
+
+        ///
+        /// Serialize the cached keys into a snapshot file, replaced if it exists.
+        ///
+        /// @exception RegistryException
+        ///
+        void Save(const std::string& fileName) const;
+
+        //
+        // Internal Operations
+        //
+
+    private:
+        /// A cached key
+        struct Key {
+            std::map<std::string, RegistryValue, Name::Less> values;
+            ULONGLONG lastWriteTime = 0;
+            bool exists = false;
+        };
+
+        /// Query the last write time of a key from the source; false if the key doesn't exist
+        bool QueryLastWriteTime(const std::string& keyName, ULONGLONG& lastWriteTime);
+
+        /// Read the values of a key from the source
+        void Read(const std::string& keyName, ULONGLONG lastWriteTime, Key& key);
+
+        /// Add the existing keys and their values to a snapshot builder
+        void AddTo(RegistrySnapshotBuilder& builder) const;
+
+
+    private:
+        /// Source of the keys, not owned
+        RegistryCacheSource& _source;
+        /// Cached keys, by normalized path
+        std::map<std::string, Key, Name::Less> _keys;
+        /// Number of keys read by the last Load or Refresh
+        size_t _reloads = 0;
+    };
+
+
+} // namespace registry
+} // namespace abscodes
+
+#pragma warning(pop)
+
+#endif // REGISTRY_VALUE_CACHE_INCLUDED
@@ -0,0 +1,179 @@
+//===--- RegistryWriteBatch.h --------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_WRITE_BATCH_INCLUDED
+#define REGISTRY_WRITE_BATCH_INCLUDED
+
+#include "Registry/RegistryApi.h"
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Registry/RegistryKey.h"
+#include "Registry/RegistryName.h"
+#include "Registry/RegistryValue.h"
+
+#pragma warning(push)
+#pragma warning(disable : 4251)
+
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// Collects (key path, value name, value) write operations and applies them in one pass.
+    ///
+    /// Operations are grouped by key, so each key is opened only once at commit time, and repeated
+    /// writes to the same value are coalesced: only the last one survives.
+    /// Reads made through the batch see its uncommitted writes.
+    ///
+    class REGISTRY_API RegistryWriteBatch
+    {
+
+    public:
+        /// Describe an operation that could not be applied
+        struct Failure {
+            /// Path of the key, relative to the root key
+            std::string keyName;
+            /// Name of the value, empty when the key itself could not be opened
+            std::string valueName;
+            /// Error message
+            std::string message;
+        };
+
+    public:
+        ///
+        /// Initialize an empty batch.
+        ///
+        RegistryWriteBatch() = default;
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Is there any pending operation?
+        bool IsEmpty() const noexcept;
+
+        /// Number of distinct keys touched by the batch
+        size_t GetKeyCount() const noexcept;
+
+        /// Number of operations left once duplicates are coalesced
+        size_t GetOperationCount() const noexcept;
+
+        /// Number of operations submitted to the batch, duplicates included
+        size_t GetSubmittedCount() const noexcept;
+
+        //
+        // Operations
+        //
+
+    public:
+        ///
+        /// Queue a write of the specified value.
+        ///
+        /// @param keyName Path to the key, relative to the root key given to Commit. The key is created if needed.
+        /// @param valueName Name of the value.
+        /// @param value New value.
+        ///
+        void SetValue(const std::string& keyName, const std::string& valueName, const RegistryValue& value);
+
+        ///
+        /// Queue the deletion of the specified value.
+        /// Deleting a value, or a value of a key, that doesn't exist succeeds and creates nothing.
+        ///
+        /// @param keyName Path to the key, relative to the root key given to Commit.
+        /// @param valueName Name of the value.
+        ///
+        void DeleteValue(const std::string& keyName, const std::string& valueName);
+
+        ///
+        /// Check if the value is modified by the batch.
+        ///
+        /// @param keyName Path to the key, relative to the root key.
+        /// @param valueName Name of the value.
+        ///
+        bool IsPending(const std::string& keyName, const std::string& valueName) const;
+
+        ///
+        /// Retrieves the value, as it would be after the batch is committed.
+        /// Pending writes are returned without reading the registry.
+        ///
+        /// @param root The root key.
+        /// @param keyName Path to the key, relative to the root key.
+        /// @param valueName Name of the value.
+        ///
+        /// @exception RegistryException thrown if the value does not exist or is deleted by the batch.
+        ///
+        RegistryValue GetValue(const RegistryKey& root, const std::string& keyName, const std::string& valueName) const;
+
+        ///
+        /// Apply all the pending operations under the root key, then clear the batch.
+        ///
+        /// A failure does not stop the commit: remaining operations are still applied.
+        ///
+        /// @param root The root key.
+        ///
+        /// @return The operations that could not be applied.
+        ///
+        std::vector<Failure> Commit(RegistryKey& root);
+
+        /// Discard all the pending operations
+        void Clear() noexcept;
+
+        ///
+        /// Visit the pending operations, sorted by key path then by value name.
+        ///
+        /// @param visitor Called with the key path, the value name, and the value, null for a deletion.
+        ///
+        void ForEach(const std::function<void(const std::string& keyName, const std::string& valueName, const RegistryValue* value)>& visitor) const;
+
+        //
+        // Internal Operations
+        //
+
+    private:
+        /// A coalesced operation, a deletion when the value is empty
+        struct Operation {
+            bool erase = false;
+            RegistryValue value;
+        };
+
+        /// Pending operations of a key, sorted by value name
+        using KeyOperations = std::map<std::string, Operation, Name::Less>;
+
+        /// Record an operation, replacing any previous one on the same value
+        void Push(const std::string& keyName, const std::string& valueName, Operation operation);
+
+        /// Find a pending operation
+        const Operation* Find(const std::string& keyName, const std::string& valueName) const;
+
+
+    private:
+        /// Pending operations, sorted by key path
+        std::map<std::string, KeyOperations, Name::Less> _keys;
+        /// Number of submitted operations
+        size_t _submitted = 0;
+        /// Number of coalesced operations
+        size_t _operations = 0;
+    };
+
+
+} // namespace registry
+} // namespace abscodes
+
+#pragma warning(pop)
+
+#endif // REGISTRY_WRITE_BATCH_INCLUDED
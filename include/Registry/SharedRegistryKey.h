@@ -0,0 +1,165 @@
+//===--- SharedRegistryKey.h ---------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_SHARED_KEY_INCLUDED
+#define REGISTRY_SHARED_KEY_INCLUDED
+
+#include "Registry/RegistryApi.h"
+
+#include <memory>
+#include <string>
+
+#include "Registry/RegistryAccessRights.h"
+#include "Registry/RegistryKey.h"
+#include "Registry/RegistryValue.h"
+
+#pragma warning(push)
+#pragma warning(disable : 4251)
+
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// Reference-counted owner of a RegistryKey, over a std::shared_ptr.
+    ///
+    /// Copies share the same key, and so the same HKEY and metadata: copying is an atomic increment,
+    /// and the handle is closed when the last copy is released. Copying and releasing are thread-safe.
+    ///
+    /// The shared key is read through the const API, which is safe to call from several threads, and
+    /// written through the operations below. None of them can close, detach or move the shared key.
+    ///
+    class REGISTRY_API SharedRegistryKey
+    {
+
+    public:
+        ///
+        /// Initialize an empty SharedRegistryKey.
+        ///
+        SharedRegistryKey() = default;
+
+        ///
+        /// Take ownership of the key.
+        ///
+        /// @param key An opened key.
+        ///
+        explicit SharedRegistryKey(RegistryKey&& key);
+
+        //
+        // Properties
+        //
+
+    public:
+        /// Is there a shared key, with a valid handle?
+        bool IsValid() const noexcept;
+
+        /// Same as IsValid(), but allow a short "if (sharedKey)" syntax
+        explicit operator bool() const noexcept;
+
+        /// Number of SharedRegistryKey sharing the key, 0 when empty
+        long GetUseCount() const noexcept;
+
+        //
+        // Accessor
+        //
+
+    public:
+        /// Access the shared key, read-only
+        const RegistryKey& operator*() const;
+
+        /// Access the shared key, read-only
+        const RegistryKey* operator->() const;
+
+        //
+        // Operations
+        //
+
+    public:
+        ///
+        /// Open a subkey, and share it. Will throw an exception if the subkey doesn't exist
+        ///
+        /// @param subkey Name or path to subkey to open.
+        ///
+        /// @exception RegistryException
+        ///
+        SharedRegistryKey OpenSubKey(const std::string& subkey) const;
+
+        ///
+        /// Open a subkey, and share it. Will throw an exception if the subkey doesn't exist
+        ///
+        /// @param subkey Name or path to subkey to open.
+        /// @param desiredAccess Access rights.
+        ///
+        /// @exception RegistryException
+        ///
+        SharedRegistryKey OpenSubKey(const std::string& subkey, RegistryAccessRights desiredAccess) const;
+
+        ///
+        /// Create a subkey, or open it if it exists, and share it.
+        /// The write operations must not run concurrently with any other operation on the key.
+        ///
+        /// @exception RegistryException
+        ///
+        SharedRegistryKey CreateSubKey(const std::string& subkey);
+
+        /// Write a value, see RegistryKey::SetValue
+        void SetValue(const std::string& valueName, const RegistryValue& value);
+
+        /// Write a DWORD value, see RegistryKey::SetDwordValue
+        void SetDwordValue(const std::string& valueName, DWORD value);
+
+        /// Write a string value, see RegistryKey::SetStringValue
+        void SetStringValue(const std::string& valueName, const std::string& value);
+
+        /// Delete a value, see RegistryKey::DeleteValue
+        void DeleteValue(const std::string& valueName);
+
+        /// Release the key, the SharedRegistryKey becomes empty
+        void Reset() noexcept;
+
+        /// Non-throwing swap
+        void SwapWith(SharedRegistryKey& other) noexcept;
+
+        //
+        // Internal Operations
+        //
+
+    private:
+        /// Get the shared key, ensuring the SharedRegistryKey is not empty
+        RegistryKey& Key() const;
+
+
+    private:
+        /// Shared key, nullptr when empty
+        std::shared_ptr<RegistryKey> _key;
+    };
+
+    inline void swap(SharedRegistryKey& lhs, SharedRegistryKey& rhs) noexcept {
+        lhs.SwapWith(rhs);
+    }
+
+    inline bool operator==(const SharedRegistryKey& a, const SharedRegistryKey& b) noexcept {
+        return (!a && !b) || (a && b && a->Get() == b->Get());
+    }
+
+    inline bool operator!=(const SharedRegistryKey& a, const SharedRegistryKey& b) noexcept {
+        return !(a == b);
+    }
+
+
+} // namespace registry
+} // namespace abscodes
+
+#pragma warning(pop)
+
+#endif // REGISTRY_SHARED_KEY_INCLUDED
@@ -0,0 +1,285 @@
+//===--- ConfigMirror.cpp ------------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+#include "Registry/ConfigMirror.h"
+
+#include "Registry/RegistryException.h"
+
+namespace abscodes {
+namespace registry {
+
+    //
+    // ConfigNode
+    //
+
+    ConfigNode::ConfigNode()
+      : _values(std::make_shared<const Values>()) {}
+
+    const std::string& ConfigNode::GetPath() const noexcept {
+        return _path;
+    }
+
+    ULONGLONG ConfigNode::GetLastWriteTime() const noexcept {
+        return _lastWriteTime;
+    }
+
+    const ConfigNode::Values& ConfigNode::GetValues() const noexcept {
+        return *_values;
+    }
+
+    const ConfigNode::SubKeys& ConfigNode::GetSubKeys() const noexcept {
+        return _subkeys;
+    }
+
+    const ConfigNode* ConfigNode::FindSubKey(std::string_view subkey) const noexcept {
+        const ConfigNode* node = this;
+
+        // Walk the path one name at a time, skipping the empty names
+        while(node != nullptr && !subkey.empty()) {
+            const size_t separator = subkey.find('\\');
+            const std::string_view name = subkey.substr(0, separator);
+            subkey = separator == std::string_view::npos ? std::string_view() : subkey.substr(separator + 1);
+            if(name.empty()) {
+                continue;
+            }
+
+            const auto child = node->_subkeys.find(name);
+            node = child != node->_subkeys.end() ? child->second.get() : nullptr;
+        }
+
+        return node;
+    }
+
+    const RegistryValue* ConfigNode::FindValue(std::string_view valueName) const noexcept {
+        const auto value = _values->find(valueName);
+        return value != _values->end() ? &value->second : nullptr;
+    }
+
+    bool ConfigNode::HasValue(std::string_view valueName) const noexcept {
+        return FindValue(valueName) != nullptr;
+    }
+
+    const RegistryValue& ConfigNode::GetValue(std::string_view valueName) const {
+        const RegistryValue* value = FindValue(valueName);
+        if(value == nullptr) {
+            throw Exceptions::RegistryException(_path, "Value not found in the configuration mirror.", ERROR_FILE_NOT_FOUND);
+        }
+        return *value;
+    }
+
+    //
+    // ConfigMirror
+    //
+
+    ConfigMirror::ConfigMirror(RegistryCacheSource& source, const std::string& keyName)
+      : _source(source)
+      , _path(Name::Normalize(keyName))
+      , _hChanged(::CreateEventW(nullptr, FALSE, FALSE, nullptr)) { // auto-reset, not signaled, unnamed
+        try {
+            Refresh();
+        }
+        catch(...) {
+            if(_hChanged != nullptr) {
+                ::CloseHandle(_hChanged);
+            }
+            throw;
+        }
+    }
+
+    ConfigMirror::~ConfigMirror() noexcept {
+        Stop();
+        if(_hChanged != nullptr) {
+            ::CloseHandle(_hChanged);
+        }
+    }
+
+    std::shared_ptr<const ConfigNode> ConfigMirror::Snapshot() const noexcept {
+        return std::atomic_load_explicit(&_root, std::memory_order_acquire);
+    }
+
+    unsigned long long ConfigMirror::GetVersion() const noexcept {
+        return _version.load(std::memory_order_acquire);
+    }
+
+    ConfigMirror::Statistics ConfigMirror::GetStatistics() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _statistics;
+    }
+
+    bool ConfigMirror::Refresh() {
+        std::lock_guard<std::mutex> refreshLock(_refreshMutex);
+
+        const std::shared_ptr<const ConfigNode> previous = Snapshot();
+
+        Statistics statistics;
+        std::shared_ptr<const ConfigNode> root;
+        try {
+            root = Rebuild(_path, previous, statistics);
+        }
+        catch(const Exceptions::RegistryException& e) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            ++_statistics.refreshes;
+            ++_statistics.failures;
+            _statistics.lastError = e.ErrorCode();
+            throw;
+        }
+
+        const bool changed = root != previous || _version.load(std::memory_order_relaxed) == 0;
+        if(changed) {
+            std::atomic_store_explicit(&_root, std::move(root), std::memory_order_release);
+            _version.fetch_add(1, std::memory_order_release);
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        ++_statistics.refreshes;
+        _statistics.publications += changed ? 1 : 0;
+        _statistics.keysChecked += statistics.keysChecked;
+        _statistics.keysRead += statistics.keysRead;
+        _statistics.keysReused += statistics.keysReused;
+        return changed;
+    }
+
+    void ConfigMirror::Start(std::chrono::milliseconds interval) {
+        std::lock_guard<std::mutex> controlLock(_controlMutex);
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(!_worker.joinable()) {
+            _stop = false;
+            _worker = std::thread(&ConfigMirror::Run, this, interval);
+        }
+    }
+
+    void ConfigMirror::Stop() noexcept {
+        // A concurrent call waits until the worker is joined
+        std::lock_guard<std::mutex> controlLock(_controlMutex);
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _stopRequested.notify_all();
+
+        if(_worker.joinable()) {
+            _worker.join();
+        }
+    }
+
+    std::shared_ptr<const ConfigNode> ConfigMirror::Rebuild(const std::string& path, const std::shared_ptr<const ConfigNode>& previous, Statistics& statistics) {
+        FILETIME time {};
+        if(!_source.QueryLastWriteTime(path, time)) {
+            return nullptr;
+        }
+        ++statistics.keysChecked;
+
+        const ULONGLONG lastWriteTime = (static_cast<ULONGLONG>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+
+        // Creating or deleting a subkey moves the time of its key: an unchanged key has the same subkeys
+        const bool unchanged = previous != nullptr && previous->_lastWriteTime == lastWriteTime;
+
+        std::vector<std::string> names;
+        if(unchanged) {
+            names.reserve(previous->_subkeys.size());
+            for(const auto& subkey : previous->_subkeys) {
+                names.push_back(subkey.first);
+            }
+        }
+        else {
+            names = _source.EnumSubKeys(path);
+        }
+
+        // The subkeys change without moving the time of their parent: check them all
+        ConfigNode::SubKeys subkeys;
+        bool reused = unchanged;
+        for(auto& name : names) {
+            std::shared_ptr<const ConfigNode> previousChild;
+            if(previous != nullptr) {
+                const auto child = previous->_subkeys.find(name);
+                if(child != previous->_subkeys.end()) {
+                    previousChild = child->second;
+                }
+            }
+
+            auto child = Rebuild(path.empty() ? name : path + '\\' + name, previousChild, statistics);
+            if(child == nullptr) {
+                // Deleted since the enumeration
+                reused = false;
+                continue;
+            }
+            reused = reused && child == previousChild;
+            subkeys.emplace(std::move(name), std::move(child));
+        }
+
+        if(reused) {
+            ++statistics.keysReused;
+            return previous;
+        }
+
+        auto node = std::make_shared<ConfigNode>();
+        node->_path = path;
+        node->_lastWriteTime = lastWriteTime;
+        node->_subkeys = std::move(subkeys);
+
+        if(unchanged) {
+            node->_values = previous->_values;
+        }
+        else {
+            ++statistics.keysRead;
+            auto values = std::make_shared<ConfigNode::Values>();
+            for(auto& value : _source.ReadKey(path)) {
+                values->insert_or_assign(std::move(value.first), std::move(value.second));
+            }
+            node->_values = std::move(values);
+        }
+
+        return node;
+    }
+
+    bool ConfigMirror::Watch() {
+        if(_hChanged == nullptr) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> refreshLock(_refreshMutex);
+        try {
+            return _source.WatchTree(_path, _hChanged);
+        }
+        catch(const Exceptions::RegistryException&) {
+            // Refreshed at every interval instead
+            return false;
+        }
+    }
+
+    void ConfigMirror::Run(std::chrono::milliseconds interval) {
+        // While the source notifies, a tick without a notification has nothing to refresh
+        bool watching = false;
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        while(!_stopRequested.wait_for(lock, interval, [this] { return _stop; })) {
+            if(watching && ::WaitForSingleObject(_hChanged, 0) != WAIT_OBJECT_0) {
+                ++_statistics.refreshesSkipped;
+                continue;
+            }
+
+            lock.unlock();
+            // Watched again before the refresh: a change during the refresh signals the next tick
+            watching = Watch();
+            try {
+                Refresh();
+            }
+            catch(const Exceptions::RegistryException&) {
+                // Counted in the metrics, the next tick refreshes again
+                watching = false;
+            }
+            lock.lock();
+        }
+    }
+
+
+} // namespace registry
+} // namespace abscodes
@@ -0,0 +1,385 @@
+//===--- LayeredKey.cpp --------------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+#include "Registry/LayeredKey.h"
+
+#include <limits>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+
+#include "Registry/RegistryException.h"
+
+namespace abscodes {
+namespace registry {
+
+    namespace {
+
+        /// Stamp of a layer whose changes are not notified: its answers are never valid
+        constexpr unsigned long long Unwatched = (std::numeric_limits<unsigned long long>::max)();
+
+        /// Changes a layer notifies
+        constexpr DWORD NotifyFilter = REG_NOTIFY_CHANGE_LAST_SET | REG_NOTIFY_THREAD_AGNOSTIC;
+
+        /// Changes of the subtree of a parent: keys created or deleted
+        constexpr DWORD ParentNotifyFilter = REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_THREAD_AGNOSTIC;
+
+        /// Store the largest value: two notifications can move a stamp concurrently
+        void StoreMax(std::atomic<unsigned long long>& stamp, unsigned long long epoch) noexcept {
+            unsigned long long current = stamp.load(std::memory_order_relaxed);
+            while(current < epoch && !stamp.compare_exchange_weak(current, epoch, std::memory_order_release, std::memory_order_relaxed)) {
+            }
+        }
+
+        /// Has the key been deleted since it was opened? Its handle then fails with ERROR_KEY_DELETED.
+        bool IsDeleted(const RegistryKey& key) noexcept {
+            return ::RegQueryInfoKeyW(key.Get(), //
+                                      nullptr, // no class
+                                      nullptr, //
+                                      nullptr, // reserved
+                                      nullptr, // no counts nor sizes
+                                      nullptr, //
+                                      nullptr, //
+                                      nullptr, //
+                                      nullptr, //
+                                      nullptr, //
+                                      nullptr, // no security descriptor
+                                      nullptr // no last write time
+                   )
+                   == ERROR_KEY_DELETED;
+        }
+
+    } // namespace
+
+    template <typename Read>
+    bool LayeredKey::ReadLayer(Layer& layer, Read&& read) const {
+        // Not notified, a missing layer is looked for at each read
+        if(layer.stamp.load(std::memory_order_acquire) == Unwatched && !IsPresent(layer.index)) {
+            Reopen(layer);
+        }
+
+        HKEY hKey = nullptr;
+        {
+            std::shared_lock<std::shared_mutex> lock(layer.keyMutex);
+            if(!layer.key.IsValid()) {
+                return false;
+            }
+            try {
+                read(static_cast<const RegistryKey&>(layer.key));
+                return true;
+            }
+            catch(const Exceptions::RegistryException& e) {
+                if(e.ErrorCode() != ERROR_KEY_DELETED) {
+                    throw;
+                }
+                hKey = layer.key.Get();
+            }
+        }
+
+        // Deleted before its notification came: absent, and the answers it gave are stale
+        Forget(layer, hKey);
+        return false;
+    }
+
+    LayeredKey::LayeredKey(std::vector<Source> layers) {
+        _layers.reserve(layers.size());
+        for(auto& source : layers) {
+            if(source.subkey.empty()) {
+                throw std::invalid_argument("The path of a layer cannot be empty.");
+            }
+
+            auto layer = std::make_unique<Layer>();
+            layer->parent = std::move(source.parent);
+            layer->subkey = std::move(source.subkey);
+            layer->index = _layers.size();
+            layer->owner = this;
+            _layers.push_back(std::move(layer));
+        }
+
+        for(auto& layer : _layers) {
+            Watch(*layer);
+        }
+    }
+
+    LayeredKey::~LayeredKey() noexcept {
+        for(auto& layer : _layers) {
+            // Wait for the callbacks in progress, they use the layer
+            for(HANDLE hWait : {layer->hParentWait, layer->hWait}) {
+                if(hWait != nullptr) {
+                    ::UnregisterWaitEx(hWait, INVALID_HANDLE_VALUE);
+                }
+            }
+            for(HANDLE hEvent : {layer->hParentEvent, layer->hEvent}) {
+                if(hEvent != nullptr) {
+                    ::CloseHandle(hEvent);
+                }
+            }
+        }
+    }
+
+    size_t LayeredKey::GetLayerCount() const noexcept {
+        return _layers.size();
+    }
+
+    bool LayeredKey::IsPresent(size_t layer) const {
+        const Layer& found = *_layers.at(layer);
+        std::shared_lock<std::shared_mutex> lock(found.keyMutex);
+        return found.key.IsValid();
+    }
+
+    bool LayeredKey::IsWatched(size_t layer) const {
+        const Layer& found = *_layers.at(layer);
+        return found.hWait != nullptr && found.hParentWait != nullptr;
+    }
+
+    LayeredKey::Statistics LayeredKey::GetStatistics() const noexcept {
+        Statistics statistics;
+        statistics.hits = _hits.load(std::memory_order_relaxed);
+        statistics.misses = _misses.load(std::memory_order_relaxed);
+        statistics.probes = _probes.load(std::memory_order_relaxed);
+        statistics.invalidations = _invalidations.load(std::memory_order_relaxed);
+        return statistics;
+    }
+
+    size_t LayeredKey::FindLayer(const std::string& valueName) const {
+        return Lookup(valueName).layer;
+    }
+
+    bool LayeredKey::HasValue(const std::string& valueName) const {
+        return FindLayer(valueName) != npos;
+    }
+
+    RegistryValue LayeredKey::GetValue(const std::string& valueName) const {
+        Entry entry = Lookup(valueName);
+        if(entry.layer == npos) {
+            throw Exceptions::RegistryException(valueName, "Value not found in any layer.", ERROR_FILE_NOT_FOUND);
+        }
+        return std::move(entry.value);
+    }
+
+    RegistryValue LayeredKey::GetValue(const std::string& valueName, const RegistryValue& defaultValue) const {
+        Entry entry = Lookup(valueName);
+        return entry.layer != npos ? std::move(entry.value) : defaultValue;
+    }
+
+    DWORD LayeredKey::GetDwordValue(const std::string& valueName, DWORD defaultValue) const {
+        const Entry entry = Lookup(valueName);
+        return entry.layer != npos ? entry.value.DWord() : defaultValue;
+    }
+
+    std::string LayeredKey::GetStringValue(const std::string& valueName, const std::string& defaultValue) const {
+        const Entry entry = Lookup(valueName);
+        return entry.layer != npos ? entry.value.String() : defaultValue;
+    }
+
+    std::vector<std::pair<std::string, RegistryValueType>> LayeredKey::EnumValues() const {
+        std::vector<std::pair<std::string, RegistryValueType>> values;
+        std::set<std::string, Name::Less> names;
+        for(const auto& layer : _layers) {
+            ReadLayer(*layer, [&](const RegistryKey& key) {
+                for(auto& value : key.EnumValues()) {
+                    if(names.insert(value.first).second) {
+                        values.push_back(std::move(value));
+                    }
+                }
+            });
+        }
+        return values;
+    }
+
+    std::vector<std::string> LayeredKey::EnumSubKeys() const {
+        std::vector<std::string> subkeys;
+        std::set<std::string, Name::Less> names;
+        for(const auto& layer : _layers) {
+            ReadLayer(*layer, [&](const RegistryKey& key) {
+                for(auto& subkey : key.EnumSubKeys()) {
+                    if(names.insert(subkey).second) {
+                        subkeys.push_back(std::move(subkey));
+                    }
+                }
+            });
+        }
+        return subkeys;
+    }
+
+    void LayeredKey::Invalidate(size_t layer) {
+        if(layer >= _layers.size()) {
+            throw std::out_of_range("Invalid layer index.");
+        }
+        Changed(layer);
+    }
+
+    void LayeredKey::Invalidate() {
+        if(!_layers.empty()) {
+            Changed(0);
+        }
+    }
+
+    LayeredKey::Entry LayeredKey::Lookup(const std::string& valueName) const {
+        {
+            std::shared_lock<std::shared_mutex> lock(_mutex);
+            const auto entry = _entries.find(valueName);
+
+            // The answer of a layer depends on the layers before it; an absent value depends on all of them
+            if(entry != _entries.end() && !_layers.empty()) {
+                const size_t layer = entry->second.layer != npos ? entry->second.layer : _layers.size() - 1;
+                if(_layers[layer]->stamp.load(std::memory_order_acquire) <= entry->second.epoch) {
+                    _hits.fetch_add(1, std::memory_order_relaxed);
+                    return entry->second;
+                }
+            }
+        }
+        _misses.fetch_add(1, std::memory_order_relaxed);
+
+        // The epoch is taken before reading: a change in between makes the entry stale, never valid
+        Entry entry;
+        entry.epoch = _epoch.load(std::memory_order_acquire);
+        for(const auto& layer : _layers) {
+            bool found = false;
+            ReadLayer(*layer, [&](const RegistryKey& key) {
+                _probes.fetch_add(1, std::memory_order_relaxed);
+                try {
+                    entry.value = key.GetValue(valueName);
+                    found = true;
+                }
+                catch(const Exceptions::RegistryException& e) {
+                    if(e.ErrorCode() != ERROR_FILE_NOT_FOUND) {
+                        throw;
+                    }
+                }
+            });
+            if(found) {
+                entry.layer = layer->index;
+                break;
+            }
+        }
+
+        std::unique_lock<std::shared_mutex> lock(_mutex);
+        _entries.insert_or_assign(valueName, entry);
+        return entry;
+    }
+
+    bool LayeredKey::Reopen(Layer& layer) const noexcept {
+        std::unique_lock<std::shared_mutex> lock(layer.keyMutex);
+
+        const bool deleted = layer.key.IsValid() && IsDeleted(layer.key);
+        if(layer.key.IsValid() && !deleted) {
+            return false;
+        }
+
+        layer.key.Close();
+        if(layer.parent.IsValid()) {
+            try {
+                layer.key = layer.parent.OpenSubKey(layer.subkey, RegistryAccessRights::Read);
+            }
+            catch(const std::exception&) {
+                // Missing, or not readable: absent
+            }
+        }
+
+        // Watch the values of the new key
+        if(layer.key.IsValid() && layer.hWait != nullptr
+           && ::RegNotifyChangeKeyValue(layer.key.Get(), FALSE, NotifyFilter, layer.hEvent, TRUE) != ERROR_SUCCESS) {
+            Unwatch(layer);
+        }
+
+        return deleted || layer.key.IsValid();
+    }
+
+    void LayeredKey::Forget(Layer& layer, HKEY hKey) const noexcept {
+        {
+            std::unique_lock<std::shared_mutex> lock(layer.keyMutex);
+            if(layer.key.Get() == hKey) {
+                layer.key.Close();
+            }
+        }
+        Changed(layer.index);
+    }
+
+    void LayeredKey::Watch(Layer& layer) noexcept {
+        if(!layer.parent.IsValid()) {
+            // Skipped by the lookups
+            return;
+        }
+
+        // The parent first: a layer created while it is opened is notified
+        layer.hEvent = ::CreateEventW(nullptr, FALSE, FALSE, nullptr); // auto-reset, not signaled, unnamed
+        layer.hParentEvent = ::CreateEventW(nullptr, FALSE, FALSE, nullptr);
+        if(layer.hEvent != nullptr && layer.hParentEvent != nullptr
+           && ::RegNotifyChangeKeyValue(layer.parent.Get(), TRUE, ParentNotifyFilter, layer.hParentEvent, TRUE) == ERROR_SUCCESS
+           && ::RegisterWaitForSingleObject(&layer.hParentWait, layer.hParentEvent, &LayeredKey::OnParentChanged, &layer, INFINITE, WT_EXECUTEDEFAULT)
+           && ::RegisterWaitForSingleObject(&layer.hWait, layer.hEvent, &LayeredKey::OnLayerChanged, &layer, INFINITE, WT_EXECUTEDEFAULT)) {
+            Reopen(layer);
+            return;
+        }
+
+        if(layer.hParentWait != nullptr) {
+            ::UnregisterWaitEx(layer.hParentWait, INVALID_HANDLE_VALUE);
+        }
+        layer.hParentWait = nullptr;
+        layer.hWait = nullptr;
+        for(HANDLE* hEvent : {&layer.hParentEvent, &layer.hEvent}) {
+            if(*hEvent != nullptr) {
+                ::CloseHandle(*hEvent);
+                *hEvent = nullptr;
+            }
+        }
+        Unwatch(layer);
+        Reopen(layer);
+    }
+
+    void LayeredKey::Unwatch(Layer& layer) const noexcept {
+        for(size_t i = layer.index; i < _layers.size(); ++i) {
+            StoreMax(_layers[i]->stamp, Unwatched);
+        }
+    }
+
+    void LayeredKey::Changed(size_t layer) const noexcept {
+        const unsigned long long epoch = _epoch.fetch_add(1, std::memory_order_acq_rel) + 1;
+        for(size_t i = layer; i < _layers.size(); ++i) {
+            StoreMax(_layers[i]->stamp, epoch);
+        }
+        _invalidations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void CALLBACK LayeredKey::OnLayerChanged(PVOID context, BOOLEAN /*timedOut*/) noexcept {
+        Layer& layer = *static_cast<Layer*>(context);
+
+        {
+            std::unique_lock<std::shared_mutex> lock(layer.keyMutex);
+
+            // The notification fires once: watch again before invalidating, so that no change is missed
+            if(layer.key.IsValid() && ::RegNotifyChangeKeyValue(layer.key.Get(), FALSE, NotifyFilter, layer.hEvent, TRUE) != ERROR_SUCCESS) {
+                // The key was deleted: absent, until the parent notifies that it is created again
+                layer.key.Close();
+            }
+        }
+        layer.owner->Changed(layer.index);
+    }
+
+    void CALLBACK LayeredKey::OnParentChanged(PVOID context, BOOLEAN /*timedOut*/) noexcept {
+        Layer& layer = *static_cast<Layer*>(context);
+        const LayeredKey& owner = *layer.owner;
+
+        if(::RegNotifyChangeKeyValue(layer.parent.Get(), TRUE, ParentNotifyFilter, layer.hParentEvent, TRUE) != ERROR_SUCCESS) {
+            // e.g. the parent was deleted: the layer is read, and looked for, at each lookup
+            owner.Unwatch(layer);
+        }
+
+        // Most changes of the subtree are not the layer's own: only its creation or deletion invalidates
+        if(owner.Reopen(layer)) {
+            owner.Changed(layer.index);
+        }
+    }
+
+
+} // namespace registry
+} // namespace abscodes
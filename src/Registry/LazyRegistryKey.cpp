@@ -0,0 +1,100 @@
+//===--- LazyRegistryKey.cpp ---------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+#include "Registry/LazyRegistryKey.h"
+
+#include "Registry/RegistryName.h"
+
+namespace abscodes {
+namespace registry {
+
+    LazyRegistryKey::LazyRegistryKey(RegistryHive hive, RegistryView view, RegistryAccessRights desiredAccess) noexcept
+      : _hive(hive)
+      , _view(view)
+      , _access(desiredAccess) {}
+
+    LazyRegistryKey::LazyRegistryKey(const LazyRegistryKey& parent, std::string path, size_t created)
+      : _hive(parent._hive)
+      , _view(parent._view)
+      , _access(parent._access)
+      , _path(std::move(path))
+      , _created(created) {}
+
+    bool LazyRegistryKey::IsOpen() const noexcept {
+        return _key.IsValid();
+    }
+
+    RegistryHive LazyRegistryKey::GetHive() const noexcept {
+        return _hive;
+    }
+
+    RegistryView LazyRegistryKey::GetView() const noexcept {
+        return _view;
+    }
+
+    RegistryAccessRights LazyRegistryKey::GetAccessRights() const noexcept {
+        return _access;
+    }
+
+    const std::string& LazyRegistryKey::GetName() const noexcept {
+        return _path;
+    }
+
+    RegistryKey& LazyRegistryKey::operator*() {
+        return Open();
+    }
+
+    RegistryKey* LazyRegistryKey::operator->() {
+        return &Open();
+    }
+
+    LazyRegistryKey LazyRegistryKey::CreateSubKey(const std::string& subkey) const {
+        std::string path = Name::Normalize(_path + '\\' + subkey);
+        const size_t created = path.size();
+        return LazyRegistryKey(*this, std::move(path), created);
+    }
+
+    LazyRegistryKey LazyRegistryKey::OpenSubKey(const std::string& subkey) const {
+        // The normalized path of the parent is a prefix of the one of the subkey
+        return LazyRegistryKey(*this, Name::Normalize(_path + '\\' + subkey), _created);
+    }
+
+    RegistryKey& LazyRegistryKey::Open() {
+        if(!_key.IsValid()) {
+            RegistryKey root(_hive, _view, _access);
+
+            if(_path.empty()) {
+                // Predefined keys are never opened nor closed
+                _key = std::move(root);
+            }
+            else if(_created == _path.size()) {
+                // One create for the whole chain, the intermediate keys included
+                _key = root.CreateSubKey(_path, _view, _access, RegistryOption::None);
+            }
+            else if(_created > 0) {
+                // The keys opened after the last create must exist
+                _key = root.CreateSubKey(_path.substr(0, _created), _view, _access, RegistryOption::None)
+                         .OpenSubKey(_path.substr(_created + 1), _view, _access, RegistryOption::None);
+            }
+            else {
+                // One open for the whole chain
+                _key = root.OpenSubKey(_path, _view, _access, RegistryOption::None);
+            }
+        }
+        return _key;
+    }
+
+    void LazyRegistryKey::Close() noexcept {
+        _key.Close();
+    }
+
+} // namespace registry
+} // namespace abscodes
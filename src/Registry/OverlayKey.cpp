@@ -0,0 +1,357 @@
+//===--- OverlayKey.cpp --------------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+#include "Registry/OverlayKey.h"
+
+#include <set>
+#include <stdexcept>
+#include <string_view>
+
+#include "Registry/RegistryException.h"
+
+namespace abscodes {
+namespace registry {
+
+    template <typename Visitor>
+    void OverlayKey::Walk(const Node& node, const std::string& path, bool baseVisible, Visitor& visitor) {
+        visitor(node, path, baseVisible);
+
+        const bool visible = baseVisible && !node.opaque;
+        for(const auto& subkey : node.subkeys) {
+            Walk(*subkey.second, path.empty() ? subkey.first : path + '\\' + subkey.first, visible, visitor);
+        }
+    }
+
+    OverlayKey::OverlayKey(RegistryCacheSource& base)
+      : _base(base)
+      , _root(std::make_unique<Node>()) {}
+
+    bool OverlayKey::IsEmpty() const noexcept {
+        return _root->subkeys.empty() && _root->values.empty();
+    }
+
+    size_t OverlayKey::GetNodeCount() const {
+        size_t count = 0;
+        auto visitor = [&](const Node&, const std::string&, bool) { ++count; };
+        Walk(*_root, std::string(), true, visitor);
+        return count;
+    }
+
+    size_t OverlayKey::GetValueCount() const {
+        size_t count = 0;
+        auto visitor = [&](const Node& node, const std::string&, bool) { count += node.values.size(); };
+        Walk(*_root, std::string(), true, visitor);
+        return count;
+    }
+
+    bool OverlayKey::KeyExists(const std::string& keyName) {
+        return Exists(Find(keyName));
+    }
+
+    bool OverlayKey::HasValue(const std::string& keyName, const std::string& valueName) {
+        return Read(Find(keyName), valueName, nullptr);
+    }
+
+    RegistryValue OverlayKey::GetValue(const std::string& keyName, const std::string& valueName) {
+        RegistryValue value;
+        if(!Read(Find(keyName), valueName, &value)) {
+            throw Exceptions::RegistryException(keyName, "Value not found in the overlay.", ERROR_FILE_NOT_FOUND);
+        }
+        return value;
+    }
+
+    std::vector<std::pair<std::string, RegistryValue>> OverlayKey::ReadKey(const std::string& keyName) {
+        const Location location = Find(keyName);
+        if(!Exists(location)) {
+            return {};
+        }
+
+        std::map<std::string, RegistryValue, Name::Less> values;
+        if(location.baseVisible) {
+            for(auto& value : _base.ReadKey(location.path)) {
+                values.insert_or_assign(std::move(value.first), std::move(value.second));
+            }
+        }
+        if(location.node != nullptr) {
+            for(const auto& value : location.node->values) {
+                if(value.second.IsEmpty()) {
+                    values.erase(value.first);
+                }
+                else {
+                    values.insert_or_assign(value.first, value.second);
+                }
+            }
+        }
+
+        return std::vector<std::pair<std::string, RegistryValue>>(values.begin(), values.end());
+    }
+
+    std::vector<std::string> OverlayKey::EnumSubKeys(const std::string& keyName) {
+        const Location location = Find(keyName);
+        if(!Exists(location)) {
+            return {};
+        }
+
+        std::set<std::string, Name::Less> names;
+        if(location.baseVisible) {
+            for(auto& name : _base.EnumSubKeys(location.path)) {
+                names.insert(std::move(name));
+            }
+        }
+        if(location.node != nullptr) {
+            for(const auto& subkey : location.node->subkeys) {
+                if(subkey.second->created) {
+                    names.insert(subkey.first);
+                }
+                else if(subkey.second->opaque) {
+                    names.erase(subkey.first);
+                }
+            }
+        }
+
+        return std::vector<std::string>(names.begin(), names.end());
+    }
+
+    void OverlayKey::CreateKey(const std::string& keyName) {
+        Insert(Name::Normalize(keyName), true);
+    }
+
+    void OverlayKey::DeleteKey(const std::string& keyName) {
+        const Location location = Find(keyName);
+        if(location.path.empty()) {
+            throw std::invalid_argument("Cannot delete the root of the overlay.");
+        }
+        if(!Exists(location)) {
+            throw Exceptions::RegistryException(keyName, "Key not found in the overlay.", ERROR_FILE_NOT_FOUND);
+        }
+
+        const size_t separator = location.path.rfind('\\');
+        const std::string parentPath = separator == std::string::npos ? std::string() : location.path.substr(0, separator);
+        const std::string name = separator == std::string::npos ? location.path : location.path.substr(separator + 1);
+
+        // Without a key to hide in the base, dropping the changes is enough. The visibility is the parent's:
+        // a key deleted, then created again, is opaque itself, while the base still holds the deleted key.
+        if(!Find(parentPath).baseVisible || !BaseExists(location.path)) {
+            Insert(parentPath, false).subkeys.erase(name);
+            return;
+        }
+
+        Node& node = Insert(location.path, false);
+        node.subkeys.clear();
+        node.values.clear();
+        node.created = false;
+        node.opaque = true;
+    }
+
+    void OverlayKey::SetValue(const std::string& keyName, const std::string& valueName, const RegistryValue& value) {
+        if(value.IsEmpty()) {
+            throw std::invalid_argument("Cannot write a REG_NONE value.");
+        }
+
+        Insert(Name::Normalize(keyName), true).values.insert_or_assign(valueName, value);
+    }
+
+    void OverlayKey::DeleteValue(const std::string& keyName, const std::string& valueName) {
+        const Location location = Find(keyName);
+
+        // A tombstone only if the base holds the value
+        RegistryValue baseValue;
+        const bool inBase = location.baseVisible && _base.ReadValue(location.path, valueName, baseValue);
+
+        bool found = inBase;
+        if(location.node != nullptr) {
+            const auto written = location.node->values.find(valueName);
+            if(written != location.node->values.end()) {
+                found = !written->second.IsEmpty();
+            }
+        }
+        if(!found) {
+            throw Exceptions::RegistryException(keyName, "Value not found in the overlay.", ERROR_FILE_NOT_FOUND);
+        }
+
+        Node& node = Insert(location.path, false);
+        if(inBase) {
+            node.values.insert_or_assign(valueName, RegistryValue());
+        }
+        else {
+            node.values.erase(valueName);
+        }
+    }
+
+    void OverlayKey::Export(RegistryWriteBatch& batch) {
+        // Parents come first: the values written again under a deleted key replace its deletions
+        auto visitor = [&](const Node& node, const std::string& path, bool baseVisible) {
+            if(node.opaque && baseVisible) {
+                ExportDeletion(batch, path);
+            }
+            for(const auto& value : node.values) {
+                if(value.second.IsEmpty()) {
+                    batch.DeleteValue(path, value.first);
+                }
+                else {
+                    batch.SetValue(path, value.first, value.second);
+                }
+            }
+        };
+        Walk(*_root, std::string(), true, visitor);
+    }
+
+    std::vector<RegistryWriteBatch::Failure> OverlayKey::Commit(RegistryKey& root) {
+
+        _ASSERTE(root.IsValid());
+
+        std::vector<RegistryWriteBatch::Failure> failures;
+        RegistryWriteBatch batch;
+
+        auto visitor = [&](const Node& node, const std::string& path, bool) {
+            if(node.opaque) {
+                try {
+                    root.DeleteSubKeyTree(path);
+                }
+                catch(const Exceptions::RegistryException& e) {
+                    if(e.ErrorCode() != ERROR_FILE_NOT_FOUND) {
+                        failures.push_back(RegistryWriteBatch::Failure {path, std::string(), e.what()});
+                    }
+                }
+            }
+            if(node.created && !path.empty()) {
+                try {
+                    root.CreateSubKey(path);
+                }
+                catch(const std::exception& e) {
+                    failures.push_back(RegistryWriteBatch::Failure {path, std::string(), e.what()});
+                }
+            }
+
+            // The deleted keys are gone with their values
+            for(const auto& value : node.values) {
+                if(value.second.IsEmpty()) {
+                    batch.DeleteValue(path, value.first);
+                }
+                else {
+                    batch.SetValue(path, value.first, value.second);
+                }
+            }
+        };
+        Walk(*_root, std::string(), true, visitor);
+
+        for(auto& failure : batch.Commit(root)) {
+            failures.push_back(std::move(failure));
+        }
+
+        // On failure, the delta is kept for another commit: applying the changes again is harmless
+        if(failures.empty()) {
+            Discard();
+        }
+        return failures;
+    }
+
+    void OverlayKey::Discard() noexcept {
+        _root->subkeys.clear();
+        _root->values.clear();
+    }
+
+    OverlayKey::Location OverlayKey::Find(const std::string& keyName) const {
+        Location location;
+        location.path = Name::Normalize(keyName);
+        location.node = _root.get();
+
+        // Walk the path one name at a time, while the delta holds it
+        std::string_view path = location.path;
+        while(location.node != nullptr && !path.empty()) {
+            const size_t separator = path.find('\\');
+            const std::string_view name = path.substr(0, separator);
+            path = separator == std::string_view::npos ? std::string_view() : path.substr(separator + 1);
+
+            const auto subkey = location.node->subkeys.find(name);
+            location.node = subkey != location.node->subkeys.end() ? subkey->second.get() : nullptr;
+            if(location.node != nullptr && location.node->opaque) {
+                location.baseVisible = false;
+            }
+        }
+
+        return location;
+    }
+
+    bool OverlayKey::Exists(const Location& location) {
+        if(location.path.empty() || (location.node != nullptr && location.node->created)) {
+            return true;
+        }
+        return location.baseVisible && BaseExists(location.path);
+    }
+
+    bool OverlayKey::BaseExists(const std::string& path) {
+        FILETIME lastWriteTime {};
+        return _base.QueryLastWriteTime(path, lastWriteTime);
+    }
+
+    bool OverlayKey::Read(const Location& location, const std::string& valueName, RegistryValue* value) {
+        // A value written in the delta belongs to a created key
+        if(location.node != nullptr) {
+            const auto written = location.node->values.find(valueName);
+            if(written != location.node->values.end()) {
+                if(written->second.IsEmpty()) {
+                    return false;
+                }
+                if(value != nullptr) {
+                    *value = written->second;
+                }
+                return true;
+            }
+        }
+
+        // The base tells a missing key from a missing value in the same single read
+        if(location.baseVisible) {
+            RegistryValue read;
+            if(!_base.ReadValue(location.path, valueName, read)) {
+                return false;
+            }
+            if(value != nullptr) {
+                *value = std::move(read);
+            }
+            return true;
+        }
+
+        return false;
+    }
+
+    OverlayKey::Node& OverlayKey::Insert(const std::string& path, bool created) {
+        Node* node = _root.get();
+
+        std::string_view rest = path;
+        while(!rest.empty()) {
+            const size_t separator = rest.find('\\');
+            const std::string_view name = rest.substr(0, separator);
+            rest = separator == std::string_view::npos ? std::string_view() : rest.substr(separator + 1);
+
+            auto subkey = node->subkeys.find(name);
+            if(subkey == node->subkeys.end()) {
+                subkey = node->subkeys.emplace(std::string(name), std::make_unique<Node>()).first;
+            }
+            node = subkey->second.get();
+            node->created = node->created || created;
+        }
+
+        return *node;
+    }
+
+    void OverlayKey::ExportDeletion(RegistryWriteBatch& batch, const std::string& path) {
+        for(const auto& value : _base.ReadKey(path)) {
+            batch.DeleteValue(path, value.first);
+        }
+        for(const auto& subkey : _base.EnumSubKeys(path)) {
+            ExportDeletion(batch, path + '\\' + subkey);
+        }
+    }
+
+
+} // namespace registry
+} // namespace abscodes
@@ -11,11 +11,120 @@
 
 #include "Registry/Registry.h"
 
-#include "Commons/NumberUtils.h"
+#include "Registry/RegistryNumberCodec.h"
+
+#include <array>
+#include <cstring>
+#include <limits>
 
 namespace abscodes {
 namespace registry {
 
+    namespace {
+
+        /// Longest text of a number read, blanks included
+        constexpr size_t MaxNumberLength = 63;
+
+        ///
+        /// Read a number stored as text, or natively (see RegistryNumberEncoding).
+        ///
+        /// The value is read with a single RegGetValue call into a stack buffer:
+        /// a text longer than MaxNumberLength characters is not a number, and throws.
+        ///
+        template <typename T>
+        T ReadNumber(const RegistryKey& key, const std::string& valueName, T defaultValue) {
+            alignas(ULONGLONG) BYTE data[(MaxNumberLength + 1) * sizeof(wchar_t)];
+            DWORD dataSize = sizeof(data);
+            const DWORD type = key.QueryValueData(valueName, data, dataSize);
+
+            T value = defaultValue;
+            switch(type) {
+                case REG_SZ:
+                case REG_EXPAND_SZ: {
+                    // RegGetValue null-terminates the string, and counts the terminating NUL
+                    const size_t length = dataSize / sizeof(wchar_t);
+                    const wchar_t* text = reinterpret_cast<const wchar_t*>(data);
+                    char buffer[MaxNumberLength + 1];
+                    size_t i = 0;
+                    for(; i < length && text[i] != L'\0'; ++i) {
+                        if(text[i] > 0x7F) {
+                            return defaultValue;
+                        }
+                        buffer[i] = static_cast<char>(text[i]);
+                    }
+                    NumberCodec::Parse(std::string_view(buffer, i), value);
+                    break;
+                }
+                case REG_DWORD:
+                    if constexpr(std::is_integral_v<T>) {
+                        // An unsigned number, the native setters write the negative ones as a REG_QWORD
+                        DWORD bits;
+                        std::memcpy(&bits, data, sizeof(bits));
+                        if(static_cast<ULONGLONG>(bits) <= static_cast<ULONGLONG>((std::numeric_limits<T>::max)())) {
+                            value = static_cast<T>(bits);
+                        }
+                    }
+                    break;
+                case REG_QWORD:
+                    if constexpr(std::is_integral_v<T>) {
+                        ULONGLONG bits;
+                        std::memcpy(&bits, data, sizeof(bits));
+                        if constexpr(sizeof(T) == sizeof(ULONGLONG)) {
+                            value = static_cast<T>(bits);
+                        }
+                        else if constexpr(std::is_signed_v<T>) {
+                            const auto number = static_cast<LONGLONG>(bits);
+                            if(number >= (std::numeric_limits<T>::min)() && number <= (std::numeric_limits<T>::max)()) {
+                                value = static_cast<T>(number);
+                            }
+                        }
+                        else if(bits <= (std::numeric_limits<T>::max)()) {
+                            value = static_cast<T>(bits);
+                        }
+                    }
+                    break;
+                case REG_BINARY:
+                    if constexpr(std::is_floating_point_v<T>) {
+                        if(dataSize == sizeof(T)) {
+                            std::memcpy(&value, data, sizeof(value));
+                        }
+                    }
+                    break;
+            }
+
+            return value;
+        }
+
+        /// Write a number in the given encoding
+        template <typename T>
+        void WriteNumber(RegistryKey& key, const std::string& valueName, T value, RegistryNumberEncoding encoding) {
+            if(encoding == RegistryNumberEncoding::Text) {
+                char buffer[NumberCodec::BufferSize];
+                key.Set(valueName, NumberCodec::Format(value, buffer));
+            }
+            else if constexpr(std::is_floating_point_v<T>) {
+                // Written as its bytes, not as a REG_QWORD, so that it cannot be mistaken for an integer
+                std::array<BYTE, sizeof(T)> bytes;
+                std::memcpy(bytes.data(), &value, sizeof(value));
+                key.Set(valueName, bytes);
+            }
+            else if constexpr(sizeof(T) <= sizeof(DWORD)) {
+                if constexpr(std::is_signed_v<T>) {
+                    if(value < 0) {
+                        // Sign-extended, so that no unsigned reader mistakes it for a large number
+                        key.SetQwordValue(valueName, static_cast<ULONGLONG>(static_cast<LONGLONG>(value)));
+                        return;
+                    }
+                }
+                key.SetDwordValue(valueName, static_cast<DWORD>(value));
+            }
+            else {
+                key.SetQwordValue(valueName, static_cast<ULONGLONG>(value));
+            }
+        }
+
+    } // namespace
+
 
     /// Retrieves the key associated with the specified name, in the specified registry hive.
     /// If the key is not found in the specified hive, a RegistryException is throw.
@@ -23,11 +132,11 @@ namespace registry {
         return RegistryKey(hive).OpenSubKey(keyName);
     }
 
-    RegistryKey GetKey(RegistryKey& key, const std::string& keyName) {
+    RegistryKey GetKey(const RegistryKey& key, const std::string& keyName) {
         return key.OpenSubKey(keyName);
     }
 
-    bool HasKey(RegistryKey& key, const std::string& keyName) noexcept {
+    bool HasKey(const RegistryKey& key, const std::string& keyName) noexcept {
         try {
             return key.OpenSubKey(keyName).IsValid();
         }
@@ -58,15 +167,15 @@ namespace registry {
         return RegistryKey(hive).OpenSubKey(keyName).GetValue(valueName);
     }
 
-    RegistryValue GetValue(RegistryKey& key, const std::string& keyName, const std::string& valueName) {
+    RegistryValue GetValue(const RegistryKey& key, const std::string& keyName, const std::string& valueName) {
         return key.OpenSubKey(keyName).GetValue(valueName);
     }
 
-    RegistryValue GetValue(RegistryKey& key, const std::string& valueName) {
+    RegistryValue GetValue(const RegistryKey& key, const std::string& valueName) {
         return key.GetValue(valueName);
     }
 
-    REGISTRY_API bool HasValue(RegistryKey& key, const std::string& valueName) noexcept {
+    REGISTRY_API bool HasValue(const RegistryKey& key, const std::string& valueName) noexcept {
         try {
             key.GetValue(valueName);
             return true;
@@ -76,7 +185,7 @@ namespace registry {
         return false;
     }
 
-    DWORD GetDWord(RegistryKey& key, const std::string& valueName, DWORD defaultValue) noexcept {
+    DWORD GetDWord(const RegistryKey& key, const std::string& valueName, DWORD defaultValue) noexcept {
         try {
             return key.GetDwordValue(valueName);
         }
@@ -85,7 +194,7 @@ namespace registry {
         return defaultValue;
     }
 
-    ULONGLONG GetQWord(RegistryKey& key, const std::string& valueName, ULONGLONG defaultValue) noexcept {
+    ULONGLONG GetQWord(const RegistryKey& key, const std::string& valueName, ULONGLONG defaultValue) noexcept {
         try {
             return key.GetQwordValue(valueName);
         }
@@ -94,7 +203,7 @@ namespace registry {
         return defaultValue;
     }
 
-    const std::string GetString(RegistryKey& key, const std::string& valueName, const std::string& defaultValue) noexcept {
+    const std::string GetString(const RegistryKey& key, const std::string& valueName, const std::string& defaultValue) noexcept {
         try {
             return key.GetStringValue(valueName);
         }
@@ -103,7 +212,7 @@ namespace registry {
         return defaultValue;
     }
 
-    const std::string GetExpandString(RegistryKey& key, const std::string& valueName, const std::string& defaultValue) noexcept {
+    const std::string GetExpandString(const RegistryKey& key, const std::string& valueName, const std::string& defaultValue) noexcept {
         try {
             return key.GetExpandStringValue(valueName);
         }
@@ -112,7 +221,7 @@ namespace registry {
         return defaultValue;
     }
 
-    const std::vector<std::string> GetMultiString(RegistryKey& key, const std::string& valueName, const std::vector<std::string>& defaultValue) noexcept {
+    const std::vector<std::string> GetMultiString(const RegistryKey& key, const std::string& valueName, const std::vector<std::string>& defaultValue) noexcept {
         try {
             return key.GetMultiStringValue(valueName);
         }
@@ -121,7 +230,7 @@ namespace registry {
         return defaultValue;
     }
 
-    const std::vector<BYTE> GetBinary(RegistryKey& key, const std::string& valueName, const std::vector<BYTE>& defaultValue) noexcept {
+    const std::vector<BYTE> GetBinary(const RegistryKey& key, const std::string& valueName, const std::vector<BYTE>& defaultValue) noexcept {
         try {
             return key.GetBinaryValue(valueName);
         }
@@ -130,45 +239,45 @@ namespace registry {
         return defaultValue;
     }
 
-    int GetInt(RegistryKey& key, const std::string& valueName, int defaultValue) noexcept {
+    int GetInt(const RegistryKey& key, const std::string& valueName, int defaultValue) noexcept {
         try {
-            return commons::number::toNumber<int>(key.GetStringValue(valueName));
+            return ReadNumber(key, valueName, defaultValue);
         }
         catch(...) {
         }
         return defaultValue;
     }
 
-    unsigned int GetUInt(RegistryKey& key, const std::string& valueName, unsigned int defaultValue) noexcept {
+    unsigned int GetUInt(const RegistryKey& key, const std::string& valueName, unsigned int defaultValue) noexcept {
         try {
-            return commons::number::toNumber<unsigned int>(key.GetStringValue(valueName));
+            return ReadNumber(key, valueName, defaultValue);
         }
         catch(...) {
         }
         return defaultValue;
     }
 
-    long GetLong(RegistryKey& key, const std::string& valueName, long defaultValue) noexcept {
+    long GetLong(const RegistryKey& key, const std::string& valueName, long defaultValue) noexcept {
         try {
-            return commons::number::toNumber<long>(key.GetStringValue(valueName));
+            return ReadNumber(key, valueName, defaultValue);
         }
         catch(...) {
         }
         return defaultValue;
     }
 
-    unsigned long GetULong(RegistryKey& key, const std::string& valueName, unsigned long defaultValue) noexcept {
+    unsigned long GetULong(const RegistryKey& key, const std::string& valueName, unsigned long defaultValue) noexcept {
         try {
-            return commons::number::toNumber<unsigned long>(key.GetStringValue(valueName));
+            return ReadNumber(key, valueName, defaultValue);
         }
         catch(...) {
         }
         return defaultValue;
     }
 
-    double GetDouble(RegistryKey& key, const std::string& valueName, double defaultValue) noexcept {
+    double GetDouble(const RegistryKey& key, const std::string& valueName, double defaultValue) noexcept {
         try {
-            return commons::number::toNumber<double>(key.GetStringValue(valueName));
+            return ReadNumber(key, valueName, defaultValue);
         }
         catch(...) {
         }
@@ -241,41 +350,41 @@ namespace registry {
         }
     }
 
-    void SetInt(RegistryKey& key, const std::string& valueName, int value) noexcept {
+    void SetInt(RegistryKey& key, const std::string& valueName, int value, RegistryNumberEncoding encoding) noexcept {
         try {
-            key.SetStringValue(valueName, commons::number::toString(value));
+            WriteNumber(key, valueName, value, encoding);
         }
         catch(...) {
         }
     }
 
-    void SetUInt(RegistryKey& key, const std::string& valueName, unsigned int value) noexcept {
+    void SetUInt(RegistryKey& key, const std::string& valueName, unsigned int value, RegistryNumberEncoding encoding) noexcept {
         try {
-            key.SetStringValue(valueName, commons::number::toString(value));
+            WriteNumber(key, valueName, value, encoding);
         }
         catch(...) {
         }
     }
 
-    void SetLong(RegistryKey& key, const std::string& valueName, long value) noexcept {
+    void SetLong(RegistryKey& key, const std::string& valueName, long value, RegistryNumberEncoding encoding) noexcept {
         try {
-            key.SetStringValue(valueName, commons::number::toString(value));
+            WriteNumber(key, valueName, value, encoding);
         }
         catch(...) {
         }
     }
 
-    void SetULong(RegistryKey& key, const std::string& valueName, unsigned long value) noexcept {
+    void SetULong(RegistryKey& key, const std::string& valueName, unsigned long value, RegistryNumberEncoding encoding) noexcept {
         try {
-            key.SetStringValue(valueName, commons::number::toString(value));
+            WriteNumber(key, valueName, value, encoding);
         }
         catch(...) {
         }
     }
 
-    void SetDouble(RegistryKey& key, const std::string& valueName, double value) noexcept {
+    void SetDouble(RegistryKey& key, const std::string& valueName, double value, RegistryNumberEncoding encoding) noexcept {
         try {
-            key.SetStringValue(valueName, commons::number::toString(value));
+            WriteNumber(key, valueName, value, encoding);
         }
         catch(...) {
         }
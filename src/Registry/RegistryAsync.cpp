@@ -0,0 +1,38 @@
+//===--- RegistryAsync.cpp -----------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+#include "Registry/RegistryAsync.h"
+
+namespace abscodes {
+namespace registry {
+
+    std::future<RegistryKey> OpenSubKeyAsync(const RegistryKey& key, std::string subkey, RegistryCancellationToken token, RegistryIoPool& pool) {
+        return pool.Submit([&key, subkey = std::move(subkey)] { return key.OpenSubKey(subkey); }, std::move(token));
+    }
+
+    std::future<RegistryValue> GetValueAsync(const RegistryKey& key, std::string valueName, RegistryCancellationToken token, RegistryIoPool& pool) {
+        return pool.Submit([&key, valueName = std::move(valueName)] { return key.GetValue(valueName); }, std::move(token));
+    }
+
+    std::future<void> SetValueAsync(RegistryKey& key, std::string valueName, RegistryValue value, RegistryCancellationToken token, RegistryIoPool& pool) {
+        return pool.Submit([&key, valueName = std::move(valueName), value = std::move(value)] { key.SetValue(valueName, value); }, std::move(token));
+    }
+
+    std::future<std::vector<std::string>> EnumSubKeysAsync(const RegistryKey& key, RegistryCancellationToken token, RegistryIoPool& pool) {
+        return pool.Submit([&key] { return key.EnumSubKeys(); }, std::move(token));
+    }
+
+    std::future<std::vector<std::pair<std::string, RegistryValueType>>> EnumValuesAsync(const RegistryKey& key, RegistryCancellationToken token, RegistryIoPool& pool) {
+        return pool.Submit([&key] { return key.EnumValues(); }, std::move(token));
+    }
+
+} // namespace registry
+} // namespace abscodes
@@ -0,0 +1,106 @@
+//===--- RegistryAtomTable.cpp -------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+#include "Registry/RegistryAtomTable.h"
+
+#include <mutex>
+#include <stdexcept>
+
+namespace abscodes {
+namespace registry {
+
+    RegistryAtomTable::RegistryAtomTable() {
+        // The empty name is atom 0
+        Intern(std::string_view());
+    }
+
+    RegistryAtomTable::~RegistryAtomTable() noexcept = default;
+
+    RegistryAtomTable& RegistryAtomTable::Names() {
+        static RegistryAtomTable table;
+        return table;
+    }
+
+    size_t RegistryAtomTable::GetCount() const noexcept {
+        return _next.load(std::memory_order_acquire);
+    }
+
+    std::string_view RegistryAtomTable::GetName(Atom atom) const {
+        return GetString(atom);
+    }
+
+    const std::string& RegistryAtomTable::GetString(Atom atom) const {
+        const auto slot = _names.Find(atom);
+        if(slot != nullptr) {
+            const auto name = slot->load(std::memory_order_acquire);
+            if(name != nullptr) {
+                return *name;
+            }
+        }
+        throw std::out_of_range("Unknown registry atom.");
+    }
+
+    RegistryAtomTable::Atom RegistryAtomTable::Intern(std::string_view name) {
+        Shard& shard = _shards[ShardOf(name)];
+
+        // Most names are already known
+        {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            const auto it = shard.atoms.find(name);
+            if(it != shard.atoms.end()) {
+                return it->second;
+            }
+        }
+
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+        // Another thread may have added it meanwhile
+        const auto it = shard.atoms.find(name);
+        if(it != shard.atoms.end()) {
+            return it->second;
+        }
+
+        // The other shards take atoms concurrently
+        const Atom atom = _next.fetch_add(1, std::memory_order_acq_rel);
+        if(atom >= _names.Capacity) {
+            _next.store(static_cast<Atom>(_names.Capacity), std::memory_order_relaxed);
+            throw std::overflow_error("Registry atom table is full.");
+        }
+
+        shard.names.emplace_back(name);
+        const std::string* stored = &shard.names.back();
+
+        // Publish the name before the atom can be seen by anybody
+        _names.Slot(atom).store(stored, std::memory_order_release);
+        shard.atoms.emplace(*stored, atom);
+
+        return atom;
+    }
+
+    bool RegistryAtomTable::TryFind(std::string_view name, Atom& atom) const {
+        const Shard& shard = _shards[ShardOf(name)];
+
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        const auto it = shard.atoms.find(name);
+        if(it == shard.atoms.end()) {
+            return false;
+        }
+
+        atom = it->second;
+        return true;
+    }
+
+    size_t RegistryAtomTable::ShardOf(std::string_view name) const noexcept {
+        return Name::Hash(name) & (ShardCount - 1);
+    }
+
+} // namespace registry
+} // namespace abscodes
@@ -12,6 +12,8 @@
 
 #include "Registry/RegistryException.h"
 
+#include <cstring>
+
 
 namespace abscodes {
 namespace registry {
@@ -20,40 +22,74 @@ namespace registry {
 
         RegistryException::RegistryException(const std::string& keyName, const std::string& message)
           : ErrorCodeException(message, 0L)
-          , _keyName(keyName.c_str()) {}
+          , _errorCode(0L) {
+            SetKeyName(keyName.data(), keyName.size());
+        }
 
         RegistryException::RegistryException(const std::string& keyName, const std::string& message, LONG errorCode)
           : ErrorCodeException(message, errorCode)
-          , _keyName(keyName.c_str()) {}
+          , _errorCode(errorCode) {
+            SetKeyName(keyName.data(), keyName.size());
+        }
 
         RegistryException::RegistryException(const std::string& message, LONG errorCode)
           : ErrorCodeException(message, errorCode)
-          , _keyName("") {}
+          , _errorCode(errorCode) {
+            SetKeyName(nullptr, 0);
+        }
 
         RegistryException::RegistryException(const std::string& message)
           : ErrorCodeException(message, 0L)
-          , _keyName("") {}
+          , _errorCode(0L) {
+            SetKeyName(nullptr, 0);
+        }
 
         RegistryException::RegistryException(const char* keyName, const char* message)
           : ErrorCodeException(message, 0L)
-          , _keyName(keyName) {}
+          , _errorCode(0L) {
+            SetKeyName(keyName, keyName != nullptr ? std::strlen(keyName) : 0);
+        }
 
         RegistryException::RegistryException(const char* keyName, const char* message, LONG errorCode)
           : ErrorCodeException(message, errorCode)
-          , _keyName(keyName) {}
+          , _errorCode(errorCode) {
+            SetKeyName(keyName, keyName != nullptr ? std::strlen(keyName) : 0);
+        }
 
         RegistryException::RegistryException(const char* message, LONG errorCode)
           : ErrorCodeException(message, errorCode)
-          , _keyName("") {}
+          , _errorCode(errorCode) {
+            SetKeyName(nullptr, 0);
+        }
 
         RegistryException::RegistryException(const char* message)
           : ErrorCodeException(message, 0L)
-          , _keyName("") {}
+          , _errorCode(0L) {
+            SetKeyName(nullptr, 0);
+        }
 
         char const* RegistryException::ErrorKeyName() const noexcept {
             return _keyName;
         }
 
+        LONG RegistryException::ErrorCode() const noexcept {
+            return _errorCode;
+        }
+
+        void RegistryException::SetKeyName(const char* keyName, size_t length) noexcept {
+            if(length >= _maxKeyNameLength) {
+                // Cut before the character the last byte belongs to, not inside it: skip back its UTF-8 continuation bytes
+                length = _maxKeyNameLength - 1;
+                while(length > 0 && (static_cast<unsigned char>(keyName[length]) & 0xC0) == 0x80) {
+                    --length;
+                }
+            }
+            if(length > 0) {
+                std::memcpy(_keyName, keyName, length);
+            }
+            _keyName[length] = '\0';
+        }
+
     } // namespace Exceptions
 } // namespace registry
 } // namespace abscodes
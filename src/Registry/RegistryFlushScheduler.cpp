@@ -0,0 +1,201 @@
+//===--- RegistryFlushScheduler.cpp --------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+#include "Registry/RegistryFlushScheduler.h"
+
+#include <algorithm>
+
+#include "Registry/RegistryException.h"
+
+namespace abscodes {
+namespace registry {
+
+    RegistryFlushScheduler& RegistryFlushScheduler::Instance() {
+        // Leaked: a static destructor would join the worker under the loader lock, see Shutdown
+        static RegistryFlushScheduler* instance = new RegistryFlushScheduler();
+        return *instance;
+    }
+
+    RegistryFlushScheduler::~RegistryFlushScheduler() noexcept {
+        Shutdown();
+    }
+
+    void RegistryFlushScheduler::Schedule(RegistryHive hive, RegistryDurability durability, std::chrono::milliseconds window) {
+
+        if(durability == RegistryDurability::None) {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        // Once stopped, fall back to a synchronous flush
+        if(_stop) {
+            lock.unlock();
+            Flush(hive, Hive::Handle(hive));
+            return;
+        }
+
+        // Lazily start the worker thread
+        if(!_worker.joinable()) {
+            _worker = std::thread(&RegistryFlushScheduler::Run, this);
+        }
+
+        HiveState& state = _hives[hive];
+        const auto generation = ++state.requested;
+        ++state.statistics.requests;
+
+        // The earliest deadline of the requests not taken by a flush yet wins
+        const auto delay = (durability == RegistryDurability::Deferred) ? _deferredDelay : window;
+        state.deadline = (std::min)(state.deadline, std::chrono::steady_clock::now() + delay);
+
+        _requested.notify_one();
+
+        if(durability == RegistryDurability::GroupCommit) {
+            // Wait for a flush covering our request, which hands us its result: a later flush may fail or succeed
+            Waiter waiter {generation};
+            state.waiters.push_back(&waiter);
+            _completed.wait(lock, [&waiter] { return waiter.done; });
+
+            if(waiter.result != ERROR_SUCCESS) {
+                throw Exceptions::RegistryException("RegFlushKey failed.", waiter.result);
+            }
+        }
+    }
+
+    void RegistryFlushScheduler::Flush(RegistryHive hive, HKEY hKey) {
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto retCode = ::RegFlushKey(hKey);
+        const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            Record(_hives[hive].statistics, retCode, latency);
+        }
+
+        if(retCode != ERROR_SUCCESS) {
+            throw Exceptions::RegistryException("RegFlushKey failed.", retCode);
+        }
+    }
+
+    void RegistryFlushScheduler::Shutdown() noexcept {
+        // Concurrent callers wait for the first one; once stopped, no request starts the worker again
+        std::call_once(_shutdown, [this] {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stop = true;
+            }
+            _requested.notify_all();
+
+            // The worker flushes the pending requests before exiting
+            if(_worker.joinable() && _worker.get_id() != std::this_thread::get_id()) {
+                _worker.join();
+            }
+        });
+    }
+
+    std::chrono::milliseconds RegistryFlushScheduler::GetDeferredDelay() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _deferredDelay;
+    }
+
+    void RegistryFlushScheduler::SetDeferredDelay(std::chrono::milliseconds delay) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _deferredDelay = delay;
+    }
+
+    RegistryFlushScheduler::Statistics RegistryFlushScheduler::GetStatistics(RegistryHive hive) const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        const auto it = _hives.find(hive);
+        return it != _hives.end() ? it->second.statistics : Statistics();
+    }
+
+    void RegistryFlushScheduler::Run() {
+
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        for(;;) {
+            // Find the earliest deadline of the pending requests
+            bool pending = false;
+            auto next = std::chrono::steady_clock::time_point::max();
+            for(const auto& hive : _hives) {
+                if(hive.second.requested > hive.second.completed) {
+                    pending = true;
+                    next = (std::min)(next, hive.second.deadline);
+                }
+            }
+
+            if(!pending) {
+                if(_stop) {
+                    return;
+                }
+                _requested.wait(lock);
+                continue;
+            }
+
+            if(!_stop && std::chrono::steady_clock::now() < next) {
+                _requested.wait_until(lock, next);
+                continue;
+            }
+
+            // Flush every hive whose deadline is reached, one call serves all its pending requests.
+            // Map nodes are stable, so the iteration survives the unlocked flush.
+            const auto now = std::chrono::steady_clock::now();
+            for(auto& hive : _hives) {
+                HiveState& state = hive.second;
+                if(state.requested <= state.completed || (!_stop && now < state.deadline)) {
+                    continue;
+                }
+
+                // The requests received during the flush start a new group, with a deadline of their own
+                const auto generation = state.requested;
+                state.deadline = std::chrono::steady_clock::time_point::max();
+
+                lock.unlock();
+                const auto start = std::chrono::steady_clock::now();
+                const auto retCode = ::RegFlushKey(Hive::Handle(hive.first));
+                const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+                lock.lock();
+
+                Record(state.statistics, retCode, latency);
+                state.completed = generation;
+
+                // Hand the result to the waiters of the generations covered
+                auto& waiters = state.waiters;
+                waiters.erase(std::remove_if(waiters.begin(),
+                                             waiters.end(),
+                                             [&](Waiter* waiter) {
+                                                 if(waiter->generation > generation) {
+                                                     return false;
+                                                 }
+                                                 waiter->result = retCode;
+                                                 waiter->done = true;
+                                                 return true;
+                                             }),
+                              waiters.end());
+            }
+
+            _completed.notify_all();
+        }
+    }
+
+    void RegistryFlushScheduler::Record(Statistics& statistics, LONG retCode, std::chrono::microseconds latency) {
+        ++statistics.flushes;
+        if(retCode != ERROR_SUCCESS) {
+            ++statistics.failures;
+        }
+        statistics.totalLatency += latency;
+        statistics.lastLatency = latency;
+        statistics.maxLatency = (std::max)(statistics.maxLatency, latency);
+    }
+
+} // namespace registry
+} // namespace abscodes
@@ -0,0 +1,182 @@
+//===--- RegistryIoPool.cpp ----------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+#include "Registry/RegistryIoPool.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace abscodes {
+namespace registry {
+
+    namespace {
+
+        /// Pool run by the current thread, if any
+        thread_local const RegistryIoPool* currentPool = nullptr;
+
+    } // namespace
+
+    RegistryCancellationToken::RegistryCancellationToken()
+      : _cancelled(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void RegistryCancellationToken::Cancel() noexcept {
+        _cancelled->store(true);
+    }
+
+    bool RegistryCancellationToken::IsCancellationRequested() const noexcept {
+        return _cancelled->load();
+    }
+
+    void RegistryCancellationToken::ThrowIfCancellationRequested() const {
+        if(IsCancellationRequested()) {
+            throw Exceptions::RegistryException("Registry operation cancelled.", ERROR_OPERATION_ABORTED);
+        }
+    }
+
+    RegistryIoPool::RegistryIoPool(size_t threadCount, size_t queueCapacity)
+      : _capacity(queueCapacity > 0 ? queueCapacity : 1) {
+
+        if(threadCount == 0) {
+            throw std::invalid_argument("threadCount cannot be zero!");
+        }
+
+        _threads.reserve(threadCount);
+        for(size_t i = 0; i < threadCount; ++i) {
+            _threads.emplace_back(&RegistryIoPool::Run, this);
+        }
+    }
+
+    RegistryIoPool::~RegistryIoPool() noexcept {
+        RequestStop();
+
+        std::lock_guard<std::mutex> lock(_joinMutex);
+        for(auto& thread : _threads) {
+            if(!thread.joinable()) {
+                continue;
+            }
+            // Destroyed by one of its jobs: the thread cannot join itself, it leaves the pool as the job returns
+            if(thread.get_id() == std::this_thread::get_id()) {
+                thread.detach();
+                currentPool = nullptr;
+            }
+            else {
+                thread.join();
+            }
+        }
+    }
+
+    RegistryIoPool& RegistryIoPool::Default() {
+        // Leaked: a static destructor would join the threads under the loader lock, see Shutdown
+        static RegistryIoPool* pool = new RegistryIoPool((std::max)(2u, (std::min)(8u, std::thread::hardware_concurrency())));
+        return *pool;
+    }
+
+    void RegistryIoPool::Shutdown() noexcept {
+        RequestStop();
+
+        // A pool thread cannot join itself, and could be joined by another caller meanwhile: the threads exit
+        // once the queue is empty, and are joined by the next call from another thread or by the destructor
+        if(currentPool == this) {
+            return;
+        }
+
+        // Concurrent callers join the threads one at a time
+        std::lock_guard<std::mutex> lock(_joinMutex);
+        for(auto& thread : _threads) {
+            if(thread.joinable()) {
+                thread.join();
+            }
+        }
+    }
+
+    size_t RegistryIoPool::GetThreadCount() const noexcept {
+        return _threads.size();
+    }
+
+    RegistryIoPool::Statistics RegistryIoPool::GetStatistics() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _statistics;
+    }
+
+    void RegistryIoPool::Post(std::function<void()> operation) {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        if(_stop) {
+            throw Exceptions::RegistryException("Registry I/O pool is stopped.", ERROR_OPERATION_ABORTED);
+        }
+
+        // A pool thread waiting for room could wait for itself, e.g. a coroutine resumed on the pool that awaits
+        // again: the caller gets the operation back instead, and decides how to run it
+        if(currentPool == this && _queue.size() >= _capacity) {
+            ++_statistics.rejected;
+            throw Exceptions::RegistryException("Registry I/O pool queue is full.", ERROR_BUSY);
+        }
+
+        // Back pressure
+        _notFull.wait(lock, [this] { return _stop || _queue.size() < _capacity; });
+
+        if(_stop) {
+            throw Exceptions::RegistryException("Registry I/O pool is stopped.", ERROR_OPERATION_ABORTED);
+        }
+
+        _queue.push_back(Job {std::move(operation), std::chrono::steady_clock::now()});
+
+        ++_statistics.posted;
+        _statistics.maxQueueDepth = (std::max)(_statistics.maxQueueDepth, _queue.size());
+
+        lock.unlock();
+        _notEmpty.notify_one();
+    }
+
+    void RegistryIoPool::RequestStop() noexcept {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _notEmpty.notify_all();
+        _notFull.notify_all();
+    }
+
+    void RegistryIoPool::Run() {
+        currentPool = this;
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        for(;;) {
+            _notEmpty.wait(lock, [this] { return _stop || !_queue.empty(); });
+
+            // Queued jobs are still run once stop is requested, so no future is left broken
+            if(_queue.empty()) {
+                return;
+            }
+
+            Job job = std::move(_queue.front());
+            _queue.pop_front();
+            lock.unlock();
+            _notFull.notify_one();
+
+            const auto start = std::chrono::steady_clock::now();
+            job.operation();
+            const auto end = std::chrono::steady_clock::now();
+
+            // The job destroyed the pool, see the destructor
+            if(currentPool != this) {
+                return;
+            }
+
+            lock.lock();
+            ++_statistics.completed;
+            _statistics.totalQueueLatency += std::chrono::duration_cast<std::chrono::microseconds>(start - job.posted);
+            _statistics.totalRunLatency += std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        }
+    }
+
+} // namespace registry
+} // namespace abscodes
@@ -11,36 +11,340 @@
 
 #include "Registry/RegistryKey.h"
 
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <tuple>
+
 #include "Commons/StringUtils.h"
-#include "Commons/Utf8Convert.h"
 #include "Registry/RegistryException.h"
+#include "Registry/RegistryFlushScheduler.h"
+#include "Registry/RegistryTransaction.h"
+#include "RegistryUtils.h"
 
 namespace abscodes {
 namespace registry {
 
+    namespace {
+
+        using detail::AppendWide;
+        using detail::Narrow;
+        using detail::Widen;
+
+        ///
+        /// Buffers of the UTF-8/UTF-16 marshaling, one set per thread.
+        ///
+        /// The buffers only grow: once warmed up, converting names and payloads reuses their capacity, and
+        /// a read allocates only the result returned to the caller. A buffer is used between the calls
+        /// to the Windows API of a single function, never across a call to another RegistryKey method.
+        ///
+        struct Scratch {
+            /// Key or value name, in UTF-16
+            std::wstring name;
+            /// Value payload, in UTF-16
+            std::wstring text;
+            /// Enumerated name, in UTF-16
+            std::wstring enumName;
+            /// Enumerated name, in UTF-8
+            std::string utf8;
+            /// Data of several values
+            std::vector<BYTE> data;
+        };
+
+        /// Get the buffers of the current thread
+        Scratch& GetScratch() {
+            thread_local Scratch scratch;
+            return scratch;
+        }
+
+        /// Get the scratch buffer of the thread for enumerated names, of the given length
+        wchar_t* EnumNameBuffer(DWORD length) {
+            std::wstring& buffer = GetScratch().enumName;
+            buffer.resize(length);
+            return &buffer[0];
+        }
+
+        /// Convert a key or value name to UTF-16, into the scratch buffer of the thread
+        const wchar_t* WideName(const std::string& name) {
+            std::wstring& buffer = GetScratch().name;
+            Widen(name, buffer);
+            return buffer.c_str();
+        }
+
+        ///
+        /// Convert a UTF-16 name to UTF-8, reusing the storage of buffer.
+        ///
+        /// @return A view into buffer, valid until the next call.
+        ///
+        std::string_view NarrowName(const wchar_t* name, DWORD length, std::string& buffer) {
+            Narrow(name, length, buffer);
+            return buffer;
+        }
+
+        ///
+        /// Read the data of a value into buffer, resized to the data read.
+        ///
+        /// Buffer is a vector or a string of BYTE or wchar_t.
+        ///
+        template <typename Buffer>
+        void ReadValueData(HKEY hKey, const wchar_t* valueName, DWORD flags, Buffer& data, const char* sizeMessage, const char* dataMessage) {
+            using Unit = typename Buffer::value_type;
+
+            // Get the size of the data
+            DWORD dataSize = 0; // size of data, in bytes
+            auto retCode = ::RegGetValueW(hKey, //
+                                          nullptr, // no subkey
+                                          valueName, //
+                                          flags, //
+                                          nullptr, // type not required
+                                          nullptr, // output buffer not needed now
+                                          &dataSize);
+            if(retCode != ERROR_SUCCESS) {
+                throw Exceptions::RegistryException(sizeMessage, retCode);
+            }
+
+            data.resize(dataSize / sizeof(Unit));
+            if(data.empty()) {
+                return;
+            }
+
+            // Read the data
+            retCode = ::RegGetValueW(hKey, //
+                                     nullptr, // no subkey
+                                     valueName, //
+                                     flags, //
+                                     nullptr, // type not required
+                                     &data[0], // output buffer
+                                     &dataSize);
+            if(retCode != ERROR_SUCCESS) {
+                throw Exceptions::RegistryException(dataMessage, retCode);
+            }
+
+            data.resize(dataSize / sizeof(Unit));
+        }
+
+        ///
+        /// Read a fixed-size value, i.e. a DWORD or a QWORD.
+        ///
+        template <typename T>
+        T ReadValueScalar(HKEY hKey, const wchar_t* valueName, DWORD flags, const char* message) {
+            T data {}; // to be read from the registry
+            DWORD dataSize = sizeof(data); // size of data, in bytes
+
+            const auto retCode = ::RegGetValueW(hKey, //
+                                                nullptr, // no subkey
+                                                valueName, //
+                                                flags, //
+                                                nullptr, // type not required
+                                                &data, //
+                                                &dataSize //
+            );
+            if(retCode != ERROR_SUCCESS) {
+                throw Exceptions::RegistryException(message, retCode);
+            }
+
+            return data;
+        }
+
+        ///
+        /// Decode the raw data of a value, as returned by RegQueryMultipleValues or RegQueryValueEx.
+        ///
+        /// Unlike RegGetValue, the data of a string may lack its terminating NUL: it is bounded by its size only.
+        ///
+        /// @return False if the data cannot be decoded: an unsupported type (e.g. REG_NONE, REG_LINK or
+        ///         REG_DWORD_BIG_ENDIAN), or a REG_DWORD or REG_QWORD of the wrong size. The value is then empty.
+        ///
+        bool DecodeValue(DWORD type, const BYTE* data, DWORD dataSize, RegistryValue& value) {
+            const auto text = reinterpret_cast<const wchar_t*>(data);
+            size_t length = dataSize / sizeof(wchar_t);
+
+            switch(type) {
+                case REG_DWORD:
+                    if(dataSize != sizeof(DWORD)) {
+                        return false;
+                    }
+                    value.Reset(RegistryValueType::DWord);
+                    std::memcpy(&value.DWord(), data, sizeof(DWORD));
+                    return true;
+                case REG_QWORD:
+                    if(dataSize != sizeof(ULONGLONG)) {
+                        return false;
+                    }
+                    value.Reset(RegistryValueType::QWord);
+                    std::memcpy(&value.QWord(), data, sizeof(ULONGLONG));
+                    return true;
+                case REG_SZ:
+                case REG_EXPAND_SZ:
+                    value.Reset(ValueType::Handle(type));
+                    while(length > 0 && text[length - 1] == L'\0') {
+                        --length;
+                    }
+                    Narrow(text, length, value.GetType() == RegistryValueType::String ? value.String() : value.ExpandString());
+                    return true;
+                case REG_MULTI_SZ:
+                    value.Reset(RegistryValueType::MultiString);
+                    for(size_t first = 0; first < length && text[first] != L'\0';) {
+                        size_t last = first;
+                        while(last < length && text[last] != L'\0') {
+                            ++last;
+                        }
+                        value.MultiString().emplace_back();
+                        Narrow(text + first, last - first, value.MultiString().back());
+                        first = last + 1;
+                    }
+                    return true;
+                case REG_BINARY:
+                    value.Reset(RegistryValueType::Binary);
+                    value.Binary().assign(data, data + dataSize);
+                    return true;
+                default: return false;
+            }
+        }
+
+        ///
+        /// Read the raw data of a value, whatever its type, into data, resized to the data read.
+        ///
+        /// @return The error code of RegQueryValueEx.
+        ///
+        LONG QueryRawValue(HKEY hKey, const wchar_t* valueName, DWORD& type, std::vector<BYTE>& data) {
+            // Without a buffer, RegQueryValueEx returns the size only
+            data.resize((std::max)(data.size(), size_t(1024)));
+
+            LONG retCode = ERROR_MORE_DATA;
+            DWORD dataSize = 0;
+            while(retCode == ERROR_MORE_DATA) {
+                dataSize = static_cast<DWORD>(data.size());
+                retCode = ::RegQueryValueExW(hKey, //
+                                             valueName, //
+                                             nullptr, // reserved
+                                             &type, //
+                                             data.data(), //
+                                             &dataSize);
+                if(retCode == ERROR_MORE_DATA) {
+                    data.resize(dataSize);
+                }
+            }
+            if(retCode == ERROR_SUCCESS) {
+                data.resize(dataSize);
+            }
+            return retCode;
+        }
+
+        /// What EnumNames enumerates
+        enum class EnumKind { SubKeys, Values };
+
+        /// Length of a typical name, in bytes: the longest name is often far longer than the others
+        constexpr size_t TypicalNameLength = 32;
+
+        /// Estimate the bytes of the names, the arena growing past it for longer names
+        size_t EstimateNameBytes(DWORD count, DWORD maxNameLen) noexcept {
+            return static_cast<size_t>(count) * (std::min)(static_cast<size_t>(maxNameLen), TypicalNameLength);
+        }
+
+        ///
+        /// Enumerate the subkeys or the values of a key, with a single RegQueryInfoKey call.
+        ///
+        /// reserve(count, maxNameLength) is called once, before the names; the length doesn't include the
+        /// terminating NUL. onName(name, nameLength, type) is then called for each name, which is in the scratch
+        /// buffer of the thread, overwritten by the next name; the type of the subkeys is REG_NONE.
+        ///
+        template <typename Reserve, typename OnName>
+        void EnumNames(HKEY hKey, EnumKind kind, Reserve&& reserve, OnName&& onName) {
+            const bool subKeys = kind == EnumKind::SubKeys;
+
+            DWORD count {};
+            DWORD maxNameLen {};
+            auto retCode = ::RegQueryInfoKeyW(hKey, //
+                                              nullptr, // no user-defined class
+                                              nullptr, // no user-defined class size
+                                              nullptr, // reserved
+                                              subKeys ? &count : nullptr, //
+                                              subKeys ? &maxNameLen : nullptr, //
+                                              nullptr, // no subkey class length
+                                              subKeys ? nullptr : &count, //
+                                              subKeys ? nullptr : &maxNameLen, //
+                                              nullptr, // no max value length
+                                              nullptr, // no security descriptor
+                                              nullptr // no last write time
+            );
+            if(retCode != ERROR_SUCCESS) {
+                throw Exceptions::RegistryException(subKeys ? "RegQueryInfoKey failed while preparing for subkey enumeration."
+                                                            : "RegQueryInfoKey failed while preparing for value enumeration.",
+                                                    retCode);
+            }
+
+            reserve(count, maxNameLen);
+
+            // NOTE: According to the MSDN documentation, the max length returned does *not* include
+            // the terminating NUL, so let's add +1 to take it into account in the buffer.
+            maxNameLen++;
+            wchar_t* nameBuffer = EnumNameBuffer(maxNameLen);
+
+            for(DWORD index = 0; index < count; index++) {
+                // On success, the length of the name is written back (not including the terminating NUL)
+                DWORD nameLen = maxNameLen;
+                DWORD type = REG_NONE;
+                if(subKeys) {
+                    retCode = ::RegEnumKeyExW(hKey, //
+                                              index, //
+                                              nameBuffer, //
+                                              &nameLen, //
+                                              nullptr, // reserved
+                                              nullptr, // no class
+                                              nullptr, // no class
+                                              nullptr // no last write time
+                    );
+                    if(retCode != ERROR_SUCCESS) {
+                        throw Exceptions::RegistryException("Cannot enumerate subkeys: RegEnumKeyEx failed.", retCode);
+                    }
+                }
+                else {
+                    retCode = ::RegEnumValueW(hKey, //
+                                              index, //
+                                              nameBuffer, //
+                                              &nameLen, //
+                                              nullptr, // reserved
+                                              &type, //
+                                              nullptr, // no data
+                                              nullptr // no data size
+                    );
+                    if(retCode != ERROR_SUCCESS) {
+                        throw Exceptions::RegistryException("Cannot enumerate values: RegEnumValue failed.", retCode);
+                    }
+                }
+
+                onName(static_cast<const wchar_t*>(nameBuffer), nameLen, type);
+            }
+        }
+
+    } // namespace
+
     RegistryKey::RegistryKey(RegistryHive hive) noexcept
-      : _hive(hive)
-      , _hKey(Hive::Handle(hive)) {}
+      : _hKey(Hive::Handle(hive))
+      , _hive(hive) {}
 
     RegistryKey::RegistryKey(RegistryHive hive, RegistryView view) noexcept
-      : _hive(hive)
-      , _view(view)
-      , _hKey(Hive::Handle(hive)) {}
+      : _hKey(Hive::Handle(hive))
+      , _hive(hive)
+      , _view(view) {}
 
     RegistryKey::RegistryKey(RegistryHive hive, RegistryView view, RegistryAccessRights access) noexcept
-      : _hive(hive)
+      : _hKey(Hive::Handle(hive))
+      , _hive(hive)
       , _view(view)
-      , _access(access)
-      , _hKey(Hive::Handle(hive)) {}
+      , _access(access) {}
 
     RegistryKey::RegistryKey(RegistryKey&& other) noexcept
-      : _hive(std::move(other._hive))
-      , _view(std::move(other._view))
-      , _access(std::move(other._access))
-      , _hKey(std::move(other._hKey))
-      , _keyName(std::move(other._keyName)) {
-        // Other doesn't own the handle anymore
+      : _hKey(other._hKey)
+      , _options(std::move(other._options))
+      , _pathId(other._pathId)
+      , _hive(other._hive)
+      , _view(other._view)
+      , _access(other._access)
+      , _dirty(other._dirty) {
+        // Other doesn't own the handle, nor the name, anymore
         other._hKey = nullptr;
+        other._pathId = RegistryPathTable::Root;
     }
 
     RegistryKey& RegistryKey::operator=(RegistryKey&& other) noexcept {
@@ -49,30 +353,37 @@ namespace registry {
             // Close current
             Close();
 
+            RegistryPathTable::Instance().Release(_pathId);
+
             // Move from other (i.e. take ownership of other's raw handle)
-            _hive = std::move(other._hive);
-            _view = std::move(other._view);
-            _access = std::move(other._access);
-            _keyName = std::move(other._keyName);
-            _hKey = std::move(other._hKey);
+            _hKey = other._hKey;
+            _options = std::move(other._options);
+            _pathId = other._pathId;
+            _hive = other._hive;
+            _view = other._view;
+            _access = other._access;
+            _dirty = other._dirty;
 
             other._hKey = nullptr;
+            other._pathId = RegistryPathTable::Root;
         }
         return *this;
     }
 
     RegistryKey::~RegistryKey() {
-        // Release the owned handle (if any)
+        // Release the owned handle (if any), and the name
         Close();
+        RegistryPathTable::Instance().Release(_pathId);
     }
 
-    RegistryKey::RegistryKey(const RegistryKey& other, HKEY hKey, std::string subkey)
-      : _hive(other._hive)
-      , _view(other._view)
-      , _access(other._access)
-      , _hKey(hKey) {
+    RegistryKey::RegistryKey(const RegistryKey& parent, HKEY hKey, std::string subkey, RegistryView view, RegistryAccessRights access)
+      : _hKey(hKey)
+      , _options(parent._options != nullptr ? std::make_unique<Options>(*parent._options) : nullptr)
+      , _hive(parent._hive)
+      , _view(view)
+      , _access(access) {
         ValidateKeyName(subkey);
-        _keyName = subkey;
+        _pathId = RegistryPathTable::Instance().Intern(subkey);
     }
 
     bool RegistryKey::IsValid() const noexcept {
@@ -83,6 +394,10 @@ namespace registry {
         return IsValid();
     }
 
+    bool RegistryKey::IsTransacted() const noexcept {
+        return Transaction() != nullptr;
+    }
+
     RegistryHive registry::RegistryKey::GetHive() const {
         EnsureNotDisposed();
         return _hive;
@@ -98,12 +413,25 @@ namespace registry {
         return _access;
     }
 
-    std::string RegistryKey::GetName() const {
+    const std::string& RegistryKey::GetName() const {
         EnsureNotDisposed();
-        return _keyName;
+        return KeyName();
+    }
+
+    RegistryPathTable::Id RegistryKey::GetPathId() const noexcept {
+        return _pathId;
     }
 
-    size_t RegistryKey::GetSubKeyCount() {
+    size_t RegistryKey::Hash() const noexcept {
+        // The hash of the name alone spreads well, the rest only breaks the ties
+        size_t hash = RegistryPathTable::Instance().GetHash(_pathId);
+        hash = hash * 31 + static_cast<size_t>(_hive);
+        hash = hash * 31 + static_cast<size_t>(_view);
+        hash = hash * 31 + static_cast<size_t>(_access);
+        return hash;
+    }
+
+    size_t RegistryKey::GetSubKeyCount() const {
         try {
             return EnumSubKeys().size();
         }
@@ -112,7 +440,7 @@ namespace registry {
         return 0;
     }
 
-    size_t RegistryKey::GetValueCount() {
+    size_t RegistryKey::GetValueCount() const {
         try {
             return EnumValues().size();
         }
@@ -121,6 +449,16 @@ namespace registry {
         return 0;
     }
 
+    RegistryDurability RegistryKey::GetDurability() const noexcept {
+        return _options != nullptr ? _options->durability : RegistryDurability::None;
+    }
+
+    void RegistryKey::SetDurability(RegistryDurability durability, std::chrono::milliseconds window) {
+        Options& options = MutableOptions();
+        options.durability = durability;
+        options.flushWindow = window;
+    }
+
     HKEY RegistryKey::Get() const noexcept {
         return _hKey;
     }
@@ -131,10 +469,8 @@ namespace registry {
 
     void RegistryKey::Flush() {
         if(IsValid() && IsDirty()) {
-            const auto retCode = ::RegFlushKey(_hKey);
-            if(retCode != ERROR_SUCCESS) {
-                throw Exceptions::RegistryException("RegFlushKey failed.", retCode);
-            }
+            RegistryFlushScheduler::Instance().Flush(_hive, _hKey);
+            _dirty = false;
         }
     }
 
@@ -162,8 +498,14 @@ namespace registry {
     }
 
     void RegistryKey::SwapWith(RegistryKey& other) noexcept {
-        // Swap the raw handle members
+        // Swap every member, so the metadata keeps matching the handle
         std::swap(_hKey, other._hKey);
+        std::swap(_options, other._options);
+        std::swap(_pathId, other._pathId);
+        std::swap(_hive, other._hive);
+        std::swap(_view, other._view);
+        std::swap(_access, other._access);
+        std::swap(_dirty, other._dirty);
     }
 
     RegistryKey RegistryKey::CreateSubKey(std::string subkey) {
@@ -178,71 +520,85 @@ namespace registry {
 
         _ASSERTE(IsValid());
 
-        // Update acces rights
-        _access = desiredAccess;
-        // Update acces rights
-        _view = view;
         // Make sure the key is writable
-        EnsureWriteable();
+        EnsureWriteable(desiredAccess);
         // validate the subkey
         ValidateKeyName(subkey);
 
-        std::wstring wsubkey = commons::utf8convert::Utf8ToUtf16(subkey);
+        const wchar_t* wsubkey = WideName(subkey);
 
         HKEY hKey = nullptr;
-        const auto retCode = ::RegCreateKeyExW(_hKey, //
-                                               wsubkey.c_str(), //
-                                               0, // reserved
-                                               REG_NONE, // user-defined class type parameter not supported
-                                               (DWORD)option, //
-                                               (DWORD)desiredAccess | (DWORD)view, //
-                                               nullptr, // securityAttributes,
-                                               &hKey, //
-                                               nullptr // disposition
-        );
+        const auto retCode = IsTransacted() ? ::RegCreateKeyTransactedW(_hKey, //
+                                                                        wsubkey, //
+                                                                        0, // reserved
+                                                                        REG_NONE, // user-defined class type parameter not supported
+                                                                        (DWORD)option, //
+                                                                        (DWORD)desiredAccess | (DWORD)view, //
+                                                                        nullptr, // securityAttributes,
+                                                                        &hKey, //
+                                                                        nullptr, // disposition
+                                                                        Transaction(), //
+                                                                        nullptr // reserved
+                                                                        )
+                                            : ::RegCreateKeyExW(_hKey, //
+                                                                wsubkey, //
+                                                                0, // reserved
+                                                                REG_NONE, // user-defined class type parameter not supported
+                                                                (DWORD)option, //
+                                                                (DWORD)desiredAccess | (DWORD)view, //
+                                                                nullptr, // securityAttributes,
+                                                                &hKey, //
+                                                                nullptr // disposition
+                                              );
 
         if(retCode != ERROR_SUCCESS) {
             throw Exceptions::RegistryException("RegCreateKeyEx failed.", retCode);
         }
 
+        setDirty();
+
         //
-        return RegistryKey(*this, hKey, _keyName + '\\' + subkey);
+        return RegistryKey(*this, hKey, KeyName() + '\\' + subkey, view, desiredAccess);
     }
 
-    RegistryKey RegistryKey::OpenSubKey(std::string subkey) {
+    RegistryKey RegistryKey::OpenSubKey(std::string subkey) const {
         return OpenSubKey(subkey, this->GetView(), this->GetAccessRights(), RegistryOption::None);
     }
 
-    RegistryKey RegistryKey::OpenSubKey(std::string subkey, RegistryAccessRights desiredAccess) {
+    RegistryKey RegistryKey::OpenSubKey(std::string subkey, RegistryAccessRights desiredAccess) const {
         return OpenSubKey(subkey, this->GetView(), desiredAccess, RegistryOption::None);
     }
 
-    RegistryKey RegistryKey::OpenSubKey(std::string subkey, RegistryView view, RegistryAccessRights desiredAccess, RegistryOption option) {
+    RegistryKey RegistryKey::OpenSubKey(std::string subkey, RegistryView view, RegistryAccessRights desiredAccess, RegistryOption option) const {
 
         _ASSERTE(IsValid());
 
-        // Update acces rights
-        _access = desiredAccess;
-        // Update view
-        _view = view;
         // validate the subkey
         ValidateKeyName(subkey);
 
-        std::wstring wsubkey = commons::utf8convert::Utf8ToUtf16(subkey);
+        const wchar_t* wsubkey = WideName(subkey);
 
         HKEY hKey = nullptr;
-        const auto retCode = ::RegOpenKeyExW(_hKey, //
-                                             wsubkey.c_str(), //
-                                             (DWORD)option, //
-                                             (DWORD)desiredAccess | (DWORD)view, //
-                                             &hKey);
+        const auto retCode = IsTransacted() ? ::RegOpenKeyTransactedW(_hKey, //
+                                                                      wsubkey, //
+                                                                      (DWORD)option, //
+                                                                      (DWORD)desiredAccess | (DWORD)view, //
+                                                                      &hKey, //
+                                                                      Transaction(), //
+                                                                      nullptr // reserved
+                                                                      )
+                                            : ::RegOpenKeyExW(_hKey, //
+                                                              wsubkey, //
+                                                              (DWORD)option, //
+                                                              (DWORD)desiredAccess | (DWORD)view, //
+                                                              &hKey);
 
         if(retCode != ERROR_SUCCESS) {
             throw Exceptions::RegistryException("RegOpenKeyEx failed.", retCode);
         }
 
         //
-        return RegistryKey(*this, hKey, _keyName + '\\' + subkey);
+        return RegistryKey(*this, hKey, KeyName() + '\\' + subkey, view, desiredAccess);
     }
 
     void RegistryKey::DeleteSubKey(std::string subkey, RegistryAccessRights desiredAccess) {
@@ -253,25 +609,30 @@ namespace registry {
 
         _ASSERTE(IsValid());
 
-        // Update acces rights
-        _access = desiredAccess;
-        // Update view
-        _view = view;
         // Make sure the key is writable
-        EnsureWriteable();
+        EnsureWriteable(desiredAccess);
         // validate the subkey
         ValidateKeyName(subkey);
 
-        std::wstring wsubkey = commons::utf8convert::Utf8ToUtf16(subkey);
+        const wchar_t* wsubkey = WideName(subkey);
 
-        const auto retCode = ::RegDeleteKeyExW(_hKey, //
-                                               wsubkey.c_str(), //
-                                               (REGSAM)desiredAccess | (DWORD)view, //
-                                               0);
+        const auto retCode = IsTransacted() ? ::RegDeleteKeyTransactedW(_hKey, //
+                                                                        wsubkey, //
+                                                                        (REGSAM)desiredAccess | (DWORD)view, //
+                                                                        0, // reserved
+                                                                        Transaction(), //
+                                                                        nullptr // reserved
+                                                                        )
+                                            : ::RegDeleteKeyExW(_hKey, //
+                                                                wsubkey, //
+                                                                (REGSAM)desiredAccess | (DWORD)view, //
+                                                                0);
 
         if(retCode != ERROR_SUCCESS) {
             throw Exceptions::RegistryException("RegDeleteKeyEx failed.", retCode);
         }
+
+        setDirty();
     }
 
     void RegistryKey::DeleteSubKeyTree(std::string subkey, RegistryAccessRights desiredAccess) {
@@ -282,17 +643,11 @@ namespace registry {
 
         _ASSERTE(IsValid());
 
-        // Update acces rights
-        _access = desiredAccess;
-        // Update view
-        _view = view;
         // Make sure the key is writable
-        EnsureWriteable();
+        EnsureWriteable(desiredAccess);
         // validate the subkey
         ValidateKeyName(subkey);
 
-        std::wstring wsubkey = commons::utf8convert::Utf8ToUtf16(subkey);
-
         RegistryKey key = OpenSubKey(subkey, view, desiredAccess, RegistryOption::None);
 
         if(key.IsValid()) {
@@ -314,15 +669,17 @@ namespace registry {
 
         _ASSERTE(IsValid());
 
-        const std::wstring sValueName = commons::utf8convert::Utf8ToUtf16(valueName);
+        const wchar_t* sValueName = WideName(valueName);
 
         const auto retCode = ::RegDeleteValueW(_hKey, //
-                                               sValueName.c_str() //
+                                               sValueName //
         );
 
         if(retCode != ERROR_SUCCESS) {
             throw Exceptions::RegistryException("RegDeleteValue failed.", retCode);
         }
+
+        setDirty();
     }
 
     void RegistryKey::SetValue(const std::string& valueName, const RegistryValue& value) {
@@ -364,9 +721,9 @@ namespace registry {
 
         const DWORD data = value;
         const DWORD dataSize = sizeof(data);
-        const std::wstring sValueName = commons::utf8convert::Utf8ToUtf16(valueName);
+        const wchar_t* sValueName = WideName(valueName);
         const auto retCode = ::RegSetValueExW(_hKey, //
-                                              sValueName.c_str(), //
+                                              sValueName, //
                                               0, // reserved
                                               REG_DWORD, //
                                               reinterpret_cast<const BYTE*>(&data), //
@@ -375,6 +732,8 @@ namespace registry {
         if(retCode != ERROR_SUCCESS) {
             throw Exceptions::RegistryException("RegSetValueEx() failed in writing REG_DWORD value.", retCode);
         }
+
+        setDirty();
     }
 
     void RegistryKey::SetQwordValue(const std::string& valueName, const ULONGLONG& value) {
@@ -383,9 +742,9 @@ namespace registry {
 
         const ULONGLONG data = value;
         const DWORD dataSize = sizeof(data);
-        const std::wstring sValueName = commons::utf8convert::Utf8ToUtf16(valueName);
+        const wchar_t* sValueName = WideName(valueName);
         const auto retCode = ::RegSetValueExW(_hKey, //
-                                              sValueName.c_str(), //
+                                              sValueName, //
                                               0, // reserved
                                               REG_QWORD, //
                                               reinterpret_cast<const BYTE*>(&data), //
@@ -394,100 +753,45 @@ namespace registry {
         if(retCode != ERROR_SUCCESS) {
             throw Exceptions::RegistryException("RegSetValueEx() failed in writing REG_QWORD value.", retCode);
         }
+
+        setDirty();
     }
 
     void RegistryKey::SetStringValue(const std::string& valueName, const std::string& value) {
-
-        _ASSERTE(IsValid());
-
-        const std::wstring sValueName = commons::utf8convert::Utf8ToUtf16(valueName);
-        const std::wstring sValue = commons::utf8convert::Utf8ToUtf16(value);
-        // According to MSDN doc, this size must include the terminating NULL
-        // Note that size is in *BYTES*, so we must scale by wchar_t.
-        const DWORD dataSize = SafeSizeToDwordCast((sValue.size() + 1) * sizeof(wchar_t));
-
-        const auto retCode = ::RegSetValueExW(_hKey, //
-                                              sValueName.c_str(), //
-                                              0, // reserved
-                                              REG_SZ, //
-                                              reinterpret_cast<const BYTE*>(sValue.c_str()), //
-                                              dataSize);
-
-        if(retCode != ERROR_SUCCESS) {
-            throw Exceptions::RegistryException("RegSetValueEx() failed in writing REG_SZ value.", retCode);
-        }
+        SetStringData(valueName, value, REG_SZ);
     }
 
     void RegistryKey::SetExpandStringValue(const std::string& valueName, const std::string& value) {
-
-        _ASSERTE(IsValid());
-
-        const std::wstring sValueName = commons::utf8convert::Utf8ToUtf16(valueName);
-        const std::wstring sValue = commons::utf8convert::Utf8ToUtf16(value);
-        // According to MSDN doc, this size must include the terminating NULL
-        // Note that size is in *BYTES*, so we must scale by wchar_t.
-        const DWORD dataSize = SafeSizeToDwordCast((sValue.size() + 1) * sizeof(wchar_t));
-
-        const auto retCode = ::RegSetValueExW(_hKey, //
-                                              sValueName.c_str(), //
-                                              0, // reserved
-                                              REG_EXPAND_SZ, //
-                                              reinterpret_cast<const BYTE*>(sValue.c_str()), //
-                                              dataSize);
-
-        if(retCode != ERROR_SUCCESS) {
-            throw Exceptions::RegistryException("RegSetValueEx() failed in writing REG_EXPAND_SZ value.", retCode);
-        }
+        SetStringData(valueName, value, REG_EXPAND_SZ);
     }
 
     void RegistryKey::SetMultiStringValue(const std::string& valueName, const std::vector<std::string>& value) {
 
         _ASSERTE(IsValid());
 
-        const std::wstring sValueName = commons::utf8convert::Utf8ToUtf16(valueName);
-        const std::vector<std::wstring>& sMultiString = commons::utf8convert::Utf8ToUtf16(value);
+        const wchar_t* sValueName = WideName(valueName);
 
         // We need to build a whole array containing the multi-strings, with double-NUL termination
-        std::vector<wchar_t> buffer;
+        std::wstring& buffer = GetScratch().text;
+        buffer.clear();
 
-        // Get total buffer size, in wchar_ts
-        size_t totalLen = 0;
-        for(const std::wstring& s : sMultiString) {
-            // +1 to include the terminating NUL for current string
-            totalLen += (s.size() + 1);
+        // Convert the single strings in the buffer, each with its terminating NUL
+        for(const std::string& s : value) {
+            AppendWide(s, buffer);
+            buffer.push_back(L'\0');
         }
-        // Consider another terminating NUL (double-NUL-termination)
-        totalLen++;
-
-        // Optimization: reserve room in the multi-string buffer
-        buffer.resize(totalLen);
-
-        // Deep copy the single strings in the buffer
-        if(!sMultiString.empty()) {
-            wchar_t* dest = &buffer[0];
-            for(const std::wstring& s : sMultiString) {
-                // Copy the whole string to destination buffer, including the terminating NUL
-                wmemcpy(dest, s.c_str(), s.size() + 1);
-
-                // Skip to the next string slot
-                dest += s.size() + 1;
-            }
 
-            // Add another NUL terminator
-            *dest = L'\0';
-        }
-        else {
-            // Just write two NULs in the buffer
-            buffer.resize(2);
-            buffer[0] = L'\0';
-            buffer[1] = L'\0';
+        // Add another NUL terminator; an empty multi-string is just two NULs
+        buffer.push_back(L'\0');
+        if(value.empty()) {
+            buffer.push_back(L'\0');
         }
 
         // Size is in *BYTES*
         const DWORD dataSize = SafeSizeToDwordCast(buffer.size() * sizeof(wchar_t));
 
         const auto retCode = ::RegSetValueExW(_hKey, //
-                                             sValueName.c_str(), //
+                                             sValueName, //
                                              0, // reserved
                                              REG_MULTI_SZ, //
                                              reinterpret_cast<const BYTE*>(buffer.data()), //
@@ -496,18 +800,20 @@ namespace registry {
         if(retCode != ERROR_SUCCESS) {
             throw Exceptions::RegistryException("RegSetValueEx() failed in writing REG_MULTI_SZ value.", retCode);
         }
+
+        setDirty();
     }
 
     void RegistryKey::SetBinaryValue(const std::string& valueName, const std::vector<BYTE>& value) {
 
         _ASSERTE(IsValid());
 
-        const std::wstring sValueName = commons::utf8convert::Utf8ToUtf16(valueName);
+        const wchar_t* sValueName = WideName(valueName);
 
         const std::vector<BYTE>& data = value;
         const DWORD dataSize = SafeSizeToDwordCast(data.size());
         const auto retCode = ::RegSetValueExW(_hKey, //
-                                             sValueName.c_str(), //
+                                             sValueName, //
                                              0, // reserved
                                              REG_BINARY, //
                                              &data[0], //
@@ -516,15 +822,17 @@ namespace registry {
         if(retCode != ERROR_SUCCESS) {
             throw Exceptions::RegistryException("RegSetValueEx() failed in writing REG_BINARY value.", retCode);
         }
+
+        setDirty();
     }
 
     void RegistryKey::SetBinaryValue(const std::string& valueName, const BYTE lpByte[], DWORD& dataSize) {
 
         _ASSERTE(IsValid());
 
-        const std::wstring sValueName = commons::utf8convert::Utf8ToUtf16(valueName);
+        const wchar_t* sValueName = WideName(valueName);
         const auto retCode = ::RegSetValueExW(_hKey, //
-                                             sValueName.c_str(), //
+                                             sValueName, //
                                              0, // reserved
                                              REG_BINARY, //
                                              lpByte, //
@@ -533,9 +841,83 @@ namespace registry {
         if(retCode != ERROR_SUCCESS) {
             throw Exceptions::RegistryException("RegSetValueEx() failed in writing REG_BINARY value.", retCode);
         }
+
+        setDirty();
     }
 
-    RegistryValue RegistryKey::GetValue(const std::string& valueName) {
+    void RegistryKey::SetStringData(const std::string& valueName, std::string_view value, DWORD type) {
+
+        _ASSERTE(IsValid());
+
+        const wchar_t* sValueName = WideName(valueName);
+        std::wstring& sValue = GetScratch().text;
+        Widen(value, sValue);
+        // According to MSDN doc, this size must include the terminating NULL
+        // Note that size is in *BYTES*, so we must scale by wchar_t.
+        const DWORD dataSize = SafeSizeToDwordCast((sValue.size() + 1) * sizeof(wchar_t));
+
+        const auto retCode = ::RegSetValueExW(_hKey, //
+                                              sValueName, //
+                                              0, // reserved
+                                              type, //
+                                              reinterpret_cast<const BYTE*>(sValue.c_str()), //
+                                              dataSize);
+
+        if(retCode != ERROR_SUCCESS) {
+            throw Exceptions::RegistryException(type == REG_EXPAND_SZ ? "RegSetValueEx() failed in writing REG_EXPAND_SZ value."
+                                                                      : "RegSetValueEx() failed in writing REG_SZ value.",
+                                                retCode);
+        }
+
+        setDirty();
+    }
+
+    void RegistryKey::SetData(const std::string& valueName, DWORD type, const void* data, size_t dataSize) {
+
+        _ASSERTE(IsValid());
+
+        const wchar_t* sValueName = WideName(valueName);
+        const auto retCode = ::RegSetValueExW(_hKey, //
+                                              sValueName, //
+                                              0, // reserved
+                                              type, //
+                                              static_cast<const BYTE*>(data), //
+                                              SafeSizeToDwordCast(dataSize));
+
+        if(retCode != ERROR_SUCCESS) {
+            throw Exceptions::RegistryException("RegSetValueEx() failed.", retCode);
+        }
+
+        setDirty();
+    }
+
+    void RegistryKey::GetData(const std::string& valueName, DWORD flags, void* data, DWORD dataSize) const {
+
+        _ASSERTE(IsValid());
+
+        const wchar_t* sValueName = WideName(valueName);
+
+        DWORD readSize = dataSize; // size of data, in bytes
+        const auto retCode = ::RegGetValueW(_hKey, //
+                                            nullptr, // no subkey
+                                            sValueName, //
+                                            flags, //
+                                            nullptr, // type not required
+                                            data, //
+                                            &readSize //
+        );
+
+        if(retCode != ERROR_SUCCESS) {
+            throw Exceptions::RegistryException("Cannot get value: RegGetValue failed.", retCode);
+        }
+
+        // A REG_BINARY value may be shorter than the type read
+        if(readSize != dataSize) {
+            throw Exceptions::RegistryException("Cannot get value: the size of the value does not match the type.", ERROR_INVALID_DATA);
+        }
+    }
+
+    RegistryValue RegistryKey::GetValue(const std::string& valueName) const {
 
         DWORD dValueType = QueryValueType(valueName);
         RegistryValueType valueType = ValueType::Handle(dValueType);
@@ -556,11 +938,11 @@ namespace registry {
         return value;
     }
 
-    DWORD RegistryKey::GetDwordValue(const std::string& valueName) {
+    DWORD RegistryKey::GetDwordValue(const std::string& valueName) const {
 
         _ASSERTE(IsValid());
 
-        const std::wstring sValueName = commons::utf8convert::Utf8ToUtf16(valueName);
+        const wchar_t* sValueName = WideName(valueName);
 
         DWORD data {}; // to be read from the registry
         DWORD dataSize = sizeof(data); // size of data, in bytes
@@ -568,7 +950,7 @@ namespace registry {
         const DWORD flags = RRF_RT_REG_DWORD;
         const auto retCode = ::RegGetValueW(_hKey, //
                                             nullptr, // no subkey
-                                            sValueName.c_str(), //
+                                            sValueName, //
                                             flags, //
                                             nullptr, // type not required
                                             &data, //
@@ -582,11 +964,11 @@ namespace registry {
         return data;
     }
 
-    ULONGLONG RegistryKey::GetQwordValue(const std::string& valueName) {
+    ULONGLONG RegistryKey::GetQwordValue(const std::string& valueName) const {
 
         _ASSERTE(IsValid());
 
-        const std::wstring sValueName = commons::utf8convert::Utf8ToUtf16(valueName);
+        const wchar_t* sValueName = WideName(valueName);
 
         ULONGLONG data {}; // to be read from the registry
         DWORD dataSize = sizeof(data); // size of data, in bytes
@@ -594,7 +976,7 @@ namespace registry {
         const DWORD flags = RRF_RT_REG_QWORD;
         const auto retCode = ::RegGetValueW(_hKey, //
                                             nullptr, // no subkey
-                                            sValueName.c_str(), //
+                                            sValueName, //
                                             flags, //
                                             nullptr, // type not required
                                             &data, //
@@ -608,18 +990,18 @@ namespace registry {
         return data;
     }
 
-    std::string RegistryKey::GetStringValue(const std::string& valueName) {
+    std::string RegistryKey::GetStringValue(const std::string& valueName) const {
 
         _ASSERTE(IsValid());
 
-        const std::wstring sValueName = commons::utf8convert::Utf8ToUtf16(valueName);
+        const wchar_t* sValueName = WideName(valueName);
 
         // Get the size of the result string
         DWORD dataSize = 0; // size of data, in bytes
         const DWORD flags = RRF_RT_REG_SZ;
         auto retCode = ::RegGetValueW(_hKey, //
                                       nullptr, // no subkey
-                                      sValueName.c_str(), //
+                                      sValueName, //
                                       flags, //
                                       nullptr, // type not required
                                       nullptr, // output buffer not needed now
@@ -633,13 +1015,13 @@ namespace registry {
         // Allocate a string of proper size.
         // Note that dataSize is in bytes and includes the terminating NUL;
         // we have to convert the size from bytes to wchar_ts for wstring::resize.
-        std::wstring result;
+        std::wstring& result = GetScratch().text;
         result.resize(dataSize / sizeof(wchar_t));
 
         // Call RegGetValue for the second time to read the string's content
         retCode = ::RegGetValueW(_hKey, //
                                  nullptr, // no subkey
-                                 sValueName.c_str(), //
+                                 sValueName, //
                                  flags, //
                                  nullptr, // type not required
                                  &result[0], // output buffer
@@ -652,14 +1034,16 @@ namespace registry {
         // Remove the NUL terminator scribbled by RegGetValue from the wstring
         result.resize((dataSize / sizeof(wchar_t)) - 1);
 
-        return commons::utf8convert::Utf16ToUtf8(result);
+        std::string value;
+        Narrow(result.data(), result.size(), value);
+        return value;
     }
 
-    std::string RegistryKey::GetExpandStringValue(const std::string& valueName, ExpandStringOption expandOption) {
+    std::string RegistryKey::GetExpandStringValue(const std::string& valueName, ExpandStringOption expandOption) const {
 
         _ASSERTE(IsValid());
 
-        const std::wstring sValueName = commons::utf8convert::Utf8ToUtf16(valueName);
+        const wchar_t* sValueName = WideName(valueName);
 
         DWORD flags = RRF_RT_REG_EXPAND_SZ;
 
@@ -672,7 +1056,7 @@ namespace registry {
         DWORD dataSize = 0; // size of data, in bytes
         auto retCode = ::RegGetValueW(_hKey, //
                                       nullptr, // no subkey
-                                      sValueName.c_str(), //
+                                      sValueName, //
                                       flags, //
                                       nullptr, // type not required
                                       nullptr, // output buffer not needed now
@@ -685,13 +1069,13 @@ namespace registry {
         // Allocate a string of proper size.
         // Note that dataSize is in bytes and includes the terminating NUL.
         // We must convert from bytes to wchar_ts for wstring::resize.
-        std::wstring result;
+        std::wstring& result = GetScratch().text;
         result.resize(dataSize / sizeof(wchar_t));
 
         // Call RegGetValue for the second time to read the string's content
         retCode = ::RegGetValueW(_hKey, //
                                  nullptr, // no subkey
-                                 sValueName.c_str(), //
+                                 sValueName, //
                                  flags, //
                                  nullptr, // type not required
                                  &result[0], // output buffer
@@ -704,14 +1088,16 @@ namespace registry {
         // Remove the NUL terminator scribbled by RegGetValue from the wstring
         result.resize((dataSize / sizeof(wchar_t)) - 1);
 
-        return commons::utf8convert::Utf16ToUtf8(result);
+        std::string value;
+        Narrow(result.data(), result.size(), value);
+        return value;
     }
 
-    std::vector<std::string> RegistryKey::GetMultiStringValue(const std::string& valueName) {
+    std::vector<std::string> RegistryKey::GetMultiStringValue(const std::string& valueName) const {
 
         _ASSERTE(IsValid());
 
-        const std::wstring sValueName = commons::utf8convert::Utf8ToUtf16(valueName);
+        const wchar_t* sValueName = WideName(valueName);
 
         const DWORD flags = RRF_RT_REG_MULTI_SZ;
 
@@ -719,7 +1105,7 @@ namespace registry {
         DWORD dataSize = 0;
         auto retCode = ::RegGetValueW(_hKey, //
                                       nullptr, // no subkey
-                                      sValueName.c_str(), //
+                                      sValueName, //
                                       flags, //
                                       nullptr, // type not required
                                       nullptr, // output buffer not needed now
@@ -729,16 +1115,16 @@ namespace registry {
             throw Exceptions::RegistryException("Cannot get size of multi-string value: RegGetValue failed.", retCode);
         }
 
-        // Allocate room for the result multi-string.
-        // Note that dataSize is in bytes, but our vector<wchar_t>::resize method requires size
+        // Make room for the result multi-string.
+        // Note that dataSize is in bytes, but our wstring::resize method requires size
         // to be expressed in wchar_ts.
-        std::vector<wchar_t> data;
+        std::wstring& data = GetScratch().text;
         data.resize(dataSize / sizeof(wchar_t));
 
-        // Read the multi-string from the registry into the vector object
+        // Read the multi-string from the registry into the buffer
         retCode = ::RegGetValueW(_hKey, //
                                  nullptr, // no subkey
-                                 sValueName.c_str(), //
+                                 sValueName, //
                                  flags, //
                                  nullptr, // no type required
                                  &data[0], // output buffer
@@ -748,34 +1134,42 @@ namespace registry {
             throw Exceptions::RegistryException("Cannot get multi-string value: RegGetValue failed.", retCode);
         }
 
-        // Resize vector to the actual size returned by GetRegValue.
-        // Note that the vector is a vector of wchar_ts, instead the size returned by GetRegValue
+        // Resize the buffer to the actual size returned by GetRegValue.
+        // Note that the buffer holds wchar_ts, instead the size returned by GetRegValue
         // is in bytes, so we have to scale from bytes to wchar_t count.
         data.resize(dataSize / sizeof(wchar_t));
 
-        // Parse the double-NUL-terminated string into a vector<wstring>,
+        // Count the strings first, so that the result is allocated once
+        size_t count = 0;
+        for(const wchar_t* currStringPtr = data.c_str(); *currStringPtr != L'\0'; currStringPtr += wcslen(currStringPtr) + 1) {
+            ++count;
+        }
+
+        // Parse the double-NUL-terminated string into a vector<string>,
         // which will be returned to the caller
-        std::vector<std::wstring> result;
-        const wchar_t* currStringPtr = &data[0];
+        std::vector<std::string> result;
+        result.reserve(count);
+        const wchar_t* currStringPtr = data.c_str();
         while(*currStringPtr != L'\0') {
             // Current string is NUL-terminated, so get its length calling wcslen
             const size_t currStringLength = wcslen(currStringPtr);
 
             // Add current string to the result vector
-            result.push_back(std::wstring {currStringPtr, currStringLength});
+            result.emplace_back();
+            Narrow(currStringPtr, currStringLength, result.back());
 
             // Move to the next string
             currStringPtr += currStringLength + 1;
         }
 
-        return commons::utf8convert::Utf16ToUtf8(result);
+        return result;
     }
 
-    std::vector<BYTE> RegistryKey::GetBinaryValue(const std::string& valueName) {
+    std::vector<BYTE> RegistryKey::GetBinaryValue(const std::string& valueName) const {
 
         _ASSERTE(IsValid());
 
-        const std::wstring sValueName = commons::utf8convert::Utf8ToUtf16(valueName);
+        const wchar_t* sValueName = WideName(valueName);
 
         const DWORD flags = RRF_RT_REG_BINARY;
 
@@ -783,7 +1177,7 @@ namespace registry {
         DWORD dataSize = 0; // size of data, in bytes
         auto retCode = ::RegGetValueW(_hKey, //
                                       nullptr, // no subkey
-                                      sValueName.c_str(), //
+                                      sValueName, //
                                       flags, //
                                       nullptr, // type not required
                                       nullptr, // output buffer not needed now
@@ -799,7 +1193,7 @@ namespace registry {
         // Call RegGetValue for the second time to read the data content
         retCode = ::RegGetValueW(_hKey, //
                                  nullptr, // no subkey
-                                 sValueName.c_str(), //
+                                 sValueName, //
                                  flags, //
                                  nullptr, // type not required
                                  &data[0], // output buffer
@@ -812,17 +1206,342 @@ namespace registry {
         return data;
     }
 
-    DWORD RegistryKey::QueryValueType(const std::string& valueName) {
+    std::vector<RegistryValue> RegistryKey::GetValues(const std::vector<std::string>& valueNames) const {
 
         _ASSERTE(IsValid());
 
-        const std::wstring sValueName = commons::utf8convert::Utf8ToUtf16(valueName);
+        std::vector<RegistryValue> values(valueNames.size());
+        if(valueNames.empty()) {
+            return values;
+        }
 
-        DWORD typeId {}; // will be returned by RegQueryValueEx
+        // Pack the names in one buffer, separated by NULs, then point the entries into it
+        Scratch& scratch = GetScratch();
+        std::wstring& names = scratch.name;
+        names.clear();
+        std::vector<size_t> offsets;
+        offsets.reserve(valueNames.size());
+        for(const auto& valueName : valueNames) {
+            offsets.push_back(names.size());
+            AppendWide(valueName, names);
+            names.push_back(L'\0');
+        }
+
+        std::vector<VALENTW> entries(valueNames.size());
+        for(size_t i = 0; i < entries.size(); ++i) {
+            entries[i].ve_valuename = &names[offsets[i]];
+        }
 
+        // Read all the values in one call, growing the buffer while they do not fit
+        std::vector<BYTE>& data = scratch.data;
+        if(data.empty()) {
+            data.resize(1024);
+        }
+
+        LONG retCode = ERROR_MORE_DATA;
+        while(retCode == ERROR_MORE_DATA) {
+            DWORD dataSize = SafeSizeToDwordCast(data.size());
+            retCode = ::RegQueryMultipleValuesW(_hKey, //
+                                                entries.data(), //
+                                                SafeSizeToDwordCast(entries.size()), //
+                                                reinterpret_cast<LPWSTR>(data.data()), //
+                                                &dataSize);
+            if(retCode == ERROR_MORE_DATA) {
+                data.resize(dataSize);
+            }
+        }
+
+        if(retCode == ERROR_FILE_NOT_FOUND) {
+            // One of the values is missing, and the call fails as a whole: read them one by one
+            for(size_t i = 0; i < valueNames.size(); ++i) {
+                DWORD type = REG_NONE;
+                const LONG valueRetCode = QueryRawValue(_hKey, WideName(valueNames[i]), type, data);
+                if(valueRetCode == ERROR_FILE_NOT_FOUND) {
+                    continue;
+                }
+                if(valueRetCode != ERROR_SUCCESS) {
+                    throw Exceptions::RegistryException("Cannot get values: RegQueryValueEx failed.", valueRetCode);
+                }
+                DecodeValue(type, data.data(), static_cast<DWORD>(data.size()), values[i]);
+            }
+            return values;
+        }
+
+        if(retCode != ERROR_SUCCESS) {
+            throw Exceptions::RegistryException("Cannot get values: RegQueryMultipleValues failed.", retCode);
+        }
+
+        for(size_t i = 0; i < entries.size(); ++i) {
+            DecodeValue(entries[i].ve_type, reinterpret_cast<const BYTE*>(entries[i].ve_valueptr), entries[i].ve_valuelen, values[i]);
+        }
+
+        return values;
+    }
+
+    bool RegistryKey::TryGetValue(const std::string& subKeyName, const std::string& valueName, RegistryValue& value) const {
+
+        _ASSERTE(IsValid());
+
+        std::wstring sSubKeyName;
+        Widen(subKeyName, sSubKeyName);
+        const wchar_t* sValueName = WideName(valueName);
+
+        // A single call, unless the data outgrows the buffer of the thread
+        std::vector<BYTE>& data = GetScratch().data;
+        data.resize((std::max)(data.size(), size_t(1024)));
+
+        DWORD typeId = REG_NONE;
+        DWORD dataSize = 0;
+        LONG retCode = ERROR_MORE_DATA;
+        while(retCode == ERROR_MORE_DATA) {
+            dataSize = SafeSizeToDwordCast(data.size());
+            retCode = ::RegGetValueW(_hKey, //
+                                     sSubKeyName.empty() ? nullptr : sSubKeyName.c_str(), //
+                                     sValueName, //
+                                     RRF_RT_ANY | RRF_NOEXPAND, //
+                                     &typeId, //
+                                     data.data(), //
+                                     &dataSize);
+            if(retCode == ERROR_MORE_DATA) {
+                data.resize(dataSize);
+            }
+        }
+
+        // The subkey or the value is missing
+        if(retCode == ERROR_FILE_NOT_FOUND) {
+            return false;
+        }
+        if(retCode != ERROR_SUCCESS) {
+            throw Exceptions::RegistryException("Cannot get value: RegGetValue failed.", retCode);
+        }
+
+        return DecodeValue(typeId, data.data(), dataSize, value);
+    }
+
+    pmr::RegistryValue RegistryKey::GetValue(const std::string& valueName, std::pmr::memory_resource* resource) const {
+
+        _ASSERTE(IsValid());
+
+        std::pmr::wstring sValueName(resource);
+        Widen(valueName, sValueName);
+
+        DWORD dValueType {};
         const auto retCode = ::RegQueryValueExW(_hKey, //
                                                 sValueName.c_str(), //
                                                 nullptr, // reserved
+                                                &dValueType, //
+                                                nullptr, // no data
+                                                nullptr // no data size
+        );
+        if(retCode != ERROR_SUCCESS) {
+            throw Exceptions::RegistryException("Cannot get the value type: RegQueryValueEx failed.", retCode);
+        }
+
+        const RegistryValueType valueType = ValueType::Handle(dValueType);
+
+        pmr::RegistryValue value(valueType, resource);
+
+        switch(valueType) {
+            case RegistryValueType::DWord:
+            case RegistryValueType::DWordBigEndian:
+                value.DWord() = ReadValueScalar<DWORD>(_hKey, sValueName.c_str(), RRF_RT_REG_DWORD, "Cannot get DWORD value: RegGetValue failed.");
+                break;
+            case RegistryValueType::QWord:
+                value.QWord() = ReadValueScalar<ULONGLONG>(_hKey, sValueName.c_str(), RRF_RT_REG_QWORD, "Cannot get QWORD value: RegGetValue failed.");
+                break;
+            case RegistryValueType::String: value.String() = GetStringValue(valueName, resource); break;
+            case RegistryValueType::ExpandString: value.ExpandString() = GetExpandStringValue(valueName, resource); break;
+            case RegistryValueType::MultiString: value.MultiString() = GetMultiStringValue(valueName, resource); break;
+            case RegistryValueType::Binary: value.Binary() = GetBinaryValue(valueName, resource); break;
+            default: throw std::invalid_argument("Unsupported registry value type.");
+        }
+
+        return value;
+    }
+
+    std::pmr::string RegistryKey::GetStringValue(const std::string& valueName, std::pmr::memory_resource* resource) const {
+
+        _ASSERTE(IsValid());
+
+        std::pmr::wstring sValueName(resource);
+        Widen(valueName, sValueName);
+
+        std::pmr::wstring data(resource);
+        ReadValueData(_hKey,
+                      sValueName.c_str(),
+                      RRF_RT_REG_SZ,
+                      data,
+                      "Cannot get size of string value: RegGetValue failed.",
+                      "Cannot get string value: RegGetValue failed.");
+
+        // Remove the NUL terminator scribbled by RegGetValue
+        const size_t length = data.empty() ? 0 : data.size() - 1;
+
+        std::pmr::string result(resource);
+        Narrow(data.c_str(), length, result);
+        return result;
+    }
+
+    std::pmr::string RegistryKey::GetExpandStringValue(const std::string& valueName,
+                                                       std::pmr::memory_resource* resource,
+                                                       ExpandStringOption expandOption) const {
+
+        _ASSERTE(IsValid());
+
+        std::pmr::wstring sValueName(resource);
+        Widen(valueName, sValueName);
+
+        DWORD flags = RRF_RT_REG_EXPAND_SZ;
+        if(expandOption == ExpandStringOption::DontExpand) {
+            flags |= RRF_NOEXPAND;
+        }
+
+        std::pmr::wstring data(resource);
+        ReadValueData(_hKey,
+                      sValueName.c_str(),
+                      flags,
+                      data,
+                      "Cannot get size of expand string value: RegGetValue failed.",
+                      "Cannot get expand string value: RegGetValue failed.");
+
+        // Remove the NUL terminator scribbled by RegGetValue
+        const size_t length = data.empty() ? 0 : data.size() - 1;
+
+        std::pmr::string result(resource);
+        Narrow(data.c_str(), length, result);
+        return result;
+    }
+
+    std::pmr::vector<std::pmr::string> RegistryKey::GetMultiStringValue(const std::string& valueName, std::pmr::memory_resource* resource) const {
+
+        _ASSERTE(IsValid());
+
+        std::pmr::wstring sValueName(resource);
+        Widen(valueName, sValueName);
+
+        std::pmr::vector<wchar_t> data(resource);
+        ReadValueData(_hKey,
+                      sValueName.c_str(),
+                      RRF_RT_REG_MULTI_SZ,
+                      data,
+                      "Cannot get size of multi-string value: RegGetValue failed.",
+                      "Cannot get multi-string value: RegGetValue failed.");
+
+        // Count the strings first, so that the result is allocated once
+        size_t count = 0;
+        for(size_t i = 0; i < data.size() && data[i] != L'\0'; i += wcslen(&data[i]) + 1) {
+            ++count;
+        }
+
+        std::pmr::vector<std::pmr::string> result(resource);
+        result.reserve(count);
+
+        // Parse the double-NUL-terminated string
+        for(size_t i = 0; i < data.size() && data[i] != L'\0';) {
+            const size_t length = wcslen(&data[i]);
+            result.emplace_back();
+            Narrow(&data[i], length, result.back());
+            i += length + 1;
+        }
+
+        return result;
+    }
+
+    std::pmr::vector<BYTE> RegistryKey::GetBinaryValue(const std::string& valueName, std::pmr::memory_resource* resource) const {
+
+        _ASSERTE(IsValid());
+
+        std::pmr::wstring sValueName(resource);
+        Widen(valueName, sValueName);
+
+        std::pmr::vector<BYTE> data(resource);
+        ReadValueData(_hKey,
+                      sValueName.c_str(),
+                      RRF_RT_REG_BINARY,
+                      data,
+                      "Cannot get size of binary data: RegGetValue failed.",
+                      "Cannot get binary data: RegGetValue failed.");
+
+        return data;
+    }
+
+    bool RegistryKey::CompareExchangeValue(const std::string& valueName, RegistryValue& expected, const RegistryValue& desired) {
+
+        EnsureNotDisposed();
+
+        // Reopen this key in a transaction, against which the write is made: the value only is read and written
+        RegistryTransaction transaction;
+        const auto access = static_cast<RegistryAccessRights>(KEY_QUERY_VALUE | KEY_SET_VALUE);
+        RegistryKey key = transaction.OpenKey(_hive, KeyName(), _view, access);
+
+        // Writing first takes the transaction lock on the key: from now on,
+        // no other writer can change the committed value until we are done.
+        try {
+            if(desired.IsEmpty()) {
+                // Write a placeholder, which locks the key even if the value is missing, then delete it
+                key.SetDwordValue(valueName, 0);
+                key.DeleteValue(valueName);
+            }
+            else {
+                key.SetValue(valueName, desired);
+            }
+        }
+        catch(const Exceptions::RegistryException& e) {
+            if(e.ErrorCode() != ERROR_TRANSACTIONAL_CONFLICT) {
+                throw;
+            }
+            // Another transaction holds the key
+            expected = GetValueOrEmpty(valueName);
+            return false;
+        }
+
+        // Verify the committed value, read outside of the transaction: the key is locked, it cannot change until the commit
+        RegistryValue current = GetValueOrEmpty(valueName);
+        if(current != expected) {
+            transaction.Rollback();
+            expected = std::move(current);
+            return false;
+        }
+
+        transaction.Commit();
+
+        setDirty();
+
+        return true;
+    }
+
+    bool RegistryKey::UpdateValue(const std::string& valueName, const std::function<RegistryValue(const RegistryValue&)>& update, unsigned int maxAttempts) {
+
+        RegistryValue expected = GetValueOrEmpty(valueName);
+
+        for(unsigned int attempt = 0; attempt < maxAttempts; ++attempt) {
+            if(CompareExchangeValue(valueName, expected, update(expected))) {
+                return true;
+            }
+
+            // Back off a little, longer and longer, to let the other writer commit
+            if(attempt < 4) {
+                std::this_thread::yield();
+            }
+            else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50) * (1u << (std::min)(attempt - 4, 10u)));
+            }
+        }
+
+        return false;
+    }
+
+    DWORD RegistryKey::QueryValueType(const std::string& valueName) const {
+
+        _ASSERTE(IsValid());
+
+        const wchar_t* sValueName = WideName(valueName);
+
+        DWORD typeId {}; // will be returned by RegQueryValueEx
+
+        const auto retCode = ::RegQueryValueExW(_hKey, //
+                                                sValueName, //
+                                                nullptr, // reserved
                                                 &typeId,
                                                 nullptr, // not interested
                                                 nullptr // not interested
@@ -835,7 +1554,30 @@ namespace registry {
         return typeId;
     }
 
-    void RegistryKey::QueryInfoKey(DWORD& subKeys, DWORD& values, FILETIME& lastWriteTime) {
+    DWORD RegistryKey::QueryValueData(const std::string& valueName, void* data, DWORD& dataSize) const {
+
+        _ASSERTE(IsValid());
+
+        const wchar_t* sValueName = WideName(valueName);
+
+        DWORD typeId {};
+        const auto retCode = ::RegGetValueW(_hKey, //
+                                            nullptr, // no subkey
+                                            sValueName, //
+                                            RRF_RT_ANY | RRF_NOEXPAND, //
+                                            &typeId, //
+                                            data, //
+                                            &dataSize //
+        );
+
+        if(retCode != ERROR_SUCCESS) {
+            throw Exceptions::RegistryException("Cannot get value: RegGetValue failed.", retCode);
+        }
+
+        return typeId;
+    }
+
+    void RegistryKey::QueryInfoKey(DWORD& subKeys, DWORD& values, FILETIME& lastWriteTime) const {
 
         _ASSERTE(IsValid());
 
@@ -856,137 +1598,148 @@ namespace registry {
         }
     }
 
-    std::vector<std::string> RegistryKey::EnumSubKeys() {
+    std::vector<std::string> RegistryKey::EnumSubKeys() const {
 
         _ASSERTE(IsValid());
 
-        // Get some useful enumeration info, like the total number of subkeys
-        // and the maximum length of the subkey names
-        DWORD subKeyCount {};
-        DWORD maxSubKeyNameLen {};
-        auto retCode = ::RegQueryInfoKeyW(_hKey, //
-                                          nullptr, // no user-defined class
-                                          nullptr, // no user-defined class size
-                                          nullptr, // reserved
-                                          &subKeyCount, //
-                                          &maxSubKeyNameLen, //
-                                          nullptr, // no subkey class length
-                                          nullptr, // no value count
-                                          nullptr, // no value name max length
-                                          nullptr, // no max value length
-                                          nullptr, // no security descriptor
-                                          nullptr // no last write time
-        );
-        if(retCode != ERROR_SUCCESS) {
-            throw Exceptions::RegistryException("RegQueryInfoKey failed while preparing for subkey enumeration.", retCode);
-        }
+        std::vector<std::string> subkeyNames;
+        EnumNames(
+            _hKey,
+            EnumKind::SubKeys,
+            [&](DWORD count, DWORD) { subkeyNames.reserve(count); },
+            [&](const wchar_t* name, DWORD length, DWORD) {
+                subkeyNames.emplace_back();
+                Narrow(name, length, subkeyNames.back());
+            });
 
-        // NOTE: According to the MSDN documentation, the size returned for subkey name max length
-        // does *not* include the terminating NULL, so let's add +1 to take it into account
-        // when I allocate the buffer for reading subkey names.
-        maxSubKeyNameLen++;
+        return subkeyNames;
+    }
 
-        // Preallocate a buffer for the subkey names
-        auto nameBuffer = std::make_unique<wchar_t[]>(maxSubKeyNameLen);
+    std::vector<std::pair<std::string, RegistryValueType>> RegistryKey::EnumValues() const {
 
-        // The result subkey names will be stored here
-        std::vector<std::string> subkeyNames;
+        _ASSERTE(IsValid());
 
-        // Enumerate all the subkeys
-        for(DWORD index = 0; index < subKeyCount; index++) {
-            // Get the name of the current subkey
-            DWORD subKeyNameLen = maxSubKeyNameLen;
-            retCode = ::RegEnumKeyExW(_hKey, //
-                                      index, //
-                                      nameBuffer.get(), //
-                                      &subKeyNameLen, //
-                                      nullptr, // reserved
-                                      nullptr, // no class
-                                      nullptr, // no class
-                                      nullptr // no last write time
-            );
+        std::vector<std::pair<std::string, RegistryValueType>> valueInfo;
+        EnumNames(
+            _hKey,
+            EnumKind::Values,
+            [&](DWORD count, DWORD) { valueInfo.reserve(count); },
+            [&](const wchar_t* name, DWORD length, DWORD type) {
+                valueInfo.emplace_back(std::string(), ValueType::Handle(type));
+                Narrow(name, length, valueInfo.back().first);
+            });
 
-            if(retCode != ERROR_SUCCESS) {
-                throw Exceptions::RegistryException("Cannot enumerate subkeys: RegEnumKeyEx failed.", retCode);
-            }
+        return valueInfo;
+    }
 
-            // On success, the ::RegEnumKeyEx API writes the length of the
-            // subkey name in the subKeyNameLen output parameter
-            // (not including the terminating NUL).
-            // So I can build a string based on that length.
-            std::string subkey = commons::utf8convert::Utf16ToUtf8(std::wstring(nameBuffer.get(), subKeyNameLen));
-            subkeyNames.push_back(subkey);
-        }
+    std::pmr::vector<std::pmr::string> RegistryKey::EnumSubKeys(std::pmr::memory_resource* resource) const {
+
+        _ASSERTE(IsValid());
+
+        std::pmr::vector<std::pmr::string> subkeyNames(resource);
+        EnumNames(
+            _hKey,
+            EnumKind::SubKeys,
+            [&](DWORD count, DWORD) { subkeyNames.reserve(count); },
+            [&](const wchar_t* name, DWORD length, DWORD) {
+                subkeyNames.emplace_back();
+                Narrow(name, length, subkeyNames.back());
+            });
 
         return subkeyNames;
     }
 
-    std::vector<std::pair<std::string, RegistryValueType>> RegistryKey::EnumValues() {
+    std::pmr::vector<std::pair<std::pmr::string, RegistryValueType>> RegistryKey::EnumValues(std::pmr::memory_resource* resource) const {
 
         _ASSERTE(IsValid());
 
-        // Get useful enumeration info, like the total number of values
-        // and the maximum length of the value names
-        DWORD valueCount {};
-        DWORD maxValueNameLen {};
-        auto retCode = ::RegQueryInfoKeyW(_hKey, //
-                                          nullptr, // no user-defined class
-                                          nullptr, // no user-defined class size
-                                          nullptr, // reserved
-                                          nullptr, // no subkey count
-                                          nullptr, // no subkey max length
-                                          nullptr, // no subkey class length
-                                          &valueCount, //
-                                          &maxValueNameLen, //
-                                          nullptr, // no max value length
-                                          nullptr, // no security descriptor
-                                          nullptr // no last write time
-        );
+        std::pmr::vector<std::pair<std::pmr::string, RegistryValueType>> valueInfo(resource);
+        EnumNames(
+            _hKey,
+            EnumKind::Values,
+            [&](DWORD count, DWORD) { valueInfo.reserve(count); },
+            [&](const wchar_t* name, DWORD length, DWORD type) {
+                // The pair gets the allocator of the vector
+                valueInfo.emplace_back(std::piecewise_construct, std::forward_as_tuple(), std::forward_as_tuple(ValueType::Handle(type)));
+                Narrow(name, length, valueInfo.back().first);
+            });
 
-        if(retCode != ERROR_SUCCESS) {
-            throw Exceptions::RegistryException("RegQueryInfoKey failed while preparing for value enumeration.", retCode);
+        return valueInfo;
+    }
+
+    std::vector<RegistryAtomTable::Atom> RegistryKey::EnumSubKeyAtoms(RegistryAtomTable& names) const {
+
+        _ASSERTE(IsValid());
+
+        std::string& utf8Buffer = GetScratch().utf8;
+
+        std::vector<RegistryAtomTable::Atom> subkeyAtoms;
+        EnumNames(
+            _hKey,
+            EnumKind::SubKeys,
+            [&](DWORD count, DWORD) { subkeyAtoms.reserve(count); },
+            [&](const wchar_t* name, DWORD length, DWORD) { subkeyAtoms.push_back(names.Intern(NarrowName(name, length, utf8Buffer))); });
+
+        return subkeyAtoms;
+    }
+
+    std::vector<std::pair<RegistryAtomTable::Atom, RegistryValueType>> RegistryKey::EnumValueAtoms(RegistryAtomTable& names) const {
+
+        _ASSERTE(IsValid());
+
+        std::string& utf8Buffer = GetScratch().utf8;
+
+        std::vector<std::pair<RegistryAtomTable::Atom, RegistryValueType>> valueAtoms;
+        EnumNames(
+            _hKey,
+            EnumKind::Values,
+            [&](DWORD count, DWORD) { valueAtoms.reserve(count); },
+            [&](const wchar_t* name, DWORD length, DWORD type) {
+                const auto atom = names.Intern(NarrowName(name, length, utf8Buffer));
+                valueAtoms.emplace_back(atom, ValueType::Handle(type));
+            });
+
+        return valueAtoms;
+    }
+
+    RegistryNameList RegistryKey::EnumSubKeyNames(bool sorted, std::pmr::memory_resource* resource) const {
+
+        _ASSERTE(IsValid());
+
+        std::string& utf8Buffer = GetScratch().utf8;
+
+        RegistryNameList subkeyNames(resource);
+        EnumNames(
+            _hKey,
+            EnumKind::SubKeys,
+            [&](DWORD count, DWORD maxNameLen) { subkeyNames.Reserve(count, EstimateNameBytes(count, maxNameLen)); },
+            [&](const wchar_t* name, DWORD length, DWORD) { subkeyNames.PushBack(NarrowName(name, length, utf8Buffer)); });
+
+        if(sorted) {
+            subkeyNames.Sort();
         }
 
-        // NOTE: According to the MSDN documentation, the size returned for value name max length
-        // does *not* include the terminating NUL, so let's add +1 to take it into account
-        // when I allocate the buffer for reading value names.
-        maxValueNameLen++;
+        return subkeyNames;
+    }
 
-        // Preallocate a buffer for the value names
-        auto nameBuffer = std::make_unique<wchar_t[]>(maxValueNameLen);
+    RegistryNameList RegistryKey::EnumValueNames(bool sorted, std::pmr::memory_resource* resource) const {
 
-        // The value names and types will be stored here
-        std::vector<std::pair<std::string, RegistryValueType>> valueInfo;
+        _ASSERTE(IsValid());
 
-        // Enumerate all the values
-        for(DWORD index = 0; index < valueCount; index++) {
-            // Get the name and the type of the current value
-            DWORD valueNameLen = maxValueNameLen;
-            DWORD valueType {};
-            retCode = ::RegEnumValueW(_hKey, //
-                                      index, //
-                                      nameBuffer.get(), //
-                                      &valueNameLen, //
-                                      nullptr, // reserved
-                                      &valueType,
-                                      nullptr, // no data
-                                      nullptr // no data size
-            );
+        std::string& utf8Buffer = GetScratch().utf8;
 
-            if(retCode != ERROR_SUCCESS) {
-                throw Exceptions::RegistryException("Cannot enumerate values: RegEnumValue failed.", retCode);
-            }
+        RegistryNameList valueNames(resource);
+        EnumNames(
+            _hKey,
+            EnumKind::Values,
+            [&](DWORD count, DWORD maxNameLen) { valueNames.Reserve(count, EstimateNameBytes(count, maxNameLen)); },
+            [&](const wchar_t* name, DWORD length, DWORD) { valueNames.PushBack(NarrowName(name, length, utf8Buffer)); });
 
-            // On success, the RegEnumValue API writes the length of the
-            // value name in the valueNameLen output parameter
-            // (not including the terminating NUL).
-            // So we can build a wstring based on that.
-            std::string subkey = commons::utf8convert::Utf16ToUtf8(std::wstring(nameBuffer.get(), valueNameLen));
-            RegistryValueType type = ValueType::Handle(valueType);
-            valueInfo.push_back(std::make_pair(subkey, type));
+        if(sorted) {
+            valueNames.Sort();
         }
 
-        return valueInfo;
+        return valueNames;
     }
 
     void RegistryKey::EnableReflectionKey() {
@@ -1003,7 +1756,7 @@ namespace registry {
         }
     }
 
-    bool RegistryKey::QueryReflectionKey() {
+    bool RegistryKey::QueryReflectionKey() const {
         BOOL isReflectionDisabled = FALSE;
         const auto retCode = ::RegQueryReflectionKey(_hKey, &isReflectionDisabled);
         if(retCode != ERROR_SUCCESS) {
@@ -1054,8 +1807,9 @@ namespace registry {
         return false;
     }
 
-    bool RegistryKey::IsWritable() const {
-        return AccessRights::Handle(_access) == AccessRights::Handle(RegistryAccessRights::Write) || AccessRights::Handle(RegistryAccessRights::AllAccess);
+    bool RegistryKey::IsWritable(RegistryAccessRights access) {
+        // The rights are access masks: Write and AllAccess include both bits
+        return (static_cast<REGSAM>(access) & (KEY_SET_VALUE | KEY_CREATE_SUB_KEY)) != 0;
     }
 
     bool RegistryKey::IsDirty() const {
@@ -1064,22 +1818,46 @@ namespace registry {
 
     void RegistryKey::setDirty() {
         _dirty = true;
+
+        const RegistryDurability durability = GetDurability();
+        if(durability == RegistryDurability::None) {
+            return;
+        }
+
+        RegistryFlushScheduler::Instance().Schedule(_hive, durability, _options->flushWindow);
+
+        // A group commit returns once the hive has been flushed
+        if(durability == RegistryDurability::GroupCommit) {
+            _dirty = false;
+        }
     }
 
     void RegistryKey::EnsureNotDisposed() const {
         if(!IsValid()) {
-            throw Exceptions::RegistryException(_keyName, "Registry key cannot be null!");
+            throw Exceptions::RegistryException(KeyName(), "Registry key cannot be null!");
         }
     }
 
-    void RegistryKey::EnsureWriteable() const {
+    void RegistryKey::EnsureWriteable(RegistryAccessRights access) const {
         EnsureNotDisposed();
-        if(!IsWritable()) {
-            throw Exceptions::RegistryException(_keyName, "Key is not writable!");
+        if(!IsWritable(access)) {
+            throw Exceptions::RegistryException(KeyName(), "Key is not writable!");
         }
     }
 
-    void RegistryKey::ValidateKeyName(std::string& keyName) {
+    RegistryValue RegistryKey::GetValueOrEmpty(const std::string& valueName) const {
+        try {
+            return GetValue(valueName);
+        }
+        catch(const Exceptions::RegistryException& e) {
+            if(e.ErrorCode() != ERROR_FILE_NOT_FOUND) {
+                throw;
+            }
+        }
+        return RegistryValue();
+    }
+
+    void RegistryKey::ValidateKeyName(std::string& keyName) const {
         FixupName(keyName);
         commons::string::InPlace::ltrim(keyName);
 
@@ -1104,6 +1882,21 @@ namespace registry {
             throw std::length_error("keyName is too long!");
     }
 
+    const std::string& RegistryKey::KeyName() const {
+        return RegistryPathTable::Instance().GetPath(_pathId);
+    }
+
+    HANDLE RegistryKey::Transaction() const noexcept {
+        return _options != nullptr ? _options->transaction.get() : nullptr;
+    }
+
+    RegistryKey::Options& RegistryKey::MutableOptions() {
+        if(_options == nullptr) {
+            _options = std::make_unique<Options>();
+        }
+        return *_options;
+    }
+
     std::string& RegistryKey::FixupName(std::string& name) {
         if(name.find_first_of('\\') == std::string::npos)
             return name;
@@ -0,0 +1,935 @@
+//===--- RegistryLogStore.cpp --------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+#include "Registry/RegistryLogStore.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <string_view>
+
+#include "Registry/RegistryException.h"
+#include "Registry/RegistrySnapshot.h"
+#include "RegistryUtils.h"
+
+namespace abscodes {
+namespace registry {
+
+    namespace {
+
+        /// Operations of a log record
+        enum class LogOperation : uint8_t {
+            CreateKey = 1,
+            DeleteKey = 2,
+            SetValue = 3,
+            DeleteValue = 4,
+        };
+
+        ///
+        /// Header of a log record, followed by its operations.
+        ///
+        /// Each operation is its code, the key path, then for the values the value name, and for SetValue the
+        /// value type and data. Texts and data are prefixed by their size on 32 bits.
+        ///
+        struct RecordHeader {
+            /// Size of the operations, in bytes
+            uint32_t size;
+            /// FNV-1a checksum of the time and of the operations
+            uint32_t checksum;
+            /// Last write time given to the keys changed by the record
+            uint64_t time;
+        };
+
+        static_assert(sizeof(RecordHeader) == 16, "The record header is 16 bytes.");
+
+        /// A decoded operation
+        struct Operation {
+            LogOperation code = LogOperation::CreateKey;
+            std::string keyName;
+            std::string valueName;
+            RegistryValue value;
+        };
+
+        uint32_t Checksum(const BYTE* data, size_t size, uint32_t hash = 2166136261u) noexcept {
+            for(size_t i = 0; i < size; ++i) {
+                hash ^= data[i];
+                hash *= 16777619u;
+            }
+            return hash;
+        }
+
+        uint32_t Checksum(const RecordHeader& header, const BYTE* operations) noexcept {
+            return Checksum(operations, header.size, Checksum(reinterpret_cast<const BYTE*>(&header.time), sizeof(header.time)));
+        }
+
+        /// Can the store hold a value of this type?
+        bool IsSupported(RegistryValueType type) noexcept {
+            switch(type) {
+                case RegistryValueType::DWord:
+                case RegistryValueType::QWord:
+                case RegistryValueType::String:
+                case RegistryValueType::ExpandString:
+                case RegistryValueType::MultiString:
+                case RegistryValueType::Binary: return true;
+                default: return false;
+            }
+        }
+
+        FILETIME ToFileTime(ULONGLONG time) noexcept {
+            FILETIME fileTime;
+            fileTime.dwLowDateTime = static_cast<DWORD>(time);
+            fileTime.dwHighDateTime = static_cast<DWORD>(time >> 32);
+            return fileTime;
+        }
+
+        ULONGLONG FromFileTime(const FILETIME& fileTime) noexcept {
+            return (static_cast<ULONGLONG>(fileTime.dwHighDateTime) << 32) | fileTime.dwLowDateTime;
+        }
+
+        /// Move the end of a file
+        LONG Truncate(HANDLE hFile, unsigned long long size) noexcept {
+            LARGE_INTEGER position {};
+            position.QuadPart = static_cast<long long>(size);
+            if(!::SetFilePointerEx(hFile, position, nullptr, FILE_BEGIN) || !::SetEndOfFile(hFile)) {
+                return static_cast<LONG>(::GetLastError());
+            }
+            return ERROR_SUCCESS;
+        }
+
+        ///
+        /// Encodes the operations of a record, after room for its header.
+        ///
+        class RecordWriter
+        {
+        public:
+            RecordWriter()
+              : _record(sizeof(RecordHeader)) {}
+
+            bool IsEmpty() const noexcept {
+                return _record.size() == sizeof(RecordHeader);
+            }
+
+            void Add(LogOperation code, const std::string& keyName) {
+                _record.push_back(static_cast<BYTE>(code));
+                Text(Name::Normalize(keyName));
+            }
+
+            void Add(LogOperation code, const std::string& keyName, const std::string& valueName) {
+                Add(code, keyName);
+                Text(valueName);
+            }
+
+            void Add(const std::string& keyName, const std::string& valueName, const RegistryValue& value) {
+                if(!IsSupported(value.GetType())) {
+                    throw std::invalid_argument("The registry log store cannot hold this value type.");
+                }
+
+                Add(LogOperation::SetValue, keyName, valueName);
+                Integer(static_cast<uint32_t>(value.GetType()));
+                switch(value.GetType()) {
+                    case RegistryValueType::DWord: {
+                        const DWORD data = value.DWord();
+                        Data(&data, sizeof(data));
+                        break;
+                    }
+                    case RegistryValueType::QWord: {
+                        const ULONGLONG data = value.QWord();
+                        Data(&data, sizeof(data));
+                        break;
+                    }
+                    case RegistryValueType::String: Text(value.String()); break;
+                    case RegistryValueType::ExpandString: Text(value.ExpandString()); break;
+                    case RegistryValueType::MultiString: {
+                        // Each string is terminated, like REG_MULTI_SZ without the final terminator
+                        std::string data;
+                        for(const auto& text : value.MultiString()) {
+                            data.append(text).push_back('\0');
+                        }
+                        Text(data);
+                        break;
+                    }
+                    default: Data(value.Binary().data(), value.Binary().size()); break;
+                }
+            }
+
+            std::vector<BYTE> Finish() {
+                return std::move(_record);
+            }
+
+        private:
+            void Integer(uint32_t integer) {
+                const auto bytes = reinterpret_cast<const BYTE*>(&integer);
+                _record.insert(_record.end(), bytes, bytes + sizeof(integer));
+            }
+
+            void Data(const void* data, size_t size) {
+                if(size > UINT32_MAX) {
+                    throw std::length_error("The registry log record is too large.");
+                }
+                Integer(static_cast<uint32_t>(size));
+                const auto bytes = static_cast<const BYTE*>(data);
+                _record.insert(_record.end(), bytes, bytes + size);
+            }
+
+            void Text(std::string_view text) {
+                Data(text.data(), text.size());
+            }
+
+            std::vector<BYTE> _record;
+        };
+
+        ///
+        /// Decodes the operations of a record.
+        ///
+        class RecordReader
+        {
+        public:
+            RecordReader(const BYTE* data, size_t size) noexcept
+              : _data(data)
+              , _left(size) {}
+
+            bool AtEnd() const noexcept {
+                return _left == 0;
+            }
+
+            bool Read(Operation& operation) {
+                BYTE code = 0;
+                if(!Bytes(&code, sizeof(code)) || !Text(operation.keyName)) {
+                    return false;
+                }
+
+                operation.code = static_cast<LogOperation>(code);
+                switch(operation.code) {
+                    case LogOperation::CreateKey:
+                    case LogOperation::DeleteKey: return true;
+                    case LogOperation::DeleteValue: return Text(operation.valueName);
+                    case LogOperation::SetValue: return Text(operation.valueName) && Value(operation.value);
+                    default: return false;
+                }
+            }
+
+        private:
+            bool Bytes(void* data, size_t size) noexcept {
+                if(size > _left) {
+                    return false;
+                }
+                std::memcpy(data, _data, size);
+                _data += size;
+                _left -= size;
+                return true;
+            }
+
+            bool Text(std::string& text) {
+                uint32_t size = 0;
+                if(!Bytes(&size, sizeof(size)) || size > _left) {
+                    return false;
+                }
+                text.assign(reinterpret_cast<const char*>(_data), size);
+                _data += size;
+                _left -= size;
+                return true;
+            }
+
+            bool Value(RegistryValue& value) {
+                uint32_t type = 0;
+                std::string data;
+                if(!Bytes(&type, sizeof(type)) || !Text(data) || !IsSupported(static_cast<RegistryValueType>(type))) {
+                    return false;
+                }
+
+                value.Reset(static_cast<RegistryValueType>(type));
+                switch(value.GetType()) {
+                    case RegistryValueType::DWord:
+                        if(data.size() != sizeof(DWORD)) {
+                            return false;
+                        }
+                        std::memcpy(&value.DWord(), data.data(), sizeof(DWORD));
+                        return true;
+                    case RegistryValueType::QWord:
+                        if(data.size() != sizeof(ULONGLONG)) {
+                            return false;
+                        }
+                        std::memcpy(&value.QWord(), data.data(), sizeof(ULONGLONG));
+                        return true;
+                    case RegistryValueType::String: value.String() = std::move(data); return true;
+                    case RegistryValueType::ExpandString: value.ExpandString() = std::move(data); return true;
+                    case RegistryValueType::MultiString:
+                        for(size_t start = 0; start < data.size();) {
+                            const size_t end = data.find('\0', start);
+                            if(end == std::string::npos) {
+                                return false;
+                            }
+                            value.MultiString().push_back(data.substr(start, end - start));
+                            start = end + 1;
+                        }
+                        return true;
+                    default: value.Binary().assign(data.begin(), data.end()); return true;
+                }
+            }
+
+            const BYTE* _data;
+            size_t _left;
+        };
+
+    } // namespace
+
+    ///
+    /// A change of the index, and what it replaced. Undoing it never allocates, so that a rollback cannot fail:
+    /// the replaced values and the erased keys are kept as map nodes.
+    ///
+    struct RegistryLogStore::Change {
+        enum class Kind { KeyCreated, KeyTime, Value, KeyErased };
+
+        Kind kind;
+        /// Path of the key
+        std::string path;
+        /// Previous last write time, for KeyTime
+        ULONGLONG time = 0;
+        /// Name of the value, for Value
+        std::string valueName;
+        /// Previous value, empty if there was none, for Value
+        Values::node_type value;
+        /// The key, for KeyErased
+        Keys::node_type key;
+    };
+
+    namespace {
+
+        /// Track a change before making it: the change never fails to be tracked once made
+        template <typename Change>
+        Change& Track(std::vector<Change>& changes, typename Change::Kind kind, const std::string& path) {
+            Change change {kind, path};
+            if(changes.size() == changes.capacity()) {
+                changes.reserve(changes.size() * 2 + 16);
+            }
+            changes.push_back(std::move(change));
+            return changes.back();
+        }
+
+    } // namespace
+
+    RegistryLogStore::RegistryLogStore(const std::string& fileName, RegistryDurability durability, size_t checkpointSize)
+      : _checkpointFileName(fileName + ".checkpoint")
+      , _logFileName(fileName + ".log")
+      , _durability(durability)
+      , _checkpointSize(checkpointSize)
+      , _nextCheckpoint(checkpointSize) {
+
+        _keys.emplace(std::string(), Key());
+        LoadCheckpoint();
+
+        const std::wstring wFileName = detail::Widen(_logFileName);
+        _hLog = ::CreateFileW(wFileName.c_str(), //
+                              GENERIC_READ | GENERIC_WRITE, //
+                              FILE_SHARE_READ, //
+                              nullptr, // default security attributes
+                              OPEN_ALWAYS, //
+                              FILE_ATTRIBUTE_NORMAL, //
+                              nullptr // no template
+        );
+        if(_hLog == INVALID_HANDLE_VALUE) {
+            throw Exceptions::RegistryException(_logFileName, "CreateFile failed.", static_cast<LONG>(::GetLastError()));
+        }
+
+        try {
+            Replay();
+        }
+        catch(...) {
+            ::CloseHandle(_hLog);
+            throw;
+        }
+    }
+
+    RegistryLogStore::~RegistryLogStore() noexcept {
+        if(_durability != RegistryDurability::GroupCommit) {
+            ::FlushFileBuffers(_hLog);
+        }
+        ::CloseHandle(_hLog);
+    }
+
+    unsigned long long RegistryLogStore::GetLogSize() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _logSize;
+    }
+
+    RegistryLogStore::Statistics RegistryLogStore::GetStatistics() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _statistics;
+    }
+
+    LONG RegistryLogStore::GetCheckpointError() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _checkpointError;
+    }
+
+    bool RegistryLogStore::KeyExists(const std::string& keyName) const {
+        std::shared_lock<std::shared_mutex> lock(_indexMutex);
+        return FindKey(Name::Normalize(keyName)) != nullptr;
+    }
+
+    bool RegistryLogStore::HasValue(const std::string& keyName, const std::string& valueName) const {
+        std::shared_lock<std::shared_mutex> lock(_indexMutex);
+        return FindValue(keyName, valueName) != nullptr;
+    }
+
+    RegistryValue RegistryLogStore::GetValue(const std::string& keyName, const std::string& valueName) const {
+        std::shared_lock<std::shared_mutex> lock(_indexMutex);
+        const RegistryValue* value = FindValue(keyName, valueName);
+        if(value == nullptr) {
+            throw Exceptions::RegistryException(keyName, "Value not found in the registry log store.", ERROR_FILE_NOT_FOUND);
+        }
+        return *value;
+    }
+
+    DWORD RegistryLogStore::GetDwordValue(const std::string& keyName, const std::string& valueName) const {
+        return GetValue(keyName, valueName).DWord();
+    }
+
+    ULONGLONG RegistryLogStore::GetQwordValue(const std::string& keyName, const std::string& valueName) const {
+        return GetValue(keyName, valueName).QWord();
+    }
+
+    std::string RegistryLogStore::GetStringValue(const std::string& keyName, const std::string& valueName) const {
+        return GetValue(keyName, valueName).String();
+    }
+
+    void RegistryLogStore::CreateKey(const std::string& keyName) {
+        RecordWriter writer;
+        writer.Add(LogOperation::CreateKey, keyName);
+        Commit(writer.Finish());
+    }
+
+    void RegistryLogStore::DeleteKey(const std::string& keyName) {
+        if(Name::Normalize(keyName).empty()) {
+            throw std::invalid_argument("Cannot delete the root of the registry log store.");
+        }
+        if(!KeyExists(keyName)) {
+            throw Exceptions::RegistryException(keyName, "Key not found in the registry log store.", ERROR_FILE_NOT_FOUND);
+        }
+
+        RecordWriter writer;
+        writer.Add(LogOperation::DeleteKey, keyName);
+        Commit(writer.Finish());
+    }
+
+    void RegistryLogStore::SetValue(const std::string& keyName, const std::string& valueName, const RegistryValue& value) {
+        if(value.IsEmpty()) {
+            throw std::invalid_argument("Cannot write a REG_NONE value.");
+        }
+
+        RecordWriter writer;
+        writer.Add(keyName, valueName, value);
+        Commit(writer.Finish());
+    }
+
+    void RegistryLogStore::SetDwordValue(const std::string& keyName, const std::string& valueName, DWORD value) {
+        RegistryValue data(RegistryValueType::DWord);
+        data.DWord() = value;
+        SetValue(keyName, valueName, data);
+    }
+
+    void RegistryLogStore::SetQwordValue(const std::string& keyName, const std::string& valueName, ULONGLONG value) {
+        RegistryValue data(RegistryValueType::QWord);
+        data.QWord() = value;
+        SetValue(keyName, valueName, data);
+    }
+
+    void RegistryLogStore::SetStringValue(const std::string& keyName, const std::string& valueName, const std::string& value) {
+        RegistryValue data(RegistryValueType::String);
+        data.String() = value;
+        SetValue(keyName, valueName, data);
+    }
+
+    void RegistryLogStore::DeleteValue(const std::string& keyName, const std::string& valueName) {
+        if(!HasValue(keyName, valueName)) {
+            throw Exceptions::RegistryException(keyName, "Value not found in the registry log store.", ERROR_FILE_NOT_FOUND);
+        }
+
+        RecordWriter writer;
+        writer.Add(LogOperation::DeleteValue, keyName, valueName);
+        Commit(writer.Finish());
+    }
+
+    void RegistryLogStore::Apply(const RegistryWriteBatch& batch) {
+        RecordWriter writer;
+        batch.ForEach([&writer](const std::string& keyName, const std::string& valueName, const RegistryValue* value) {
+            if(value != nullptr) {
+                writer.Add(keyName, valueName, *value);
+            }
+            else {
+                writer.Add(LogOperation::DeleteValue, keyName, valueName);
+            }
+        });
+
+        if(!writer.IsEmpty()) {
+            Commit(writer.Finish());
+        }
+    }
+
+    void RegistryLogStore::Checkpoint() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _written.wait(lock, [this] { return !_writing; });
+
+        // Lead, so that no record is written meanwhile
+        _writing = true;
+        lock.unlock();
+
+        try {
+            WriteCheckpoint();
+        }
+        catch(...) {
+            lock.lock();
+            _writing = false;
+            _written.notify_all();
+            throw;
+        }
+
+        lock.lock();
+        _writing = false;
+        _written.notify_all();
+    }
+
+    bool RegistryLogStore::QueryLastWriteTime(const std::string& keyName, FILETIME& lastWriteTime) {
+        std::shared_lock<std::shared_mutex> lock(_indexMutex);
+        const Key* key = FindKey(Name::Normalize(keyName));
+        if(key == nullptr) {
+            return false;
+        }
+
+        lastWriteTime = ToFileTime(key->lastWriteTime);
+        return true;
+    }
+
+    std::vector<std::pair<std::string, RegistryValue>> RegistryLogStore::ReadKey(const std::string& keyName) {
+        std::shared_lock<std::shared_mutex> lock(_indexMutex);
+        const Key* key = FindKey(Name::Normalize(keyName));
+        if(key == nullptr) {
+            return {};
+        }
+
+        return std::vector<std::pair<std::string, RegistryValue>>(key->values.begin(), key->values.end());
+    }
+
+    bool RegistryLogStore::ReadValue(const std::string& keyName, const std::string& valueName, RegistryValue& value) {
+        std::shared_lock<std::shared_mutex> lock(_indexMutex);
+        const RegistryValue* found = FindValue(keyName, valueName);
+        if(found == nullptr) {
+            return false;
+        }
+
+        value = *found;
+        return true;
+    }
+
+    std::vector<std::string> RegistryLogStore::EnumSubKeys(const std::string& keyName) {
+        std::shared_lock<std::shared_mutex> lock(_indexMutex);
+        const std::string path = Name::Normalize(keyName);
+        if(FindKey(path) == nullptr) {
+            return {};
+        }
+
+        return detail::DirectSubKeys(_keys, path);
+    }
+
+    void RegistryLogStore::LoadCheckpoint() {
+        RegistrySnapshot snapshot;
+        try {
+            snapshot = RegistrySnapshot::Open(_checkpointFileName);
+        }
+        catch(const Exceptions::RegistryException& e) {
+            // A new store; an invalid checkpoint is not silently dropped
+            if(e.ErrorCode() == ERROR_FILE_NOT_FOUND) {
+                return;
+            }
+            throw;
+        }
+
+        // The mapping is released once the keys are copied into the index
+        std::vector<SnapshotKey> keys {snapshot.Root()};
+        while(!keys.empty()) {
+            const SnapshotKey snapshotKey = keys.back();
+            keys.pop_back();
+
+            Key& key = _keys[std::string(snapshotKey.GetName())];
+            key.lastWriteTime = FromFileTime(snapshotKey.GetLastWriteTime());
+            _clock = (std::max)(_clock, key.lastWriteTime);
+            for(const auto& value : snapshotKey.EnumValues()) {
+                key.values.insert_or_assign(std::string(value.first), snapshotKey.GetValue(value.first));
+            }
+
+            for(size_t i = 0; i < snapshotKey.GetSubKeyCount(); ++i) {
+                keys.push_back(snapshotKey.GetSubKey(i));
+            }
+        }
+    }
+
+    void RegistryLogStore::Replay() {
+        LARGE_INTEGER fileSize {};
+        if(!::GetFileSizeEx(_hLog, &fileSize)) {
+            throw Exceptions::RegistryException(_logFileName, "GetFileSize failed.", static_cast<LONG>(::GetLastError()));
+        }
+
+        std::vector<BYTE> log(static_cast<size_t>(fileSize.QuadPart));
+        size_t read = 0;
+        LONG result = detail::ReadAll(_hLog, log.data(), log.size(), read);
+        if(result != ERROR_SUCCESS) {
+            throw Exceptions::RegistryException(_logFileName, "ReadFile failed.", result);
+        }
+        log.resize(read);
+
+        // The replay stops at the first record torn by a crash
+        size_t offset = 0;
+        std::vector<Change> changes;
+        while(log.size() - offset >= sizeof(RecordHeader)) {
+            RecordHeader header;
+            std::memcpy(&header, log.data() + offset, sizeof(header));
+            if(header.size == 0 || header.size > log.size() - offset - sizeof(header)
+               || header.checksum != Checksum(header, log.data() + offset + sizeof(header))
+               || !ApplyRecord(log.data() + offset, sizeof(header) + header.size, changes)) {
+                break;
+            }
+            changes.clear();
+
+            _clock = (std::max)(_clock, static_cast<ULONGLONG>(header.time));
+            offset += sizeof(header) + header.size;
+            ++_statistics.replayed;
+        }
+
+        // Cut the torn record, so that the next records follow the valid ones
+        result = Truncate(_hLog, offset);
+        if(result != ERROR_SUCCESS) {
+            throw Exceptions::RegistryException(_logFileName, "Cannot truncate the registry log.", result);
+        }
+        if(offset < log.size()) {
+            _statistics.truncated = log.size() - offset;
+            ::FlushFileBuffers(_hLog);
+        }
+        _logSize = offset;
+    }
+
+    void RegistryLogStore::Commit(std::vector<BYTE> record) {
+        Pending pending;
+        pending.record = std::move(record);
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _pending.push_back(&pending);
+
+        while(!pending.done) {
+            if(_writing) {
+                _written.wait(lock);
+                continue;
+            }
+
+            // Lead the group: write the records of all the waiting writers, with a single flush
+            _writing = true;
+            std::deque<Pending*> group;
+            group.swap(_pending);
+
+            // Whatever happens, the group ends done and the next writer can lead: a record not written by then failed
+            struct Leadership {
+                RegistryLogStore& store;
+                std::unique_lock<std::mutex>& lock;
+                std::deque<Pending*>& group;
+
+                ~Leadership() {
+                    if(!lock.owns_lock()) {
+                        lock.lock();
+                    }
+                    for(Pending* member : group) {
+                        if(!member->done) {
+                            member->result = ERROR_NOT_ENOUGH_MEMORY;
+                            member->done = true;
+                        }
+                    }
+                    store._writing = false;
+                    store._written.notify_all();
+                }
+            } leadership {*this, lock, group};
+
+            // Each record gets a later time than the previous one, so that each change moves the time of its keys
+            std::vector<BYTE> buffer;
+            for(Pending* member : group) {
+                auto& header = *reinterpret_cast<RecordHeader*>(member->record.data());
+                header.size = static_cast<uint32_t>(member->record.size() - sizeof(RecordHeader));
+                header.time = ++_clock;
+                header.checksum = Checksum(header, member->record.data() + sizeof(RecordHeader));
+                buffer.insert(buffer.end(), member->record.begin(), member->record.end());
+            }
+            const unsigned long long logSize = _logSize;
+            lock.unlock();
+
+            LONG result = detail::WriteAll(_hLog, buffer.data(), buffer.size());
+            const bool flush = result == ERROR_SUCCESS && _durability == RegistryDurability::GroupCommit;
+            if(flush && !::FlushFileBuffers(_hLog)) {
+                result = static_cast<LONG>(::GetLastError());
+            }
+
+            if(result == ERROR_SUCCESS) {
+                // Visible once durable, in the order of the log
+                std::vector<Change> changes;
+                try {
+                    std::unique_lock<std::shared_mutex> indexLock(_indexMutex);
+                    try {
+                        for(Pending* member : group) {
+                            ApplyRecord(member->record.data(), member->record.size(), changes);
+                        }
+                    }
+                    catch(...) {
+                        // The index is left as the log once cut: without any record of the group
+                        Undo(changes);
+                        throw;
+                    }
+                }
+                catch(...) {
+                    // Out of memory: the records failed, they must not be replayed either
+                    Truncate(_hLog, logSize);
+                    throw;
+                }
+            }
+            else {
+                // Cut the partial write, the next records must follow the valid ones
+                Truncate(_hLog, logSize);
+            }
+
+            lock.lock();
+            _statistics.commits += result == ERROR_SUCCESS ? group.size() : 0;
+            _statistics.writes += 1;
+            _statistics.flushes += flush ? 1 : 0;
+            _logSize = result == ERROR_SUCCESS ? logSize + buffer.size() : logSize;
+            for(Pending* member : group) {
+                member->result = result;
+                member->done = true;
+            }
+            _written.notify_all();
+
+            if(result == ERROR_SUCCESS && _logSize >= _nextCheckpoint) {
+                // Still leading: the next records wait for the checkpoint. The records are written whatever
+                // happens to it: the log is kept, the error is kept for GetCheckpointError, and the next
+                // attempt waits for the log to double, rather than slowing down every commit.
+                lock.unlock();
+                LONG error = ERROR_SUCCESS;
+                try {
+                    WriteCheckpoint();
+                }
+                catch(const Exceptions::RegistryException& e) {
+                    error = e.ErrorCode();
+                }
+                catch(const std::bad_alloc&) {
+                    error = ERROR_NOT_ENOUGH_MEMORY;
+                }
+                catch(...) {
+                    error = ERROR_INVALID_DATA;
+                }
+                lock.lock();
+
+                if(error != ERROR_SUCCESS) {
+                    ++_statistics.checkpointFailures;
+                    _checkpointError = error;
+                    _nextCheckpoint = 2 * _logSize;
+                }
+            }
+        }
+
+        if(pending.result != ERROR_SUCCESS) {
+            throw Exceptions::RegistryException(_logFileName, "Cannot write the registry log.", pending.result);
+        }
+    }
+
+    void RegistryLogStore::WriteCheckpoint() {
+        RegistrySnapshotBuilder builder;
+        {
+            std::shared_lock<std::shared_mutex> lock(_indexMutex);
+            for(const auto& key : _keys) {
+                builder.AddKey(key.first, ToFileTime(key.second.lastWriteTime));
+                for(const auto& value : key.second.values) {
+                    builder.SetValue(key.first, value.first, value.second);
+                }
+            }
+        }
+        const std::vector<BYTE> image = builder.Build();
+
+        // Write a new file, then replace the checkpoint with it: a crash leaves one or the other
+        const std::string temporaryFileName = _checkpointFileName + ".tmp";
+        const std::wstring wTemporaryFileName = detail::Widen(temporaryFileName);
+        const HANDLE hFile = detail::CreateFileForWriting(wTemporaryFileName.c_str());
+        if(hFile == INVALID_HANDLE_VALUE) {
+            throw Exceptions::RegistryException(temporaryFileName, "CreateFile failed.", static_cast<LONG>(::GetLastError()));
+        }
+
+        LONG result = detail::WriteAll(hFile, image.data(), image.size());
+        if(result == ERROR_SUCCESS && !::FlushFileBuffers(hFile)) {
+            result = static_cast<LONG>(::GetLastError());
+        }
+        ::CloseHandle(hFile);
+        if(result != ERROR_SUCCESS) {
+            throw Exceptions::RegistryException(temporaryFileName, "Cannot write the registry checkpoint.", result);
+        }
+
+        const std::wstring wCheckpointFileName = detail::Widen(_checkpointFileName);
+        if(!::MoveFileExW(wTemporaryFileName.c_str(), wCheckpointFileName.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+            throw Exceptions::RegistryException(_checkpointFileName, "MoveFileEx failed.", static_cast<LONG>(::GetLastError()));
+        }
+
+        // The checkpoint holds every record of the log. If emptying the log fails, replaying it again is harmless:
+        // the operations write or delete, they never depend on the previous content.
+        result = Truncate(_hLog, 0);
+        if(result == ERROR_SUCCESS && !::FlushFileBuffers(_hLog)) {
+            result = static_cast<LONG>(::GetLastError());
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        ++_statistics.checkpoints;
+        if(result != ERROR_SUCCESS) {
+            throw Exceptions::RegistryException(_logFileName, "Cannot empty the registry log.", result);
+        }
+        _logSize = 0;
+        _nextCheckpoint = _checkpointSize;
+        _checkpointError = ERROR_SUCCESS;
+    }
+
+    bool RegistryLogStore::ApplyRecord(const BYTE* data, size_t size, std::vector<Change>& changes) {
+        RecordHeader header;
+        std::memcpy(&header, data, sizeof(header));
+
+        // Decode all the operations first: a record is applied entirely or not at all
+        std::vector<Operation> operations;
+        RecordReader reader(data + sizeof(header), size - sizeof(header));
+        while(!reader.AtEnd()) {
+            Operation operation;
+            if(!reader.Read(operation)) {
+                return false;
+            }
+            operations.push_back(std::move(operation));
+        }
+
+        // Each change is tracked before it is made, see Undo
+        const ULONGLONG time = header.time;
+        for(auto& operation : operations) {
+            switch(operation.code) {
+                case LogOperation::CreateKey: CreateIndexKey(operation.keyName, time, changes); break;
+                case LogOperation::SetValue: {
+                    Key& key = CreateIndexKey(operation.keyName, time, changes);
+                    Track(changes, Change::Kind::KeyTime, operation.keyName).time = key.lastWriteTime;
+                    Change& change = Track(changes, Change::Kind::Value, operation.keyName);
+                    change.valueName = operation.valueName;
+
+                    const auto value = key.values.find(operation.valueName);
+                    if(value != key.values.end()) {
+                        change.value = key.values.extract(value);
+                    }
+                    key.values.emplace(std::move(operation.valueName), std::move(operation.value));
+                    key.lastWriteTime = time;
+                    break;
+                }
+                case LogOperation::DeleteValue: {
+                    const auto key = _keys.find(operation.keyName);
+                    if(key == _keys.end()) {
+                        break;
+                    }
+                    const auto value = key->second.values.find(operation.valueName);
+                    if(value == key->second.values.end()) {
+                        break;
+                    }
+
+                    Track(changes, Change::Kind::KeyTime, operation.keyName).time = key->second.lastWriteTime;
+                    Change& change = Track(changes, Change::Kind::Value, operation.keyName);
+                    change.valueName = operation.valueName;
+                    change.value = key->second.values.extract(value);
+                    key->second.lastWriteTime = time;
+                    break;
+                }
+                case LogOperation::DeleteKey: {
+                    const auto key = _keys.find(operation.keyName);
+                    if(operation.keyName.empty() || key == _keys.end()) {
+                        break;
+                    }
+
+                    // The key then its subkeys are moved into the changes, in the order of the index
+                    const auto subKeys = detail::SubKeyRange(_keys, operation.keyName);
+                    changes.reserve(changes.size() + std::distance(subKeys.first, subKeys.second) + 2);
+                    Track(changes, Change::Kind::KeyErased, operation.keyName).key = _keys.extract(key);
+                    for(auto it = subKeys.first; it != subKeys.second;) {
+                        Track(changes, Change::Kind::KeyErased, it->first).key = _keys.extract(it++);
+                    }
+
+                    const auto parent = _keys.find(detail::ParentPath(operation.keyName));
+                    if(parent != _keys.end()) {
+                        Track(changes, Change::Kind::KeyTime, parent->first).time = parent->second.lastWriteTime;
+                        parent->second.lastWriteTime = time;
+                    }
+                    break;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    void RegistryLogStore::Undo(std::vector<Change>& changes) noexcept {
+        for(auto change = changes.rbegin(); change != changes.rend(); ++change) {
+            if(change->kind == Change::Kind::KeyCreated) {
+                _keys.erase(change->path);
+                continue;
+            }
+            if(change->kind == Change::Kind::KeyErased) {
+                _keys.insert(std::move(change->key));
+                continue;
+            }
+
+            // The key exists: the later changes, which could erase it, are undone
+            const auto key = _keys.find(change->path);
+            if(key == _keys.end()) {
+                continue;
+            }
+            if(change->kind == Change::Kind::KeyTime) {
+                key->second.lastWriteTime = change->time;
+            }
+            else {
+                key->second.values.erase(change->valueName);
+                key->second.values.insert(std::move(change->value));
+            }
+        }
+        changes.clear();
+    }
+
+    RegistryLogStore::Key& RegistryLogStore::CreateIndexKey(const std::string& path, ULONGLONG time, std::vector<Change>& changes) {
+        auto touch = [&](const std::string& keyPath, const Key* key) {
+            if(key != nullptr) {
+                Track(changes, Change::Kind::KeyTime, keyPath).time = key->lastWriteTime;
+            }
+            else {
+                Track(changes, Change::Kind::KeyCreated, keyPath);
+            }
+            return time;
+        };
+        return detail::CreateKey(_keys, path, touch);
+    }
+
+    const RegistryLogStore::Key* RegistryLogStore::FindKey(const std::string& path) const {
+        const auto key = _keys.find(path);
+        return key != _keys.end() ? &key->second : nullptr;
+    }
+
+    const RegistryValue* RegistryLogStore::FindValue(const std::string& keyName, const std::string& valueName) const {
+        const Key* key = FindKey(Name::Normalize(keyName));
+        if(key == nullptr) {
+            return nullptr;
+        }
+
+        const auto value = key->values.find(valueName);
+        return value != key->values.end() ? &value->second : nullptr;
+    }
+
+
+} // namespace registry
+} // namespace abscodes
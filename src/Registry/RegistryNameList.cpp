@@ -0,0 +1,78 @@
+//===--- RegistryNameList.cpp --------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+#include "Registry/RegistryNameList.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include "Registry/RegistryName.h"
+
+namespace abscodes {
+namespace registry {
+
+    RegistryNameList::RegistryNameList(std::pmr::memory_resource* resource)
+      : _arena(resource)
+      , _entries(resource) {}
+
+    void RegistryNameList::Reserve(size_t count, size_t bytes) {
+        _entries.reserve(_entries.size() + count);
+        _arena.reserve(_arena.size() + bytes);
+    }
+
+    void RegistryNameList::PushBack(std::string_view name) {
+        const size_t offset = _arena.size();
+        if(name.size() > std::numeric_limits<std::uint32_t>::max() - offset) {
+            throw std::length_error("Registry name list is too large.");
+        }
+
+        _arena.insert(_arena.end(), name.begin(), name.end());
+        _entries.push_back(Entry {static_cast<std::uint32_t>(offset), static_cast<std::uint32_t>(name.size())});
+    }
+
+    void RegistryNameList::Sort() noexcept {
+        const char* arena = _arena.data();
+        std::sort(_entries.begin(), _entries.end(), [arena](const Entry& lhs, const Entry& rhs) {
+            return Name::Compare(std::string_view(arena + lhs.offset, lhs.length), //
+                                 std::string_view(arena + rhs.offset, rhs.length))
+                   < 0;
+        });
+    }
+
+    size_t RegistryNameList::Find(std::string_view name) const noexcept {
+        const char* arena = _arena.data();
+        const auto it = std::lower_bound(_entries.begin(), _entries.end(), name, [arena](const Entry& entry, std::string_view value) {
+            return Name::Compare(std::string_view(arena + entry.offset, entry.length), value) < 0;
+        });
+
+        if(it == _entries.end() || !Name::Equals(std::string_view(arena + it->offset, it->length), name)) {
+            return _entries.size();
+        }
+        return static_cast<size_t>(it - _entries.begin());
+    }
+
+    void RegistryNameList::Clear() noexcept {
+        _arena.clear();
+        _entries.clear();
+    }
+
+    std::vector<std::string> RegistryNameList::ToVector() const {
+        std::vector<std::string> names;
+        names.reserve(_entries.size());
+        for(const auto name : *this) {
+            names.emplace_back(name);
+        }
+        return names;
+    }
+
+} // namespace registry
+} // namespace abscodes
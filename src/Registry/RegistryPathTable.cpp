@@ -0,0 +1,159 @@
+//===--- RegistryPathTable.cpp -------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+#include "Registry/RegistryPathTable.h"
+
+#include <functional>
+#include <stdexcept>
+
+#include "Registry/RegistryName.h"
+
+namespace abscodes {
+namespace registry {
+
+    RegistryPathTable::RegistryPathTable() {
+        // The empty path is ID 0
+        Intern(std::string_view());
+    }
+
+    RegistryPathTable& RegistryPathTable::Instance() {
+        // Leaked: a key destroyed after the static destructors still releases its path
+        static RegistryPathTable* table = new RegistryPathTable();
+        return *table;
+    }
+
+    const std::string& RegistryPathTable::GetPath(Id id) const {
+        const Entry* entry = EntryOf(id);
+        if(entry == nullptr) {
+            throw std::out_of_range("Unknown registry path.");
+        }
+        return entry->path;
+    }
+
+    size_t RegistryPathTable::GetHash(Id id) const noexcept {
+        const Entry* entry = EntryOf(id);
+        return entry != nullptr ? entry->hash : 0;
+    }
+
+    bool RegistryPathTable::Equals(Id lhs, Id rhs) const noexcept {
+        if(lhs == rhs) {
+            return true;
+        }
+
+        // Another spelling of the same path has the same hash
+        const Entry* left = EntryOf(lhs);
+        const Entry* right = EntryOf(rhs);
+        return left != nullptr && right != nullptr && left->hash == right->hash && Name::Equals(left->path, right->path);
+    }
+
+    size_t RegistryPathTable::GetCount() const noexcept {
+        return _count.load(std::memory_order_relaxed);
+    }
+
+    RegistryPathTable::Id RegistryPathTable::Intern(std::string_view path) {
+        Shard& shard = _shards[ShardOf(path)];
+
+        // Most paths are already held by another key
+        {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            const auto it = shard.ids.find(path);
+            if(it != shard.ids.end()) {
+                // Entries are only removed under the exclusive lock
+                _entries.Slot(it->second).load(std::memory_order_relaxed)->references.fetch_add(1, std::memory_order_relaxed);
+                return it->second;
+            }
+        }
+
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+        // Another thread may have added it meanwhile
+        const auto it = shard.ids.find(path);
+        if(it != shard.ids.end()) {
+            _entries.Slot(it->second).load(std::memory_order_relaxed)->references.fetch_add(1, std::memory_order_relaxed);
+            return it->second;
+        }
+
+        Id id;
+        {
+            std::lock_guard<std::mutex> freeLock(_freeMutex);
+            if(!_free.empty()) {
+                id = _free.back();
+                _free.pop_back();
+            }
+            else if(_next < _entries.Capacity) {
+                id = _next++;
+            }
+            else {
+                throw std::overflow_error("Registry path table is full.");
+            }
+        }
+
+        auto entry = new Entry {std::string(path), Name::Hash(path)};
+
+        // Publish the entry before the ID can be seen by anybody
+        _entries.Slot(id).store(entry, std::memory_order_release);
+        shard.ids.emplace(entry->path, id);
+        _count.fetch_add(1, std::memory_order_relaxed);
+
+        return id;
+    }
+
+    void RegistryPathTable::Release(Id id) noexcept {
+        if(id == Root) {
+            return;
+        }
+
+        Entry* entry = _entries.Slot(id).load(std::memory_order_acquire);
+
+        // Not the last reference: no lock
+        uint32_t references = entry->references.load(std::memory_order_relaxed);
+        while(references > 1) {
+            if(entry->references.compare_exchange_weak(references, references - 1, std::memory_order_release, std::memory_order_relaxed)) {
+                return;
+            }
+        }
+
+        // Maybe the last one: Intern cannot take a new reference under the exclusive lock
+        Shard& shard = _shards[ShardOf(entry->path)];
+        {
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+            if(entry->references.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+                return;
+            }
+
+            shard.ids.erase(entry->path);
+            _entries.Slot(id).store(nullptr, std::memory_order_relaxed);
+        }
+
+        delete entry;
+        _count.fetch_sub(1, std::memory_order_relaxed);
+
+        try {
+            std::lock_guard<std::mutex> freeLock(_freeMutex);
+            _free.push_back(id);
+        }
+        catch(...) {
+            // The ID is not reused, nothing else is lost
+        }
+    }
+
+    const RegistryPathTable::Entry* RegistryPathTable::EntryOf(Id id) const noexcept {
+        const auto slot = _entries.Find(id);
+        return slot != nullptr ? slot->load(std::memory_order_acquire) : nullptr;
+    }
+
+    size_t RegistryPathTable::ShardOf(std::string_view path) const noexcept {
+        // Spellings of a path may land in different shards: the map is case-sensitive
+        return std::hash<std::string_view>()(path) & (ShardCount - 1);
+    }
+
+} // namespace registry
+} // namespace abscodes
@@ -0,0 +1,305 @@
+//===--- RegistryPrefetch.cpp --------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+#include "Registry/RegistryPrefetch.h"
+
+
+#include "Registry/RegistryException.h"
+#include "RegistryUtils.h"
+
+namespace abscodes {
+namespace registry {
+
+    namespace {
+
+        /// First line of a serialized profile
+        constexpr std::string_view Signature = "RegistryPrefetch 1\n";
+
+        [[noreturn]] void ThrowInvalid() {
+            throw Exceptions::RegistryException("Invalid registry prefetch profile.", ERROR_INVALID_DATA);
+        }
+
+    } // namespace
+
+    //
+    // RegistryPrefetchProfile
+    //
+
+    size_t RegistryPrefetchProfile::GetSize() const noexcept {
+        return _entries.size();
+    }
+
+    bool RegistryPrefetchProfile::IsEmpty() const noexcept {
+        return _entries.empty();
+    }
+
+    const std::vector<RegistryPrefetchProfile::Entry>& RegistryPrefetchProfile::GetEntries() const noexcept {
+        return _entries;
+    }
+
+    bool RegistryPrefetchProfile::Add(const std::string& keyName, const std::string& valueName) {
+        std::string path = Name::Normalize(keyName);
+        if(!_index[path].insert(valueName).second) {
+            return false;
+        }
+
+        _entries.emplace_back(std::move(path), valueName);
+        return true;
+    }
+
+    void RegistryPrefetchProfile::Clear() {
+        _entries.clear();
+        _index.clear();
+    }
+
+    std::string RegistryPrefetchProfile::Serialize() const {
+        size_t size = Signature.size();
+        for(const auto& entry : _entries) {
+            size += entry.first.size() + entry.second.size() + 2;
+        }
+
+        std::string text;
+        text.reserve(size);
+        text.append(Signature);
+        for(const auto& entry : _entries) {
+            text.append(entry.first).push_back('\0');
+            text.append(entry.second).push_back('\0');
+        }
+        return text;
+    }
+
+    RegistryPrefetchProfile RegistryPrefetchProfile::Parse(std::string_view text) {
+        if(text.substr(0, Signature.size()) != Signature) {
+            ThrowInvalid();
+        }
+        text.remove_prefix(Signature.size());
+
+        RegistryPrefetchProfile profile;
+        while(!text.empty()) {
+            const size_t keyEnd = text.find('\0');
+            const size_t valueEnd = keyEnd == std::string_view::npos ? keyEnd : text.find('\0', keyEnd + 1);
+            if(valueEnd == std::string_view::npos) {
+                ThrowInvalid();
+            }
+
+            profile.Add(std::string(text.substr(0, keyEnd)), std::string(text.substr(keyEnd + 1, valueEnd - keyEnd - 1)));
+            text.remove_prefix(valueEnd + 1);
+        }
+        return profile;
+    }
+
+    void RegistryPrefetchProfile::Save(const std::string& fileName) const {
+        const std::string text = Serialize();
+
+        const HANDLE hFile = detail::CreateFileForWriting(detail::Widen(fileName).c_str());
+        if(hFile == INVALID_HANDLE_VALUE) {
+            throw Exceptions::RegistryException("CreateFile failed.", static_cast<LONG>(::GetLastError()));
+        }
+
+        const LONG result = detail::WriteAll(hFile, reinterpret_cast<const BYTE*>(text.data()), text.size());
+        ::CloseHandle(hFile);
+        if(result != ERROR_SUCCESS) {
+            throw Exceptions::RegistryException("WriteFile failed.", result);
+        }
+    }
+
+    RegistryPrefetchProfile RegistryPrefetchProfile::Load(const std::string& fileName) {
+        const HANDLE hFile = detail::OpenFileForReading(detail::Widen(fileName).c_str());
+        if(hFile == INVALID_HANDLE_VALUE) {
+            throw Exceptions::RegistryException("CreateFile failed.", static_cast<LONG>(::GetLastError()));
+        }
+
+        LARGE_INTEGER fileSize {};
+        if(!::GetFileSizeEx(hFile, &fileSize)) {
+            const auto error = static_cast<LONG>(::GetLastError());
+            ::CloseHandle(hFile);
+            throw Exceptions::RegistryException("GetFileSize failed.", error);
+        }
+
+        std::string text(static_cast<size_t>(fileSize.QuadPart), '\0');
+        size_t read = 0;
+        const LONG result = detail::ReadAll(hFile, reinterpret_cast<BYTE*>(&text[0]), text.size(), read);
+        ::CloseHandle(hFile);
+        if(result != ERROR_SUCCESS) {
+            throw Exceptions::RegistryException("ReadFile failed.", result);
+        }
+        text.resize(read);
+
+        return Parse(text);
+    }
+
+    //
+    // RegistryPrefetchRecorder
+    //
+
+    RegistryPrefetchRecorder::RegistryPrefetchRecorder(std::chrono::milliseconds window)
+      : _end(std::chrono::steady_clock::now() + window) {}
+
+    bool RegistryPrefetchRecorder::IsRecording() const noexcept {
+        return !_stopped.load(std::memory_order_relaxed) && std::chrono::steady_clock::now() < _end;
+    }
+
+    RegistryPrefetchProfile RegistryPrefetchRecorder::GetProfile() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _profile;
+    }
+
+    bool RegistryPrefetchRecorder::Record(const std::string& keyName, const std::string& valueName) {
+        if(!IsRecording()) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _profile.Add(keyName, valueName);
+        return true;
+    }
+
+    void RegistryPrefetchRecorder::Stop() noexcept {
+        _stopped.store(true, std::memory_order_relaxed);
+    }
+
+    //
+    // RegistryPrefetcher
+    //
+
+    double RegistryPrefetcher::Statistics::GetHitRate() const noexcept {
+        const size_t reads = hits + misses;
+        return reads != 0 ? static_cast<double>(hits) / reads : 0;
+    }
+
+    RegistryPrefetcher::RegistryPrefetcher(RegistrySettingsStore& store, RegistryIoPool& pool, RegistryPrefetchRecorder* recorder)
+      : _store(store)
+      , _pool(pool)
+      , _recorder(recorder) {}
+
+    RegistryPrefetcher::~RegistryPrefetcher() noexcept {
+        // The queued reads use the store
+        Wait();
+    }
+
+    RegistryPrefetcher::Statistics RegistryPrefetcher::GetStatistics() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _statistics;
+    }
+
+    void RegistryPrefetcher::Start(const RegistryPrefetchProfile& profile) {
+
+        // Group the values by key, keeping the keys in the order of the profile
+        std::vector<std::pair<std::string, std::vector<std::string>>> reads;
+        std::map<std::string_view, size_t, Name::Less> indexes;
+        for(const auto& entry : profile.GetEntries()) {
+            const auto index = indexes.emplace(entry.first, reads.size());
+            if(index.second) {
+                reads.emplace_back(entry.first, std::vector<std::string>());
+            }
+            reads[index.first->second].second.push_back(entry.second);
+        }
+
+        for(auto& read : reads) {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                const auto key = _keys.emplace(read.first, Key());
+                if(!key.second) {
+                    // Already prefetched by a previous Start
+                    continue;
+                }
+                for(size_t i = 0; i < read.second.size(); ++i) {
+                    key.first->second.values.emplace(read.second[i], std::make_pair(i, false));
+                }
+                _statistics.prefetched += read.second.size();
+            }
+
+            // Post outside of the lock: it blocks while the pool queue is full
+            auto result = _pool
+                            .Submit([&store = _store, keyName = read.first, valueNames = std::move(read.second)] {
+                                return store.ReadValues(keyName, valueNames);
+                            })
+                            .share();
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            const auto key = _keys.find(read.first);
+            if(key != _keys.end()) {
+                key->second.result = std::move(result);
+            }
+        }
+    }
+
+    void RegistryPrefetcher::Wait() const {
+        std::vector<std::shared_future<std::vector<RegistryValue>>> results;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            results.reserve(_keys.size());
+            for(const auto& key : _keys) {
+                if(key.second.result.valid()) {
+                    results.push_back(key.second.result);
+                }
+            }
+        }
+
+        for(const auto& result : results) {
+            result.wait();
+        }
+    }
+
+    RegistryValue RegistryPrefetcher::GetValue(const std::string& keyName, const std::string& valueName) {
+        if(_recorder != nullptr) {
+            _recorder->Record(keyName, valueName);
+        }
+
+        std::shared_future<std::vector<RegistryValue>> result;
+        size_t index = 0;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            const auto key = _keys.find(Name::Normalize(keyName));
+            if(key != _keys.end()) {
+                const auto value = key->second.values.find(valueName);
+                // Only the first read is answered: the later ones must see the changes
+                if(key->second.result.valid() && value != key->second.values.end() && !value->second.second) {
+                    value->second.second = true;
+                    index = value->second.first;
+                    result = key->second.result;
+                }
+            }
+        }
+
+        if(result.valid()) {
+            const bool ready = result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+            try {
+                RegistryValue value = result.get()[index];
+
+                std::lock_guard<std::mutex> lock(_mutex);
+                ++_statistics.hits;
+                _statistics.waits += ready ? 0 : 1;
+                return value;
+            }
+            catch(const std::exception&) {
+                // The prefetch read failed, read again below
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            ++_statistics.misses;
+        }
+
+        return _store.ReadValues(keyName, {valueName}).front();
+    }
+
+    void RegistryPrefetcher::Clear() {
+        Wait();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _keys.clear();
+    }
+
+
+} // namespace registry
+} // namespace abscodes
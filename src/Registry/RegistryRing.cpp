@@ -0,0 +1,194 @@
+//===--- RegistryRing.cpp ------------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+#include "Registry/RegistryRing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+#include "Registry/RegistryException.h"
+
+namespace abscodes {
+namespace registry {
+
+    RegistryRing::RegistryRing(RegistryKey root, size_t capacity, size_t batchSize, size_t handleCacheSize)
+      : _root(std::move(root))
+      , _submissions(capacity)
+      , _completions(capacity)
+      , _batchSize(batchSize > 0 ? batchSize : 1)
+      , _handleCacheSize(handleCacheSize) {
+
+        _ASSERTE(_root.IsValid());
+
+        _worker = std::thread(&RegistryRing::Run, this);
+    }
+
+    RegistryRing::~RegistryRing() noexcept {
+        _stop.store(true);
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _wakeUp.notify_one();
+        }
+        if(_worker.joinable()) {
+            _worker.join();
+        }
+    }
+
+    RegistryRing::Statistics RegistryRing::GetStatistics() const noexcept {
+        Statistics statistics;
+        statistics.submitted = _submitted.load();
+        statistics.completed = _completed.load();
+        statistics.batches = _batches.load();
+        statistics.handleHits = _handleHits.load();
+        statistics.handleMisses = _handleMisses.load();
+        return statistics;
+    }
+
+    bool RegistryRing::TrySubmit(RegistrySubmission& submission) {
+        if(!_submissions.TryPush(submission)) {
+            return false;
+        }
+
+        ++_submitted;
+        Notify();
+        return true;
+    }
+
+    void RegistryRing::Submit(RegistrySubmission submission) {
+        while(!TrySubmit(submission)) {
+            std::this_thread::yield();
+        }
+    }
+
+    bool RegistryRing::TryPoll(RegistryCompletion& completion) {
+        return _completions.TryPop(completion);
+    }
+
+    RegistryCompletion RegistryRing::Poll() {
+        RegistryCompletion completion;
+        while(!TryPoll(completion)) {
+            std::this_thread::yield();
+        }
+        return completion;
+    }
+
+    void RegistryRing::Run() {
+        // Normalized key path, and operation
+        std::vector<std::pair<std::string, RegistrySubmission>> batch;
+        batch.reserve(_batchSize);
+
+        RegistrySubmission submission;
+
+        for(;;) {
+            batch.clear();
+            while(batch.size() < _batchSize && _submissions.TryPop(submission)) {
+                std::string keyName = Name::Normalize(submission.keyName);
+                batch.emplace_back(std::move(keyName), std::move(submission));
+            }
+
+            if(batch.empty()) {
+                // Submitted operations are processed before stopping
+                if(_stop.load()) {
+                    return;
+                }
+
+                // Announced before checking the ring: either the check sees the submission, or its producer sees
+                // the worker sleeping and notifies under the mutex
+                std::unique_lock<std::mutex> lock(_mutex);
+                _sleeping.store(true);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                _wakeUp.wait(lock, [this] { return !_submissions.IsEmpty() || _stop.load(); });
+                _sleeping.store(false);
+                continue;
+            }
+
+            ++_batches;
+
+            // Group by key, so each handle is looked up once per run of operations
+            std::stable_sort(batch.begin(), batch.end(), [](const auto& lhs, const auto& rhs) { return Name::Compare(lhs.first, rhs.first) < 0; });
+
+            for(auto& entry : batch) {
+                RegistryCompletion completion;
+                Process(entry.first, entry.second, completion);
+
+                // Back pressure, unless nobody will poll anymore
+                bool pushed;
+                while(!(pushed = _completions.TryPush(completion)) && !_stop.load()) {
+                    std::this_thread::yield();
+                }
+                if(pushed) {
+                    ++_completed;
+                }
+            }
+        }
+    }
+
+    void RegistryRing::Process(const std::string& keyName, RegistrySubmission& submission, RegistryCompletion& completion) {
+        completion.opcode = submission.opcode;
+        completion.userData = submission.userData;
+
+        try {
+            switch(submission.opcode) {
+                case RegistryOpcode::OpenKey: Acquire(keyName, false); break;
+                case RegistryOpcode::CreateKey: Acquire(keyName, true); break;
+                case RegistryOpcode::GetValue: completion.value = Acquire(keyName, false).GetValue(submission.valueName); break;
+                case RegistryOpcode::SetValue: Acquire(keyName, true).SetValue(submission.valueName, submission.value); break;
+                case RegistryOpcode::DeleteValue: Acquire(keyName, false).DeleteValue(submission.valueName); break;
+                case RegistryOpcode::EnumSubKeys: completion.subKeys = Acquire(keyName, false).EnumSubKeys(); break;
+                case RegistryOpcode::EnumValues: completion.values = Acquire(keyName, false).EnumValues(); break;
+                default: throw std::invalid_argument("Unknown registry opcode.");
+            }
+        }
+        catch(const Exceptions::RegistryException& e) {
+            completion.errorCode = e.ErrorCode();
+            completion.message = e.what();
+        }
+        catch(const std::exception& e) {
+            completion.errorCode = ERROR_INVALID_PARAMETER;
+            completion.message = e.what();
+        }
+    }
+
+    RegistryKey& RegistryRing::Acquire(const std::string& keyName, bool create) {
+        if(keyName.empty()) {
+            return _root;
+        }
+
+        const auto it = _handles.find(keyName);
+        if(it != _handles.end()) {
+            ++_handleHits;
+            return it->second;
+        }
+
+        ++_handleMisses;
+
+        RegistryKey key = create ? _root.CreateSubKey(keyName) : _root.OpenSubKey(keyName);
+
+        // Crude eviction, the cache is meant to hold the working set of a bulk job
+        if(_handles.size() >= _handleCacheSize) {
+            _handles.clear();
+        }
+
+        return _handles.emplace(keyName, std::move(key)).first->second;
+    }
+
+    void RegistryRing::Notify() {
+        // Pairs with the fence of the worker: the push is visible to it, or the flag to us
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(_sleeping.load()) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _wakeUp.notify_one();
+        }
+    }
+
+} // namespace registry
+} // namespace abscodes
@@ -0,0 +1,119 @@
+//===--- RegistrySettings.cpp --------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+#include "Registry/RegistrySettings.h"
+
+#include "Registry/RegistryException.h"
+
+namespace abscodes {
+namespace registry {
+
+    //
+    // RegistryKeyStore
+    //
+
+    RegistryKeyStore::RegistryKeyStore(RegistryKey& root) noexcept
+      : _root(root) {}
+
+    size_t RegistryKeyStore::GetReadCount() const noexcept {
+        return _reads;
+    }
+
+    std::vector<RegistryValue> RegistryKeyStore::ReadValues(const std::string& keyName, const std::vector<std::string>& valueNames) {
+
+        _ASSERTE(_root.IsValid());
+
+        ++_reads;
+
+        const std::string path = Name::Normalize(keyName);
+        if(path.empty()) {
+            return _root.GetValues(valueNames);
+        }
+
+        RegistryKey key;
+        try {
+            key = _root.OpenSubKey(path, RegistryAccessRights::Read);
+        }
+        catch(const Exceptions::RegistryException& e) {
+            if(e.ErrorCode() != ERROR_FILE_NOT_FOUND) {
+                throw;
+            }
+            // A missing key holds no value
+            return std::vector<RegistryValue>(valueNames.size());
+        }
+
+        return key.GetValues(valueNames);
+    }
+
+    std::vector<RegistryWriteBatch::Failure> RegistryKeyStore::Commit(RegistryWriteBatch& batch) {
+        return batch.Commit(_root);
+    }
+
+    //
+    // MemorySettingsStore
+    //
+
+    size_t MemorySettingsStore::GetReadCount() const noexcept {
+        return _reads;
+    }
+
+    size_t MemorySettingsStore::GetWriteCount() const noexcept {
+        return _writes;
+    }
+
+    RegistryValue MemorySettingsStore::GetValue(const std::string& keyName, const std::string& valueName) const {
+        const auto key = _keys.find(Name::Normalize(keyName));
+        if(key == _keys.end()) {
+            return RegistryValue();
+        }
+
+        const auto value = key->second.find(valueName);
+        return value != key->second.end() ? value->second : RegistryValue();
+    }
+
+    void MemorySettingsStore::SetValue(const std::string& keyName, const std::string& valueName, const RegistryValue& value) {
+        _keys[Name::Normalize(keyName)][valueName] = value;
+    }
+
+    std::vector<RegistryValue> MemorySettingsStore::ReadValues(const std::string& keyName, const std::vector<std::string>& valueNames) {
+        ++_reads;
+
+        std::vector<RegistryValue> values;
+        values.reserve(valueNames.size());
+        for(const auto& valueName : valueNames) {
+            values.push_back(GetValue(keyName, valueName));
+        }
+        return values;
+    }
+
+    std::vector<RegistryWriteBatch::Failure> MemorySettingsStore::Commit(RegistryWriteBatch& batch) {
+        batch.ForEach([this](const std::string& keyName, const std::string& valueName, const RegistryValue* value) {
+            if(value != nullptr) {
+                _keys[keyName][valueName] = *value;
+            }
+            else {
+                // Like the registry store, deleting from a missing key creates nothing
+                const auto key = _keys.find(keyName);
+                if(key != _keys.end()) {
+                    key->second.erase(valueName);
+                }
+            }
+            ++_writes;
+        });
+
+        batch.Clear();
+
+        return {};
+    }
+
+
+} // namespace registry
+} // namespace abscodes
@@ -0,0 +1,329 @@
+//===--- RegistrySharedSnapshot.cpp --------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+#include "Registry/RegistrySharedSnapshot.h"
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+
+#include "Registry/RegistryException.h"
+#include "RegistryUtils.h"
+
+namespace abscodes {
+namespace registry {
+
+    namespace {
+
+        /// "RSHM", first bytes of a segment
+        constexpr uint32_t Magic = 0x4D485352;
+        /// Version of the segment layout
+        constexpr uint32_t Version = 1;
+
+        ///
+        /// Header of a segment, followed by the two slots.
+        ///
+        /// The sequence number is even while no publication is in progress. Version v of the image, published
+        /// when the sequence reaches 2v, lives in slot v % 2: writing version v + 1 never touches it, writing
+        /// version v + 2 starts by moving the sequence to 2v + 3.
+        ///
+        struct SegmentHeader {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t capacity;
+            std::atomic<uint64_t> sequence;
+            std::atomic<uint64_t> sizes[2];
+            uint64_t reserved[3];
+        };
+
+        static_assert(sizeof(SegmentHeader) == 64, "The segment header is 64 bytes.");
+        static_assert(std::atomic<uint64_t>::is_always_lock_free, "The sequence must be lock-free to be shared between processes.");
+
+        size_t Align(size_t size) noexcept {
+            return (size + 7) & ~size_t(7);
+        }
+
+        const SegmentHeader& HeaderOf(const BYTE* segment) noexcept {
+            return *reinterpret_cast<const SegmentHeader*>(segment);
+        }
+
+        SegmentHeader& HeaderOf(BYTE* segment) noexcept {
+            return *reinterpret_cast<SegmentHeader*>(segment);
+        }
+
+        size_t SlotOffset(uint64_t capacity, uint64_t version) noexcept {
+            return sizeof(SegmentHeader) + static_cast<size_t>(version % 2) * Align(static_cast<size_t>(capacity));
+        }
+
+        /// Does the region hold a segment header, of this layout, whose slots fit in the region?
+        bool IsSegment(const BYTE* segment, size_t size) noexcept {
+            if(segment == nullptr || reinterpret_cast<uintptr_t>(segment) % 8 != 0 || size < sizeof(SegmentHeader)) {
+                return false;
+            }
+            const SegmentHeader& header = HeaderOf(segment);
+            return header.magic == Magic && header.version == Version && header.capacity % 8 == 0
+                   && header.capacity <= (size - sizeof(SegmentHeader)) / 2;
+        }
+
+        /// Size of a mapped view, from the pages it spans; 0 if it cannot be queried
+        size_t ViewSize(const void* view) noexcept {
+            MEMORY_BASIC_INFORMATION info {};
+            return ::VirtualQuery(view, &info, sizeof(info)) == sizeof(info) ? info.RegionSize : 0;
+        }
+
+    } // namespace
+
+    //
+    // RegistrySharedPublisher
+    //
+
+    RegistrySharedPublisher::RegistrySharedPublisher(const std::string& name, size_t capacity) {
+        const uint64_t size = GetSegmentSize(capacity);
+        const std::wstring wName = detail::Widen(name);
+
+        _hMapping = ::CreateFileMappingW(INVALID_HANDLE_VALUE, // backed by the paging file
+                                         nullptr, // default security attributes
+                                         PAGE_READWRITE, //
+                                         static_cast<DWORD>(size >> 32), //
+                                         static_cast<DWORD>(size), //
+                                         wName.c_str() //
+        );
+        if(_hMapping == nullptr) {
+            throw Exceptions::RegistryException(name, "CreateFileMapping failed.", static_cast<LONG>(::GetLastError()));
+        }
+        // The readers keep the mapping of a publisher that restarts
+        const bool existing = ::GetLastError() == ERROR_ALREADY_EXISTS;
+
+        // Map the whole mapping: an existing one may be larger than requested
+        _segment = static_cast<BYTE*>(::MapViewOfFile(_hMapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+        if(_segment == nullptr) {
+            const auto error = static_cast<LONG>(::GetLastError());
+            Dispose();
+            throw Exceptions::RegistryException(name, "MapViewOfFile failed.", error);
+        }
+
+        if(existing) {
+            // Carry on from the last version published, so that the readers don't notice the restart
+            if(IsSegment(_segment, ViewSize(_segment)) && HeaderOf(_segment).capacity >= Align(capacity)) {
+                return;
+            }
+            Dispose();
+            throw Exceptions::RegistryException(name, "Shared registry snapshot segment has another layout.", ERROR_ALREADY_EXISTS);
+        }
+
+        Initialize(capacity);
+    }
+
+    RegistrySharedPublisher::RegistrySharedPublisher(void* memory, size_t size)
+      : _segment(static_cast<BYTE*>(memory)) {
+        if(memory == nullptr || reinterpret_cast<uintptr_t>(memory) % 8 != 0 || size < GetSegmentSize(0)) {
+            throw std::invalid_argument("The shared registry snapshot segment is too small or not aligned.");
+        }
+
+        // Two slots, each aligned on 8 bytes
+        Initialize(((size - sizeof(SegmentHeader)) / 2) & ~size_t(7));
+    }
+
+    RegistrySharedPublisher::~RegistrySharedPublisher() noexcept {
+        Dispose();
+    }
+
+    size_t RegistrySharedPublisher::GetSegmentSize(size_t capacity) noexcept {
+        return sizeof(SegmentHeader) + 2 * Align(capacity);
+    }
+
+    size_t RegistrySharedPublisher::GetCapacity() const noexcept {
+        return static_cast<size_t>(HeaderOf(_segment).capacity);
+    }
+
+    unsigned long long RegistrySharedPublisher::GetVersion() const noexcept {
+        return HeaderOf(_segment).sequence.load(std::memory_order_relaxed) / 2;
+    }
+
+    void RegistrySharedPublisher::Publish(const std::vector<BYTE>& image) {
+        SegmentHeader& header = HeaderOf(_segment);
+        if(image.size() > header.capacity) {
+            throw std::length_error("The registry snapshot exceeds the capacity of the shared segment.");
+        }
+
+        // Only the publisher moves the sequence; it is odd if a previous publisher died while publishing
+        const uint64_t sequence = header.sequence.load(std::memory_order_relaxed);
+        const uint64_t version = sequence / 2 + 1;
+
+        // Tell the readers of version - 1 that its slot is being overwritten
+        header.sequence.store(2 * version - 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        header.sizes[version % 2].store(image.size(), std::memory_order_relaxed);
+        std::memcpy(_segment + SlotOffset(header.capacity, version), image.data(), image.size());
+
+        header.sequence.store(2 * version, std::memory_order_release);
+    }
+
+    void RegistrySharedPublisher::Publish(const RegistrySnapshotBuilder& builder) {
+        Publish(builder.Build());
+    }
+
+    void RegistrySharedPublisher::Publish(const RegistryKey& key) {
+        RegistrySnapshotBuilder builder;
+        builder.AddTree(key);
+        Publish(builder);
+    }
+
+    void RegistrySharedPublisher::Initialize(size_t capacity) {
+        SegmentHeader* header = new(_segment) SegmentHeader {};
+        header->version = Version;
+        header->capacity = capacity;
+        header->sequence.store(0, std::memory_order_relaxed);
+        header->sizes[0].store(0, std::memory_order_relaxed);
+        header->sizes[1].store(0, std::memory_order_relaxed);
+
+        // Readers check the magic first
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic = Magic;
+    }
+
+    void RegistrySharedPublisher::Dispose() noexcept {
+        if(_hMapping != nullptr) {
+            if(_segment != nullptr) {
+                ::UnmapViewOfFile(_segment);
+            }
+            ::CloseHandle(_hMapping);
+            _hMapping = nullptr;
+        }
+        _segment = nullptr;
+    }
+
+    //
+    // RegistrySharedReader
+    //
+
+    RegistrySharedReader::RegistrySharedReader(const std::string& name) {
+        const std::wstring wName = detail::Widen(name);
+
+        _hMapping = ::OpenFileMappingW(FILE_MAP_READ, FALSE, wName.c_str());
+        if(_hMapping == nullptr) {
+            throw Exceptions::RegistryException(name, "OpenFileMapping failed.", static_cast<LONG>(::GetLastError()));
+        }
+
+        // Map the whole segment, and check the header against the size actually mapped
+        _segment = static_cast<const BYTE*>(::MapViewOfFile(_hMapping, FILE_MAP_READ, 0, 0, 0));
+        if(_segment == nullptr) {
+            const auto error = static_cast<LONG>(::GetLastError());
+            Dispose();
+            throw Exceptions::RegistryException(name, "MapViewOfFile failed.", error);
+        }
+
+        try {
+            Validate(ViewSize(_segment));
+        }
+        catch(...) {
+            Dispose();
+            throw;
+        }
+    }
+
+    RegistrySharedReader::RegistrySharedReader(const void* memory, size_t size)
+      : _segment(static_cast<const BYTE*>(memory)) {
+        Validate(size);
+    }
+
+    RegistrySharedReader::~RegistrySharedReader() noexcept {
+        Dispose();
+    }
+
+    unsigned long long RegistrySharedReader::GetVersion() const noexcept {
+        return HeaderOf(_segment).sequence.load(std::memory_order_acquire) / 2;
+    }
+
+    unsigned long long RegistrySharedReader::GetSnapshotVersion() const noexcept {
+        return _version;
+    }
+
+    unsigned long long RegistrySharedReader::GetRetryCount() const noexcept {
+        return _retries;
+    }
+
+    bool RegistrySharedReader::Refresh() {
+        const SegmentHeader& header = HeaderOf(_segment);
+
+        // Each image gets its own buffer, kept alive by its keys: a refresh never invalidates them
+        std::shared_ptr<uint64_t[]> copy;
+        size_t copyWords = 0;
+
+        for(;;) {
+            const uint64_t sequence = header.sequence.load(std::memory_order_acquire);
+
+            // An odd sequence is a publication in progress, into the other slot
+            const uint64_t version = sequence / 2;
+            if(version == _version) {
+                return false;
+            }
+
+            // Copy into a new buffer: the current image stays readable if this one is invalid
+            const uint64_t size = header.sizes[version % 2].load(std::memory_order_relaxed);
+            if(size <= header.capacity) {
+                const size_t words = static_cast<size_t>((size + 7) / 8);
+                if(words > copyWords) {
+                    copy.reset(new uint64_t[words]);
+                    copyWords = words;
+                }
+                std::memcpy(copy.get(), _segment + SlotOffset(header.capacity, version), static_cast<size_t>(size));
+            }
+
+            // The slot is overwritten once the publication of version + 2 starts
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(header.sequence.load(std::memory_order_relaxed) >= 2 * version + 3 || size > header.capacity) {
+                ++_retries;
+                continue;
+            }
+
+            // The previous image is freed with the last of its keys
+            _snapshot = RegistrySnapshot(std::shared_ptr<const BYTE>(copy, reinterpret_cast<const BYTE*>(copy.get())), static_cast<size_t>(size));
+            _version = version;
+            return true;
+        }
+    }
+
+    const RegistrySnapshot& RegistrySharedReader::Snapshot() const noexcept {
+        return _snapshot;
+    }
+
+    SnapshotKey RegistrySharedReader::Root() const {
+        return _snapshot.Root();
+    }
+
+    SnapshotKey RegistrySharedReader::OpenKey(std::string_view keyName) const {
+        return _snapshot.OpenKey(keyName);
+    }
+
+    void RegistrySharedReader::Validate(size_t size) const {
+        if(!IsSegment(_segment, size)) {
+            throw Exceptions::RegistryException("Invalid shared registry snapshot segment.", ERROR_INVALID_DATA);
+        }
+    }
+
+    void RegistrySharedReader::Dispose() noexcept {
+        if(_hMapping != nullptr) {
+            if(_segment != nullptr) {
+                ::UnmapViewOfFile(_segment);
+            }
+            ::CloseHandle(_hMapping);
+            _hMapping = nullptr;
+        }
+        _segment = nullptr;
+    }
+
+
+} // namespace registry
+} // namespace abscodes
@@ -0,0 +1,1010 @@
+//===--- RegistrySnapshot.cpp --------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+#include "Registry/RegistrySnapshot.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+
+#include "Registry/RegistryException.h"
+#include "RegistryUtils.h"
+
+namespace abscodes {
+namespace registry {
+
+    namespace {
+
+        /// "ARSN", little-endian
+        constexpr uint32_t Magic = 0x4E535241;
+        constexpr uint32_t Version = 1;
+
+        /// Parent of the root key
+        constexpr uint32_t NoKey = 0xFFFFFFFF;
+
+        /// Alignment of the sections and of the payloads
+        constexpr size_t Alignment = 8;
+
+        /// Number of keys or values hashed to the same bucket of an index, on average
+        constexpr size_t BucketSize = 4;
+
+        /// Most seeds tried for a bucket of an index
+        constexpr uint32_t MaxSeed = 1u << 24;
+
+        ///
+        /// Header of an image. Offsets are from the start of the image.
+        ///
+        struct Header {
+            uint32_t magic;
+            uint32_t version;
+            /// FNV-1a checksum of the header, computed with this field set to zero
+            uint32_t checksum;
+            uint32_t keyCount;
+            uint32_t valueCount;
+            uint32_t keyBuckets;
+            uint32_t valueBuckets;
+            uint32_t reserved;
+            /// Size of the image
+            uint64_t size;
+            /// KeyRecord[keyCount]
+            uint64_t keys;
+            /// ValueRecord[valueCount]
+            uint64_t values;
+            /// Seed of each bucket of the key index, uint32_t[keyBuckets]
+            uint64_t keySeeds;
+            /// Key of each slot of the key index, uint32_t[keyCount]
+            uint64_t keySlots;
+            /// Seed of each bucket of the value index, uint32_t[valueBuckets]
+            uint64_t valueSeeds;
+            /// Value of each slot of the value index, uint32_t[valueCount]
+            uint64_t valueSlots;
+            /// UTF-8 names
+            uint64_t strings;
+            uint64_t stringsSize;
+        };
+
+        /// A key; its subkeys, and its values, are contiguous
+        struct KeyRecord {
+            /// Path, in the strings
+            uint32_t pathOffset;
+            uint32_t pathLength;
+            /// Length of the name, at the end of the path
+            uint32_t nameLength;
+            uint32_t parent;
+            uint32_t firstChild;
+            uint32_t childCount;
+            uint32_t firstValue;
+            uint32_t valueCount;
+            uint64_t lastWriteTime;
+        };
+
+        /// A value
+        struct ValueRecord {
+            uint32_t key;
+            /// Name, in the strings
+            uint32_t nameOffset;
+            uint32_t nameLength;
+            /// REG_* type
+            uint32_t type;
+            /// Payload, from the start of the image
+            uint64_t dataOffset;
+            uint32_t dataSize;
+            uint32_t reserved;
+        };
+
+        static_assert(sizeof(Header) % Alignment == 0 && sizeof(KeyRecord) % Alignment == 0 && sizeof(ValueRecord) % Alignment == 0,
+                      "Records must keep the sections aligned.");
+
+        size_t Align(size_t size) noexcept {
+            return (size + Alignment - 1) & ~(Alignment - 1);
+        }
+
+        /// FNV-1a checksum of the header, without its checksum
+        uint32_t Checksum(const Header& header) noexcept {
+            Header copy = header;
+            copy.checksum = 0;
+
+            uint32_t hash = 2166136261u;
+            const auto bytes = reinterpret_cast<const BYTE*>(&copy);
+            for(size_t i = 0; i < sizeof(copy); ++i) {
+                hash ^= bytes[i];
+                hash *= 16777619u;
+            }
+            return hash;
+        }
+
+        ///
+        /// Seeded, case-insensitive FNV-1a hash, finalized with the MurmurHash3 mixer.
+        ///
+        class Hasher
+        {
+        public:
+            explicit Hasher(uint32_t seed) noexcept
+              : _hash(14695981039346656037ULL ^ (seed * 0x9E3779B97F4A7C15ULL)) {}
+
+            void AddByte(BYTE byte) noexcept {
+                _hash ^= byte;
+                _hash *= 1099511628211ULL;
+            }
+
+            void AddChar(char c) noexcept {
+                AddByte(static_cast<BYTE>(Name::Fold(c)));
+            }
+
+            uint64_t Get() const noexcept {
+                uint64_t h = _hash;
+                h ^= h >> 33;
+                h *= 0xFF51AFD7ED558CCDULL;
+                h ^= h >> 33;
+                h *= 0xC4CEB9FE1A85EC53ULL;
+                h ^= h >> 33;
+                return h;
+            }
+
+        private:
+            uint64_t _hash;
+        };
+
+        ///
+        /// Call f with each character of the path "parent\subkey", normalized like Name::Normalize does,
+        /// without building it: the backslashes are collapsed, the leading and trailing ones removed.
+        ///
+        template <typename F>
+        void ForEachPathChar(std::string_view parent, std::string_view subkey, F&& f) {
+            bool any = false;
+            bool pending = false;
+            const auto feed = [&](char c) {
+                if(c == '\\') {
+                    pending = any;
+                    return;
+                }
+                if(pending) {
+                    f('\\');
+                    pending = false;
+                }
+                f(c);
+                any = true;
+            };
+
+            for(const char c : parent) {
+                feed(c);
+            }
+            feed('\\');
+            for(const char c : subkey) {
+                feed(c);
+            }
+        }
+
+        uint64_t KeyHash(uint32_t seed, std::string_view parent, std::string_view subkey) noexcept {
+            Hasher hasher(seed);
+            ForEachPathChar(parent, subkey, [&](char c) { hasher.AddChar(c); });
+            return hasher.Get();
+        }
+
+        uint64_t ValueHash(uint32_t seed, uint32_t key, std::string_view valueName) noexcept {
+            Hasher hasher(seed);
+            for(int shift = 0; shift < 32; shift += 8) {
+                hasher.AddByte(static_cast<BYTE>(key >> shift));
+            }
+            for(const char c : valueName) {
+                hasher.AddChar(c);
+            }
+            return hasher.Get();
+        }
+
+        ///
+        /// Build a minimal perfect hash index, by hash and displace.
+        ///
+        /// Items are spread into buckets by hash(item, 0); then, from the largest bucket down, each bucket
+        /// gets the first seed placing all its items into free slots by hash(item, seed). A lookup costs two
+        /// hashes and one comparison, whatever the number of items.
+        ///
+        void BuildIndex(size_t count, const std::function<uint64_t(size_t, uint32_t)>& hash, std::vector<uint32_t>& seeds, std::vector<uint32_t>& slots) {
+            seeds.clear();
+            slots.assign(count, NoKey);
+            if(count == 0) {
+                return;
+            }
+
+            const size_t bucketCount = count / BucketSize + 1;
+            seeds.assign(bucketCount, 0);
+
+            std::vector<std::vector<uint32_t>> buckets(bucketCount);
+            for(size_t item = 0; item < count; ++item) {
+                buckets[hash(item, 0) % bucketCount].push_back(static_cast<uint32_t>(item));
+            }
+
+            std::vector<uint32_t> order(bucketCount);
+            for(uint32_t i = 0; i < bucketCount; ++i) {
+                order[i] = i;
+            }
+            std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+            std::vector<size_t> positions;
+            for(const uint32_t bucket : order) {
+                const auto& items = buckets[bucket];
+                if(items.empty()) {
+                    break;
+                }
+
+                for(uint32_t seed = 1;; ++seed) {
+                    if(seed == MaxSeed) {
+                        throw std::runtime_error("Cannot build the perfect hash index of the snapshot.");
+                    }
+
+                    positions.clear();
+                    bool placed = true;
+                    for(const uint32_t item : items) {
+                        const size_t position = hash(item, seed) % count;
+                        if(slots[position] != NoKey || std::find(positions.begin(), positions.end(), position) != positions.end()) {
+                            placed = false;
+                            break;
+                        }
+                        positions.push_back(position);
+                    }
+
+                    if(placed) {
+                        for(size_t i = 0; i < items.size(); ++i) {
+                            slots[positions[i]] = items[i];
+                        }
+                        seeds[bucket] = seed;
+                        break;
+                    }
+                }
+            }
+        }
+
+        /// Is the type one a snapshot can hold?
+        bool IsSupported(RegistryValueType type) noexcept {
+            switch(type) {
+                case RegistryValueType::DWord:
+                case RegistryValueType::DWordBigEndian:
+                case RegistryValueType::QWord:
+                case RegistryValueType::String:
+                case RegistryValueType::ExpandString:
+                case RegistryValueType::MultiString:
+                case RegistryValueType::Binary: return true;
+                default: return false;
+            }
+        }
+
+        /// Is the payload of the type followed by a NUL?
+        bool IsText(RegistryValueType type) noexcept {
+            return type == RegistryValueType::String || type == RegistryValueType::ExpandString;
+        }
+
+        /// Append the payload of a value, aligned, and return its size
+        size_t AppendPayload(std::vector<BYTE>& payloads, const RegistryValue& value) {
+            payloads.resize(Align(payloads.size()));
+
+            const auto append = [&](const void* data, size_t size) {
+                const auto bytes = static_cast<const BYTE*>(data);
+                payloads.insert(payloads.end(), bytes, bytes + size);
+            };
+
+            switch(value.GetType()) {
+                case RegistryValueType::DWord:
+                case RegistryValueType::DWordBigEndian: {
+                    const DWORD data = value.DWord();
+                    append(&data, sizeof(data));
+                    return sizeof(data);
+                }
+                case RegistryValueType::QWord: {
+                    const ULONGLONG data = value.QWord();
+                    append(&data, sizeof(data));
+                    return sizeof(data);
+                }
+                case RegistryValueType::String:
+                case RegistryValueType::ExpandString: {
+                    const std::string& text = value.GetType() == RegistryValueType::String ? value.String() : value.ExpandString();
+                    append(text.c_str(), text.size() + 1);
+                    return text.size();
+                }
+                case RegistryValueType::MultiString: {
+                    size_t size = 0;
+                    for(const auto& text : value.MultiString()) {
+                        append(text.c_str(), text.size() + 1);
+                        size += text.size() + 1;
+                    }
+                    return size;
+                }
+                case RegistryValueType::Binary: append(value.Binary().data(), value.Binary().size()); return value.Binary().size();
+                default: throw std::invalid_argument("Unsupported registry value type.");
+            }
+        }
+
+        /// Check that count elements of the given size, at offset, fit in the image
+        bool Fits(uint64_t offset, uint64_t count, size_t elementSize, size_t size) noexcept {
+            return offset <= size && offset % Alignment == 0 && count <= (size - offset) / elementSize;
+        }
+
+        const Header& HeaderOf(const BYTE* data) noexcept {
+            return *reinterpret_cast<const Header*>(data);
+        }
+
+        const KeyRecord& KeyOf(const BYTE* data, uint32_t index) noexcept {
+            return reinterpret_cast<const KeyRecord*>(data + HeaderOf(data).keys)[index];
+        }
+
+        const ValueRecord& ValueOf(const BYTE* data, uint32_t index) noexcept {
+            return reinterpret_cast<const ValueRecord*>(data + HeaderOf(data).values)[index];
+        }
+
+        const uint32_t* ArrayOf(const BYTE* data, uint64_t offset) noexcept {
+            return reinterpret_cast<const uint32_t*>(data + offset);
+        }
+
+        std::string_view StringOf(const BYTE* data, uint32_t offset, uint32_t length) noexcept {
+            return std::string_view(reinterpret_cast<const char*>(data + HeaderOf(data).strings) + offset, length);
+        }
+
+        [[noreturn]] void ThrowInvalid() {
+            throw Exceptions::RegistryException("Invalid registry snapshot.", ERROR_INVALID_DATA);
+        }
+
+    } // namespace
+
+    //
+    // RegistrySnapshotBuilder
+    //
+
+    RegistrySnapshotBuilder::RegistrySnapshotBuilder() {
+        _keys.emplace(std::string(), Key());
+    }
+
+    size_t RegistrySnapshotBuilder::GetKeyCount() const noexcept {
+        return _keys.size();
+    }
+
+    size_t RegistrySnapshotBuilder::GetValueCount() const noexcept {
+        return _valueCount;
+    }
+
+    bool RegistrySnapshotBuilder::CanStore(RegistryValueType type) noexcept {
+        return IsSupported(type);
+    }
+
+    void RegistrySnapshotBuilder::AddKey(const std::string& keyName, FILETIME lastWriteTime) {
+        std::string path = Name::Normalize(keyName);
+
+        Key& key = _keys[path];
+        key.lastWriteTime = (static_cast<ULONGLONG>(lastWriteTime.dwHighDateTime) << 32) | lastWriteTime.dwLowDateTime;
+
+        // Add the missing parents
+        for(size_t separator = path.rfind('\\'); separator != std::string::npos; separator = path.rfind('\\')) {
+            path.resize(separator);
+            if(!_keys.emplace(path, Key()).second) {
+                break;
+            }
+        }
+    }
+
+    void RegistrySnapshotBuilder::SetValue(const std::string& keyName, const std::string& valueName, const RegistryValue& value) {
+        if(value.IsEmpty()) {
+            throw std::invalid_argument("Cannot write a REG_NONE value.");
+        }
+        if(!IsSupported(value.GetType())) {
+            throw std::invalid_argument("Unsupported registry value type.");
+        }
+
+        const std::string path = Name::Normalize(keyName);
+        if(_keys.find(path) == _keys.end()) {
+            AddKey(path);
+        }
+
+        auto& values = _keys[path].values;
+        auto it = values.find(valueName);
+        if(it != values.end()) {
+            it->second = value;
+        }
+        else {
+            values.emplace(valueName, value);
+            ++_valueCount;
+        }
+    }
+
+    void RegistrySnapshotBuilder::AddTree(const RegistryKey& key, const std::string& keyName) {
+        DWORD subKeyCount = 0;
+        DWORD valueCount = 0;
+        FILETIME lastWriteTime {};
+        key.QueryInfoKey(subKeyCount, valueCount, lastWriteTime);
+        AddKey(keyName, lastWriteTime);
+
+        for(const auto& value : key.EnumValues()) {
+            if(!IsSupported(value.second)) {
+                continue;
+            }
+            SetValue(keyName, value.first, key.GetValue(value.first));
+        }
+
+        for(const auto& subkey : key.EnumSubKeys()) {
+            const RegistryKey child = key.OpenSubKey(subkey, RegistryAccessRights::Read);
+            AddTree(child, keyName.empty() ? subkey : keyName + '\\' + subkey);
+        }
+    }
+
+    std::vector<BYTE> RegistrySnapshotBuilder::Build() const {
+
+        // Number the keys breadth-first, so that the subkeys of a key are contiguous
+        std::map<std::string_view, std::vector<std::string_view>, Name::Less> children;
+        for(const auto& key : _keys) {
+            if(!key.first.empty()) {
+                const size_t separator = key.first.rfind('\\');
+                const std::string_view path(key.first);
+                children[separator == std::string::npos ? std::string_view() : path.substr(0, separator)].push_back(path);
+            }
+        }
+
+        if(_keys.size() >= NoKey || _valueCount >= NoKey) {
+            throw std::length_error("Too many keys or values for a registry snapshot.");
+        }
+
+        std::vector<KeyRecord> keys;
+        keys.reserve(_keys.size());
+        std::vector<const Key*> keyData;
+        keyData.reserve(_keys.size());
+        std::vector<std::string_view> keyPaths;
+        keyPaths.reserve(_keys.size());
+
+        std::vector<ValueRecord> values;
+        values.reserve(_valueCount);
+
+        std::string strings;
+        std::vector<BYTE> payloads;
+
+        const auto addString = [&](std::string_view text) {
+            const size_t offset = strings.size();
+            strings.append(text);
+            if(strings.size() > (std::numeric_limits<uint32_t>::max)()) {
+                throw std::length_error("Too many names for a registry snapshot.");
+            }
+            return static_cast<uint32_t>(offset);
+        };
+
+        // The root first, then each level
+        const Key& root = _keys.find(std::string())->second;
+        keys.push_back(KeyRecord {addString(""), 0, 0, NoKey, 0, 0, 0, 0, root.lastWriteTime});
+        keyData.push_back(&root);
+        keyPaths.push_back(std::string_view());
+
+        for(uint32_t index = 0; index < keys.size(); ++index) {
+            keys[index].firstChild = static_cast<uint32_t>(keys.size());
+            const auto found = children.find(keyPaths[index]);
+            if(found != children.end()) {
+                for(const std::string_view child : found->second) {
+                    const Key& data = _keys.find(child)->second;
+                    const size_t separator = child.rfind('\\');
+                    const uint32_t nameLength = static_cast<uint32_t>(separator == std::string_view::npos ? child.size() : child.size() - separator - 1);
+                    keys.push_back(KeyRecord {addString(child), static_cast<uint32_t>(child.size()), nameLength, index, 0, 0, 0, 0, data.lastWriteTime});
+                    keyData.push_back(&data);
+                    keyPaths.push_back(child);
+                }
+                keys[index].childCount = static_cast<uint32_t>(found->second.size());
+            }
+
+            keys[index].firstValue = static_cast<uint32_t>(values.size());
+            keys[index].valueCount = static_cast<uint32_t>(keyData[index]->values.size());
+            for(const auto& value : keyData[index]->values) {
+                ValueRecord record {};
+                record.key = index;
+                record.nameLength = static_cast<uint32_t>(value.first.size());
+                record.nameOffset = addString(value.first);
+                record.type = static_cast<uint32_t>(value.second.GetType());
+                record.dataOffset = Align(payloads.size());
+                const size_t dataSize = AppendPayload(payloads, value.second);
+                if(dataSize > (std::numeric_limits<uint32_t>::max)()) {
+                    throw std::length_error("Value too large for a registry snapshot.");
+                }
+                record.dataSize = static_cast<uint32_t>(dataSize);
+                values.push_back(record);
+            }
+        }
+
+        // Perfect hash indexes
+        std::vector<uint32_t> keySeeds;
+        std::vector<uint32_t> keySlots;
+        BuildIndex(
+          keys.size(),
+          [&](size_t item, uint32_t seed) {
+              return KeyHash(seed, std::string_view(), std::string_view(strings).substr(keys[item].pathOffset, keys[item].pathLength));
+          },
+          keySeeds,
+          keySlots);
+
+        std::vector<uint32_t> valueSeeds;
+        std::vector<uint32_t> valueSlots;
+        BuildIndex(
+          values.size(),
+          [&](size_t item, uint32_t seed) {
+              return ValueHash(seed, values[item].key, std::string_view(strings).substr(values[item].nameOffset, values[item].nameLength));
+          },
+          valueSeeds,
+          valueSlots);
+
+        // Layout
+        Header header {};
+        header.magic = Magic;
+        header.version = Version;
+        header.keyCount = static_cast<uint32_t>(keys.size());
+        header.valueCount = static_cast<uint32_t>(values.size());
+        header.keyBuckets = static_cast<uint32_t>(keySeeds.size());
+        header.valueBuckets = static_cast<uint32_t>(valueSeeds.size());
+
+        size_t offset = sizeof(Header);
+        const auto place = [&](size_t size) {
+            const size_t start = offset;
+            offset = Align(offset + size);
+            return start;
+        };
+        header.keys = place(keys.size() * sizeof(KeyRecord));
+        header.values = place(values.size() * sizeof(ValueRecord));
+        header.keySeeds = place(keySeeds.size() * sizeof(uint32_t));
+        header.keySlots = place(keySlots.size() * sizeof(uint32_t));
+        header.valueSeeds = place(valueSeeds.size() * sizeof(uint32_t));
+        header.valueSlots = place(valueSlots.size() * sizeof(uint32_t));
+        header.strings = place(strings.size());
+        header.stringsSize = strings.size();
+        const size_t payloadOffset = place(payloads.size());
+        header.size = offset;
+
+        for(auto& value : values) {
+            value.dataOffset += payloadOffset;
+        }
+
+        header.checksum = Checksum(header);
+
+        std::vector<BYTE> image(offset);
+        const auto copy = [&](uint64_t at, const void* data, size_t size) {
+            if(size != 0) {
+                std::memcpy(image.data() + at, data, size);
+            }
+        };
+        copy(0, &header, sizeof(header));
+        copy(header.keys, keys.data(), keys.size() * sizeof(KeyRecord));
+        copy(header.values, values.data(), values.size() * sizeof(ValueRecord));
+        copy(header.keySeeds, keySeeds.data(), keySeeds.size() * sizeof(uint32_t));
+        copy(header.keySlots, keySlots.data(), keySlots.size() * sizeof(uint32_t));
+        copy(header.valueSeeds, valueSeeds.data(), valueSeeds.size() * sizeof(uint32_t));
+        copy(header.valueSlots, valueSlots.data(), valueSlots.size() * sizeof(uint32_t));
+        copy(header.strings, strings.data(), strings.size());
+        copy(payloadOffset, payloads.data(), payloads.size());
+
+        return image;
+    }
+
+    void RegistrySnapshotBuilder::Save(const std::string& fileName) const {
+        const std::vector<BYTE> image = Build();
+
+        const HANDLE hFile = detail::CreateFileForWriting(detail::Widen(fileName).c_str());
+        if(hFile == INVALID_HANDLE_VALUE) {
+            throw Exceptions::RegistryException("CreateFile failed.", static_cast<LONG>(::GetLastError()));
+        }
+
+        const LONG result = detail::WriteAll(hFile, image.data(), image.size());
+        ::CloseHandle(hFile);
+        if(result != ERROR_SUCCESS) {
+            throw Exceptions::RegistryException("WriteFile failed.", result);
+        }
+    }
+
+    void RegistrySnapshotBuilder::Clear() {
+        _keys.clear();
+        _keys.emplace(std::string(), Key());
+        _valueCount = 0;
+    }
+
+    //
+    // RegistrySnapshot
+    //
+
+    RegistrySnapshot::RegistrySnapshot(const void* data, size_t size)
+      : RegistrySnapshot(std::shared_ptr<const BYTE>(static_cast<const BYTE*>(data), [](const BYTE*) {}), size) {}
+
+    RegistrySnapshot::RegistrySnapshot(std::shared_ptr<const BYTE> data, size_t size)
+      : _data(std::move(data))
+      , _size(size) {
+        Validate();
+    }
+
+    RegistrySnapshot RegistrySnapshot::Open(const std::string& fileName) {
+        const std::wstring wFileName = detail::Widen(fileName);
+        const HANDLE hFile = detail::OpenFileForReading(wFileName.c_str());
+        if(hFile == INVALID_HANDLE_VALUE) {
+            throw Exceptions::RegistryException("CreateFile failed.", static_cast<LONG>(::GetLastError()));
+        }
+
+        LARGE_INTEGER fileSize {};
+        if(!::GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart < static_cast<long long>(sizeof(Header))) {
+            ::CloseHandle(hFile);
+            ThrowInvalid();
+        }
+
+        const HANDLE hMapping = ::CreateFileMappingW(hFile, //
+                                                     nullptr, // default security attributes
+                                                     PAGE_READONLY, //
+                                                     0, // size of the file
+                                                     0, //
+                                                     nullptr // no name
+        );
+        const auto mappingError = static_cast<LONG>(::GetLastError());
+        ::CloseHandle(hFile);
+        if(hMapping == nullptr) {
+            throw Exceptions::RegistryException("CreateFileMapping failed.", mappingError);
+        }
+
+        // The view keeps the mapping alive
+        const void* view = ::MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+        const auto viewError = static_cast<LONG>(::GetLastError());
+        ::CloseHandle(hMapping);
+        if(view == nullptr) {
+            throw Exceptions::RegistryException("MapViewOfFile failed.", viewError);
+        }
+
+        // The last of the snapshot and its keys unmaps the view
+        std::shared_ptr<const BYTE> data(static_cast<const BYTE*>(view), [](const BYTE* p) { ::UnmapViewOfFile(p); });
+        return RegistrySnapshot(std::move(data), static_cast<size_t>(fileSize.QuadPart));
+    }
+
+    RegistrySnapshot::RegistrySnapshot(RegistrySnapshot&& other) noexcept
+      : _data(std::move(other._data))
+      , _size(other._size) {
+        other._size = 0;
+    }
+
+    RegistrySnapshot& RegistrySnapshot::operator=(RegistrySnapshot&& other) noexcept {
+        // Prevent self-move-assign
+        if(this != &other) {
+            _data = std::move(other._data);
+            _size = other._size;
+            other._size = 0;
+        }
+        return *this;
+    }
+
+    RegistrySnapshot::~RegistrySnapshot() noexcept = default;
+
+    bool RegistrySnapshot::IsValid() const noexcept {
+        return _data != nullptr;
+    }
+
+    size_t RegistrySnapshot::GetKeyCount() const noexcept {
+        return IsValid() ? HeaderOf(_data.get()).keyCount : 0;
+    }
+
+    size_t RegistrySnapshot::GetValueCount() const noexcept {
+        return IsValid() ? HeaderOf(_data.get()).valueCount : 0;
+    }
+
+    size_t RegistrySnapshot::GetSize() const noexcept {
+        return _size;
+    }
+
+    SnapshotKey RegistrySnapshot::Root() const {
+        if(!IsValid()) {
+            throw Exceptions::RegistryException("Snapshot is empty.", ERROR_INVALID_HANDLE);
+        }
+        return SnapshotKey(_data, 0);
+    }
+
+    SnapshotKey RegistrySnapshot::OpenKey(std::string_view keyName) const {
+        return Root().OpenSubKey(keyName);
+    }
+
+    void RegistrySnapshot::Validate() const {
+        const BYTE* data = _data.get();
+        if(data == nullptr || _size < sizeof(Header) || reinterpret_cast<uintptr_t>(data) % Alignment != 0) {
+            ThrowInvalid();
+        }
+
+        const Header& header = HeaderOf(data);
+        if(header.magic != Magic || header.version != Version || header.checksum != Checksum(header) || header.size != _size) {
+            ThrowInvalid();
+        }
+
+        if(header.keyCount == 0 || header.keyCount == NoKey || header.valueCount == NoKey //
+           || header.keyBuckets == 0 || (header.valueCount != 0 && header.valueBuckets == 0) //
+           || !Fits(header.keys, header.keyCount, sizeof(KeyRecord), _size) //
+           || !Fits(header.values, header.valueCount, sizeof(ValueRecord), _size) //
+           || !Fits(header.keySeeds, header.keyBuckets, sizeof(uint32_t), _size) //
+           || !Fits(header.keySlots, header.keyCount, sizeof(uint32_t), _size) //
+           || !Fits(header.valueSeeds, header.valueBuckets, sizeof(uint32_t), _size) //
+           || !Fits(header.valueSlots, header.valueCount, sizeof(uint32_t), _size) //
+           || !Fits(header.strings, header.stringsSize, 1, _size)) {
+            ThrowInvalid();
+        }
+
+        // Check every record once, so that lookups can trust them
+        for(uint32_t i = 0; i < header.keyCount; ++i) {
+            const KeyRecord& key = KeyOf(data, i);
+            if(uint64_t(key.pathOffset) + key.pathLength > header.stringsSize || key.nameLength > key.pathLength //
+               || (i == 0 ? key.parent != NoKey : key.parent >= header.keyCount) //
+               || uint64_t(key.firstChild) + key.childCount > header.keyCount //
+               || uint64_t(key.firstValue) + key.valueCount > header.valueCount) {
+                ThrowInvalid();
+            }
+        }
+
+        for(uint32_t i = 0; i < header.valueCount; ++i) {
+            const ValueRecord& value = ValueOf(data, i);
+            const auto type = static_cast<RegistryValueType>(value.type);
+            const uint64_t payloadSize = uint64_t(value.dataSize) + (IsText(type) ? 1 : 0);
+            if(value.key >= header.keyCount || uint64_t(value.nameOffset) + value.nameLength > header.stringsSize //
+               || !IsSupported(type) || value.dataOffset > _size || payloadSize > _size - value.dataOffset) {
+                ThrowInvalid();
+            }
+            if((type == RegistryValueType::DWord || type == RegistryValueType::DWordBigEndian) && value.dataSize != sizeof(DWORD)) {
+                ThrowInvalid();
+            }
+            if(type == RegistryValueType::QWord && value.dataSize != sizeof(ULONGLONG)) {
+                ThrowInvalid();
+            }
+            if(IsText(type) && data[value.dataOffset + value.dataSize] != 0) {
+                ThrowInvalid();
+            }
+        }
+
+        for(uint32_t i = 0; i < header.keyCount; ++i) {
+            if(ArrayOf(data, header.keySlots)[i] >= header.keyCount) {
+                ThrowInvalid();
+            }
+        }
+
+        for(uint32_t i = 0; i < header.valueCount; ++i) {
+            if(ArrayOf(data, header.valueSlots)[i] >= header.valueCount) {
+                ThrowInvalid();
+            }
+        }
+    }
+
+    uint32_t RegistrySnapshot::FindKey(const BYTE* data, uint32_t parent, std::string_view subkey) noexcept {
+        const Header& header = HeaderOf(data);
+        const KeyRecord& parentKey = KeyOf(data, parent);
+        const std::string_view parentPath = StringOf(data, parentKey.pathOffset, parentKey.pathLength);
+
+        const uint32_t bucket = static_cast<uint32_t>(KeyHash(0, parentPath, subkey) % header.keyBuckets);
+        const uint32_t seed = ArrayOf(data, header.keySeeds)[bucket];
+        const uint32_t slot = static_cast<uint32_t>(KeyHash(seed, parentPath, subkey) % header.keyCount);
+        const uint32_t candidate = ArrayOf(data, header.keySlots)[slot];
+
+        // The index is perfect for the keys of the snapshot only: compare the paths
+        const KeyRecord& key = KeyOf(data, candidate);
+        const std::string_view path = StringOf(data, key.pathOffset, key.pathLength);
+        size_t length = 0;
+        bool equal = true;
+        ForEachPathChar(parentPath, subkey, [&](char c) {
+            equal = equal && length < path.size() && Name::Fold(path[length]) == Name::Fold(c);
+            ++length;
+        });
+
+        return equal && length == path.size() ? candidate : header.keyCount;
+    }
+
+    uint32_t RegistrySnapshot::FindValue(const BYTE* data, uint32_t key, std::string_view valueName) noexcept {
+        const Header& header = HeaderOf(data);
+        if(header.valueCount == 0) {
+            return 0;
+        }
+
+        const uint32_t bucket = static_cast<uint32_t>(ValueHash(0, key, valueName) % header.valueBuckets);
+        const uint32_t seed = ArrayOf(data, header.valueSeeds)[bucket];
+        const uint32_t slot = static_cast<uint32_t>(ValueHash(seed, key, valueName) % header.valueCount);
+        const uint32_t candidate = ArrayOf(data, header.valueSlots)[slot];
+
+        const ValueRecord& value = ValueOf(data, candidate);
+        if(value.key != key || !Name::Equals(StringOf(data, value.nameOffset, value.nameLength), valueName)) {
+            return header.valueCount;
+        }
+        return candidate;
+    }
+
+    //
+    // SnapshotKey
+    //
+
+    SnapshotKey::SnapshotKey(std::shared_ptr<const BYTE> data, uint32_t index) noexcept
+      : _data(std::move(data))
+      , _index(index) {}
+
+    bool SnapshotKey::IsValid() const noexcept {
+        return _data != nullptr;
+    }
+
+    SnapshotKey::operator bool() const noexcept {
+        return IsValid();
+    }
+
+    std::string_view SnapshotKey::GetName() const {
+        EnsureValid();
+        const KeyRecord& key = KeyOf(_data.get(), _index);
+        return StringOf(_data.get(), key.pathOffset, key.pathLength);
+    }
+
+    size_t SnapshotKey::GetSubKeyCount() const {
+        EnsureValid();
+        return KeyOf(_data.get(), _index).childCount;
+    }
+
+    size_t SnapshotKey::GetValueCount() const {
+        EnsureValid();
+        return KeyOf(_data.get(), _index).valueCount;
+    }
+
+    FILETIME SnapshotKey::GetLastWriteTime() const {
+        EnsureValid();
+        const uint64_t time = KeyOf(_data.get(), _index).lastWriteTime;
+        FILETIME result {};
+        result.dwLowDateTime = static_cast<DWORD>(time);
+        result.dwHighDateTime = static_cast<DWORD>(time >> 32);
+        return result;
+    }
+
+    SnapshotKey SnapshotKey::OpenSubKey(std::string_view subkey) const {
+        EnsureValid();
+        const SnapshotKey key = FindSubKey(subkey);
+        if(!key.IsValid()) {
+            throw Exceptions::RegistryException("Subkey not found in the snapshot.", ERROR_FILE_NOT_FOUND);
+        }
+        return key;
+    }
+
+    SnapshotKey SnapshotKey::FindSubKey(std::string_view subkey) const noexcept {
+        if(!IsValid()) {
+            return SnapshotKey();
+        }
+        const uint32_t index = RegistrySnapshot::FindKey(_data.get(), _index, subkey);
+        return index < HeaderOf(_data.get()).keyCount ? SnapshotKey(_data, index) : SnapshotKey();
+    }
+
+    SnapshotKey SnapshotKey::GetSubKey(size_t index) const {
+        EnsureValid();
+        const KeyRecord& key = KeyOf(_data.get(), _index);
+        if(index >= key.childCount) {
+            throw std::out_of_range("Subkey index out of range.");
+        }
+        return SnapshotKey(_data, key.firstChild + static_cast<uint32_t>(index));
+    }
+
+    bool SnapshotKey::HasValue(std::string_view valueName) const noexcept {
+        return IsValid() && RegistrySnapshot::FindValue(_data.get(), _index, valueName) < HeaderOf(_data.get()).valueCount;
+    }
+
+    DWORD SnapshotKey::QueryValueType(std::string_view valueName) const {
+        return static_cast<DWORD>(GetData(valueName).type);
+    }
+
+    SnapshotData SnapshotKey::GetData(std::string_view valueName) const {
+        EnsureValid();
+
+        const BYTE* data = _data.get();
+        const uint32_t index = RegistrySnapshot::FindValue(_data.get(), _index, valueName);
+        if(index >= HeaderOf(data).valueCount) {
+            throw Exceptions::RegistryException("Value not found in the snapshot.", ERROR_FILE_NOT_FOUND);
+        }
+
+        const ValueRecord& value = ValueOf(data, index);
+        return SnapshotData {static_cast<RegistryValueType>(value.type), data + value.dataOffset, value.dataSize};
+    }
+
+    RegistryValue SnapshotKey::GetValue(std::string_view valueName) const {
+        const SnapshotData data = GetData(valueName);
+
+        RegistryValue value(data.type);
+        switch(data.type) {
+            case RegistryValueType::DWord:
+            case RegistryValueType::DWordBigEndian: std::memcpy(&value.DWord(), data.data, sizeof(DWORD)); break;
+            case RegistryValueType::QWord: std::memcpy(&value.QWord(), data.data, sizeof(ULONGLONG)); break;
+            case RegistryValueType::String: value.String().assign(reinterpret_cast<const char*>(data.data), data.size); break;
+            case RegistryValueType::ExpandString: value.ExpandString().assign(reinterpret_cast<const char*>(data.data), data.size); break;
+            case RegistryValueType::MultiString:
+                for(const auto text : GetMultiStringValue(valueName)) {
+                    value.MultiString().emplace_back(text);
+                }
+                break;
+            default: value.Binary().assign(data.data, data.data + data.size); break;
+        }
+        return value;
+    }
+
+    DWORD SnapshotKey::GetDwordValue(std::string_view valueName) const {
+        const SnapshotData data = GetTypedData(valueName, RegistryValueType::DWord);
+        DWORD value;
+        std::memcpy(&value, data.data, sizeof(value));
+        return value;
+    }
+
+    ULONGLONG SnapshotKey::GetQwordValue(std::string_view valueName) const {
+        const SnapshotData data = GetTypedData(valueName, RegistryValueType::QWord);
+        ULONGLONG value;
+        std::memcpy(&value, data.data, sizeof(value));
+        return value;
+    }
+
+    std::string_view SnapshotKey::GetStringValue(std::string_view valueName) const {
+        const SnapshotData data = GetTypedData(valueName, RegistryValueType::String);
+        return std::string_view(reinterpret_cast<const char*>(data.data), data.size);
+    }
+
+    std::string_view SnapshotKey::GetExpandStringValue(std::string_view valueName) const {
+        const SnapshotData data = GetTypedData(valueName, RegistryValueType::ExpandString);
+        return std::string_view(reinterpret_cast<const char*>(data.data), data.size);
+    }
+
+    std::vector<std::string_view> SnapshotKey::GetMultiStringValue(std::string_view valueName) const {
+        const SnapshotData data = GetTypedData(valueName, RegistryValueType::MultiString);
+        const std::string_view texts(reinterpret_cast<const char*>(data.data), data.size);
+
+        // Each string is NUL-terminated
+        std::vector<std::string_view> result;
+        for(size_t first = 0; first < texts.size();) {
+            size_t last = texts.find('\0', first);
+            if(last == std::string_view::npos) {
+                last = texts.size();
+            }
+            result.push_back(texts.substr(first, last - first));
+            first = last + 1;
+        }
+        return result;
+    }
+
+    std::vector<BYTE> SnapshotKey::GetBinaryValue(std::string_view valueName) const {
+        const SnapshotData data = GetTypedData(valueName, RegistryValueType::Binary);
+        return std::vector<BYTE>(data.data, data.data + data.size);
+    }
+
+    std::vector<std::string_view> SnapshotKey::EnumSubKeys() const {
+        EnsureValid();
+
+        const BYTE* data = _data.get();
+        const KeyRecord& key = KeyOf(data, _index);
+
+        std::vector<std::string_view> result;
+        result.reserve(key.childCount);
+        for(uint32_t i = 0; i < key.childCount; ++i) {
+            const KeyRecord& child = KeyOf(data, key.firstChild + i);
+            result.push_back(StringOf(data, child.pathOffset + child.pathLength - child.nameLength, child.nameLength));
+        }
+        return result;
+    }
+
+    std::vector<std::pair<std::string_view, RegistryValueType>> SnapshotKey::EnumValues() const {
+        EnsureValid();
+
+        const BYTE* data = _data.get();
+        const KeyRecord& key = KeyOf(data, _index);
+
+        std::vector<std::pair<std::string_view, RegistryValueType>> result;
+        result.reserve(key.valueCount);
+        for(uint32_t i = 0; i < key.valueCount; ++i) {
+            const ValueRecord& value = ValueOf(data, key.firstValue + i);
+            result.emplace_back(StringOf(data, value.nameOffset, value.nameLength), static_cast<RegistryValueType>(value.type));
+        }
+        return result;
+    }
+
+    void SnapshotKey::EnsureValid() const {
+        if(!IsValid()) {
+            throw Exceptions::RegistryException("Snapshot key is not valid.", ERROR_INVALID_HANDLE);
+        }
+    }
+
+    SnapshotData SnapshotKey::GetTypedData(std::string_view valueName, RegistryValueType type) const {
+        const SnapshotData data = GetData(valueName);
+        if(data.type != type) {
+            throw Exceptions::RegistryException("Value has another type in the snapshot.", ERROR_UNSUPPORTED_TYPE);
+        }
+        return data;
+    }
+
+
+} // namespace registry
+} // namespace abscodes
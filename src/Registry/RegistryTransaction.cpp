@@ -0,0 +1,145 @@
+//===--- RegistryTransaction.cpp -----------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+#include "Registry/RegistryTransaction.h"
+
+#include <ktmw32.h>
+
+#include "Registry/RegistryException.h"
+
+#pragma comment(lib, "KtmW32.lib")
+
+namespace abscodes {
+namespace registry {
+
+    RegistryTransaction::RegistryTransaction(std::chrono::milliseconds timeout) {
+
+        const auto hTransaction = ::CreateTransaction(nullptr, // default security attributes
+                                                      nullptr, // reserved
+                                                      0, // no options
+                                                      0, // reserved
+                                                      0, // reserved
+                                                      static_cast<DWORD>(timeout.count()), // zero means infinite
+                                                      nullptr // no description
+        );
+
+        if(hTransaction == INVALID_HANDLE_VALUE) {
+            throw Exceptions::RegistryException("CreateTransaction failed.", static_cast<LONG>(::GetLastError()));
+        }
+
+        // Closed with the last key of the transaction
+        _hTransaction = std::shared_ptr<void>(hTransaction, [](HANDLE handle) { ::CloseHandle(handle); });
+    }
+
+    RegistryTransaction::RegistryTransaction(RegistryTransaction&& other) noexcept
+      : _hTransaction(std::move(other._hTransaction))
+      , _completed(other._completed) {}
+
+    RegistryTransaction& RegistryTransaction::operator=(RegistryTransaction&& other) noexcept {
+        // Prevent self-move-assign
+        if(this != &other) {
+            Dispose();
+
+            _hTransaction = std::move(other._hTransaction);
+            _completed = other._completed;
+        }
+        return *this;
+    }
+
+    RegistryTransaction::~RegistryTransaction() noexcept {
+        Dispose();
+    }
+
+    bool RegistryTransaction::IsActive() const noexcept {
+        return _hTransaction != nullptr && !_completed;
+    }
+
+    HANDLE RegistryTransaction::Get() const noexcept {
+        return _hTransaction.get();
+    }
+
+    RegistryKey RegistryTransaction::CreateKey(RegistryHive hive, std::string subkey, RegistryView view, RegistryAccessRights desiredAccess, RegistryOption option) {
+        EnsureActive();
+
+        // Subkeys of a transacted key are created with RegCreateKeyTransacted
+        RegistryKey root = OpenRoot(hive, view, desiredAccess);
+        RegistryKey::FixupName(subkey);
+        return subkey.empty() ? std::move(root) : root.CreateSubKey(subkey, view, desiredAccess, option);
+    }
+
+    RegistryKey RegistryTransaction::OpenKey(RegistryHive hive, std::string subkey, RegistryView view, RegistryAccessRights desiredAccess) {
+        EnsureActive();
+
+        // Subkeys of a transacted key are opened with RegOpenKeyTransacted
+        RegistryKey root = OpenRoot(hive, view, desiredAccess);
+        RegistryKey::FixupName(subkey);
+        return subkey.empty() ? std::move(root) : root.OpenSubKey(subkey, view, desiredAccess, RegistryOption::None);
+    }
+
+    void RegistryTransaction::Commit() {
+        EnsureActive();
+
+        if(!::CommitTransaction(_hTransaction.get())) {
+            throw Exceptions::RegistryException("CommitTransaction failed.", static_cast<LONG>(::GetLastError()));
+        }
+
+        _completed = true;
+    }
+
+    void RegistryTransaction::Rollback() {
+        EnsureActive();
+
+        if(!::RollbackTransaction(_hTransaction.get())) {
+            throw Exceptions::RegistryException("RollbackTransaction failed.", static_cast<LONG>(::GetLastError()));
+        }
+
+        _completed = true;
+    }
+
+    void RegistryTransaction::EnsureActive() const {
+        if(!IsActive()) {
+            throw Exceptions::RegistryException("Transaction is no longer active.", ERROR_TRANSACTION_NOT_ACTIVE);
+        }
+    }
+
+    void RegistryTransaction::Dispose() noexcept {
+        if(_hTransaction != nullptr) {
+            if(!_completed) {
+                ::RollbackTransaction(_hTransaction.get());
+            }
+            // The keys still holding the handle close it
+            _hTransaction.reset();
+        }
+    }
+
+    RegistryKey RegistryTransaction::OpenRoot(RegistryHive hive, RegistryView view, RegistryAccessRights desiredAccess) const {
+        RegistryKey root(hive, view, desiredAccess);
+
+        HKEY hKey = nullptr;
+        const auto retCode = ::RegOpenKeyTransactedW(root._hKey, //
+                                                     L"", // the key itself
+                                                     0, // no options
+                                                     (DWORD)desiredAccess | (DWORD)view, //
+                                                     &hKey, //
+                                                     _hTransaction.get(), //
+                                                     nullptr // reserved
+        );
+        if(retCode != ERROR_SUCCESS) {
+            throw Exceptions::RegistryException("RegOpenKeyTransacted failed.", retCode);
+        }
+
+        root._hKey = hKey;
+        root.MutableOptions().transaction = _hTransaction;
+        return root;
+    }
+
+} // namespace registry
+} // namespace abscodes
@@ -0,0 +1,269 @@
+//===--- RegistryUtils.h -------------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+
+#ifndef REGISTRY_UTILS_INCLUDED
+#define REGISTRY_UTILS_INCLUDED
+
+#include "Registry/RegistryApi.h"
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Registry/RegistryException.h"
+#include "Registry/RegistryName.h"
+
+namespace abscodes {
+namespace registry {
+
+
+    ///
+    /// Helpers shared by the sources of the library, not exported.
+    ///
+    namespace detail {
+
+        ///
+        /// Convert UTF-16 text to UTF-8, into result.
+        ///
+        /// String is any std::basic_string of char: the conversion allocates only if result is too small.
+        ///
+        template <typename String>
+        void Narrow(const wchar_t* text, size_t length, String& result) {
+            if(length == 0) {
+                result.clear();
+                return;
+            }
+
+            const int size = ::WideCharToMultiByte(CP_UTF8, //
+                                                   0, // default flags
+                                                   text, //
+                                                   static_cast<int>(length), //
+                                                   nullptr, // get the size only
+                                                   0, //
+                                                   nullptr, // no default char
+                                                   nullptr // no default char used
+            );
+            if(size <= 0) {
+                throw Exceptions::RegistryException("WideCharToMultiByte failed.", static_cast<LONG>(::GetLastError()));
+            }
+
+            result.resize(static_cast<size_t>(size));
+            ::WideCharToMultiByte(CP_UTF8, //
+                                  0, // default flags
+                                  text, //
+                                  static_cast<int>(length), //
+                                  &result[0], //
+                                  size, //
+                                  nullptr, // no default char
+                                  nullptr // no default char used
+            );
+        }
+
+        ///
+        /// Convert UTF-8 text to UTF-16, appending it to result.
+        ///
+        /// WString is any std::basic_string of wchar_t: the conversion allocates only if result is too small.
+        ///
+        template <typename WString>
+        void AppendWide(std::string_view text, WString& result) {
+            if(text.empty()) {
+                return;
+            }
+
+            const int size = ::MultiByteToWideChar(CP_UTF8, //
+                                                   0, // default flags
+                                                   text.data(), //
+                                                   static_cast<int>(text.size()), //
+                                                   nullptr, // get the size only
+                                                   0);
+            if(size <= 0) {
+                throw Exceptions::RegistryException("MultiByteToWideChar failed.", static_cast<LONG>(::GetLastError()));
+            }
+
+            const size_t offset = result.size();
+            result.resize(offset + static_cast<size_t>(size));
+            ::MultiByteToWideChar(CP_UTF8, //
+                                  0, // default flags
+                                  text.data(), //
+                                  static_cast<int>(text.size()), //
+                                  &result[offset], //
+                                  size);
+        }
+
+        ///
+        /// Convert UTF-8 text to UTF-16, into result.
+        ///
+        template <typename WString>
+        void Widen(std::string_view text, WString& result) {
+            result.clear();
+            AppendWide(text, result);
+        }
+
+        /// Convert UTF-8 text to UTF-16, e.g. a file or mapping name
+        inline std::wstring Widen(std::string_view text) {
+            std::wstring result;
+            AppendWide(text, result);
+            return result;
+        }
+
+        ///
+        /// Create or replace a file, opened for writing without sharing.
+        ///
+        /// @return The handle, or INVALID_HANDLE_VALUE as CreateFile.
+        ///
+        inline HANDLE CreateFileForWriting(const wchar_t* fileName) noexcept {
+            return ::CreateFileW(fileName, //
+                                 GENERIC_WRITE, //
+                                 0, // no sharing while writing
+                                 nullptr, // default security attributes
+                                 CREATE_ALWAYS, //
+                                 FILE_ATTRIBUTE_NORMAL, //
+                                 nullptr // no template
+            );
+        }
+
+        ///
+        /// Write a buffer to a file, by chunks: WriteFile takes a DWORD size.
+        ///
+        /// @return ERROR_SUCCESS, or the error of WriteFile.
+        ///
+        inline LONG WriteAll(HANDLE hFile, const BYTE* data, size_t size) noexcept {
+            size_t written = 0;
+            while(written < size) {
+                const DWORD chunk = static_cast<DWORD>((std::min)(size - written, size_t(1) << 30));
+                DWORD done = 0;
+                if(!::WriteFile(hFile, data + written, chunk, &done, nullptr)) {
+                    return static_cast<LONG>(::GetLastError());
+                }
+                written += done;
+            }
+            return ERROR_SUCCESS;
+        }
+
+        ///
+        /// Open an existing file for reading, shared with the other readers.
+        ///
+        /// @return The handle, or INVALID_HANDLE_VALUE as CreateFile.
+        ///
+        inline HANDLE OpenFileForReading(const wchar_t* fileName) noexcept {
+            return ::CreateFileW(fileName, //
+                                 GENERIC_READ, //
+                                 FILE_SHARE_READ, //
+                                 nullptr, // default security attributes
+                                 OPEN_EXISTING, //
+                                 FILE_ATTRIBUTE_NORMAL, //
+                                 nullptr // no template
+            );
+        }
+
+        ///
+        /// Read a file into a buffer, by chunks, until the buffer is full or the end of the file.
+        ///
+        /// @param read Receives the number of bytes read.
+        ///
+        /// @return ERROR_SUCCESS, or the error of ReadFile.
+        ///
+        inline LONG ReadAll(HANDLE hFile, BYTE* data, size_t size, size_t& read) noexcept {
+            read = 0;
+            while(read < size) {
+                const DWORD chunk = static_cast<DWORD>((std::min)(size - read, size_t(1) << 30));
+                DWORD done = 0;
+                if(!::ReadFile(hFile, data + read, chunk, &done, nullptr)) {
+                    return static_cast<LONG>(::GetLastError());
+                }
+                if(done == 0) {
+                    break;
+                }
+                read += done;
+            }
+            return ERROR_SUCCESS;
+        }
+
+        //
+        // Trees of keys held in a map, by normalized path sorted with Name::Less; the root is the empty path.
+        // Keys is such a map, whose keys have a lastWriteTime.
+        //
+
+        /// Path of the parent of a key, other than the root
+        inline std::string ParentPath(const std::string& path) {
+            const size_t separator = path.rfind('\\');
+            return separator == std::string::npos ? std::string() : path.substr(0, separator);
+        }
+
+        ///
+        /// Get the range of the subkeys of a key, at any depth, the key itself excluded.
+        ///
+        template <typename Keys>
+        auto SubKeyRange(Keys& keys, const std::string& path) -> std::pair<decltype(keys.begin()), decltype(keys.begin())> {
+            // The subkeys sort together, from the "path\" prefix
+            const std::string prefix = path.empty() ? path : path + '\\';
+            auto first = keys.lower_bound(prefix);
+            if(path.empty() && first != keys.end() && first->first.empty()) {
+                ++first; // the root itself
+            }
+            auto last = first;
+            while(last != keys.end() && Name::Equals(std::string_view(last->first).substr(0, prefix.size()), prefix)) {
+                ++last;
+            }
+            return {first, last};
+        }
+
+        /// Get the names of the direct subkeys of a key
+        template <typename Keys>
+        std::vector<std::string> DirectSubKeys(const Keys& keys, const std::string& path) {
+            const size_t length = path.empty() ? 0 : path.size() + 1;
+            std::vector<std::string> result;
+            const auto range = SubKeyRange(keys, path);
+            for(auto it = range.first; it != range.second; ++it) {
+                // The direct ones have no more separator
+                if(it->first.find('\\', length) == std::string::npos) {
+                    result.push_back(it->first.substr(length));
+                }
+            }
+            return result;
+        }
+
+        ///
+        /// Find a key, or create it and its missing parents.
+        ///
+        /// @param touch Called as touch(path, key) before a key is created, with a null key, and before the
+        ///              existing parent of the first one created is changed; it returns the new last write time.
+        ///
+        template <typename Keys, typename Touch>
+        typename Keys::mapped_type& CreateKey(Keys& keys, const std::string& path, Touch& touch) {
+            const auto key = keys.find(path);
+            if(key != keys.end()) {
+                return key->second;
+            }
+
+            if(!path.empty()) {
+                const std::string parentPath = ParentPath(path);
+                auto& parent = CreateKey(keys, parentPath, touch);
+                parent.lastWriteTime = touch(parentPath, &parent);
+            }
+
+            const auto time = touch(path, static_cast<const typename Keys::mapped_type*>(nullptr));
+            auto& created = keys[path];
+            created.lastWriteTime = time;
+            return created;
+        }
+
+    } // namespace detail
+
+
+} // namespace registry
+} // namespace abscodes
+
+
+#endif // REGISTRY_UTILS_INCLUDED
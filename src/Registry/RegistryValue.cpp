@@ -16,23 +16,54 @@
 namespace abscodes {
 namespace registry {
 
-    RegistryValue::RegistryValue(RegistryValueType type)
-      : _type(type) {}
-
-    RegistryValueType RegistryValue::GetType() const {
+    template <typename Allocator>
+    BasicRegistryValue<Allocator>::BasicRegistryValue(const Allocator& allocator)
+      : _string(allocator)
+      , _expandString(allocator)
+      , _multiString(allocator)
+      , _binary(allocator) {}
+
+    template <typename Allocator>
+    BasicRegistryValue<Allocator>::BasicRegistryValue(RegistryValueType type, const Allocator& allocator)
+      : _type(type)
+      , _string(allocator)
+      , _expandString(allocator)
+      , _multiString(allocator)
+      , _binary(allocator) {}
+
+    template <typename Allocator>
+    BasicRegistryValue<Allocator>::BasicRegistryValue(const BasicRegistryValue& other, const Allocator& allocator)
+      : _type(other._type)
+      , _dword(other._dword)
+      , _qword(other._qword)
+      , _string(other._string, allocator)
+      , _expandString(other._expandString, allocator)
+      , _multiString(other._multiString, allocator)
+      , _binary(other._binary, allocator) {}
+
+    template <typename Allocator>
+    typename BasicRegistryValue<Allocator>::allocator_type BasicRegistryValue<Allocator>::get_allocator() const noexcept {
+        return _string.get_allocator();
+    }
+
+    template <typename Allocator>
+    RegistryValueType BasicRegistryValue<Allocator>::GetType() const {
         return _type;
     }
 
-    void RegistryValue::Reset(RegistryValueType type) {
+    template <typename Allocator>
+    void BasicRegistryValue<Allocator>::Reset(RegistryValueType type) {
         ResetValues();
         _type = type;
     }
 
-    bool RegistryValue::IsEmpty() const {
+    template <typename Allocator>
+    bool BasicRegistryValue<Allocator>::IsEmpty() const {
         return _type == RegistryValueType::None;
     }
 
-    void RegistryValue::ResetValues() {
+    template <typename Allocator>
+    void BasicRegistryValue<Allocator>::ResetValues() {
         _dword = 0;
         _qword = 0;
         _string.clear();
@@ -41,7 +72,8 @@ namespace registry {
         _binary.clear();
     }
 
-    DWORD RegistryValue::DWord() const {
+    template <typename Allocator>
+    DWORD BasicRegistryValue<Allocator>::DWord() const {
 
         _ASSERTE(_type == RegistryValueType::DWord);
         if(_type != RegistryValueType::DWord) {
@@ -51,7 +83,8 @@ namespace registry {
         return _dword;
     }
 
-    ULONGLONG RegistryValue::QWord() const {
+    template <typename Allocator>
+    ULONGLONG BasicRegistryValue<Allocator>::QWord() const {
 
         _ASSERTE(_type == RegistryValueType::QWord);
         if(_type != RegistryValueType::QWord) {
@@ -61,7 +94,8 @@ namespace registry {
         return _qword;
     }
 
-    const std::string& RegistryValue::String() const {
+    template <typename Allocator>
+    const typename BasicRegistryValue<Allocator>::string_type& BasicRegistryValue<Allocator>::String() const {
 
         _ASSERTE(_type == RegistryValueType::String);
         if(_type != RegistryValueType::String) {
@@ -71,7 +105,8 @@ namespace registry {
         return _string;
     }
 
-    const std::string& RegistryValue::ExpandString() const {
+    template <typename Allocator>
+    const typename BasicRegistryValue<Allocator>::string_type& BasicRegistryValue<Allocator>::ExpandString() const {
 
         _ASSERTE(_type == RegistryValueType::ExpandString);
         if(_type != RegistryValueType::ExpandString) {
@@ -81,7 +116,8 @@ namespace registry {
         return _expandString;
     }
 
-    const std::vector<std::string>& RegistryValue::MultiString() const {
+    template <typename Allocator>
+    const typename BasicRegistryValue<Allocator>::multi_string_type& BasicRegistryValue<Allocator>::MultiString() const {
 
         _ASSERTE(_type == RegistryValueType::MultiString);
         if(_type != RegistryValueType::MultiString) {
@@ -91,7 +127,8 @@ namespace registry {
         return _multiString;
     }
 
-    const std::vector<BYTE>& RegistryValue::Binary() const {
+    template <typename Allocator>
+    const typename BasicRegistryValue<Allocator>::binary_type& BasicRegistryValue<Allocator>::Binary() const {
 
         _ASSERTE(_type == RegistryValueType::Binary);
         if(_type != RegistryValueType::Binary) {
@@ -101,7 +138,8 @@ namespace registry {
         return _binary;
     }
 
-    DWORD& RegistryValue::DWord() {
+    template <typename Allocator>
+    DWORD& BasicRegistryValue<Allocator>::DWord() {
 
         _ASSERTE(_type == RegistryValueType::DWord);
         if(_type != RegistryValueType::DWord) {
@@ -111,7 +149,8 @@ namespace registry {
         return _dword;
     }
 
-    ULONGLONG& RegistryValue::QWord() {
+    template <typename Allocator>
+    ULONGLONG& BasicRegistryValue<Allocator>::QWord() {
 
         _ASSERTE(_type == RegistryValueType::QWord);
         if(_type != RegistryValueType::QWord) {
@@ -121,7 +160,8 @@ namespace registry {
         return _qword;
     }
 
-    std::string& RegistryValue::String() {
+    template <typename Allocator>
+    typename BasicRegistryValue<Allocator>::string_type& BasicRegistryValue<Allocator>::String() {
 
         _ASSERTE(_type == RegistryValueType::String);
         if(_type != RegistryValueType::String) {
@@ -131,7 +171,8 @@ namespace registry {
         return _string;
     }
 
-    std::string& RegistryValue::ExpandString() {
+    template <typename Allocator>
+    typename BasicRegistryValue<Allocator>::string_type& BasicRegistryValue<Allocator>::ExpandString() {
 
         _ASSERTE(_type == RegistryValueType::ExpandString);
         if(_type != RegistryValueType::ExpandString) {
@@ -141,7 +182,8 @@ namespace registry {
         return _expandString;
     }
 
-    std::vector<std::string>& RegistryValue::MultiString() {
+    template <typename Allocator>
+    typename BasicRegistryValue<Allocator>::multi_string_type& BasicRegistryValue<Allocator>::MultiString() {
 
         _ASSERTE(_type == RegistryValueType::MultiString);
         if(_type != RegistryValueType::MultiString) {
@@ -151,7 +193,8 @@ namespace registry {
         return _multiString;
     }
 
-    std::vector<BYTE>& RegistryValue::Binary() {
+    template <typename Allocator>
+    typename BasicRegistryValue<Allocator>::binary_type& BasicRegistryValue<Allocator>::Binary() {
 
         _ASSERTE(_type == RegistryValueType::Binary);
         if(_type != RegistryValueType::Binary) {
@@ -161,5 +204,8 @@ namespace registry {
         return _binary;
     }
 
+    template class REGISTRY_API BasicRegistryValue<std::allocator<char>>;
+    template class REGISTRY_API BasicRegistryValue<std::pmr::polymorphic_allocator<char>>;
+
 } // namespace registry
 } // namespace abscodes
@@ -0,0 +1,420 @@
+//===--- RegistryValueCache.cpp ------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+#include "Registry/RegistryValueCache.h"
+
+#include "Registry/RegistryException.h"
+#include "RegistryUtils.h"
+
+namespace abscodes {
+namespace registry {
+
+    namespace {
+
+        /// Changes notified by WatchTree: keys created or deleted, values set or deleted
+        constexpr DWORD WatchFilter = REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET | REG_NOTIFY_THREAD_AGNOSTIC;
+
+        ULONGLONG ToTicks(const FILETIME& time) noexcept {
+            return (static_cast<ULONGLONG>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+        }
+
+        FILETIME ToFileTime(ULONGLONG ticks) noexcept {
+            FILETIME time {};
+            time.dwLowDateTime = static_cast<DWORD>(ticks);
+            time.dwHighDateTime = static_cast<DWORD>(ticks >> 32);
+            return time;
+        }
+
+        /// Open a key under the root, or return an invalid key if it doesn't exist
+        RegistryKey OpenKey(RegistryKey& root, const std::string& path) {
+            try {
+                return root.OpenSubKey(path, RegistryAccessRights::Read);
+            }
+            catch(const Exceptions::RegistryException& e) {
+                if(e.ErrorCode() != ERROR_FILE_NOT_FOUND) {
+                    throw;
+                }
+                return RegistryKey();
+            }
+        }
+
+    } // namespace
+
+    //
+    // RegistryCacheSource
+    //
+
+    bool RegistryCacheSource::ReadValue(const std::string& keyName, const std::string& valueName, RegistryValue& value) {
+        for(auto& read : ReadKey(keyName)) {
+            if(Name::Equals(read.first, valueName)) {
+                value = std::move(read.second);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool RegistryCacheSource::WatchTree(const std::string& /*keyName*/, HANDLE /*hEvent*/) {
+        return false;
+    }
+
+    //
+    // RegistryKeyCacheSource
+    //
+
+    RegistryKeyCacheSource::RegistryKeyCacheSource(RegistryKey& root) noexcept
+      : _root(root) {}
+
+    size_t RegistryKeyCacheSource::GetQueryCount() const noexcept {
+        return _queries;
+    }
+
+    size_t RegistryKeyCacheSource::GetReadCount() const noexcept {
+        return _reads;
+    }
+
+    size_t RegistryKeyCacheSource::GetValueReadCount() const noexcept {
+        return _valueReads;
+    }
+
+    bool RegistryKeyCacheSource::QueryLastWriteTime(const std::string& keyName, FILETIME& lastWriteTime) {
+
+        _ASSERTE(_root.IsValid());
+
+        ++_queries;
+
+        DWORD subKeyCount = 0;
+        DWORD valueCount = 0;
+
+        const std::string path = Name::Normalize(keyName);
+        if(path.empty()) {
+            _root.QueryInfoKey(subKeyCount, valueCount, lastWriteTime);
+            return true;
+        }
+
+        const RegistryKey key = OpenKey(_root, path);
+        if(!key.IsValid()) {
+            return false;
+        }
+
+        key.QueryInfoKey(subKeyCount, valueCount, lastWriteTime);
+        return true;
+    }
+
+    std::vector<std::pair<std::string, RegistryValue>> RegistryKeyCacheSource::ReadKey(const std::string& keyName) {
+
+        _ASSERTE(_root.IsValid());
+
+        ++_reads;
+
+        const std::string path = Name::Normalize(keyName);
+        const RegistryKey opened = path.empty() ? RegistryKey() : OpenKey(_root, path);
+        if(!path.empty() && !opened.IsValid()) {
+            return {};
+        }
+        const RegistryKey& key = path.empty() ? _root : opened;
+
+        std::vector<std::pair<std::string, RegistryValue>> result;
+        for(const auto& value : key.EnumValues()) {
+            if(RegistrySnapshotBuilder::CanStore(value.second)) {
+                result.emplace_back(value.first, key.GetValue(value.first));
+            }
+        }
+        return result;
+    }
+
+    bool RegistryKeyCacheSource::ReadValue(const std::string& keyName, const std::string& valueName, RegistryValue& value) {
+
+        _ASSERTE(_root.IsValid());
+
+        ++_valueReads;
+
+        // RegGetValue opens the key itself: one call, where ReadKey opens, enumerates, then reads each value
+        return _root.TryGetValue(Name::Normalize(keyName), valueName, value);
+    }
+
+    std::vector<std::string> RegistryKeyCacheSource::EnumSubKeys(const std::string& keyName) {
+
+        _ASSERTE(_root.IsValid());
+
+        const std::string path = Name::Normalize(keyName);
+        if(path.empty()) {
+            return _root.EnumSubKeys();
+        }
+
+        const RegistryKey key = OpenKey(_root, path);
+        return key.IsValid() ? key.EnumSubKeys() : std::vector<std::string>();
+    }
+
+    bool RegistryKeyCacheSource::WatchTree(const std::string& keyName, HANDLE hEvent) {
+
+        _ASSERTE(_root.IsValid());
+
+        const std::string path = Name::Normalize(keyName);
+        if(path.empty()) {
+            return ::RegNotifyChangeKeyValue(_root.Get(), TRUE, WatchFilter, hEvent, TRUE) == ERROR_SUCCESS;
+        }
+
+        try {
+            if(!_watched.IsValid() || !Name::Equals(_watchedName, path)) {
+                _watched = OpenKey(_root, path);
+                _watchedName = path;
+            }
+        }
+        catch(const Exceptions::RegistryException&) {
+            return false;
+        }
+
+        if(_watched.IsValid() && ::RegNotifyChangeKeyValue(_watched.Get(), TRUE, WatchFilter, hEvent, TRUE) == ERROR_SUCCESS) {
+            return true;
+        }
+
+        // Deleted since it was opened: opened again by the next call
+        _watched.Close();
+        return false;
+    }
+
+    //
+    // MemoryCacheSource
+    //
+
+    size_t MemoryCacheSource::GetQueryCount() const noexcept {
+        return _queries;
+    }
+
+    size_t MemoryCacheSource::GetReadCount() const noexcept {
+        return _reads;
+    }
+
+    void MemoryCacheSource::SetValue(const std::string& keyName, const std::string& valueName, const RegistryValue& value) {
+        Key& key = CreateKey(Name::Normalize(keyName));
+        key.values.insert_or_assign(valueName, value);
+        key.lastWriteTime = ++_clock;
+    }
+
+    void MemoryCacheSource::DeleteKey(const std::string& keyName) {
+        const std::string path = Name::Normalize(keyName);
+        if(path.empty()) {
+            _keys.clear();
+            return;
+        }
+
+        if(_keys.erase(path) == 0) {
+            return;
+        }
+
+        const auto subKeys = detail::SubKeyRange(_keys, path);
+        _keys.erase(subKeys.first, subKeys.second);
+
+        const auto parent = _keys.find(detail::ParentPath(path));
+        if(parent != _keys.end()) {
+            parent->second.lastWriteTime = ++_clock;
+        }
+    }
+
+    bool MemoryCacheSource::QueryLastWriteTime(const std::string& keyName, FILETIME& lastWriteTime) {
+        ++_queries;
+
+        const auto key = _keys.find(Name::Normalize(keyName));
+        if(key == _keys.end()) {
+            return false;
+        }
+
+        lastWriteTime = ToFileTime(key->second.lastWriteTime);
+        return true;
+    }
+
+    std::vector<std::pair<std::string, RegistryValue>> MemoryCacheSource::ReadKey(const std::string& keyName) {
+        ++_reads;
+
+        const auto key = _keys.find(Name::Normalize(keyName));
+        if(key == _keys.end()) {
+            return {};
+        }
+
+        return std::vector<std::pair<std::string, RegistryValue>>(key->second.values.begin(), key->second.values.end());
+    }
+
+    bool MemoryCacheSource::ReadValue(const std::string& keyName, const std::string& valueName, RegistryValue& value) {
+        const auto key = _keys.find(Name::Normalize(keyName));
+        if(key == _keys.end()) {
+            return false;
+        }
+
+        const auto found = key->second.values.find(valueName);
+        if(found == key->second.values.end()) {
+            return false;
+        }
+
+        value = found->second;
+        return true;
+    }
+
+    std::vector<std::string> MemoryCacheSource::EnumSubKeys(const std::string& keyName) {
+        const std::string path = Name::Normalize(keyName);
+        if(_keys.find(path) == _keys.end()) {
+            return {};
+        }
+
+        return detail::DirectSubKeys(_keys, path);
+    }
+
+    MemoryCacheSource::Key& MemoryCacheSource::CreateKey(const std::string& path) {
+        auto touch = [this](const std::string&, const Key*) { return ++_clock; };
+        return detail::CreateKey(_keys, path, touch);
+    }
+
+    //
+    // RegistryValueCache
+    //
+
+    RegistryValueCache::RegistryValueCache(RegistryCacheSource& source, const std::vector<std::string>& keyNames)
+      : _source(source) {
+        for(const auto& keyName : keyNames) {
+            _keys.emplace(Name::Normalize(keyName), Key());
+        }
+    }
+
+    size_t RegistryValueCache::GetKeyCount() const noexcept {
+        return _keys.size();
+    }
+
+    size_t RegistryValueCache::GetReloadCount() const noexcept {
+        return _reloads;
+    }
+
+    bool RegistryValueCache::HasValue(const std::string& keyName, const std::string& valueName) const {
+        const auto key = _keys.find(Name::Normalize(keyName));
+        return key != _keys.end() && key->second.values.find(valueName) != key->second.values.end();
+    }
+
+    const RegistryValue& RegistryValueCache::GetValue(const std::string& keyName, const std::string& valueName) const {
+        const auto key = _keys.find(Name::Normalize(keyName));
+        if(key == _keys.end()) {
+            throw Exceptions::RegistryException("Key not declared in the cache.", ERROR_FILE_NOT_FOUND);
+        }
+
+        const auto value = key->second.values.find(valueName);
+        if(value == key->second.values.end()) {
+            throw Exceptions::RegistryException("Value not found in the cache.", ERROR_FILE_NOT_FOUND);
+        }
+        return value->second;
+    }
+
+    size_t RegistryValueCache::Load(const RegistrySnapshot& snapshot) {
+        _reloads = 0;
+
+        for(auto& key : _keys) {
+            ULONGLONG lastWriteTime = 0;
+            if(!QueryLastWriteTime(key.first, lastWriteTime)) {
+                key.second = Key();
+                continue;
+            }
+
+            const SnapshotKey cached = snapshot.IsValid() ? snapshot.Root().FindSubKey(key.first) : SnapshotKey();
+            if(!cached || ToTicks(cached.GetLastWriteTime()) != lastWriteTime) {
+                Read(key.first, lastWriteTime, key.second);
+                ++_reloads;
+                continue;
+            }
+
+            // Decode the values: the cache outlives the mapping
+            Key current;
+            current.exists = true;
+            current.lastWriteTime = lastWriteTime;
+            for(const auto& value : cached.EnumValues()) {
+                current.values.emplace(std::string(value.first), cached.GetValue(value.first));
+            }
+            key.second = std::move(current);
+        }
+
+        return _reloads;
+    }
+
+    size_t RegistryValueCache::Load(const std::string& fileName) {
+        RegistrySnapshot snapshot;
+        try {
+            snapshot = RegistrySnapshot::Open(fileName);
+        }
+        catch(const Exceptions::RegistryException&) {
+            // No usable cache, start cold
+        }
+        return Load(snapshot);
+    }
+
+    size_t RegistryValueCache::Refresh() {
+        _reloads = 0;
+
+        for(auto& key : _keys) {
+            ULONGLONG lastWriteTime = 0;
+            if(!QueryLastWriteTime(key.first, lastWriteTime)) {
+                key.second = Key();
+            }
+            else if(!key.second.exists || key.second.lastWriteTime != lastWriteTime) {
+                Read(key.first, lastWriteTime, key.second);
+                ++_reloads;
+            }
+        }
+
+        return _reloads;
+    }
+
+    std::vector<BYTE> RegistryValueCache::Build() const {
+        RegistrySnapshotBuilder builder;
+        AddTo(builder);
+        return builder.Build();
+    }
+
+    void RegistryValueCache::Save(const std::string& fileName) const {
+        RegistrySnapshotBuilder builder;
+        AddTo(builder);
+        builder.Save(fileName);
+    }
+
+    void RegistryValueCache::AddTo(RegistrySnapshotBuilder& builder) const {
+        for(const auto& key : _keys) {
+            // A missing key is checked again on load, there is nothing to store
+            if(!key.second.exists) {
+                continue;
+            }
+
+            builder.AddKey(key.first, ToFileTime(key.second.lastWriteTime));
+            for(const auto& value : key.second.values) {
+                if(RegistrySnapshotBuilder::CanStore(value.second.GetType())) {
+                    builder.SetValue(key.first, value.first, value.second);
+                }
+            }
+        }
+    }
+
+    bool RegistryValueCache::QueryLastWriteTime(const std::string& keyName, ULONGLONG& lastWriteTime) {
+        FILETIME time {};
+        if(!_source.QueryLastWriteTime(keyName, time)) {
+            return false;
+        }
+        lastWriteTime = ToTicks(time);
+        return true;
+    }
+
+    void RegistryValueCache::Read(const std::string& keyName, ULONGLONG lastWriteTime, Key& key) {
+        // The time is queried before reading: a change in between makes the next check fail, never pass
+        Key fresh;
+        fresh.exists = true;
+        fresh.lastWriteTime = lastWriteTime;
+        for(auto& value : _source.ReadKey(keyName)) {
+            fresh.values.insert_or_assign(std::move(value.first), std::move(value.second));
+        }
+        key = std::move(fresh);
+    }
+
+
+} // namespace registry
+} // namespace abscodes
@@ -0,0 +1,175 @@
+//===--- RegistryWriteBatch.cpp ------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+#include "Registry/RegistryWriteBatch.h"
+
+#include <algorithm>
+
+#include "Registry/RegistryException.h"
+
+namespace abscodes {
+namespace registry {
+
+    bool RegistryWriteBatch::IsEmpty() const noexcept {
+        return _keys.empty();
+    }
+
+    size_t RegistryWriteBatch::GetKeyCount() const noexcept {
+        return _keys.size();
+    }
+
+    size_t RegistryWriteBatch::GetOperationCount() const noexcept {
+        return _operations;
+    }
+
+    size_t RegistryWriteBatch::GetSubmittedCount() const noexcept {
+        return _submitted;
+    }
+
+    void RegistryWriteBatch::SetValue(const std::string& keyName, const std::string& valueName, const RegistryValue& value) {
+        if(value.IsEmpty()) {
+            throw std::invalid_argument("Cannot write a REG_NONE value.");
+        }
+
+        Operation operation;
+        operation.value = value;
+        Push(keyName, valueName, std::move(operation));
+    }
+
+    void RegistryWriteBatch::DeleteValue(const std::string& keyName, const std::string& valueName) {
+        Operation operation;
+        operation.erase = true;
+        Push(keyName, valueName, std::move(operation));
+    }
+
+    bool RegistryWriteBatch::IsPending(const std::string& keyName, const std::string& valueName) const {
+        return Find(keyName, valueName) != nullptr;
+    }
+
+    RegistryValue RegistryWriteBatch::GetValue(const RegistryKey& root, const std::string& keyName, const std::string& valueName) const {
+        // Read our own writes first
+        if(const Operation* operation = Find(keyName, valueName)) {
+            if(operation->erase) {
+                throw Exceptions::RegistryException("Value is deleted by the pending write batch.", ERROR_FILE_NOT_FOUND);
+            }
+            return operation->value;
+        }
+
+        // Then fall through to the registry
+        const std::string path = Name::Normalize(keyName);
+        if(path.empty()) {
+            return root.GetValue(valueName);
+        }
+        return root.OpenSubKey(path).GetValue(valueName);
+    }
+
+    std::vector<RegistryWriteBatch::Failure> RegistryWriteBatch::Commit(RegistryKey& root) {
+
+        _ASSERTE(root.IsValid());
+
+        std::vector<Failure> failures;
+
+        // Keys are sorted, so parents are created before their children
+        for(const auto& key : _keys) {
+            RegistryKey subkey;
+            if(!key.first.empty()) {
+                // Only deletions: a missing key has nothing to delete, and must not be created
+                const bool writes = std::any_of(key.second.begin(), key.second.end(), [](const auto& value) { return !value.second.erase; });
+                try {
+                    // One open per key, whatever the number of values written
+                    subkey = writes ? root.CreateSubKey(key.first) : root.OpenSubKey(key.first);
+                }
+                catch(const Exceptions::RegistryException& e) {
+                    if(writes || e.ErrorCode() != ERROR_FILE_NOT_FOUND) {
+                        failures.push_back(Failure {key.first, std::string(), e.what()});
+                    }
+                    continue;
+                }
+                catch(const std::exception& e) {
+                    failures.push_back(Failure {key.first, std::string(), e.what()});
+                    continue;
+                }
+            }
+
+            RegistryKey& target = key.first.empty() ? root : subkey;
+
+            for(const auto& value : key.second) {
+                try {
+                    if(value.second.erase) {
+                        target.DeleteValue(value.first);
+                    }
+                    else {
+                        target.SetValue(value.first, value.second.value);
+                    }
+                }
+                catch(const Exceptions::RegistryException& e) {
+                    // The value is already gone, as requested
+                    if(!value.second.erase || e.ErrorCode() != ERROR_FILE_NOT_FOUND) {
+                        failures.push_back(Failure {key.first, value.first, e.what()});
+                    }
+                }
+                catch(const std::exception& e) {
+                    failures.push_back(Failure {key.first, value.first, e.what()});
+                }
+            }
+        }
+
+        Clear();
+
+        return failures;
+    }
+
+    void RegistryWriteBatch::Clear() noexcept {
+        _keys.clear();
+        _submitted = 0;
+        _operations = 0;
+    }
+
+    void RegistryWriteBatch::ForEach(const std::function<void(const std::string&, const std::string&, const RegistryValue*)>& visitor) const {
+        for(const auto& key : _keys) {
+            for(const auto& value : key.second) {
+                visitor(key.first, value.first, value.second.erase ? nullptr : &value.second.value);
+            }
+        }
+    }
+
+    void RegistryWriteBatch::Push(const std::string& keyName, const std::string& valueName, Operation operation) {
+        KeyOperations& operations = _keys[Name::Normalize(keyName)];
+
+        auto it = operations.find(valueName);
+        if(it != operations.end()) {
+            // Last write wins
+            it->second = std::move(operation);
+        }
+        else {
+            operations.emplace(valueName, std::move(operation));
+            ++_operations;
+        }
+
+        ++_submitted;
+    }
+
+    const RegistryWriteBatch::Operation* RegistryWriteBatch::Find(const std::string& keyName, const std::string& valueName) const {
+        const auto key = _keys.find(Name::Normalize(keyName));
+        if(key == _keys.end()) {
+            return nullptr;
+        }
+
+        const auto value = key->second.find(valueName);
+        if(value == key->second.end()) {
+            return nullptr;
+        }
+
+        return &value->second;
+    }
+
+} // namespace registry
+} // namespace abscodes
@@ -0,0 +1,86 @@
+//===--- SharedRegistryKey.cpp -------------------------------------------------------------------------*- C++ -*-===//
+//
+// This source file is part of the Absolute Codes Design open source projects
+//
+// Copyright (c) 2016-2019 Absolute Codes Design and the project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://raw.githubusercontent.com/AbsCoDes/AbsCoDes.github.io/master/Licence.txt for license information
+//
+//===-------------------------------------------------------------------------------------------------------------===//
+
+#include "Registry/SharedRegistryKey.h"
+
+#include "Registry/RegistryException.h"
+
+namespace abscodes {
+namespace registry {
+
+    SharedRegistryKey::SharedRegistryKey(RegistryKey&& key)
+      : _key(std::make_shared<RegistryKey>(std::move(key))) {}
+
+    bool SharedRegistryKey::IsValid() const noexcept {
+        return _key != nullptr && _key->IsValid();
+    }
+
+    SharedRegistryKey::operator bool() const noexcept {
+        return IsValid();
+    }
+
+    long SharedRegistryKey::GetUseCount() const noexcept {
+        return _key.use_count();
+    }
+
+    const RegistryKey& SharedRegistryKey::operator*() const {
+        return Key();
+    }
+
+    const RegistryKey* SharedRegistryKey::operator->() const {
+        return &Key();
+    }
+
+    SharedRegistryKey SharedRegistryKey::OpenSubKey(const std::string& subkey) const {
+        return SharedRegistryKey(Key().OpenSubKey(subkey));
+    }
+
+    SharedRegistryKey SharedRegistryKey::OpenSubKey(const std::string& subkey, RegistryAccessRights desiredAccess) const {
+        return SharedRegistryKey(Key().OpenSubKey(subkey, desiredAccess));
+    }
+
+    SharedRegistryKey SharedRegistryKey::CreateSubKey(const std::string& subkey) {
+        return SharedRegistryKey(Key().CreateSubKey(subkey));
+    }
+
+    void SharedRegistryKey::SetValue(const std::string& valueName, const RegistryValue& value) {
+        Key().SetValue(valueName, value);
+    }
+
+    void SharedRegistryKey::SetDwordValue(const std::string& valueName, DWORD value) {
+        Key().SetDwordValue(valueName, value);
+    }
+
+    void SharedRegistryKey::SetStringValue(const std::string& valueName, const std::string& value) {
+        Key().SetStringValue(valueName, value);
+    }
+
+    void SharedRegistryKey::DeleteValue(const std::string& valueName) {
+        Key().DeleteValue(valueName);
+    }
+
+    void SharedRegistryKey::Reset() noexcept {
+        _key.reset();
+    }
+
+    void SharedRegistryKey::SwapWith(SharedRegistryKey& other) noexcept {
+        _key.swap(other._key);
+    }
+
+    RegistryKey& SharedRegistryKey::Key() const {
+        if(_key == nullptr) {
+            throw Exceptions::RegistryException("Shared registry key is empty!");
+        }
+        return *_key;
+    }
+
+} // namespace registry
+} // namespace abscodes
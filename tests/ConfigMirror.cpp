@@ -0,0 +1,168 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "Registry\ConfigMirror.h"
+#include "Registry\Registry.h"
+#include "Registry\RegistryException.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace abscodes::registry;
+using namespace abscodes::registry::Exceptions;
+
+namespace RegistryTests
+{
+	TEST_CLASS(ConfigMirror_Tests)
+	{
+	public:
+
+		TEST_METHOD(Snapshot)
+		{
+			MemoryCacheSource source;
+			RegistryValue id(RegistryValueType::DWord);
+			for(DWORD i = 0; i < 3; ++i) {
+				for(DWORD j = 0; j < 3; ++j) {
+					id.DWord() = i * 10 + j;
+					source.SetValue("TestRegistryKey\\Key" + std::to_string(i) + "\\Key" + std::to_string(j), "ID", id);
+				}
+			}
+			source.SetValue("TestName", "ID", id);
+			ConfigMirror mirror(source, "TestRegistryKey");
+			Assert::IsTrue(mirror.GetVersion() == 1);
+
+			const auto root = mirror.Snapshot();
+			Assert::IsTrue(root->GetSubKeys().size() == 3);
+			Assert::IsTrue(root->FindSubKey("key2\\KEY1")->GetValue("id").DWord() == 21);
+			Assert::IsTrue(root->FindSubKey("\\Key1\\") == root->GetSubKeys().at("Key1").get());
+			Assert::IsTrue(root->FindSubKey("TestName") == nullptr);
+			Assert::IsFalse(root->HasValue("ID"));
+			Assert::ExpectException<RegistryException>([&] { root->GetValue("ID"); });
+
+			// Nothing changed, nothing is published
+			Assert::IsFalse(mirror.Refresh());
+			Assert::IsTrue(mirror.Snapshot() == root);
+			Assert::IsTrue(mirror.GetVersion() == 1);
+		}
+
+		TEST_METHOD(Refresh)
+		{
+			MemoryCacheSource source;
+			RegistryValue id(RegistryValueType::DWord);
+			for(DWORD i = 0; i < 3; ++i) {
+				for(DWORD j = 0; j < 3; ++j) {
+					id.DWord() = i * 10 + j;
+					source.SetValue("TestRegistryKey\\Key" + std::to_string(i) + "\\Key" + std::to_string(j), "ID", id);
+				}
+			}
+			source.SetValue("TestName", "ID", id);
+			ConfigMirror mirror(source, "TestRegistryKey");
+			const auto before = mirror.Snapshot();
+			const size_t reads = source.GetReadCount();
+
+			RegistryValue value(RegistryValueType::DWord); value.DWord() = 123;
+			source.SetValue("TestRegistryKey\\Key1\\Key1", "ID", value);
+			Assert::IsTrue(mirror.Refresh());
+			Assert::IsTrue(mirror.GetVersion() == 2);
+
+			// Only the changed key is read again, the unchanged subtrees are shared
+			const auto after = mirror.Snapshot();
+			Assert::IsTrue(source.GetReadCount() == reads + 1);
+			Assert::IsTrue(after->FindSubKey("Key1\\Key1")->GetValue("ID").DWord() == 123);
+			Assert::IsTrue(after->FindSubKey("Key0") == before->FindSubKey("Key0"));
+			Assert::IsTrue(after->FindSubKey("Key1\\Key2") == before->FindSubKey("Key1\\Key2"));
+			Assert::IsFalse(after->FindSubKey("Key1") == before->FindSubKey("Key1"));
+
+			// Readers keep their snapshot
+			Assert::IsTrue(before->FindSubKey("Key1\\Key1")->GetValue("ID").DWord() == 11);
+
+			source.DeleteKey("TestRegistryKey\\Key2");
+			Assert::IsTrue(mirror.Refresh());
+			Assert::IsTrue(mirror.Snapshot()->GetSubKeys().size() == 2);
+
+			const auto statistics = mirror.GetStatistics();
+			Assert::IsTrue(statistics.refreshes == 3);
+			Assert::IsTrue(statistics.publications == 3);
+			Assert::IsTrue(statistics.keysReused > 0);
+		}
+
+		TEST_METHOD(Background)
+		{
+			MemoryCacheSource source;
+			RegistryValue id(RegistryValueType::DWord);
+			for(DWORD i = 0; i < 3; ++i) {
+				for(DWORD j = 0; j < 3; ++j) {
+					id.DWord() = i * 10 + j;
+					source.SetValue("TestRegistryKey\\Key" + std::to_string(i) + "\\Key" + std::to_string(j), "ID", id);
+				}
+			}
+			source.SetValue("TestName", "ID", id);
+			ConfigMirror mirror(source, "TestRegistryKey");
+
+			RegistryValue value(RegistryValueType::DWord); value.DWord() = 123;
+			source.SetValue("TestRegistryKey\\Key0\\Key0", "ID", value);
+
+			mirror.Start(std::chrono::milliseconds(1));
+			const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+			while(mirror.GetVersion() == 1 && std::chrono::steady_clock::now() < deadline) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			mirror.Stop();
+
+			Assert::IsTrue(mirror.Snapshot()->FindSubKey("Key0\\Key0")->GetValue("ID").DWord() == 123);
+		}
+
+		TEST_METHOD(Registry)
+		{
+			auto testSettings = CurrentUser().CreateSubKey("TestRegistryKey").CreateSubKey("TestSettings");
+			testSettings.SetStringValue("Language", "French");
+
+			auto root = CurrentUser().OpenSubKey("TestRegistryKey");
+			RegistryKeyCacheSource source(root);
+			ConfigMirror mirror(source);
+			Assert::IsTrue(mirror.Snapshot()->FindSubKey("TestSettings")->GetValue("Language").String() == "French");
+
+			testSettings.SetStringValue("Language", "English");
+			Assert::IsTrue(mirror.Refresh());
+			Assert::IsTrue(mirror.Snapshot()->FindSubKey("TestSettings")->GetValue("Language").String() == "English");
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(Notification)
+		{
+			auto testSettings = CurrentUser().CreateSubKey("TestRegistryKey").CreateSubKey("TestSettings");
+			testSettings.SetStringValue("Language", "French");
+
+			auto root = CurrentUser().OpenSubKey("TestRegistryKey");
+			RegistryKeyCacheSource source(root);
+			ConfigMirror mirror(source);
+			mirror.Start(std::chrono::milliseconds(1));
+
+			// Nothing changes: once watched, the ticks check no key
+			auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+			while(mirror.GetStatistics().refreshesSkipped == 0 && std::chrono::steady_clock::now() < deadline) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			const auto before = mirror.GetStatistics();
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			Assert::IsTrue(mirror.GetStatistics().refreshesSkipped > before.refreshesSkipped);
+			Assert::IsTrue(mirror.GetStatistics().keysChecked == before.keysChecked);
+
+			// A change deep in the subtree is notified
+			testSettings.SetStringValue("Language", "English");
+			deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+			while(mirror.GetVersion() == 1 && std::chrono::steady_clock::now() < deadline) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			mirror.Stop();
+			mirror.Stop();
+
+			Assert::IsTrue(mirror.Snapshot()->FindSubKey("TestSettings")->GetValue("Language").String() == "English");
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+	};
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <memory_resource>
+
+namespace RegistryTests
+{
+	/// Memory resource counting its allocations
+	class CountingResource : public std::pmr::memory_resource
+	{
+	public:
+		explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+			: _upstream(upstream) {}
+
+		size_t allocations = 0;
+		size_t bytes = 0;
+
+	private:
+		void* do_allocate(size_t size, size_t alignment) override {
+			++allocations;
+			bytes += size;
+			return _upstream->allocate(size, alignment);
+		}
+
+		void do_deallocate(void* p, size_t size, size_t alignment) override {
+			_upstream->deallocate(p, size, alignment);
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+			return this == &other;
+		}
+
+		std::pmr::memory_resource* _upstream;
+	};
+}
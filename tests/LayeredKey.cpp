@@ -0,0 +1,190 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Registry\LayeredKey.h"
+#include "Registry\Registry.h"
+#include "Registry\RegistryException.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace abscodes::registry;
+using namespace abscodes::registry::Exceptions;
+
+namespace RegistryTests
+{
+	TEST_CLASS(LayeredKey_Tests)
+	{
+	public:
+
+		TEST_METHOD(Precedence)
+		{
+			auto testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+			testKey.CreateSubKey("Policy").SetDwordValue("Proxy", 1);
+			auto user = testKey.CreateSubKey("User");
+			user.SetDwordValue("Proxy", 2);
+			user.SetStringValue("Language", "French");
+			auto machine = testKey.CreateSubKey("Machine");
+			machine.SetStringValue("Language", "English");
+			machine.SetDwordValue("Timeout", 30);
+
+			std::vector<LayeredKey::Source> layers;
+			for(const char* name : { "Policy", "User", "Machine" }) {
+				layers.push_back({ CurrentUser().OpenSubKey("TestRegistryKey"), name });
+			}
+			LayeredKey key(std::move(layers));
+			Assert::IsTrue(key.GetLayerCount() == 3);
+			Assert::IsTrue(key.IsWatched(0) && key.IsWatched(2));
+
+			Assert::IsTrue(key.GetDwordValue("Proxy", 0) == 1);
+			Assert::IsTrue(key.GetStringValue("Language", "") == "French");
+			Assert::IsTrue(key.GetDwordValue("Timeout", 0) == 30);
+			Assert::IsTrue(key.FindLayer("Timeout") == 2);
+			Assert::IsTrue(key.GetDwordValue("Missing", 123) == 123);
+			Assert::IsFalse(key.HasValue("Missing"));
+			Assert::ExpectException<RegistryException>([&] { key.GetValue("Missing"); });
+			Assert::ExpectException<RegistryException>([&] { key.GetDwordValue("Language", 0); });
+
+			// The second lookups are answered by the cache, absent values included
+			const auto before = key.GetStatistics();
+			Assert::IsTrue(key.GetDwordValue("proxy", 0) == 1);
+			Assert::IsTrue(key.GetDwordValue("Timeout", 0) == 30);
+			Assert::IsTrue(key.GetDwordValue("Missing", 123) == 123);
+			const auto after = key.GetStatistics();
+			Assert::IsTrue(after.hits == before.hits + 3);
+			Assert::IsTrue(after.probes == before.probes);
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(Invalidate)
+		{
+			auto testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+			testKey.CreateSubKey("Policy").SetDwordValue("Proxy", 1);
+			testKey.CreateSubKey("User");
+			testKey.CreateSubKey("Machine").SetDwordValue("Timeout", 30);
+
+			std::vector<LayeredKey::Source> layers;
+			for(const char* name : { "Policy", "User", "Machine" }) {
+				layers.push_back({ CurrentUser().OpenSubKey("TestRegistryKey"), name });
+			}
+			LayeredKey key(std::move(layers));
+			Assert::IsTrue(key.GetDwordValue("Proxy", 0) == 1);
+			Assert::IsTrue(key.GetDwordValue("Timeout", 0) == 30);
+
+			// A change of the last layer keeps the answers of the layers before it
+			key.Invalidate(2);
+			const auto before = key.GetStatistics();
+			Assert::IsTrue(key.GetDwordValue("Proxy", 0) == 1);
+			Assert::IsTrue(key.GetDwordValue("Timeout", 0) == 30);
+			const auto after = key.GetStatistics();
+			Assert::IsTrue(after.hits == before.hits + 1);
+			Assert::IsTrue(after.misses == before.misses + 1);
+
+			Assert::ExpectException<std::out_of_range>([&] { key.Invalidate(3); });
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(Notification)
+		{
+			auto testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+			testKey.CreateSubKey("Policy");
+			auto user = testKey.CreateSubKey("User");
+			testKey.CreateSubKey("Machine").SetStringValue("Language", "English");
+
+			std::vector<LayeredKey::Source> layers;
+			for(const char* name : { "Policy", "User", "Machine" }) {
+				layers.push_back({ CurrentUser().OpenSubKey("TestRegistryKey"), name });
+			}
+			LayeredKey key(std::move(layers));
+			Assert::IsTrue(key.GetStringValue("Language", "") == "English");
+
+			// The user layer hides the machine layer once its change is notified
+			user.SetStringValue("Language", "French");
+			const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+			while(key.GetStringValue("Language", "") != "French" && std::chrono::steady_clock::now() < deadline) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			Assert::IsTrue(key.FindLayer("Language") == 1);
+			Assert::IsTrue(key.GetStatistics().invalidations > 0);
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(Enumeration)
+		{
+			auto testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+			testKey.CreateSubKey("Policy").SetDwordValue("Proxy", 1);
+			auto user = testKey.CreateSubKey("User");
+			user.SetStringValue("proxy", "Direct");
+			user.SetStringValue("Language", "French");
+			user.CreateSubKey("Fonts");
+			auto machine = testKey.CreateSubKey("Machine");
+			machine.CreateSubKey("fonts");
+			machine.CreateSubKey("Colors");
+
+			std::vector<LayeredKey::Source> layers;
+			for(const char* name : { "Policy", "User", "Machine" }) {
+				layers.push_back({ CurrentUser().OpenSubKey("TestRegistryKey"), name });
+			}
+
+			// A layer without parent is skipped
+			layers.insert(layers.begin(), LayeredKey::Source { RegistryKey(), "Missing" });
+
+			LayeredKey key(std::move(layers));
+			Assert::IsFalse(key.IsWatched(0));
+
+			const auto values = key.EnumValues();
+			Assert::IsTrue(values.size() == 2);
+			Assert::IsTrue(values[0].first == "Proxy" && values[0].second == RegistryValueType::DWord);
+			Assert::IsTrue(values[1].first == "Language");
+
+			const auto subkeys = key.EnumSubKeys();
+			Assert::IsTrue(subkeys.size() == 2);
+			Assert::IsTrue(subkeys[0] == "Fonts" && subkeys[1] == "Colors");
+
+			Assert::IsTrue(key.GetDwordValue("Proxy", 0) == 1);
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(CreatedAndDeletedLayers)
+		{
+			auto testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+			testKey.CreateSubKey("Machine").SetDwordValue("Proxy", 2);
+
+			std::vector<LayeredKey::Source> layers;
+			for(const char* name : { "Policy", "Machine" }) {
+				layers.push_back({ CurrentUser().OpenSubKey("TestRegistryKey"), name });
+			}
+
+			LayeredKey key(std::move(layers));
+			Assert::IsFalse(key.IsPresent(0));
+			Assert::IsTrue(key.IsWatched(0));
+			Assert::IsTrue(key.GetDwordValue("Proxy", 0) == 2);
+
+			// A policy created later is opened once notified
+			testKey.CreateSubKey("Policy").SetDwordValue("Proxy", 1);
+			auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+			while(key.GetDwordValue("Proxy", 0) != 1 && std::chrono::steady_clock::now() < deadline) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			Assert::IsTrue(key.FindLayer("Proxy") == 0);
+
+			// A deleted policy is absent, not an error
+			testKey.DeleteSubKeyTree("Policy");
+			deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+			while(key.GetDwordValue("Proxy", 0) != 2 && std::chrono::steady_clock::now() < deadline) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			Assert::IsTrue(key.FindLayer("Proxy") == 1);
+			Assert::IsFalse(key.IsPresent(0));
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+	};
+}
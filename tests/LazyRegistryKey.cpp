@@ -0,0 +1,78 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "Registry\LazyRegistryKey.h"
+#include "Registry\Registry.h"
+#include "Registry\RegistryException.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace abscodes::registry;
+using namespace abscodes::registry::Exceptions;
+
+namespace RegistryTests
+{
+	TEST_CLASS(LazyRegistryKey_Tests)
+	{
+	public:
+
+		TEST_METHOD(FoldedCreate)
+		{
+			auto currentUser = CurrentUser();
+
+			LazyRegistryKey root(RegistryHive::CurrentUser);
+			auto testName = root.CreateSubKey("TestRegistryKey").CreateSubKey("TestSettings").CreateSubKey("TestName");
+
+			// Nothing is opened, nor created, by the chain
+			Assert::IsFalse(testName.IsOpen());
+			Assert::IsTrue(testName.GetName() == "TestRegistryKey\\TestSettings\\TestName");
+			Assert::IsFalse(HasKey(currentUser, "TestRegistryKey"));
+
+			// The first access creates the whole path at once
+			testName->SetDwordValue("ID", 123);
+			Assert::IsTrue(testName.IsOpen());
+			Assert::IsTrue(testName->GetName() == "TestRegistryKey\\TestSettings\\TestName");
+			Assert::IsTrue(currentUser.OpenSubKey("TestRegistryKey\\TestSettings\\TestName").GetDwordValue("ID") == 123);
+
+			currentUser.DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(CreateThenOpen)
+		{
+			auto currentUser = CurrentUser();
+
+			LazyRegistryKey root(RegistryHive::CurrentUser);
+			auto testName = root.CreateSubKey("TestRegistryKey\\TestSettings").OpenSubKey("TestName");
+
+			// The opened leaf is not created, the keys before it are
+			Assert::ExpectException<RegistryException>([&] { testName.Open(); });
+			Assert::IsFalse(testName.IsOpen());
+			Assert::IsTrue(HasKey(currentUser, "TestRegistryKey\\TestSettings"));
+			Assert::IsFalse(HasKey(currentUser, "TestRegistryKey\\TestSettings\\TestName"));
+
+			currentUser.CreateSubKey("TestRegistryKey\\TestSettings\\TestName").SetDwordValue("ID", 123);
+			Assert::IsTrue(testName->GetDwordValue("ID") == 123);
+
+			currentUser.DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(FoldedOpen)
+		{
+			auto currentUser = CurrentUser();
+			currentUser.CreateSubKey("TestRegistryKey\\TestSettings").SetStringValue("Language", "French");
+
+			LazyRegistryKey root(RegistryHive::CurrentUser, RegistryView::Default, RegistryAccessRights::Read);
+			auto testSettings = root.OpenSubKey("TestRegistryKey").OpenSubKey("TestSettings");
+			Assert::IsFalse(testSettings.IsOpen());
+			Assert::IsTrue(testSettings->GetStringValue("Language") == "French");
+			Assert::IsTrue(testSettings->GetAccessRights() == RegistryAccessRights::Read);
+
+			// A missing key is only reported on first access
+			auto missing = root.OpenSubKey("TestRegistryKey").OpenSubKey("Missing");
+			Assert::ExpectException<RegistryException>([&] { missing.Open(); });
+			Assert::IsFalse(missing.IsOpen());
+
+			currentUser.DeleteSubKeyTree("TestRegistryKey");
+		}
+
+	};
+}
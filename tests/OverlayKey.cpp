@@ -0,0 +1,206 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <stdexcept>
+#include <string>
+
+#include "Registry\OverlayKey.h"
+#include "Registry\Registry.h"
+#include "Registry\RegistryException.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace abscodes::registry;
+using namespace abscodes::registry::Exceptions;
+
+namespace RegistryTests
+{
+	TEST_CLASS(OverlayKey_Tests)
+	{
+	public:
+
+		TEST_METHOD(Reads)
+		{
+			MemoryCacheSource base;
+			RegistryValue id(RegistryValueType::DWord);
+			for(DWORD i = 0; i < 100; ++i) {
+				id.DWord() = i;
+				base.SetValue("Software\\Key" + std::to_string(i), "ID", id);
+			}
+			RegistryValue french(RegistryValueType::String); french.String() = "French";
+			base.SetValue("Software\\Settings", "Language", french);
+			base.SetValue("Software\\Settings\\Fonts", "ID", id);
+			OverlayKey overlay(base);
+			Assert::IsTrue(overlay.IsEmpty());
+			Assert::IsTrue(overlay.KeyExists("Software\\Key42"));
+			Assert::IsTrue(overlay.GetValue("Software\\Key42", "id").DWord() == 42);
+			Assert::IsTrue(overlay.EnumSubKeys("Software").size() == 101);
+			Assert::IsFalse(overlay.KeyExists("Software\\Missing"));
+			Assert::IsFalse(overlay.HasValue("Software\\Key42", "Missing"));
+			Assert::ExpectException<RegistryException>([&] { overlay.GetValue("Software\\Missing", "ID"); });
+		}
+
+		TEST_METHOD(Writes)
+		{
+			MemoryCacheSource base;
+			RegistryValue id(RegistryValueType::DWord);
+			for(DWORD i = 0; i < 100; ++i) {
+				id.DWord() = i;
+				base.SetValue("Software\\Key" + std::to_string(i), "ID", id);
+			}
+			RegistryValue french(RegistryValueType::String); french.String() = "French";
+			base.SetValue("Software\\Settings", "Language", french);
+			base.SetValue("Software\\Settings\\Fonts", "ID", id);
+			OverlayKey overlay(base);
+
+			RegistryValue value(RegistryValueType::DWord); value.DWord() = 123;
+			overlay.SetValue("Software\\Key42", "ID", value);
+			overlay.SetValue("Software\\Added\\Deep", "ID", value);
+			overlay.DeleteValue("Software\\Settings", "Language");
+			Assert::ExpectException<RegistryException>([&] { overlay.DeleteValue("Software\\Settings", "Language"); });
+			Assert::ExpectException<std::invalid_argument>([&] { overlay.SetValue("Software", "Empty", RegistryValue()); });
+
+			Assert::IsTrue(overlay.GetValue("Software\\Key42", "ID").DWord() == 123);
+			Assert::IsTrue(overlay.GetValue("Software\\Added\\Deep", "ID").DWord() == 123);
+			Assert::IsTrue(overlay.KeyExists("Software\\Added"));
+			Assert::IsFalse(overlay.HasValue("Software\\Settings", "Language"));
+			Assert::IsTrue(overlay.ReadKey("Software\\Settings").empty());
+			Assert::IsTrue(overlay.EnumSubKeys("Software").size() == 102);
+
+			// The base is untouched
+			Assert::IsTrue(base.ReadKey("Software\\Key42")[0].second.DWord() == 42);
+			Assert::IsTrue(base.EnumSubKeys("Software").size() == 101);
+
+			// Only the changed keys and their parents are in the delta
+			Assert::IsTrue(overlay.GetNodeCount() == 6);
+			Assert::IsTrue(overlay.GetValueCount() == 3);
+
+			overlay.Discard();
+			Assert::IsTrue(overlay.IsEmpty());
+			Assert::IsTrue(overlay.GetValue("Software\\Settings", "Language").String() == "French");
+		}
+
+		TEST_METHOD(DeleteKey)
+		{
+			MemoryCacheSource base;
+			RegistryValue id(RegistryValueType::DWord);
+			for(DWORD i = 0; i < 100; ++i) {
+				id.DWord() = i;
+				base.SetValue("Software\\Key" + std::to_string(i), "ID", id);
+			}
+			RegistryValue french(RegistryValueType::String); french.String() = "French";
+			base.SetValue("Software\\Settings", "Language", french);
+			base.SetValue("Software\\Settings\\Fonts", "ID", id);
+			OverlayKey overlay(base);
+
+			overlay.DeleteKey("Software\\Settings");
+			Assert::IsFalse(overlay.KeyExists("Software\\Settings"));
+			Assert::IsFalse(overlay.KeyExists("Software\\Settings\\Fonts"));
+			Assert::IsTrue(overlay.EnumSubKeys("Software").size() == 100);
+			Assert::ExpectException<RegistryException>([&] { overlay.DeleteKey("Software\\Settings"); });
+			Assert::ExpectException<std::invalid_argument>([&] { overlay.DeleteKey(""); });
+
+			// Created again, without the keys and values of the base
+			overlay.CreateKey("Software\\Settings\\Colors");
+			Assert::IsTrue(overlay.KeyExists("Software\\Settings"));
+			Assert::IsTrue(overlay.ReadKey("Software\\Settings").empty());
+			const auto subkeys = overlay.EnumSubKeys("Software\\Settings");
+			Assert::IsTrue(subkeys.size() == 1 && subkeys[0] == "Colors");
+
+			// A key of the delta only leaves no tombstone
+			overlay.DeleteKey("Software\\Settings\\Colors");
+			Assert::IsTrue(overlay.EnumSubKeys("Software\\Settings").empty());
+
+			// Deleted again, the key of the base stays hidden
+			overlay.DeleteKey("Software\\Settings");
+			Assert::IsFalse(overlay.KeyExists("Software\\Settings"));
+			Assert::IsFalse(overlay.KeyExists("Software\\Settings\\Fonts"));
+			Assert::IsFalse(overlay.HasValue("Software\\Settings", "Language"));
+			Assert::IsTrue(overlay.EnumSubKeys("Software").size() == 100);
+		}
+
+		TEST_METHOD(Export)
+		{
+			MemoryCacheSource base;
+			RegistryValue id(RegistryValueType::DWord);
+			for(DWORD i = 0; i < 100; ++i) {
+				id.DWord() = i;
+				base.SetValue("Software\\Key" + std::to_string(i), "ID", id);
+			}
+			RegistryValue french(RegistryValueType::String); french.String() = "French";
+			base.SetValue("Software\\Settings", "Language", french);
+			base.SetValue("Software\\Settings\\Fonts", "ID", id);
+			OverlayKey overlay(base);
+
+			RegistryValue value(RegistryValueType::DWord); value.DWord() = 123;
+			overlay.SetValue("Software\\Key1", "ID", value);
+			overlay.DeleteValue("Software\\Key2", "ID");
+			overlay.DeleteKey("Software\\Settings");
+			overlay.SetValue("Software\\Settings", "ID", value);
+
+			RegistryWriteBatch batch;
+			overlay.Export(batch);
+			Assert::IsTrue(batch.IsPending("Software\\Key1", "ID"));
+			Assert::IsTrue(batch.IsPending("Software\\Key2", "ID"));
+			Assert::IsTrue(batch.IsPending("Software\\Settings\\Fonts", "ID"));
+			Assert::IsTrue(batch.GetOperationCount() == 5);
+			Assert::IsFalse(overlay.IsEmpty());
+		}
+
+		TEST_METHOD(Commit)
+		{
+			auto testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+			testKey.CreateSubKey("TestSettings").SetStringValue("Language", "French");
+			testKey.CreateSubKey("TestDeleted").SetDwordValue("ID", 1);
+
+			RegistryKeyCacheSource base(testKey);
+			OverlayKey overlay(base);
+			RegistryValue language(RegistryValueType::String); language.String() = "English";
+			overlay.SetValue("TestSettings", "Language", language);
+			overlay.DeleteKey("TestDeleted");
+			overlay.CreateKey("TestCreated");
+
+			// Nothing is written before the commit
+			Assert::IsTrue(testKey.OpenSubKey("TestSettings").GetStringValue("Language") == "French");
+
+			Assert::IsTrue(overlay.Commit(testKey).empty());
+			Assert::IsTrue(overlay.IsEmpty());
+			Assert::IsTrue(testKey.OpenSubKey("TestSettings").GetStringValue("Language") == "English");
+			Assert::IsFalse(overlay.KeyExists("TestDeleted"));
+			Assert::IsTrue(overlay.KeyExists("TestCreated"));
+
+			// A failed commit keeps the delta
+			overlay.SetValue("", "Language", language);
+			auto readOnly = CurrentUser().OpenSubKey("TestRegistryKey", RegistryAccessRights::Read);
+			Assert::IsFalse(overlay.Commit(readOnly).empty());
+			Assert::IsTrue(overlay.GetValueCount() == 1);
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(FallThroughReads)
+		{
+			auto testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+			testKey.CreateSubKey("TestSettings").SetStringValue("Language", "French");
+			testKey.SetDwordValue("ID", 1);
+
+			RegistryKeyCacheSource base(testKey);
+			OverlayKey overlay(base);
+
+			// One single-value read each, neither a key read nor a key query
+			Assert::IsTrue(overlay.GetValue("TestSettings", "Language").String() == "French");
+			Assert::IsTrue(overlay.HasValue("", "ID"));
+			Assert::IsFalse(overlay.HasValue("TestSettings", "Missing"));
+			Assert::IsFalse(overlay.HasValue("TestMissing", "Language"));
+			overlay.DeleteValue("TestSettings", "Language");
+			Assert::IsTrue(base.GetValueReadCount() == 5);
+			Assert::IsTrue(base.GetReadCount() == 0);
+			Assert::IsTrue(base.GetQueryCount() == 0);
+
+			// The tombstone hides the base
+			Assert::IsFalse(overlay.HasValue("TestSettings", "Language"));
+			Assert::IsTrue(base.GetValueReadCount() == 5);
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+	};
+}
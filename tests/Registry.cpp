@@ -62,6 +62,59 @@ namespace RegistryTests
 			abscodes::registry::SetInt(TestRegistryKey, "iValue", -10);
 			Assert::IsTrue(abscodes::registry::GetInt(TestRegistryKey, "iValue", 0) == -10);
 			Assert::IsTrue(abscodes::registry::GetString(TestRegistryKey, "iValue", "0") == "-10");
+
+			// Test SetDouble and GetDouble
+			abscodes::registry::SetDouble(TestRegistryKey, "dValue", 0.1);
+			Assert::IsTrue(abscodes::registry::GetString(TestRegistryKey, "dValue", "") == "0.1");
+			Assert::IsTrue(abscodes::registry::GetDouble(TestRegistryKey, "dValue", 0) == 0.1);
+
+			// Text that is not a number gives the default value
+			abscodes::registry::SetString(TestRegistryKey, "sValue", "Not a number");
+			Assert::IsTrue(abscodes::registry::GetInt(TestRegistryKey, "sValue", 7) == 7);
+			Assert::IsTrue(abscodes::registry::GetUInt(TestRegistryKey, "iValue", 7) == 7);
+		}
+
+		TEST_METHOD(NumberEncoding_Test)
+		{
+			{
+				auto TestRegistryKey = CurrentUser().CreateSubKey("TestRegistryKey");
+
+				// Native numbers are stored as REG_DWORD and REG_BINARY, negative ones as REG_QWORD
+				abscodes::registry::SetInt(TestRegistryKey, "iValue", 10, RegistryNumberEncoding::Native);
+				abscodes::registry::SetInt(TestRegistryKey, "nValue", -10, RegistryNumberEncoding::Native);
+				abscodes::registry::SetDouble(TestRegistryKey, "dValue", 1.0 / 3, RegistryNumberEncoding::Native);
+				Assert::IsTrue(TestRegistryKey.QueryValueType("iValue") == REG_DWORD);
+				Assert::IsTrue(TestRegistryKey.QueryValueType("nValue") == REG_QWORD);
+				Assert::IsTrue(TestRegistryKey.QueryValueType("dValue") == REG_BINARY);
+				Assert::IsTrue(abscodes::registry::GetInt(TestRegistryKey, "iValue", 0) == 10);
+				Assert::IsTrue(abscodes::registry::GetInt(TestRegistryKey, "nValue", 0) == -10);
+				Assert::IsTrue(abscodes::registry::GetDouble(TestRegistryKey, "dValue", 0) == 1.0 / 3);
+
+				// Like the text, a negative number is not an unsigned one
+				Assert::IsTrue(abscodes::registry::GetUInt(TestRegistryKey, "nValue", 7) == 7);
+				Assert::IsTrue(abscodes::registry::GetULong(TestRegistryKey, "nValue", 7) == 7);
+
+				// Both encodings read the same
+				abscodes::registry::SetUInt(TestRegistryKey, "uText", 4000000000u);
+				abscodes::registry::SetUInt(TestRegistryKey, "uNative", 4000000000u, RegistryNumberEncoding::Native);
+				Assert::IsTrue(abscodes::registry::GetUInt(TestRegistryKey, "uText", 0) == 4000000000u);
+				Assert::IsTrue(abscodes::registry::GetUInt(TestRegistryKey, "uNative", 0) == 4000000000u);
+				Assert::IsTrue(abscodes::registry::GetInt(TestRegistryKey, "uNative", 7) == 7);
+
+				// A REG_QWORD out of the range of the type gives the default value
+				TestRegistryKey.SetQwordValue("qValue", 5000000000);
+				Assert::IsTrue(abscodes::registry::GetInt(TestRegistryKey, "qValue", 7) == 7);
+				TestRegistryKey.SetQwordValue("qValue", 123);
+				Assert::IsTrue(abscodes::registry::GetInt(TestRegistryKey, "qValue", 7) == 123);
+
+				// The typed accessors and the native encoding share the same doubles
+				TestRegistryKey.Set("dTyped", 2.5);
+				Assert::IsTrue(abscodes::registry::GetDouble(TestRegistryKey, "dTyped", 0) == 2.5);
+				abscodes::registry::SetDouble(TestRegistryKey, "dNative", 0.1, RegistryNumberEncoding::Native);
+				Assert::IsTrue(TestRegistryKey.Get<double>("dNative") == 0.1);
+			}
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
 		}
 
 		TEST_METHOD(Enum_Test)
@@ -0,0 +1,240 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <cstddef>
+#include <cstdlib>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "Registry\Registry.h"
+#include "Registry\RegistryException.h"
+#include "Registry\RegistryValue.h"
+
+#include "CountingResource.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace abscodes::registry;
+using namespace abscodes::registry::Exceptions;
+
+// The replaced operator new only sees the allocations of this module: the heap is counted when the library is
+// linked statically, the shared configurations only check the memory resources
+#if defined(REGISTRY_STATIC)
+
+namespace
+{
+	/// Number of global heap allocations made by the current thread while counting
+	thread_local size_t heapAllocations = 0;
+	thread_local bool countHeapAllocations = false;
+
+	/// Count the global heap allocations of the current thread, for the lifetime of the object
+	class HeapAllocationCounter
+	{
+	public:
+		HeapAllocationCounter() {
+			heapAllocations = 0;
+			countHeapAllocations = true;
+		}
+
+		~HeapAllocationCounter() {
+			countHeapAllocations = false;
+		}
+
+		size_t GetCount() const { return heapAllocations; }
+	};
+}
+
+void* operator new(size_t size) {
+	if (countHeapAllocations) {
+		++heapAllocations;
+	}
+	if (void* p = std::malloc(size == 0 ? 1 : size)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	std::free(p);
+}
+
+#endif // REGISTRY_STATIC
+
+namespace RegistryTests
+{
+	TEST_CLASS(RegistryAllocation_Tests)
+	{
+	public:
+
+		TEST_METHOD(PmrGetters)
+		{
+			{
+				RegistryKey testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+				testKey.SetDwordValue("DWord", 123);
+				testKey.SetStringValue("String", "A string long enough not to fit in the small string buffer");
+				testKey.SetExpandStringValue("ExpandString", "%PATH%;a string long enough not to fit in the small string buffer");
+				testKey.SetMultiStringValue("MultiString", { "First string of the multi-string value", "Second", "Third" });
+				testKey.SetBinaryValue("Binary", std::vector<BYTE>(100, 0x42));
+
+				// The arena must hold everything: the null upstream throws if it runs out
+				alignas(std::max_align_t) static char buffer[16 * 1024];
+				std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+				CountingResource resource(&arena);
+
+#if defined(REGISTRY_STATIC)
+				HeapAllocationCounter heap;
+#endif
+
+				const auto string = testKey.GetStringValue("String", &resource);
+				const auto expandString = testKey.GetExpandStringValue("ExpandString", &resource);
+				const auto multiString = testKey.GetMultiStringValue("MultiString", &resource);
+				const auto binary = testKey.GetBinaryValue("Binary", &resource);
+				const auto value = testKey.GetValue("MultiString", &resource);
+				const auto dword = testKey.GetValue("DWord", &resource);
+
+#if defined(REGISTRY_STATIC)
+				Assert::IsTrue(heap.GetCount() == 0);
+#endif
+				Assert::IsTrue(resource.allocations > 0);
+
+				Assert::IsTrue(string == "A string long enough not to fit in the small string buffer");
+				Assert::IsTrue(string.get_allocator().resource() == &resource);
+				Assert::IsTrue(expandString.substr(0, 6) == "%PATH%");
+				Assert::IsTrue(multiString.size() == 3);
+				Assert::IsTrue(multiString[0] == "First string of the multi-string value");
+				Assert::IsTrue(multiString[2] == "Third");
+				Assert::IsTrue(multiString[0].get_allocator().resource() == &resource);
+				Assert::IsTrue(binary.size() == 100);
+				Assert::IsTrue(binary[99] == 0x42);
+				Assert::IsTrue(value.GetType() == RegistryValueType::MultiString);
+				Assert::IsTrue(value.MultiString() == multiString);
+				Assert::IsTrue(value.get_allocator().resource() == &resource);
+				Assert::IsTrue(dword.DWord() == 123);
+			}
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(PmrEnumerations)
+		{
+			{
+				RegistryKey testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+				for (int i = 0; i < 100; ++i) {
+					testKey.CreateSubKey("A subkey name long enough not to fit in the small string buffer " + std::to_string(i));
+					testKey.SetDwordValue("A value name long enough not to fit in the small string buffer " + std::to_string(i), i);
+				}
+
+				CountingResource resource;
+
+#if defined(REGISTRY_STATIC)
+				HeapAllocationCounter heap;
+#endif
+				const auto subKeys = testKey.EnumSubKeys(&resource);
+				const auto values = testKey.EnumValues(&resource);
+#if defined(REGISTRY_STATIC)
+				Assert::IsTrue(heap.GetCount() == 0);
+#endif
+
+				Assert::IsTrue(subKeys.size() == 100);
+				Assert::IsTrue(values.size() == 100);
+				Assert::IsTrue(values[0].second == RegistryValueType::DWord);
+				Assert::IsTrue(values[0].first.get_allocator().resource() == &resource);
+				Assert::IsTrue(resource.allocations > 0);
+			}
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+#if defined(REGISTRY_STATIC)
+		TEST_METHOD(ScratchBuffers)
+		{
+			{
+				RegistryKey testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+
+				const std::string dwordName = "A value name long enough not to fit in the small string buffer";
+				const std::string stringName = "Another value name long enough not to fit in the small string buffer";
+				const std::string text = "A string long enough not to fit in the small string buffer";
+
+				// Warm up the buffers of the thread
+				testKey.SetDwordValue(dwordName, 123);
+				testKey.SetStringValue(stringName, text);
+				testKey.GetDwordValue(dwordName);
+				testKey.GetStringValue(stringName);
+				testKey.EnumValues();
+
+				// Allocations of a string like the result
+				size_t resultAllocations = 0;
+				{
+					HeapAllocationCounter heap;
+					std::string copy(text);
+					resultAllocations = heap.GetCount();
+				}
+
+				HeapAllocationCounter heap;
+
+				// Writing and reading scalars does not allocate anymore
+				testKey.SetDwordValue(dwordName, 456);
+				testKey.SetStringValue(stringName, text);
+				Assert::IsTrue(testKey.GetDwordValue(dwordName) == 456);
+				Assert::IsTrue(heap.GetCount() == 0);
+
+				// Reading a string only allocates the result
+				const std::string value = testKey.GetStringValue(stringName);
+				Assert::IsTrue(heap.GetCount() == resultAllocations);
+				Assert::IsTrue(value == text);
+			}
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+#endif // REGISTRY_STATIC
+
+		TEST_METHOD(PmrValue)
+		{
+			CountingResource resource;
+
+			pmr::RegistryValue value(RegistryValueType::String, &resource);
+			value.String() = "A string long enough not to fit in the small string buffer";
+			const size_t allocations = resource.allocations;
+			Assert::IsTrue(allocations > 0);
+
+			// Copying into another resource leaves the first one alone
+			CountingResource other;
+			pmr::RegistryValue copy(value, &other);
+			Assert::IsTrue(copy == value);
+			Assert::IsTrue(copy.get_allocator().resource() == &other);
+			Assert::IsTrue(other.allocations > 0);
+			Assert::IsTrue(resource.allocations == allocations);
+
+			// Values in a pmr container get the container's resource
+			CountingResource containerResource;
+			std::pmr::vector<pmr::RegistryValue> values(&containerResource);
+			values.emplace_back(RegistryValueType::MultiString);
+			values.back().MultiString().emplace_back("A string long enough not to fit in the small string buffer");
+			Assert::IsTrue(values.back().get_allocator().resource() == &containerResource);
+			Assert::IsTrue(values.back().MultiString()[0].get_allocator().resource() == &containerResource);
+		}
+
+		TEST_METHOD(ExceptionKeyName)
+		{
+			// The key name outlives the string it was built from
+			RegistryException exception(std::string("Software\\Test\\Key"), std::string("Message"));
+			Assert::IsTrue(std::string(exception.ErrorKeyName()) == "Software\\Test\\Key");
+
+			RegistryException copy = exception;
+			Assert::IsTrue(std::string(copy.ErrorKeyName()) == "Software\\Test\\Key");
+
+			RegistryException noKey("Message");
+			Assert::IsTrue(std::string(noKey.ErrorKeyName()).empty());
+
+			// A long name is truncated on a UTF-8 character boundary
+			const std::string longName = std::string(510, 'a') + "\xC3\xA9";
+			RegistryException truncated(longName, std::string("Message"));
+			Assert::IsTrue(std::string(truncated.ErrorKeyName()) == std::string(510, 'a'));
+		}
+	};
+}
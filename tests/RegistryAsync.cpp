@@ -0,0 +1,142 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "Registry\Registry.h"
+#include "Registry\RegistryAsync.h"
+#include "Registry\RegistryException.h"
+#include "Registry\RegistryIoPool.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace abscodes::registry;
+using namespace abscodes::registry::Exceptions;
+
+namespace RegistryTests
+{
+	TEST_CLASS(RegistryAsync_Tests)
+	{
+	public:
+
+		TEST_METHOD(Futures)
+		{
+			RegistryIoPool pool(2);
+
+			auto testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+
+			RegistryValue language(RegistryValueType::String);
+			language.String() = "French";
+			SetValueAsync(testKey, "Language", language, RegistryCancellationToken(), pool).get();
+			Assert::IsTrue(GetValueAsync(testKey, "Language", RegistryCancellationToken(), pool).get().String() == "French");
+
+			testKey.CreateSubKey("TestSettings");
+			auto testSettings = OpenSubKeyAsync(testKey, "TestSettings", RegistryCancellationToken(), pool).get();
+			Assert::IsTrue(testSettings.IsValid());
+
+			Assert::IsTrue(EnumSubKeysAsync(testKey, RegistryCancellationToken(), pool).get().size() == 1);
+			Assert::IsTrue(EnumValuesAsync(testKey, RegistryCancellationToken(), pool).get().size() == 1);
+
+			// Errors are reported through the future
+			auto missing = GetValueAsync(testKey, "Missing", RegistryCancellationToken(), pool);
+			Assert::ExpectException<RegistryException>([&] { missing.get(); });
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(Cancellation)
+		{
+			RegistryIoPool pool(1);
+
+			auto testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+
+			RegistryCancellationToken token;
+			token.Cancel();
+
+			RegistryValue id(RegistryValueType::DWord);
+			id.DWord() = 123;
+			auto cancelled = SetValueAsync(testKey, "ID", id, token, pool);
+			LONG errorCode = ERROR_SUCCESS;
+			try {
+				cancelled.get();
+			}
+			catch(const RegistryException& e) {
+				errorCode = e.ErrorCode();
+			}
+			Assert::IsTrue(errorCode == ERROR_OPERATION_ABORTED);
+
+			// The operation was never run
+			Assert::IsFalse(HasValue(testKey, "ID"));
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(Statistics)
+		{
+			RegistryIoPool pool(4, 8);
+			Assert::IsTrue(pool.GetThreadCount() == 4);
+
+			auto testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+			testKey.SetDwordValue("ID", 123);
+
+			std::vector<RegistryKey> keys;
+			for(int i = 0; i < 4; ++i) {
+				keys.push_back(CurrentUser().OpenSubKey("TestRegistryKey"));
+			}
+
+			std::vector<std::future<RegistryValue>> futures;
+			for(int i = 0; i < 64; ++i) {
+				futures.push_back(GetValueAsync(keys[i % keys.size()], "ID", RegistryCancellationToken(), pool));
+			}
+			for(auto& future : futures) {
+				Assert::IsTrue(future.get().DWord() == 123);
+			}
+
+			const auto statistics = pool.GetStatistics();
+			Assert::IsTrue(statistics.posted == 64);
+			Assert::IsTrue(statistics.maxQueueDepth <= 8);
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(Shutdown)
+		{
+			RegistryIoPool pool(1);
+
+			// The queued operations run before the threads stop
+			std::vector<std::future<int>> futures;
+			for(int i = 0; i < 16; ++i) {
+				futures.push_back(pool.Submit([i] { return i; }));
+			}
+			pool.Shutdown();
+			for(int i = 0; i < 16; ++i) {
+				Assert::IsTrue(futures[i].get() == i);
+			}
+
+			Assert::ExpectException<RegistryException>([&] { pool.Post([] {}); });
+
+			// Stopping twice does nothing
+			pool.Shutdown();
+		}
+
+		TEST_METHOD(ShutdownFromPool)
+		{
+			// Stopped, then destroyed, by its own jobs
+			auto pool = std::make_unique<RegistryIoPool>(2);
+			pool->Submit([&] { pool->Shutdown(); }).get();
+			Assert::ExpectException<RegistryException>([&] { pool->Post([] {}); });
+			pool.reset();
+
+			auto owned = new RegistryIoPool(2);
+			std::promise<void> destroyed;
+			owned->Post([&] {
+				delete owned;
+				destroyed.set_value();
+			});
+			Assert::IsTrue(destroyed.get_future().wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+		}
+
+	};
+}
@@ -0,0 +1,129 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Registry\Registry.h"
+#include "Registry\RegistryAtomTable.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace abscodes::registry;
+
+namespace RegistryTests
+{
+	TEST_CLASS(RegistryAtomTable_Tests)
+	{
+	public:
+
+		TEST_METHOD(Intern)
+		{
+			RegistryAtomTable table;
+			Assert::IsTrue(table.GetCount() == 1);
+			Assert::IsTrue(table.Intern("") == RegistryAtomTable::Empty);
+
+			const auto atom = table.Intern("Version");
+			Assert::IsTrue(atom != RegistryAtomTable::Empty);
+			Assert::IsTrue(table.GetCount() == 2);
+
+			// Names are case-insensitive, the first spelling is kept
+			Assert::IsTrue(table.Intern("VERSION") == atom);
+			Assert::IsTrue(table.Intern("version") == atom);
+			Assert::IsTrue(table.GetName(atom) == "Version");
+			Assert::IsTrue(table.GetCount() == 2);
+
+			Assert::IsTrue(table.Intern("Build") != atom);
+
+			RegistryAtomTable::Atom found {};
+			Assert::IsTrue(table.TryFind("BUILD", found));
+			Assert::IsTrue(found == table.Intern("Build"));
+			Assert::IsFalse(table.TryFind("Unknown", found));
+
+			Assert::ExpectException<std::out_of_range>([&] { table.GetName(12345); });
+		}
+
+		TEST_METHOD(StableNames)
+		{
+			RegistryAtomTable table;
+			const auto atom = table.Intern("First");
+			const std::string& first = table.GetString(atom);
+			const std::string_view view = table.GetName(atom);
+
+			// Growing the table never moves the stored names
+			for (int i = 0; i < 10000; ++i) {
+				table.Intern("Name" + std::to_string(i));
+			}
+
+			Assert::IsTrue(&table.GetString(atom) == &first);
+			Assert::IsTrue(view.data() == first.data());
+			Assert::IsTrue(table.GetName(table.Intern("Name9999")) == "Name9999");
+		}
+
+		TEST_METHOD(ConcurrentIntern)
+		{
+			RegistryAtomTable table;
+			const int threadCount = 8;
+			const int nameCount = 2000;
+
+			std::vector<std::vector<RegistryAtomTable::Atom>> atoms(threadCount);
+			std::vector<std::thread> threads;
+			for (int t = 0; t < threadCount; ++t) {
+				threads.emplace_back([&, t] {
+					for (int i = 0; i < nameCount; ++i) {
+						// Every thread interns the same names, half of them in upper case
+						const std::string name = (t % 2 ? "VALUE" : "value") + std::to_string(i);
+						atoms[t].push_back(table.Intern(name));
+					}
+				});
+			}
+			for (auto& thread : threads) {
+				thread.join();
+			}
+
+			// All the threads got the same atoms, and no name was stored twice
+			for (int t = 1; t < threadCount; ++t) {
+				Assert::IsTrue(atoms[t] == atoms[0]);
+			}
+			Assert::IsTrue(table.GetCount() == nameCount + 1);
+
+			auto sorted = atoms[0];
+			std::sort(sorted.begin(), sorted.end());
+			Assert::IsTrue(std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end());
+		}
+
+		TEST_METHOD(EnumAtoms)
+		{
+			{
+				RegistryKey testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+				testKey.CreateSubKey("SubKey");
+				testKey.SetDwordValue("ID", 123);
+				testKey.SetStringValue("Name", "Test");
+
+				RegistryAtomTable names;
+
+				auto subKeys = testKey.EnumSubKeyAtoms(names);
+				Assert::IsTrue(subKeys.size() == 1);
+				Assert::IsTrue(names.GetName(subKeys[0]) == "SubKey");
+
+				auto values = testKey.EnumValueAtoms(names);
+				Assert::IsTrue(values.size() == 2);
+				for (const auto& value : values) {
+					if (value.first == names.Intern("id")) {
+						Assert::IsTrue(value.second == RegistryValueType::DWord);
+					}
+					else {
+						Assert::IsTrue(value.first == names.Intern("NAME"));
+						Assert::IsTrue(value.second == RegistryValueType::String);
+					}
+				}
+
+				// Enumerating again yields the same atoms
+				Assert::IsTrue(testKey.EnumSubKeyAtoms(names) == subKeys);
+			}
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+	};
+}
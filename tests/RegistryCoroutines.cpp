@@ -0,0 +1,120 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <chrono>
+#include <exception>
+#include <future>
+#include <vector>
+
+#include "Registry\Registry.h"
+#include "Registry\RegistryAsync.h"
+#include "Registry\RegistryException.h"
+#include "Registry\RegistryIoPool.h"
+
+// Built as C++20, without the precompiled header: see RegistryTests.vcxproj
+#if !defined(REGISTRY_HAS_COROUTINES)
+#    error "RegistryCoroutines.cpp must be compiled with C++20 coroutines."
+#endif
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace abscodes::registry;
+using namespace abscodes::registry::Exceptions;
+
+namespace
+{
+	/// Coroutine started at once, whose end is signaled through a future
+	struct Task
+	{
+		struct promise_type
+		{
+			std::promise<void> done;
+
+			Task get_return_object() { return Task{ done.get_future() }; }
+			std::suspend_never initial_suspend() noexcept { return {}; }
+			std::suspend_never final_suspend() noexcept { return {}; }
+			void return_void() { done.set_value(); }
+			void unhandled_exception() { done.set_exception(std::current_exception()); }
+		};
+
+		std::future<void> future;
+	};
+
+	Task ReadAndWrite(RegistryKey& key, RegistryIoPool& pool)
+	{
+		RegistryValue language(RegistryValueType::String);
+		language.String() = "French";
+		co_await SetValueAwaitable(key, "Language", language, RegistryCancellationToken(), pool);
+		Assert::IsTrue((co_await GetValueAwaitable(key, "Language", RegistryCancellationToken(), pool)).String() == "French");
+
+		key.CreateSubKey("TestSettings");
+		auto testSettings = co_await OpenSubKeyAwaitable(key, "TestSettings", RegistryCancellationToken(), pool);
+		Assert::IsTrue(testSettings.IsValid());
+		Assert::IsTrue((co_await EnumSubKeysAwaitable(key, RegistryCancellationToken(), pool)).size() == 1);
+		Assert::IsTrue((co_await EnumValuesAwaitable(key, RegistryCancellationToken(), pool)).size() == 1);
+
+		// Errors are thrown by co_await
+		bool thrown = false;
+		try {
+			co_await GetValueAwaitable(key, "Missing", RegistryCancellationToken(), pool);
+		}
+		catch(const RegistryException&) {
+			thrown = true;
+		}
+		Assert::IsTrue(thrown);
+	}
+
+	Task ReadMany(const RegistryKey& key, RegistryIoPool& pool, int count)
+	{
+		for(int i = 0; i < count; ++i) {
+			Assert::IsTrue((co_await GetValueAwaitable(key, "ID", RegistryCancellationToken(), pool)).DWord() == 123);
+		}
+	}
+}
+
+namespace RegistryTests
+{
+	TEST_CLASS(RegistryCoroutines_Tests)
+	{
+	public:
+
+		TEST_METHOD(Awaitables)
+		{
+			RegistryIoPool pool(2);
+			{
+				auto testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+				auto task = ReadAndWrite(testKey, pool);
+				Assert::IsTrue(task.future.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+				task.future.get();
+			}
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(AwaitOnFullPool)
+		{
+			// Coroutines resumed on the single thread await again while the queue is full: they run the
+			// operation themselves rather than nest the resumes
+			RegistryIoPool pool(1, 1);
+			{
+				auto testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+				testKey.SetDwordValue("ID", 123);
+
+				std::vector<Task> tasks;
+				for(int i = 0; i < 8; ++i) {
+					tasks.push_back(ReadMany(testKey, pool, 20));
+				}
+				for(auto& task : tasks) {
+					Assert::IsTrue(task.future.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+					task.future.get();
+				}
+
+				const auto statistics = pool.GetStatistics();
+				Assert::IsTrue(statistics.posted + statistics.rejected == 160);
+				Assert::IsTrue(statistics.maxQueueDepth <= 1);
+			}
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+	};
+}
@@ -1,11 +1,19 @@
 #include "stdafx.h"
 #include "CppUnitTest.h"
 
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
 #include <Registry\Registry.h>
+#include <Registry\RegistryException.h>
+#include <Registry\RegistryFlushScheduler.h>
 #include <Registry\RegistryKey.h>
+#include <Registry\RegistryPathTable.h>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace abscodes::registry;
+using namespace abscodes::registry::Exceptions;
 
 namespace RegistryTests
 {		
@@ -209,5 +217,334 @@ namespace RegistryTests
 			// delete all keys one by one.
 			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
 		}
+
+		TEST_METHOD(Flush)
+		{
+			auto testSettings = CurrentUser().CreateSubKey("TestRegistryKey").CreateSubKey("TestSettings");
+			auto before = RegistryFlushScheduler::Instance().GetStatistics(RegistryHive::CurrentUser);
+
+			// Nothing written, nothing flushed
+			testSettings.Flush();
+			Assert::IsTrue(RegistryFlushScheduler::Instance().GetStatistics(RegistryHive::CurrentUser).flushes == before.flushes);
+
+			testSettings.SetDwordValue("ID", 123);
+			testSettings.Flush();
+			Assert::IsTrue(RegistryFlushScheduler::Instance().GetStatistics(RegistryHive::CurrentUser).flushes == before.flushes + 1);
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(GroupCommit)
+		{
+			CurrentUser().CreateSubKey("TestRegistryKey");
+			auto before = RegistryFlushScheduler::Instance().GetStatistics(RegistryHive::CurrentUser);
+
+			// Concurrent writers share the flushes of the hive
+			std::vector<std::thread> writers;
+			for (int i = 0; i < 8; ++i)
+			{
+				writers.emplace_back([i] {
+					auto key = CurrentUser().OpenSubKey("TestRegistryKey", RegistryAccessRights::AllAccess);
+					key.SetDurability(RegistryDurability::GroupCommit, std::chrono::milliseconds(50));
+					key.SetDwordValue("Writer" + std::to_string(i), i);
+				});
+			}
+			for (auto& writer : writers)
+			{
+				writer.join();
+			}
+
+			auto after = RegistryFlushScheduler::Instance().GetStatistics(RegistryHive::CurrentUser);
+			Assert::IsTrue(after.requests - before.requests == 8);
+			Assert::IsTrue(after.flushes - before.flushes < 8);
+			Assert::IsTrue(after.flushes > before.flushes);
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(CompareExchangeValue)
+		{
+			auto testSettings = CurrentUser().CreateSubKey("TestRegistryKey").CreateSubKey("TestSettings");
+			testSettings.SetDwordValue("Counter", 1);
+
+			RegistryValue expected(RegistryValueType::DWord); expected.DWord() = 2;
+			RegistryValue desired(RegistryValueType::DWord); desired.DWord() = 3;
+
+			// Mismatch: the value is untouched and expected receives the current value
+			Assert::IsFalse(testSettings.CompareExchangeValue("Counter", expected, desired));
+			Assert::IsTrue(expected.DWord() == 1);
+			Assert::IsTrue(testSettings.GetDwordValue("Counter") == 1);
+
+			// Match
+			Assert::IsTrue(testSettings.CompareExchangeValue("Counter", expected, desired));
+			Assert::IsTrue(testSettings.GetDwordValue("Counter") == 3);
+
+			// An empty value stands for a missing value
+			RegistryValue missing;
+			Assert::IsTrue(testSettings.CompareExchangeValue("Created", missing, desired));
+			Assert::IsTrue(testSettings.GetDwordValue("Created") == 3);
+			Assert::IsTrue(testSettings.CompareExchangeValue("Created", desired, RegistryValue()));
+			Assert::IsFalse(HasValue(testSettings, "Created"));
+
+			// Deleting a missing value locks the key too, and leaves no placeholder
+			Assert::IsTrue(testSettings.CompareExchangeValue("Created", missing, RegistryValue()));
+			Assert::IsFalse(HasValue(testSettings, "Created"));
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(CompareExchangeRootValue)
+		{
+			// A value of the hive itself, whose key has no name
+			auto currentUser = CurrentUser();
+			RegistryValue missing;
+			RegistryValue desired(RegistryValueType::DWord); desired.DWord() = 1;
+
+			Assert::IsTrue(currentUser.CompareExchangeValue("TestRegistryKey", missing, desired));
+			Assert::IsTrue(currentUser.GetDwordValue("TestRegistryKey") == 1);
+			Assert::IsFalse(currentUser.CompareExchangeValue("TestRegistryKey", missing, RegistryValue()));
+			Assert::IsTrue(missing.DWord() == 1);
+			Assert::IsTrue(currentUser.CompareExchangeValue("TestRegistryKey", desired, RegistryValue()));
+			Assert::IsFalse(HasValue(currentUser, "TestRegistryKey"));
+		}
+
+		TEST_METHOD(UpdateValueContended)
+		{
+			CurrentUser().CreateSubKey("TestRegistryKey").SetDwordValue("Counter", 0);
+
+			// Concurrent increments, each writer through its own handle
+			std::atomic<int> updated(0);
+			std::vector<std::thread> writers;
+			for (int i = 0; i < 4; ++i)
+			{
+				writers.emplace_back([&updated] {
+					auto key = CurrentUser().OpenSubKey("TestRegistryKey", RegistryAccessRights::AllAccess);
+					for (int j = 0; j < 25; ++j)
+					{
+						bool done = key.UpdateValue("Counter", [](const RegistryValue& current) {
+							RegistryValue next(RegistryValueType::DWord);
+							next.DWord() = current.DWord() + 1;
+							return next;
+						}, 1000);
+						if (done)
+						{
+							++updated;
+						}
+					}
+				});
+			}
+			for (auto& writer : writers)
+			{
+				writer.join();
+			}
+
+			// No increment is lost
+			Assert::IsTrue(updated == 100);
+			Assert::IsTrue(CurrentUser().OpenSubKey("TestRegistryKey").GetDwordValue("Counter") == 100);
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(OpenSubKeyKeepsParent)
+		{
+			auto testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+			testKey.CreateSubKey("TestSettings");
+
+			// The access rights and view are those of the subkey, the parent is left untouched
+			const auto parentAccess = testKey.GetAccessRights();
+			auto readOnly = testKey.OpenSubKey("TestSettings", RegistryAccessRights::Read);
+			Assert::IsTrue(readOnly.GetAccessRights() == RegistryAccessRights::Read);
+			Assert::IsTrue(testKey.GetAccessRights() == parentAccess);
+
+			auto view64 = testKey.OpenSubKey("TestSettings", RegistryView::Registry64, RegistryAccessRights::Read, RegistryOption::None);
+			Assert::IsTrue(view64.GetView() == RegistryView::Registry64);
+			Assert::IsTrue(testKey.GetView() == RegistryView::Default);
+
+			// Only the rights to set a value or create a subkey allow writing
+			Assert::ExpectException<RegistryException>([&] { testKey.CreateSubKey("TestName", RegistryAccessRights::Read); });
+			Assert::IsFalse(HasKey(testKey, "TestName"));
+			Assert::IsTrue(testKey.CreateSubKey("TestName", RegistryAccessRights::SetValue).IsValid());
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(SwapWith)
+		{
+			auto testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+			testKey.CreateSubKey("TestSettings");
+			auto testSettings = testKey.OpenSubKey("TestSettings", RegistryAccessRights::Read);
+
+			const HKEY hTestKey = testKey.Get();
+			const HKEY hTestSettings = testSettings.Get();
+			const auto testKeyName = testKey.GetName();
+			const auto testSettingsName = testSettings.GetName();
+
+			// The metadata follows the handle
+			swap(testKey, testSettings);
+			Assert::IsTrue(testKey.Get() == hTestSettings);
+			Assert::IsTrue(testKey.GetName() == testSettingsName);
+			Assert::IsTrue(testKey.GetAccessRights() == RegistryAccessRights::Read);
+			Assert::IsTrue(testSettings.Get() == hTestKey);
+			Assert::IsTrue(testSettings.GetName() == testKeyName);
+			Assert::IsTrue(testSettings.GetAccessRights() == RegistryAccessRights::AllAccess);
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(InternedNames)
+		{
+			auto testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+			testKey.CreateSubKey("TestSettings");
+
+			// Names differing only by case are equal, each keeps its spelling
+			auto lower = CurrentUser().OpenSubKey("testregistrykey\\testsettings");
+			auto upper = CurrentUser().OpenSubKey("TESTREGISTRYKEY\\TESTSETTINGS");
+			Assert::IsTrue(lower.GetName() == "testregistrykey\\testsettings");
+			Assert::IsTrue(upper.GetName() == "TESTREGISTRYKEY\\TESTSETTINGS");
+			Assert::IsTrue(lower == upper);
+			Assert::IsTrue(std::hash<RegistryKey>()(lower) == std::hash<RegistryKey>()(upper));
+			Assert::IsTrue(lower != testKey);
+
+			// The name is stored once, in the path table
+			auto same = CurrentUser().OpenSubKey("testregistrykey\\testsettings");
+			Assert::IsTrue(same.GetPathId() == lower.GetPathId());
+			Assert::IsTrue(&lower.GetName() == &RegistryPathTable::Instance().GetPath(lower.GetPathId()));
+
+			Assert::IsTrue(sizeof(RegistryKey) <= 40);
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(ReleasedNames)
+		{
+			auto testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+			const size_t count = RegistryPathTable::Instance().GetCount();
+
+			// The path of the last key holding it is freed, so opening keys forever doesn't grow the table
+			for(int i = 0; i < 1000; ++i) {
+				auto subkey = testKey.CreateSubKey("Key" + std::to_string(i));
+				Assert::IsTrue(subkey.GetName() == "TestRegistryKey\\Key" + std::to_string(i));
+			}
+			Assert::IsTrue(RegistryPathTable::Instance().GetCount() == count);
+
+			// A moved key holds the name of the original
+			auto settings = testKey.CreateSubKey("TestSettings");
+			auto moved = std::move(settings);
+			Assert::IsTrue(moved.GetName() == "TestRegistryKey\\TestSettings");
+			Assert::IsTrue(RegistryPathTable::Instance().GetCount() == count + 1);
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(SharedReadStress)
+		{
+			{
+				auto testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+				for (int i = 0; i < 16; ++i)
+				{
+					testKey.CreateSubKey("Sub" + std::to_string(i)).SetDwordValue("ID", i);
+					testKey.SetStringValue("Value" + std::to_string(i), std::to_string(i));
+				}
+			}
+
+			// One handle, read from every thread
+			const RegistryKey shared = CurrentUser().OpenSubKey("TestRegistryKey", RegistryAccessRights::Read);
+
+			std::atomic<int> errors(0);
+			std::vector<std::thread> readers;
+			for (int t = 0; t < 8; ++t)
+			{
+				readers.emplace_back([&shared, &errors, t] {
+					for (int j = 0; j < 200; ++j)
+					{
+						const int i = (t + j) % 16;
+						const auto access = (j % 2) ? RegistryAccessRights::Read : RegistryAccessRights::Query;
+						try
+						{
+							if (shared.GetStringValue("Value" + std::to_string(i)) != std::to_string(i)
+								|| shared.OpenSubKey("Sub" + std::to_string(i), access).GetDwordValue("ID") != static_cast<DWORD>(i)
+								|| shared.GetValueCount() != 16
+								|| shared.EnumSubKeys().size() != 16)
+							{
+								++errors;
+							}
+						}
+						catch (...)
+						{
+							++errors;
+						}
+					}
+				});
+			}
+			for (auto& reader : readers)
+			{
+				reader.join();
+			}
+
+			Assert::IsTrue(errors == 0);
+			Assert::IsTrue(shared.GetAccessRights() == RegistryAccessRights::Read);
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(TypedAccessors)
+		{
+			enum class Color { Red, Green, Blue };
+			struct Point { int x; int y; };
+
+			static_assert(RegistryTypeTraits<int>::Type == RegistryValueType::DWord, "int is a REG_DWORD");
+			static_assert(RegistryTypeTraits<long long>::Type == RegistryValueType::QWord, "long long is a REG_QWORD");
+			static_assert(RegistryTypeTraits<double>::Type == RegistryValueType::Binary, "double is an 8-byte REG_BINARY");
+			static_assert(RegistryTypeTraits<Color>::Type == RegistryValueType::DWord, "enumerations are REG_DWORD");
+			static_assert(RegistryTypeTraits<Point>::Type == RegistryValueType::Binary, "structures are REG_BINARY");
+			static_assert(RegistryTypeTraits<std::string>::Flags == RRF_RT_REG_SZ, "strings are REG_SZ");
+			static_assert(!IsRegistryType<int*>, "pointers are not stored");
+
+			{
+				RegistryKey testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+
+				testKey.Set("Bool", true);
+				testKey.Set("Int", -42);
+				testKey.Set("UInt64", 0x123456789ABCDEF0ull);
+				testKey.Set("Float", 1.5f);
+				testKey.Set("Double", 3.14159);
+				testKey.Set("Color", Color::Blue);
+				testKey.Set("Point", Point {3, 4});
+				testKey.Set("Literal", "text");
+				testKey.Set("String", std::string("string"));
+				testKey.Set("MultiString", std::vector<std::string> {"a", "b"});
+				testKey.Set("Bytes", std::vector<std::byte> {std::byte {1}, std::byte {2}});
+
+				Assert::IsTrue(testKey.Get<bool>("Bool"));
+				Assert::IsTrue(testKey.Get<int>("Int") == -42);
+				Assert::IsTrue(testKey.Get<unsigned long long>("UInt64") == 0x123456789ABCDEF0ull);
+				Assert::IsTrue(testKey.Get<float>("Float") == 1.5f);
+				Assert::IsTrue(testKey.Get<double>("Double") == 3.14159);
+				Assert::IsTrue(testKey.Get<Color>("Color") == Color::Blue);
+				Assert::IsTrue(testKey.Get<Point>("Point").y == 4);
+				Assert::IsTrue(testKey.Get<std::string>("Literal") == "text");
+				Assert::IsTrue(testKey.Get<std::string>("String") == "string");
+				Assert::IsTrue(testKey.Get<std::vector<std::string>>("MultiString").size() == 2);
+				Assert::IsTrue(testKey.Get<std::vector<std::byte>>("Bytes")[1] == std::byte {2});
+
+				// The types are those of the untyped API
+				Assert::IsTrue(testKey.QueryValueType("Int") == REG_DWORD);
+				Assert::IsTrue(testKey.GetDwordValue("Int") == static_cast<DWORD>(-42));
+				Assert::IsTrue(testKey.QueryValueType("Double") == REG_BINARY);
+				Assert::IsTrue(testKey.QueryValueType("Point") == REG_BINARY);
+
+				// Reading another type, or another size of structure, throws
+				Assert::ExpectException<RegistryException>([&] { testKey.Get<int>("String"); });
+				Assert::ExpectException<RegistryException>([&] { testKey.Get<double>("Int"); });
+				Assert::ExpectException<RegistryException>([&] { testKey.Get<Point>("Bytes"); });
+
+				// Free functions fall back on the default value
+				Assert::IsTrue(Get(testKey, "String", 7) == 7);
+				Set(testKey, "Int", 7);
+				Assert::IsTrue(Get(testKey, "Int", 0) == 7);
+			}
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
   };
 }
@@ -0,0 +1,223 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Registry\RegistryException.h"
+#include "Registry\RegistryLogStore.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace abscodes::registry;
+using namespace abscodes::registry::Exceptions;
+
+namespace
+{
+	std::string MakeStoreName(const char* name)
+	{
+		const auto path = std::filesystem::temp_directory_path() / name;
+		std::filesystem::remove(path.u8string() + ".checkpoint");
+		std::filesystem::remove(path.u8string() + ".log");
+		return path.u8string();
+	}
+}
+
+namespace RegistryTests
+{
+	TEST_CLASS(RegistryLogStore_Tests)
+	{
+	public:
+
+		TEST_METHOD(SetAndGet)
+		{
+			const std::string fileName = MakeStoreName("RegistryLogStore_SetAndGet");
+			RegistryLogStore store(fileName);
+
+			store.SetDwordValue("Software\\Settings", "ID", 42);
+			store.SetStringValue("Software\\Settings", "Language", "French");
+			store.SetQwordValue("Software\\Settings\\Fonts", "Size", 12);
+			Assert::IsTrue(store.GetDwordValue("software\\settings", "id") == 42);
+			Assert::IsTrue(store.GetStringValue("Software\\Settings", "Language") == "French");
+			Assert::IsTrue(store.KeyExists("Software"));
+			Assert::IsTrue(store.EnumSubKeys("Software").size() == 1);
+			Assert::IsTrue(store.ReadKey("Software\\Settings").size() == 2);
+
+			store.DeleteValue("Software\\Settings", "Language");
+			Assert::IsFalse(store.HasValue("Software\\Settings", "Language"));
+			Assert::ExpectException<RegistryException>([&] { store.DeleteValue("Software\\Settings", "Language"); });
+			Assert::ExpectException<RegistryException>([&] { store.GetValue("Software\\Missing", "ID"); });
+			Assert::ExpectException<std::invalid_argument>([&] { store.SetValue("Software", "Empty", RegistryValue()); });
+
+			store.DeleteKey("Software\\Settings");
+			Assert::IsFalse(store.KeyExists("Software\\Settings\\Fonts"));
+			Assert::ExpectException<RegistryException>([&] { store.DeleteKey("Software\\Settings"); });
+			Assert::ExpectException<std::invalid_argument>([&] { store.DeleteKey(""); });
+		}
+
+		TEST_METHOD(Replay)
+		{
+			const std::string fileName = MakeStoreName("RegistryLogStore_Replay");
+			{
+				RegistryLogStore store(fileName);
+				for(DWORD i = 0; i < 100; ++i) {
+					store.SetDwordValue("Software\\Key" + std::to_string(i), "ID", i);
+				}
+				store.DeleteKey("Software\\Key0");
+				Assert::IsTrue(store.GetStatistics().commits == 101);
+			}
+
+			RegistryLogStore store(fileName);
+			Assert::IsTrue(store.GetStatistics().replayed == 101);
+			Assert::IsTrue(store.GetDwordValue("Software\\Key42", "ID") == 42);
+			Assert::IsFalse(store.KeyExists("Software\\Key0"));
+			Assert::IsTrue(store.EnumSubKeys("Software").size() == 99);
+		}
+
+		TEST_METHOD(Checkpoint)
+		{
+			const std::string fileName = MakeStoreName("RegistryLogStore_Checkpoint");
+			{
+				RegistryLogStore store(fileName);
+				store.SetStringValue("Software\\Settings", "Language", "French");
+				store.Checkpoint();
+				Assert::IsTrue(store.GetLogSize() == 0);
+				Assert::IsTrue(store.GetStatistics().checkpoints == 1);
+				store.SetStringValue("Software\\Settings", "Language", "English");
+			}
+
+			// The checkpoint, then the records written after it
+			RegistryLogStore store(fileName);
+			Assert::IsTrue(store.GetStatistics().replayed == 1);
+			Assert::IsTrue(store.GetStringValue("Software\\Settings", "Language") == "English");
+		}
+
+		TEST_METHOD(AutomaticCheckpoint)
+		{
+			const std::string fileName = MakeStoreName("RegistryLogStore_AutomaticCheckpoint");
+			RegistryLogStore store(fileName, RegistryDurability::Deferred, 4096);
+			for(DWORD i = 0; i < 1000; ++i) {
+				store.SetDwordValue("Software\\Settings", "ID", i);
+			}
+
+			Assert::IsTrue(store.GetStatistics().checkpoints > 0);
+			Assert::IsTrue(store.GetLogSize() < 4096);
+			Assert::IsTrue(store.GetDwordValue("Software\\Settings", "ID") == 999);
+		}
+
+		TEST_METHOD(CheckpointFailure)
+		{
+			const std::string fileName = MakeStoreName("RegistryLogStore_CheckpointFailure");
+			std::filesystem::create_directory(fileName + ".checkpoint.tmp");
+			{
+				// The records are written, the log is kept
+				RegistryLogStore store(fileName, RegistryDurability::Deferred, 256);
+				for(DWORD i = 0; i < 100; ++i) {
+					store.SetDwordValue("Software\\Settings", "ID", i);
+				}
+				Assert::IsTrue(store.GetStatistics().checkpoints == 0);
+				Assert::IsTrue(store.GetLogSize() > 256);
+				Assert::ExpectException<RegistryException>([&] { store.Checkpoint(); });
+
+				// The error is reported, and the automatic checkpoint is not tried again on every commit
+				Assert::IsTrue(store.GetCheckpointError() != ERROR_SUCCESS);
+				Assert::IsTrue(store.GetStatistics().checkpointFailures > 0);
+				Assert::IsTrue(store.GetStatistics().checkpointFailures < 10);
+
+				// The store is still usable
+				store.SetDwordValue("Software\\Settings", "ID", 100);
+				Assert::IsTrue(store.GetStatistics().commits == 101);
+
+				std::filesystem::remove(fileName + ".checkpoint.tmp");
+				store.Checkpoint();
+				Assert::IsTrue(store.GetCheckpointError() == ERROR_SUCCESS);
+			}
+
+			RegistryLogStore store(fileName);
+			Assert::IsTrue(store.GetDwordValue("Software\\Settings", "ID") == 100);
+		}
+
+		TEST_METHOD(TornRecord)
+		{
+			const std::string fileName = MakeStoreName("RegistryLogStore_TornRecord");
+			unsigned long long logSize = 0;
+			{
+				RegistryLogStore store(fileName);
+				store.SetDwordValue("Software\\Settings", "ID", 1);
+				store.SetDwordValue("Software\\Settings", "ID", 2);
+				logSize = store.GetLogSize();
+			}
+
+			// A record cut by a crash
+			{
+				std::ofstream log(fileName + ".log", std::ios::binary | std::ios::app);
+				const char torn[] = "\x40\x00\x00\x00garbage";
+				log.write(torn, sizeof(torn) - 1);
+			}
+
+			{
+				RegistryLogStore store(fileName);
+				Assert::IsTrue(store.GetStatistics().replayed == 2);
+				Assert::IsTrue(store.GetStatistics().truncated == 11);
+				Assert::IsTrue(store.GetLogSize() == logSize);
+				Assert::IsTrue(store.GetDwordValue("Software\\Settings", "ID") == 2);
+				store.SetDwordValue("Software\\Settings", "ID", 3);
+			}
+
+			// The next records follow the valid ones
+			RegistryLogStore store(fileName);
+			Assert::IsTrue(store.GetStatistics().truncated == 0);
+			Assert::IsTrue(store.GetDwordValue("Software\\Settings", "ID") == 3);
+		}
+
+		TEST_METHOD(Apply)
+		{
+			const std::string fileName = MakeStoreName("RegistryLogStore_Apply");
+			RegistryLogStore store(fileName);
+			store.SetDwordValue("Software\\Settings", "Obsolete", 1);
+
+			RegistryValue id(RegistryValueType::DWord); id.DWord() = 42;
+			RegistryValue font(RegistryValueType::String); font.String() = "Consolas";
+
+			RegistryWriteBatch batch;
+			batch.SetValue("Software\\Settings", "ID", id);
+			batch.SetValue("Software\\Settings\\Fonts", "Name", font);
+			batch.DeleteValue("Software\\Settings", "Obsolete");
+			store.Apply(batch);
+
+			// A single record for the whole batch
+			Assert::IsTrue(store.GetStatistics().commits == 2);
+			Assert::IsTrue(store.GetDwordValue("Software\\Settings", "ID") == 42);
+			Assert::IsTrue(store.GetStringValue("Software\\Settings\\Fonts", "Name") == "Consolas");
+			Assert::IsFalse(store.HasValue("Software\\Settings", "Obsolete"));
+		}
+
+		TEST_METHOD(GroupCommit)
+		{
+			const std::string fileName = MakeStoreName("RegistryLogStore_GroupCommit");
+			RegistryLogStore store(fileName);
+
+			std::vector<std::thread> writers;
+			for(int writer = 0; writer < 8; ++writer) {
+				writers.emplace_back([&store, writer] {
+					for(DWORD i = 0; i < 50; ++i) {
+						store.SetDwordValue("Software\\Writer" + std::to_string(writer), "ID", i);
+					}
+				});
+			}
+			for(auto& writer : writers) {
+				writer.join();
+			}
+
+			// The writers share the writes and the flushes
+			const auto statistics = store.GetStatistics();
+			Assert::IsTrue(statistics.commits == 400);
+			Assert::IsTrue(statistics.writes <= statistics.commits);
+			Assert::IsTrue(statistics.flushes == statistics.writes);
+			Assert::IsTrue(store.GetDwordValue("Software\\Writer7", "ID") == 49);
+		}
+	};
+}
@@ -0,0 +1,110 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <memory_resource>
+#include <string>
+
+#include "Registry\Registry.h"
+#include "Registry\RegistryNameList.h"
+
+#include "CountingResource.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace abscodes::registry;
+
+namespace RegistryTests
+{
+	TEST_CLASS(RegistryNameList_Tests)
+	{
+	public:
+
+		TEST_METHOD(PushBackAndSort)
+		{
+			RegistryNameList names;
+			Assert::IsTrue(names.empty());
+
+			names.PushBack("charlie");
+			names.PushBack("Alpha");
+			names.PushBack("");
+			names.PushBack("bravo");
+			Assert::IsTrue(names.size() == 4);
+			Assert::IsTrue(names[1] == "Alpha");
+			Assert::IsTrue(names.GetArenaSize() == 17);
+
+			// Sorting is case-insensitive, like the registry
+			names.Sort();
+			Assert::IsTrue(names[0] == "");
+			Assert::IsTrue(names[1] == "Alpha");
+			Assert::IsTrue(names[2] == "bravo");
+			Assert::IsTrue(names[3] == "charlie");
+
+			Assert::IsTrue(names.Find("BRAVO") == 2);
+			Assert::IsTrue(names.Find("delta") == names.size());
+
+			auto strings = names.ToVector();
+			Assert::IsTrue(strings.size() == 4);
+			Assert::IsTrue(strings[3] == "charlie");
+
+			size_t count = 0;
+			for (const auto name : names) {
+				Assert::IsTrue(name == names[count++]);
+			}
+			Assert::IsTrue(count == 4);
+
+			names.Clear();
+			Assert::IsTrue(names.empty());
+		}
+
+		TEST_METHOD(CallerArena)
+		{
+			char buffer[1024];
+			std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+
+			// Everything fits in the caller's buffer, or the null resource would throw
+			RegistryNameList names(&arena);
+			names.Reserve(3, 32);
+			names.PushBack("One");
+			names.PushBack("Two");
+			names.PushBack("Three");
+			Assert::IsTrue(names.GetResource() == &arena);
+			Assert::IsTrue(names[2] == "Three");
+		}
+
+		TEST_METHOD(EnumNames)
+		{
+			{
+				RegistryKey testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+
+				CountingResource fewResource;
+				for (int i = 0; i < 10; ++i) {
+					testKey.CreateSubKey("SubKey" + std::to_string(i));
+				}
+				auto few = testKey.EnumSubKeyNames(false, &fewResource);
+				Assert::IsTrue(few.size() == 10);
+
+				CountingResource manyResource;
+				for (int i = 10; i < 1000; ++i) {
+					testKey.CreateSubKey("SubKey" + std::to_string(i));
+				}
+				auto many = testKey.EnumSubKeyNames(true, &manyResource);
+				Assert::IsTrue(many.size() == 1000);
+
+				// The number of allocations does not depend on the number of subkeys
+				Assert::IsTrue(manyResource.allocations == fewResource.allocations);
+				Assert::IsTrue(manyResource.allocations <= 2);
+
+				Assert::IsTrue(many[0] == "SubKey0");
+				Assert::IsTrue(many.Find("subkey999") != many.size());
+
+				testKey.SetDwordValue("ID", 123);
+				testKey.SetStringValue("Name", "Test");
+				auto values = testKey.EnumValueNames(true);
+				Assert::IsTrue(values.size() == 2);
+				Assert::IsTrue(values[0] == "ID");
+				Assert::IsTrue(values[1] == "Name");
+			}
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+	};
+}
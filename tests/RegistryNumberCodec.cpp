@@ -0,0 +1,62 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <limits>
+#include <string_view>
+
+#include "Registry\RegistryNumberCodec.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace abscodes::registry;
+
+namespace RegistryTests
+{
+	TEST_CLASS(RegistryNumberCodec_Tests)
+	{
+	public:
+
+		TEST_METHOD(Format)
+		{
+			char buffer[NumberCodec::BufferSize];
+			Assert::IsTrue(NumberCodec::Format(-10, buffer) == "-10");
+			Assert::IsTrue(NumberCodec::Format(4294967295u, buffer) == "4294967295");
+			Assert::IsTrue(NumberCodec::Format((std::numeric_limits<long long>::min)(), buffer) == "-9223372036854775808");
+
+			// Doubles are written in their shortest round-trip form
+			Assert::IsTrue(NumberCodec::Format(0.1, buffer) == "0.1");
+			Assert::IsTrue(NumberCodec::Format(-2.2250738585072014e-308, buffer) == "-2.2250738585072014e-308");
+		}
+
+		TEST_METHOD(Parse)
+		{
+			int i = 0;
+			Assert::IsTrue(NumberCodec::Parse("-10", i) && i == -10);
+			Assert::IsTrue(NumberCodec::Parse(" +42\r\n", i) && i == 42);
+
+			// Invalid text leaves the value unchanged
+			Assert::IsFalse(NumberCodec::Parse("12a", i));
+			Assert::IsFalse(NumberCodec::Parse("", i));
+			Assert::IsFalse(NumberCodec::Parse("+-1", i));
+			Assert::IsTrue(i == 42);
+
+			unsigned int u = 0;
+			Assert::IsFalse(NumberCodec::Parse("-1", u));
+			Assert::IsFalse(NumberCodec::Parse("4294967296", u));
+			Assert::IsTrue(NumberCodec::Parse("4294967295", u) && u == 4294967295u);
+
+			double d = 0;
+			Assert::IsTrue(NumberCodec::Parse("3.5", d) && d == 3.5);
+			Assert::IsTrue(NumberCodec::Parse("1e-3", d) && d == 1e-3);
+		}
+
+		TEST_METHOD(RoundTrip)
+		{
+			char buffer[NumberCodec::BufferSize];
+			for (double value : { 1.0 / 3, -1e300, 5e-324, 123456.789, (std::numeric_limits<double>::max)() }) {
+				double read = 0;
+				Assert::IsTrue(NumberCodec::Parse(NumberCodec::Format(value, buffer), read));
+				Assert::IsTrue(read == value);
+			}
+		}
+	};
+}
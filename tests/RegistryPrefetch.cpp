@@ -0,0 +1,105 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+
+#include "Registry\Registry.h"
+#include "Registry\RegistryException.h"
+#include "Registry\RegistryPrefetch.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace abscodes::registry;
+using namespace abscodes::registry::Exceptions;
+
+namespace RegistryTests
+{
+	TEST_CLASS(RegistryPrefetch_Tests)
+	{
+	public:
+
+		TEST_METHOD(Profile)
+		{
+			RegistryPrefetchProfile profile;
+			Assert::IsTrue(profile.Add("TestRegistryKey\\TestSettings", "Language"));
+			Assert::IsTrue(profile.Add("TestRegistryKey\\TestSettings", "ID"));
+			Assert::IsFalse(profile.Add("\\testregistrykey\\testsettings\\", "language"));
+			Assert::IsTrue(profile.Add("", "Version"));
+			Assert::IsTrue(profile.GetSize() == 3);
+
+			const auto parsed = RegistryPrefetchProfile::Parse(profile.Serialize());
+			Assert::IsTrue(parsed.GetEntries() == profile.GetEntries());
+
+			const auto fileName = (std::filesystem::temp_directory_path() / "RegistryPrefetch.bin").u8string();
+			profile.Save(fileName);
+			Assert::IsTrue(RegistryPrefetchProfile::Load(fileName).GetEntries() == profile.GetEntries());
+			std::filesystem::remove(fileName);
+
+			Assert::ExpectException<RegistryException>([] { RegistryPrefetchProfile::Parse("Registry"); });
+			Assert::ExpectException<RegistryException>([] { RegistryPrefetchProfile::Parse(std::string("RegistryPrefetch 1\nKey\0Value", 28)); });
+			Assert::ExpectException<RegistryException>([&] { RegistryPrefetchProfile::Load(fileName); });
+		}
+
+		TEST_METHOD(Recorder)
+		{
+			RegistryPrefetchRecorder recorder(std::chrono::minutes(1));
+			Assert::IsTrue(recorder.IsRecording());
+			Assert::IsTrue(recorder.Record("TestSettings", "Language"));
+			Assert::IsTrue(recorder.Record("TestSettings", "Language"));
+			Assert::IsTrue(recorder.GetProfile().GetSize() == 1);
+
+			recorder.Stop();
+			Assert::IsFalse(recorder.IsRecording());
+			Assert::IsFalse(recorder.Record("TestSettings", "ID"));
+
+			RegistryPrefetchRecorder elapsed(std::chrono::milliseconds(0));
+			Assert::IsFalse(elapsed.Record("TestSettings", "ID"));
+		}
+
+		TEST_METHOD(Prefetch)
+		{
+			MemorySettingsStore store;
+			RegistryValue value(RegistryValueType::DWord);
+			for(DWORD i = 0; i < 10; ++i) {
+				value.DWord() = i;
+				store.SetValue("TestKeys\\Key" + std::to_string(i % 3), "Value" + std::to_string(i), value);
+			}
+
+			RegistryIoPool pool(2);
+
+			// The first launch records its reads
+			RegistryPrefetchRecorder recorder(std::chrono::minutes(1));
+			{
+				RegistryPrefetcher prefetcher(store, pool, &recorder);
+				for(DWORD i = 0; i < 10; ++i) {
+					Assert::IsTrue(prefetcher.GetValue("TestKeys\\Key" + std::to_string(i % 3), "Value" + std::to_string(i)).DWord() == i);
+				}
+				Assert::IsTrue(prefetcher.GetStatistics().misses == 10);
+				Assert::IsTrue(prefetcher.GetStatistics().GetHitRate() == 0);
+			}
+
+			// The next one prefetches them, with one read per key
+			const size_t reads = store.GetReadCount();
+			RegistryPrefetcher prefetcher(store, pool);
+			prefetcher.Start(recorder.GetProfile());
+			prefetcher.Wait();
+			Assert::IsTrue(store.GetReadCount() == reads + 3);
+
+			for(DWORD i = 0; i < 10; ++i) {
+				Assert::IsTrue(prefetcher.GetValue("testkeys\\key" + std::to_string(i % 3), "VALUE" + std::to_string(i)).DWord() == i);
+			}
+			Assert::IsTrue(prefetcher.GetValue("TestKeys\\Key0", "Missing").IsEmpty());
+
+			// Only the first read of a value is answered
+			Assert::IsTrue(prefetcher.GetValue("TestKeys\\Key0", "Value0").DWord() == 0);
+
+			const auto statistics = prefetcher.GetStatistics();
+			Assert::IsTrue(statistics.prefetched == 10);
+			Assert::IsTrue(statistics.hits == 10);
+			Assert::IsTrue(statistics.waits == 0);
+			Assert::IsTrue(statistics.misses == 2);
+			Assert::IsTrue(statistics.GetHitRate() > 0.8);
+		}
+	};
+}
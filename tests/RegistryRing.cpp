@@ -0,0 +1,122 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <thread>
+#include <vector>
+
+#include "Registry\Registry.h"
+#include "Registry\RegistryRing.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace abscodes::registry;
+
+namespace RegistryTests
+{
+	TEST_CLASS(RegistryRing_Tests)
+	{
+	public:
+
+		TEST_METHOD(SubmitAndPoll)
+		{
+			{
+				RegistryRing ring(CurrentUser().CreateSubKey("TestRegistryKey"), 16, 8);
+
+				RegistrySubmission set;
+				set.opcode = RegistryOpcode::SetValue;
+				set.userData = 1;
+				set.keyName = "TestSettings";
+				set.valueName = "Language";
+				set.value = RegistryValue(RegistryValueType::String);
+				set.value.String() = "French";
+				ring.Submit(set);
+
+				RegistryCompletion completion = ring.Poll();
+				Assert::IsTrue(completion.userData == 1);
+				Assert::IsTrue(completion.errorCode == ERROR_SUCCESS);
+
+				RegistrySubmission get;
+				get.opcode = RegistryOpcode::GetValue;
+				get.userData = 2;
+				get.keyName = "TestSettings";
+				get.valueName = "Language";
+				ring.Submit(get);
+
+				completion = ring.Poll();
+				Assert::IsTrue(completion.userData == 2);
+				Assert::IsTrue(completion.value.String() == "French");
+
+				// Errors are reported in the completion
+				get.userData = 3;
+				get.valueName = "Missing";
+				ring.Submit(get);
+
+				completion = ring.Poll();
+				Assert::IsTrue(completion.userData == 3);
+				Assert::IsTrue(completion.errorCode == ERROR_FILE_NOT_FOUND);
+
+				RegistrySubmission enumerate;
+				enumerate.opcode = RegistryOpcode::EnumSubKeys;
+				enumerate.userData = 4;
+				ring.Submit(enumerate);
+
+				completion = ring.Poll();
+				Assert::IsTrue(completion.subKeys.size() == 1);
+
+				// The handle opened by the first operation was reused
+				Assert::IsTrue(ring.GetStatistics().handleHits >= 2);
+			}
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(MultipleProducers)
+		{
+			const int producers = 4;
+			const int operations = 256;
+
+			{
+				RegistryRing ring(CurrentUser().CreateSubKey("TestRegistryKey"), 64);
+
+				std::vector<std::thread> threads;
+				for(int p = 0; p < producers; ++p) {
+					threads.emplace_back([&ring, p] {
+						for(int i = 0; i < operations; ++i) {
+							RegistrySubmission set;
+							set.opcode = RegistryOpcode::SetValue;
+							set.userData = static_cast<unsigned long long>(p * operations + i);
+							set.keyName = "Producer" + std::to_string(p);
+							set.valueName = "Value" + std::to_string(i);
+							set.value = RegistryValue(RegistryValueType::DWord);
+							set.value.DWord() = i;
+							ring.Submit(set);
+						}
+					});
+				}
+
+				// Consume while producing, the completion ring is smaller than the job
+				std::vector<bool> seen(producers * operations, false);
+				for(int i = 0; i < producers * operations; ++i) {
+					RegistryCompletion completion = ring.Poll();
+					Assert::IsTrue(completion.errorCode == ERROR_SUCCESS);
+					Assert::IsFalse(seen[static_cast<size_t>(completion.userData)]);
+					seen[static_cast<size_t>(completion.userData)] = true;
+				}
+
+				for(auto& thread : threads) {
+					thread.join();
+				}
+
+				const auto statistics = ring.GetStatistics();
+				Assert::IsTrue(statistics.submitted == producers * operations);
+				Assert::IsTrue(statistics.completed == producers * operations);
+				Assert::IsTrue(statistics.handleMisses <= statistics.batches * producers);
+			}
+
+			auto testKey = CurrentUser().OpenSubKey("TestRegistryKey");
+			Assert::IsTrue(testKey.OpenSubKey("Producer3").GetDwordValue("Value255") == 255);
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+	};
+}
@@ -0,0 +1,248 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <string>
+#include <vector>
+
+#include "Registry\Registry.h"
+#include "Registry\RegistrySettings.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace abscodes::registry;
+
+namespace
+{
+	enum class Theme { Light, Dark };
+
+	struct Point {
+		int x;
+		int y;
+
+		bool operator==(const Point& other) const { return x == other.x && y == other.y; }
+	};
+
+	struct Options {
+		DWORD width = 0;
+		DWORD height = 0;
+		bool maximized = false;
+		Theme theme = Theme::Light;
+		double zoom = 0;
+		ULONGLONG cacheSize = 0;
+		Point origin {};
+		std::string title;
+		std::vector<std::string> recentFiles;
+		std::vector<BYTE> layout;
+	};
+}
+
+namespace RegistryTests
+{
+	TEST_CLASS(RegistrySettings_Tests)
+	{
+	public:
+
+		TEST_METHOD(Defaults)
+		{
+			RegistrySchema<Options> schema;
+			schema.Bind("Window", "Width", &Options::width, DWORD(800))
+				.Bind("Window", "Height", &Options::height, DWORD(600))
+				.Bind("Window", "Maximized", &Options::maximized)
+				.Bind("Window", "Origin", &Options::origin, Point { 10, 20 })
+				.Bind("Window", "Layout", &Options::layout)
+				.Bind("Appearance", "Theme", &Options::theme, Theme::Dark)
+				.Bind("Appearance", "Zoom", &Options::zoom, 1.0)
+				.Bind("Appearance", "Title", &Options::title, std::string("Untitled"))
+				.Bind("", "CacheSize", &Options::cacheSize, ULONGLONG(1) << 32)
+				.Bind("\\Window\\", "RecentFiles", &Options::recentFiles);
+			Assert::IsTrue(schema.GetFieldCount() == 10);
+			Assert::IsTrue(schema.GetKeyCount() == 3);
+
+			MemorySettingsStore store;
+			RegistryBinder<Options> binder(schema, store);
+
+			// The defaults are set without reading the store
+			Assert::IsTrue(store.GetReadCount() == 0);
+			Assert::IsTrue(binder.Get().width == 800);
+			Assert::IsTrue(binder.Get().theme == Theme::Dark);
+			Assert::IsTrue(binder.Get().origin.y == 20);
+			Assert::IsTrue(binder.Get().title == "Untitled");
+			Assert::IsFalse(binder.IsDirty());
+
+			// Loading an empty store keeps them, reading each key once
+			binder.Load();
+			Assert::IsTrue(store.GetReadCount() == 3);
+			Assert::IsTrue(binder.Get().zoom == 1.0);
+			Assert::IsTrue(binder.Get().cacheSize == ULONGLONG(1) << 32);
+		}
+
+		TEST_METHOD(LoadAndSave)
+		{
+			RegistrySchema<Options> schema;
+			schema.Bind("Window", "Width", &Options::width, DWORD(800))
+				.Bind("Window", "Height", &Options::height, DWORD(600))
+				.Bind("Window", "Maximized", &Options::maximized)
+				.Bind("Window", "Origin", &Options::origin, Point { 10, 20 })
+				.Bind("Window", "Layout", &Options::layout)
+				.Bind("Appearance", "Theme", &Options::theme, Theme::Dark)
+				.Bind("Appearance", "Zoom", &Options::zoom, 1.0)
+				.Bind("Appearance", "Title", &Options::title, std::string("Untitled"))
+				.Bind("", "CacheSize", &Options::cacheSize, ULONGLONG(1) << 32)
+				.Bind("\\Window\\", "RecentFiles", &Options::recentFiles);
+			MemorySettingsStore store;
+
+			RegistryValue width(RegistryValueType::DWord);
+			width.DWord() = 1024;
+			store.SetValue("Window", "Width", width);
+			RegistryValue title(RegistryValueType::String);
+			title.String() = "Document";
+			store.SetValue("appearance", "TITLE", title);
+
+			// A value of another type gets the default
+			RegistryValue zoom(RegistryValueType::String);
+			zoom.String() = "2.0";
+			store.SetValue("Appearance", "Zoom", zoom);
+
+			RegistryBinder<Options> binder(schema, store);
+			const Options& options = binder.Load();
+			Assert::IsTrue(options.width == 1024);
+			Assert::IsTrue(options.height == 600);
+			Assert::IsTrue(options.title == "Document");
+			Assert::IsTrue(options.zoom == 1.0);
+
+			// Only the modified members are written
+			binder.Get().height = 768;
+			binder.Get().origin = Point { 1, 2 };
+			binder.Get().recentFiles = { "a.txt", "b.txt" };
+			Assert::IsTrue(binder.GetDirtyCount() == 3);
+
+			Assert::IsTrue(binder.Save().empty());
+			Assert::IsTrue(store.GetWriteCount() == 3);
+			Assert::IsFalse(binder.IsDirty());
+			Assert::IsTrue(store.GetValue("Window", "Height").DWord() == 768);
+			Assert::IsTrue(store.GetValue("Window", "Origin").Binary().size() == sizeof(Point));
+			Assert::IsTrue(store.GetValue("Window", "RecentFiles").MultiString().size() == 2);
+
+			// Nothing to write
+			Assert::IsTrue(binder.Save().empty());
+			Assert::IsTrue(store.GetWriteCount() == 3);
+
+			// Another binder reads back the same settings
+			RegistryBinder<Options> other(schema, store);
+			other.Load();
+			Assert::IsTrue(other.Get().height == 768);
+			Assert::IsTrue(other.Get().origin.x == 1);
+			Assert::IsTrue(other.Get().recentFiles[1] == "b.txt");
+
+			// Reverting discards the modifications
+			binder.Get().width = 1;
+			binder.Revert();
+			Assert::IsTrue(binder.Get().width == 1024);
+		}
+
+		TEST_METHOD(RegistryStore)
+		{
+			{
+				RegistryKey testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+				testKey.CreateSubKey("Window").SetDwordValue("Width", 1280);
+
+				RegistrySchema<Options> schema;
+				schema.Bind("Window", "Width", &Options::width, DWORD(800))
+					.Bind("Window", "Height", &Options::height, DWORD(600))
+					.Bind("Window", "Maximized", &Options::maximized)
+					.Bind("Window", "Origin", &Options::origin, Point { 10, 20 })
+					.Bind("Window", "Layout", &Options::layout)
+					.Bind("Appearance", "Theme", &Options::theme, Theme::Dark)
+					.Bind("Appearance", "Zoom", &Options::zoom, 1.0)
+					.Bind("Appearance", "Title", &Options::title, std::string("Untitled"))
+					.Bind("", "CacheSize", &Options::cacheSize, ULONGLONG(1) << 32)
+					.Bind("\\Window\\", "RecentFiles", &Options::recentFiles);
+				RegistryKeyStore store(testKey);
+				RegistryBinder<Options> binder(schema, store);
+
+				// The Appearance key is missing: its members get their defaults
+				binder.Load();
+				Assert::IsTrue(store.GetReadCount() == 3);
+				Assert::IsTrue(binder.Get().width == 1280);
+				Assert::IsTrue(binder.Get().height == 600);
+				Assert::IsTrue(binder.Get().title == "Untitled");
+
+				binder.Get().title = "Saved";
+				binder.Get().layout = { 1, 2, 3 };
+				Assert::IsTrue(binder.Save().empty());
+				Assert::IsTrue(testKey.OpenSubKey("Appearance").GetStringValue("Title") == "Saved");
+
+				RegistryBinder<Options> other(schema, store);
+				other.Load();
+				Assert::IsTrue(other.Get().title == "Saved");
+				Assert::IsTrue(other.Get().layout.size() == 3);
+			}
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(UndecodableValues)
+		{
+			{
+				RegistryKey testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+				testKey.CreateSubKey("Window").SetDwordValue("Height", 1024);
+
+				// Values the library never writes: a REG_NONE, and a REG_DWORD of 3 bytes
+				const BYTE data[] = { 1, 2, 3 };
+				Assert::IsTrue(::RegSetKeyValueW(HKEY_CURRENT_USER, L"TestRegistryKey\\Window", L"Maximized", REG_NONE, data, sizeof(data)) == ERROR_SUCCESS);
+				Assert::IsTrue(::RegSetKeyValueW(HKEY_CURRENT_USER, L"TestRegistryKey\\Window", L"Width", REG_DWORD, data, sizeof(data)) == ERROR_SUCCESS);
+
+				const auto values = testKey.OpenSubKey("Window").GetValues({ "Width", "Maximized", "Height" });
+				Assert::IsTrue(values[0].IsEmpty());
+				Assert::IsTrue(values[1].IsEmpty());
+				Assert::IsTrue(values[2].DWord() == 1024);
+
+				// Through the read of each value, when another one is missing
+				Assert::IsTrue(testKey.OpenSubKey("Window").GetValues({ "Width", "Missing" })[0].IsEmpty());
+
+				// The members get their defaults, the others are loaded
+				RegistrySchema<Options> schema;
+				schema.Bind("Window", "Width", &Options::width, DWORD(800))
+					.Bind("Window", "Height", &Options::height, DWORD(600))
+					.Bind("Window", "Maximized", &Options::maximized)
+					.Bind("Window", "Origin", &Options::origin, Point { 10, 20 })
+					.Bind("Window", "Layout", &Options::layout)
+					.Bind("Appearance", "Theme", &Options::theme, Theme::Dark)
+					.Bind("Appearance", "Zoom", &Options::zoom, 1.0)
+					.Bind("Appearance", "Title", &Options::title, std::string("Untitled"))
+					.Bind("", "CacheSize", &Options::cacheSize, ULONGLONG(1) << 32)
+					.Bind("\\Window\\", "RecentFiles", &Options::recentFiles);
+				RegistryKeyStore store(testKey);
+				RegistryBinder<Options> binder(schema, store);
+				binder.Load();
+				Assert::IsTrue(binder.Get().width == 800);
+				Assert::IsFalse(binder.Get().maximized);
+				Assert::IsTrue(binder.Get().height == 1024);
+			}
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(GetValues)
+		{
+			{
+				RegistryKey testKey = CurrentUser().CreateSubKey("TestRegistryKey");
+				testKey.SetDwordValue("DWord", 123);
+				testKey.SetStringValue("String", "Text");
+				testKey.SetMultiStringValue("MultiString", { "First", "Second" });
+
+				auto values = testKey.GetValues({ "String", "DWord", "MultiString" });
+				Assert::IsTrue(values.size() == 3);
+				Assert::IsTrue(values[0].String() == "Text");
+				Assert::IsTrue(values[1].DWord() == 123);
+				Assert::IsTrue(values[2].MultiString()[1] == "Second");
+
+				// A missing value is empty
+				values = testKey.GetValues({ "DWord", "Missing" });
+				Assert::IsTrue(values[0].DWord() == 123);
+				Assert::IsTrue(values[1].IsEmpty());
+			}
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+	};
+}
@@ -0,0 +1,112 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Registry\Registry.h"
+#include "Registry\RegistryException.h"
+#include "Registry\RegistrySharedSnapshot.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace abscodes::registry;
+using namespace abscodes::registry::Exceptions;
+
+namespace
+{
+	RegistrySnapshotBuilder MakeBuilder(DWORD id)
+	{
+		RegistryValue value(RegistryValueType::DWord); value.DWord() = id;
+		RegistrySnapshotBuilder builder;
+		builder.SetValue("TestSettings", "ID", value);
+		return builder;
+	}
+}
+
+namespace RegistryTests
+{
+	TEST_CLASS(RegistrySharedSnapshot_Tests)
+	{
+	public:
+
+		TEST_METHOD(Publish)
+		{
+			std::vector<uint64_t> memory(RegistrySharedPublisher::GetSegmentSize(4096) / 8);
+			RegistrySharedPublisher publisher(memory.data(), memory.size() * 8);
+			Assert::IsTrue(publisher.GetCapacity() == 4096);
+			Assert::IsTrue(publisher.GetVersion() == 0);
+
+			RegistrySharedReader reader(memory.data(), memory.size() * 8);
+			Assert::IsFalse(reader.Refresh());
+			Assert::IsTrue(reader.GetSnapshotVersion() == 0);
+
+			publisher.Publish(MakeBuilder(1));
+			Assert::IsTrue(reader.GetVersion() == 1);
+			Assert::IsTrue(reader.Refresh());
+			Assert::IsTrue(reader.OpenKey("TestSettings").GetDwordValue("ID") == 1);
+
+			// Nothing new, nothing is copied
+			Assert::IsFalse(reader.Refresh());
+
+			// The copy is kept until the next refresh, whatever the publisher writes
+			publisher.Publish(MakeBuilder(2));
+			publisher.Publish(MakeBuilder(3));
+			auto settings = reader.OpenKey("TestSettings");
+			Assert::IsTrue(settings.GetDwordValue("ID") == 1);
+
+			// Keys of the previous image keep reading it
+			Assert::IsTrue(reader.Refresh());
+			Assert::IsTrue(reader.GetSnapshotVersion() == 3);
+			Assert::IsTrue(reader.OpenKey("TestSettings").GetDwordValue("ID") == 3);
+			Assert::IsTrue(settings.GetDwordValue("ID") == 1);
+			Assert::IsTrue(reader.GetRetryCount() == 0);
+		}
+
+		TEST_METHOD(Invalid)
+		{
+			std::vector<uint64_t> memory(RegistrySharedPublisher::GetSegmentSize(64) / 8);
+			Assert::ExpectException<std::invalid_argument>([&] { RegistrySharedPublisher(memory.data(), 8); });
+			Assert::ExpectException<RegistryException>([&] { RegistrySharedReader(memory.data(), memory.size() * 8); });
+
+			RegistrySharedPublisher publisher(memory.data(), memory.size() * 8);
+			Assert::ExpectException<std::length_error>([&] { publisher.Publish(std::vector<BYTE>(65)); });
+			Assert::IsTrue(publisher.GetVersion() == 0);
+
+			// The reader checks the size of the region against the header
+			Assert::ExpectException<RegistryException>([&] { RegistrySharedReader(memory.data(), memory.size() * 8 - 8); });
+		}
+
+		TEST_METHOD(Named)
+		{
+			auto testSettings = CurrentUser().CreateSubKey("TestRegistryKey").CreateSubKey("TestSettings");
+			testSettings.SetStringValue("Language", "French");
+
+			const std::string name = "Local\\TestRegistrySharedSnapshot";
+			Assert::ExpectException<RegistryException>([&] { RegistrySharedReader reader(name); });
+
+			auto publisher = std::make_unique<RegistrySharedPublisher>(name, 1 << 16);
+			publisher->Publish(CurrentUser().OpenSubKey("TestRegistryKey"));
+
+			RegistrySharedReader reader(name);
+			Assert::IsTrue(reader.Refresh());
+			Assert::IsTrue(reader.OpenKey("TestSettings").GetStringValue("Language") == "French");
+
+			// A restarted publisher reuses the segment held by the reader, and carries on its versions
+			publisher.reset();
+			Assert::ExpectException<RegistryException>([&] { RegistrySharedPublisher larger(name, 1 << 20); });
+			publisher = std::make_unique<RegistrySharedPublisher>(name, 1 << 16);
+			Assert::IsTrue(publisher->GetVersion() == 1);
+
+			testSettings.SetStringValue("Language", "English");
+			publisher->Publish(CurrentUser().OpenSubKey("TestRegistryKey"));
+			Assert::IsTrue(reader.Refresh());
+			Assert::IsTrue(reader.GetSnapshotVersion() == 2);
+			Assert::IsTrue(reader.OpenKey("TestSettings").GetStringValue("Language") == "English");
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+	};
+}
@@ -0,0 +1,191 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Registry\Registry.h"
+#include "Registry\RegistryException.h"
+#include "Registry\RegistrySnapshot.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace abscodes::registry;
+using namespace abscodes::registry::Exceptions;
+
+namespace
+{
+	/// Copy an image into 8-byte aligned memory
+	std::vector<uint64_t> Aligned(const std::vector<BYTE>& image)
+	{
+		std::vector<uint64_t> memory((image.size() + 7) / 8);
+		std::memcpy(memory.data(), image.data(), image.size());
+		return memory;
+	}
+}
+
+namespace RegistryTests
+{
+	TEST_CLASS(RegistrySnapshot_Tests)
+	{
+	public:
+
+		TEST_METHOD(Values)
+		{
+			RegistryValue id(RegistryValueType::DWord); id.DWord() = 123;
+			RegistryValue size(RegistryValueType::QWord); size.QWord() = ULONGLONG(1) << 40;
+			RegistryValue language(RegistryValueType::String); language.String() = "French";
+			RegistryValue path(RegistryValueType::ExpandString); path.ExpandString() = "%TEMP%\\Registry";
+			RegistryValue files(RegistryValueType::MultiString); files.MultiString() = { "One", "", "Three" };
+			RegistryValue layout(RegistryValueType::Binary); layout.Binary() = { 1, 2, 3 };
+
+			RegistrySnapshotBuilder builder;
+			builder.SetValue("TestSettings", "ID", id);
+			builder.SetValue("TestSettings", "Size", size);
+			builder.SetValue("TestSettings", "Language", language);
+			builder.SetValue("TestSettings", "Path", path);
+			builder.SetValue("TestSettings", "Files", files);
+			builder.SetValue("TestSettings", "Layout", layout);
+			Assert::IsTrue(builder.GetKeyCount() == 2);
+			Assert::IsTrue(builder.GetValueCount() == 6);
+
+			const auto image = builder.Build();
+			const auto memory = Aligned(image);
+			RegistrySnapshot snapshot(memory.data(), image.size());
+			Assert::IsTrue(snapshot.GetKeyCount() == 2);
+			Assert::IsTrue(snapshot.GetValueCount() == 6);
+
+			auto settings = snapshot.OpenKey("TestSettings");
+			Assert::IsTrue(settings.GetValueCount() == 6);
+			Assert::IsTrue(settings.GetDwordValue("ID") == 123);
+			Assert::IsTrue(settings.GetQwordValue("Size") == ULONGLONG(1) << 40);
+			Assert::IsTrue(settings.GetStringValue("Language") == "French");
+			Assert::IsTrue(settings.GetExpandStringValue("Path") == "%TEMP%\\Registry");
+			Assert::IsTrue(settings.GetBinaryValue("Layout") == layout.Binary());
+
+			const auto texts = settings.GetMultiStringValue("Files");
+			Assert::IsTrue(texts.size() == 3);
+			Assert::IsTrue(texts[0] == "One" && texts[1].empty() && texts[2] == "Three");
+			Assert::IsTrue(settings.GetValue("Files").MultiString() == files.MultiString());
+
+			Assert::IsTrue(settings.QueryValueType("Language") == REG_SZ);
+			Assert::IsTrue(settings.GetData("ID").size == sizeof(DWORD));
+
+			// Typed getters check the type, and missing values are reported
+			Assert::ExpectException<RegistryException>([&] { settings.GetStringValue("ID"); });
+			Assert::ExpectException<RegistryException>([&] { settings.GetDwordValue("Missing"); });
+			Assert::IsFalse(settings.HasValue("Missing"));
+		}
+
+		TEST_METHOD(Lookups)
+		{
+			RegistryValue one(RegistryValueType::DWord); one.DWord() = 1;
+
+			RegistrySnapshotBuilder builder;
+			for(DWORD i = 0; i < 100; ++i) {
+				one.DWord() = i;
+				builder.SetValue("TestKeys\\Key" + std::to_string(i % 10), "Value" + std::to_string(i), one);
+			}
+			builder.AddKey("TestName\\Empty");
+
+			const auto image = builder.Build();
+			const auto memory = Aligned(image);
+			RegistrySnapshot snapshot(memory.data(), image.size());
+
+			// Paths are normalized and compared without case
+			for(DWORD i = 0; i < 100; ++i) {
+				auto key = snapshot.OpenKey("\\testkeys\\KEY" + std::to_string(i % 10) + "\\");
+				Assert::IsTrue(key.GetDwordValue("VALUE" + std::to_string(i)) == i);
+			}
+
+			auto keys = snapshot.Root().OpenSubKey("TestKeys");
+			Assert::IsTrue(keys.GetName() == "TestKeys");
+			Assert::IsTrue(keys.GetSubKeyCount() == 10);
+			Assert::IsTrue(keys.EnumSubKeys().size() == 10);
+			Assert::IsTrue(keys.GetSubKey(0).GetValueCount() == 10);
+			Assert::IsTrue(keys.OpenSubKey("Key3").EnumValues().size() == 10);
+
+			Assert::IsTrue(snapshot.OpenKey("TestName\\Empty").GetValueCount() == 0);
+			Assert::IsFalse(snapshot.Root().FindSubKey("TestKeys\\Key10").IsValid());
+			Assert::ExpectException<RegistryException>([&] { snapshot.OpenKey("Missing"); });
+		}
+
+		TEST_METHOD(Invalid)
+		{
+			RegistryValue id(RegistryValueType::DWord); id.DWord() = 123;
+
+			RegistrySnapshotBuilder builder;
+			builder.SetValue("TestSettings", "ID", id);
+
+			const auto image = builder.Build();
+			auto memory = Aligned(image);
+
+			// A truncated or corrupted image is rejected
+			Assert::ExpectException<RegistryException>([&] { RegistrySnapshot(memory.data(), image.size() - 8); });
+			reinterpret_cast<BYTE*>(memory.data())[16] ^= 1;
+			Assert::ExpectException<RegistryException>([&] { RegistrySnapshot(memory.data(), image.size()); });
+
+			RegistrySnapshot empty;
+			Assert::IsFalse(empty.IsValid());
+			Assert::ExpectException<RegistryException>([&] { empty.Root(); });
+		}
+
+		TEST_METHOD(SharedImage)
+		{
+			RegistryValue language(RegistryValueType::String); language.String() = "French";
+
+			RegistrySnapshotBuilder builder;
+			builder.SetValue("TestSettings", "Language", language);
+
+			const auto image = builder.Build();
+			auto memory = std::make_shared<std::vector<uint64_t>>(Aligned(image));
+			std::shared_ptr<const BYTE> data(memory, reinterpret_cast<const BYTE*>(memory->data()));
+			memory.reset();
+
+			SnapshotKey settings;
+			{
+				RegistrySnapshot snapshot(std::move(data), image.size());
+				settings = snapshot.OpenKey("TestSettings");
+
+				// Keys remain valid when their snapshot is moved
+				RegistrySnapshot moved(std::move(snapshot));
+				Assert::IsFalse(snapshot.IsValid());
+				Assert::IsTrue(settings.GetStringValue("Language") == "French");
+				Assert::IsTrue(moved.OpenKey("TestSettings").HasValue("Language"));
+			}
+
+			// The image is kept alive by the key once the snapshot is gone
+			Assert::IsTrue(settings.IsValid());
+			Assert::IsTrue(settings.GetStringValue("Language") == "French");
+		}
+
+		TEST_METHOD(SaveOpen)
+		{
+			auto testSettings = CurrentUser().CreateSubKey("TestRegistryKey").CreateSubKey("TestSettings");
+			testSettings.SetStringValue("Language", "French");
+			testSettings.SetDwordValue("ID", 123);
+			CurrentUser().CreateSubKey("TestRegistryKey\\TestName");
+
+			RegistrySnapshotBuilder builder;
+			builder.AddTree(CurrentUser().OpenSubKey("TestRegistryKey"), "TestRegistryKey");
+			Assert::IsTrue(builder.GetKeyCount() == 4);
+
+			const auto fileName = (std::filesystem::temp_directory_path() / "RegistrySnapshot.bin").u8string();
+			builder.Save(fileName);
+
+			{
+				auto snapshot = RegistrySnapshot::Open(fileName);
+				auto settings = snapshot.OpenKey("TestRegistryKey\\TestSettings");
+				Assert::IsTrue(settings.GetStringValue("Language") == "French");
+				Assert::IsTrue(settings.GetDwordValue("ID") == 123);
+				Assert::IsTrue(snapshot.OpenKey("TestRegistryKey").GetSubKeyCount() == 2);
+			}
+
+			std::filesystem::remove(fileName);
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+	};
+}
@@ -0,0 +1,101 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "Registry\Registry.h"
+#include "Registry\RegistryException.h"
+#include "Registry\RegistryTransaction.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace abscodes::registry;
+using namespace abscodes::registry::Exceptions;
+
+namespace RegistryTests
+{
+	TEST_CLASS(RegistryTransaction_Tests)
+	{
+	public:
+
+		TEST_METHOD(Commit)
+		{
+			auto currentUser = CurrentUser();
+
+			RegistryTransaction transaction;
+			Assert::IsTrue(transaction.IsActive());
+
+			auto testSettings = transaction.CreateKey(RegistryHive::CurrentUser, "TestRegistryKey\\TestSettings");
+			Assert::IsTrue(testSettings.IsTransacted());
+			testSettings.SetStringValue("Language", "French");
+
+			auto testName = transaction.CreateKey(RegistryHive::CurrentUser, "TestRegistryKey").CreateSubKey("TestName");
+			Assert::IsTrue(testName.IsTransacted());
+			testName.SetDwordValue("ID", 123);
+
+			// Nothing is visible outside of the transaction before commit
+			Assert::IsFalse(HasKey(currentUser, "TestRegistryKey"));
+
+			transaction.Commit();
+			Assert::IsFalse(transaction.IsActive());
+
+			Assert::IsTrue(CurrentUser().OpenSubKey("TestRegistryKey\\TestSettings").GetStringValue("Language") == "French");
+			Assert::IsTrue(CurrentUser().OpenSubKey("TestRegistryKey\\TestName").GetDwordValue("ID") == 123);
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(Rollback)
+		{
+			auto currentUser = CurrentUser();
+
+			{
+				RegistryTransaction transaction;
+				transaction.CreateKey(RegistryHive::CurrentUser, "TestRegistryKey\\TestSettings").SetStringValue("Language", "French");
+				transaction.Rollback();
+				Assert::ExpectException<RegistryException>([&] { transaction.Commit(); });
+			}
+			Assert::IsFalse(HasKey(currentUser, "TestRegistryKey"));
+
+			// An uncommitted transaction is rolled back on destruction
+			{
+				RegistryTransaction transaction;
+				transaction.CreateKey(RegistryHive::CurrentUser, "TestRegistryKey\\TestSettings").SetStringValue("Language", "French");
+			}
+			Assert::IsFalse(HasKey(currentUser, "TestRegistryKey"));
+		}
+
+		TEST_METHOD(DeleteTransacted)
+		{
+			auto currentUser = CurrentUser();
+			CurrentUser().CreateSubKey("TestRegistryKey").CreateSubKey("TestName");
+
+			RegistryTransaction transaction;
+			transaction.OpenKey(RegistryHive::CurrentUser, "TestRegistryKey").DeleteSubKey("TestName");
+			Assert::IsTrue(HasKey(currentUser, "TestRegistryKey\\TestName"));
+
+			transaction.Commit();
+			Assert::IsFalse(HasKey(currentUser, "TestRegistryKey\\TestName"));
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(KeysOutliveTransaction)
+		{
+			RegistryKey testSettings;
+			{
+				RegistryTransaction transaction;
+				testSettings = transaction.CreateKey(RegistryHive::CurrentUser, "TestRegistryKey\\TestSettings");
+				transaction.Commit();
+			}
+
+			// The key still holds the handle of the ended transaction
+			Assert::ExpectException<RegistryException>([&] { testSettings.SetStringValue("Language", "French"); });
+
+			// The root key of the hive, created or opened
+			RegistryTransaction transaction;
+			Assert::IsTrue(transaction.CreateKey(RegistryHive::CurrentUser, "").IsTransacted());
+			Assert::IsTrue(transaction.OpenKey(RegistryHive::CurrentUser, "").IsTransacted());
+			transaction.Rollback();
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+	};
+}
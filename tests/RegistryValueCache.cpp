@@ -0,0 +1,120 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "Registry\Registry.h"
+#include "Registry\RegistryException.h"
+#include "Registry\RegistryValueCache.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace abscodes::registry;
+using namespace abscodes::registry::Exceptions;
+
+namespace RegistryTests
+{
+	TEST_CLASS(RegistryValueCache_Tests)
+	{
+	public:
+
+		TEST_METHOD(WarmStart)
+		{
+			RegistryValue id(RegistryValueType::DWord); id.DWord() = 123;
+			RegistryValue language(RegistryValueType::String); language.String() = "French";
+
+			MemoryCacheSource source;
+			source.SetValue("TestSettings", "ID", id);
+			source.SetValue("TestName", "Language", language);
+			const std::vector<std::string> keyNames = { "TestSettings", "TestName", "Missing" };
+
+			// A cold start reads every existing key
+			std::vector<BYTE> image;
+			{
+				RegistryValueCache cache(source, keyNames);
+				Assert::IsTrue(cache.GetKeyCount() == 3);
+				Assert::IsTrue(cache.Load(RegistrySnapshot()) == 2);
+				Assert::IsTrue(cache.GetValue("testsettings", "id").DWord() == 123);
+				image = cache.Build();
+			}
+
+			std::vector<uint64_t> memory((image.size() + 7) / 8);
+			std::memcpy(memory.data(), image.data(), image.size());
+			RegistrySnapshot snapshot(memory.data(), image.size());
+
+			// A warm start only queries the last write times
+			{
+				const size_t reads = source.GetReadCount();
+				const size_t queries = source.GetQueryCount();
+
+				RegistryValueCache cache(source, keyNames);
+				Assert::IsTrue(cache.Load(snapshot) == 0);
+				Assert::IsTrue(source.GetReadCount() == reads);
+				Assert::IsTrue(source.GetQueryCount() == queries + 3);
+				Assert::IsTrue(cache.GetValue("TestName", "Language").String() == "French");
+				Assert::IsFalse(cache.HasValue("Missing", "ID"));
+				Assert::ExpectException<RegistryException>([&] { cache.GetValue("Undeclared", "ID"); });
+			}
+
+			// Only the keys changed since are read again
+			language.String() = "English";
+			source.SetValue("TestName", "Language", language);
+			source.DeleteKey("TestSettings");
+			{
+				RegistryValueCache cache(source, keyNames);
+				Assert::IsTrue(cache.Load(snapshot) == 1);
+				Assert::IsTrue(cache.GetValue("TestName", "Language").String() == "English");
+				Assert::IsFalse(cache.HasValue("TestSettings", "ID"));
+			}
+		}
+
+		TEST_METHOD(Refresh)
+		{
+			RegistryValue id(RegistryValueType::DWord); id.DWord() = 123;
+
+			MemoryCacheSource source;
+			source.SetValue("TestSettings", "ID", id);
+
+			RegistryValueCache cache(source, { "TestSettings", "TestName" });
+			Assert::IsTrue(cache.Refresh() == 1);
+			Assert::IsTrue(cache.Refresh() == 0);
+
+			id.DWord() = 456;
+			source.SetValue("TestName", "ID", id);
+			Assert::IsTrue(cache.Refresh() == 1);
+			Assert::IsTrue(cache.GetValue("TestName", "ID").DWord() == 456);
+			Assert::IsTrue(cache.GetValue("TestSettings", "ID").DWord() == 123);
+		}
+
+		TEST_METHOD(SaveLoad)
+		{
+			auto root = CurrentUser().CreateSubKey("TestRegistryKey");
+			auto testSettings = root.CreateSubKey("TestSettings");
+			testSettings.SetStringValue("Language", "French");
+			testSettings.SetDwordValue("ID", 123);
+
+			const auto fileName = (std::filesystem::temp_directory_path() / "RegistryValueCache.bin").u8string();
+			std::filesystem::remove(fileName);
+
+			RegistryKeyCacheSource source(root);
+			{
+				// No file yet, the cache starts cold
+				RegistryValueCache cache(source, { "TestSettings", "TestName" });
+				Assert::IsTrue(cache.Load(fileName) == 1);
+				Assert::IsTrue(cache.GetValue("TestSettings", "Language").String() == "French");
+				cache.Save(fileName);
+			}
+			{
+				RegistryValueCache cache(source, { "TestSettings", "TestName" });
+				Assert::IsTrue(cache.Load(fileName) == 0);
+				Assert::IsTrue(cache.GetValue("TestSettings", "ID").DWord() == 123);
+			}
+
+			std::filesystem::remove(fileName);
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+	};
+}
@@ -0,0 +1,91 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "Registry\Registry.h"
+#include "Registry\RegistryException.h"
+#include "Registry\RegistryWriteBatch.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace abscodes::registry;
+using namespace abscodes::registry::Exceptions;
+
+namespace RegistryTests
+{
+	TEST_CLASS(RegistryWriteBatch_Tests)
+	{
+	public:
+
+		TEST_METHOD(Coalesce)
+		{
+			RegistryValue one(RegistryValueType::DWord); one.DWord() = 1;
+			RegistryValue two(RegistryValueType::DWord); two.DWord() = 2;
+
+			RegistryWriteBatch batch;
+			Assert::IsTrue(batch.IsEmpty());
+
+			batch.SetValue("TestRegistryKey\\TestSettings", "ID", one);
+			batch.SetValue("TestRegistryKey\\\\TestSettings\\", "id", two);
+			batch.SetValue("testregistrykey\\testsettings", "Level", one);
+			batch.SetValue("TestRegistryKey", "ID", one);
+
+			Assert::IsTrue(batch.GetSubmittedCount() == 4);
+			Assert::IsTrue(batch.GetOperationCount() == 3);
+			Assert::IsTrue(batch.GetKeyCount() == 2);
+
+			batch.Clear();
+			Assert::IsTrue(batch.IsEmpty());
+			Assert::IsTrue(batch.GetOperationCount() == 0);
+		}
+
+		TEST_METHOD(ReadYourWrites)
+		{
+			auto testSettings = CurrentUser().CreateSubKey("TestRegistryKey").CreateSubKey("TestSettings");
+			testSettings.SetStringValue("Language", "French");
+			testSettings.SetStringValue("Level", "Intermediate");
+
+			auto root = CurrentUser().OpenSubKey("TestRegistryKey");
+
+			RegistryValue language(RegistryValueType::String); language.String() = "English";
+
+			RegistryWriteBatch batch;
+			batch.SetValue("TestSettings", "Language", language);
+			batch.DeleteValue("TestSettings", "Level");
+
+			// Pending values are seen through the batch, not through the key
+			Assert::IsTrue(batch.GetValue(root, "TestSettings", "Language").String() == "English");
+			Assert::IsTrue(testSettings.GetStringValue("Language") == "French");
+			Assert::ExpectException<RegistryException>([&] { batch.GetValue(root, "TestSettings", "Level"); });
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(Commit)
+		{
+			auto root = CurrentUser().CreateSubKey("TestRegistryKey");
+
+			RegistryValue id(RegistryValueType::DWord); id.DWord() = 123;
+			RegistryValue language(RegistryValueType::String); language.String() = "French";
+
+			RegistryWriteBatch batch;
+			batch.SetValue("TestSettings", "ID", id);
+			batch.SetValue("TestSettings", "Language", language);
+			batch.SetValue("TestName", "Language", language);
+			batch.SetValue("", "Language", language);
+			batch.DeleteValue("TestName", "Missing");
+			batch.DeleteValue("MissingKey", "ID");
+
+			auto failures = batch.Commit(root);
+			Assert::IsTrue(batch.IsEmpty());
+
+			// Deleting a missing value succeeds, and doesn't create its key
+			Assert::IsTrue(failures.empty());
+			Assert::ExpectException<RegistryException>([&] { root.OpenSubKey("MissingKey"); });
+
+			Assert::IsTrue(root.GetStringValue("Language") == "French");
+			Assert::IsTrue(root.OpenSubKey("TestSettings").GetDwordValue("ID") == 123);
+			Assert::IsTrue(root.OpenSubKey("TestName").GetStringValue("Language") == "French");
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+	};
+}
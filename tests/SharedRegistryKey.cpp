@@ -0,0 +1,98 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <thread>
+#include <vector>
+
+#include "Registry\Registry.h"
+#include "Registry\RegistryException.h"
+#include "Registry\SharedRegistryKey.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace abscodes::registry;
+using namespace abscodes::registry::Exceptions;
+
+namespace RegistryTests
+{
+	TEST_CLASS(SharedRegistryKey_Tests)
+	{
+	public:
+
+		TEST_METHOD(Copies)
+		{
+			{
+				SharedRegistryKey empty;
+				Assert::IsFalse(empty.IsValid());
+				Assert::IsTrue(empty.GetUseCount() == 0);
+				Assert::ExpectException<RegistryException>([&] { empty->GetName(); });
+
+				SharedRegistryKey testKey(CurrentUser().CreateSubKey("TestRegistryKey"));
+				testKey.SetDwordValue("ID", 123);
+				Assert::IsTrue(testKey.GetUseCount() == 1);
+
+				SharedRegistryKey copy = testKey;
+				Assert::IsTrue(testKey.GetUseCount() == 2);
+				Assert::IsTrue(copy == testKey);
+
+				// Copies share the handle and the metadata
+				Assert::IsTrue(copy->Get() == testKey->Get());
+				Assert::IsTrue(copy->GetName() == testKey->GetName());
+				Assert::IsTrue(copy->GetDwordValue("ID") == 123);
+
+				// The handle stays open while a copy is alive
+				testKey.Reset();
+				Assert::IsFalse(testKey.IsValid());
+				Assert::IsTrue(copy.GetUseCount() == 1);
+				Assert::IsTrue(copy->GetDwordValue("ID") == 123);
+
+				SharedRegistryKey moved = std::move(copy);
+				Assert::IsTrue(moved.GetUseCount() == 1);
+				Assert::IsFalse(copy.IsValid());
+
+				SharedRegistryKey created = moved.CreateSubKey("TestSettings");
+				created.SetStringValue("Language", "French");
+				SharedRegistryKey sub = moved.OpenSubKey("TestSettings");
+				Assert::IsTrue(sub.IsValid());
+				Assert::IsTrue(sub != moved);
+				Assert::IsTrue(sub->GetStringValue("Language") == "French");
+
+				// The writes keep the handle alive, and fail on an empty key
+				created.DeleteValue("Language");
+				Assert::IsFalse(HasValue(*sub, "Language"));
+				Assert::ExpectException<RegistryException>([&] { empty.SetDwordValue("ID", 1); });
+			}
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+		TEST_METHOD(ConcurrentCopies)
+		{
+			{
+				SharedRegistryKey testKey(CurrentUser().CreateSubKey("TestRegistryKey"));
+				testKey.SetDwordValue("ID", 123);
+
+				std::vector<std::thread> threads;
+				for (int t = 0; t < 8; ++t)
+				{
+					threads.emplace_back([testKey] {
+						for (int i = 0; i < 1000; ++i)
+						{
+							SharedRegistryKey copy = testKey;
+							Assert::IsTrue(copy->GetDwordValue("ID") == 123);
+						}
+					});
+				}
+				for (auto& thread : threads)
+				{
+					thread.join();
+				}
+
+				// Every copy has been released
+				Assert::IsTrue(testKey.GetUseCount() == 1);
+			}
+
+			CurrentUser().DeleteSubKeyTree("TestRegistryKey");
+		}
+
+	};
+}